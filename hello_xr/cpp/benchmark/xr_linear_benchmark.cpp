@@ -0,0 +1,138 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+// Times XrMatrix4x4f_CreateModelViewProjectionBatch against what the graphics plugins do per cube,
+// XrMatrix4x4f_CreateTranslationRotationScale and XrMatrix4x4f_Multiply, on random transforms, and checks how far the
+// two results are apart.
+//
+// Usage: xr_linear_benchmark [<instances> [<repetitions>]]
+
+#include "pch.h"
+#include "common.h"
+
+#include <common/xr_linear.h>
+#include <utils/nanoseconds.h>
+
+#include <random>
+
+namespace {
+struct Instance {
+    XrPosef Pose;
+    XrVector3f Scale;
+};
+
+std::vector<Instance> MakeInstances(uint32_t count) {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.01f, 2.0f);
+    std::vector<Instance> instances(count);
+    for (Instance& instance : instances) {
+        XrQuaternionf& q = instance.Pose.orientation;
+        q = {unit(random), unit(random), unit(random), unit(random)};
+        const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        q = {q.x / length, q.y / length, q.z / length, q.w / length};
+        instance.Pose.position = {unit(random) * 10.0f, unit(random) * 10.0f, unit(random) * 10.0f - 10.0f};
+        instance.Scale = {scale(random), scale(random), scale(random)};
+    }
+    return instances;
+}
+
+XrMatrix4x4f MakeViewProjection() {
+    const XrFovf fov{-0.8f, 0.7f, 0.75f, -0.85f};
+    XrMatrix4x4f proj;
+    XrMatrix4x4f_CreateProjectionFov(&proj, GRAPHICS_VULKAN, fov, 0.05f, 100.0f);
+    const XrPosef pose{{0.0f, 0.2588190f, 0.0f, 0.9659258f}, {0.1f, 1.6f, 0.3f}};
+    XrMatrix4x4f toView;
+    XrVector3f scale{1.f, 1.f, 1.f};
+    XrMatrix4x4f_CreateTranslationRotationScale(&toView, &pose.position, &pose.orientation, &scale);
+    XrMatrix4x4f view;
+    XrMatrix4x4f_InvertRigidBody(&view, &toView);
+    XrMatrix4x4f vp;
+    XrMatrix4x4f_Multiply(&vp, &proj, &view);
+    return vp;
+}
+
+// Distance between two floats in units in the last place; zeros of either sign are equal.
+uint32_t UlpDistance(float a, float b) {
+    const auto ordered = [](float value) {
+        int32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits < 0 ? INT32_MIN - bits : bits;
+    };
+    const int64_t distance = (int64_t)ordered(a) - ordered(b);
+    return (uint32_t)std::min<int64_t>(distance < 0 ? -distance : distance, UINT32_MAX);
+}
+
+// Fastest of the repetitions, in nanoseconds per instance.
+template <typename Function>
+double Time(uint32_t instanceCount, uint32_t repetitions, const Function& function) {
+    uint64_t best = UINT64_MAX;
+    for (uint32_t i = 0; i < repetitions; i++) {
+        const uint64_t start = GetTimeNanoseconds();
+        function();
+        best = std::min<uint64_t>(best, GetTimeNanoseconds() - start);
+    }
+    return (double)best / instanceCount;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const uint32_t instanceCount = argc > 1 ? (uint32_t)std::stoul(argv[1]) : 100000;
+    const uint32_t repetitions = argc > 2 ? (uint32_t)std::stoul(argv[2]) : 50;
+    if (instanceCount == 0 || repetitions == 0) {
+        Log::Write(Log::Level::Error, "Usage: xr_linear_benchmark [<instances> [<repetitions>]]");
+        return 1;
+    }
+
+    const std::vector<Instance> instances = MakeInstances(instanceCount);
+    const XrMatrix4x4f vp = MakeViewProjection();
+    std::vector<XrMatrix4x4f> scalar(instanceCount);
+    std::vector<XrMatrix4x4f> batch(instanceCount);
+
+    const double scalarNs = Time(instanceCount, repetitions, [&] {
+        for (uint32_t i = 0; i < instanceCount; i++) {
+            const Instance& instance = instances[i];
+            XrMatrix4x4f model;
+            XrMatrix4x4f_CreateTranslationRotationScale(&model, &instance.Pose.position, &instance.Pose.orientation,
+                                                        &instance.Scale);
+            XrMatrix4x4f_Multiply(&scalar[i], &vp, &model);
+        }
+    });
+    const double batchNs = Time(instanceCount, repetitions, [&] {
+        XrMatrix4x4f_CreateModelViewProjectionBatch(batch.data(), &vp, &instances[0].Pose, sizeof(Instance),
+                                                    &instances[0].Scale, sizeof(Instance), instanceCount);
+    });
+
+    // An element computed with different rounding can differ by many ULPs of itself when its terms cancel, so also
+    // measure differences in ULPs of the largest element of the column.
+    uint32_t maxUlps = 0;
+    double maxColumnUlps = 0;
+    uint64_t differing = 0;
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        for (uint32_t column = 0; column < 4; column++) {
+            const float* expected = &scalar[i].m[column * 4];
+            const float* actual = &batch[i].m[column * 4];
+            float largest = 0;
+            for (uint32_t row = 0; row < 4; row++) {
+                largest = std::max(largest, std::abs(expected[row]));
+            }
+            const float columnUlp = std::nextafter(largest, INFINITY) - largest;
+            for (uint32_t row = 0; row < 4; row++) {
+                const uint32_t ulps = UlpDistance(expected[row], actual[row]);
+                maxUlps = std::max(maxUlps, ulps);
+                maxColumnUlps = std::max(maxColumnUlps, std::abs((double)expected[row] - actual[row]) / columnUlp);
+                differing += ulps != 0 ? 1 : 0;
+            }
+        }
+    }
+
+    Log::Write(Log::Level::Info, Fmt("xr_linear %s, %u lanes: %u instances, best of %u runs", XR_LINEAR_SIMD_NAME,
+                                     XR_LINEAR_SIMD_WIDTH, instanceCount, repetitions));
+    Log::Write(Log::Level::Info, Fmt("  scalar %.2fns per instance, batch %.2fns per instance, %.2fx", scalarNs, batchNs,
+                                     scalarNs / batchNs));
+    Log::Write(Log::Level::Info, Fmt("  %llu of %llu elements differ, by at most %u ULP, %.2f ULP of the column's largest element",
+                                     (unsigned long long)differing, (unsigned long long)instanceCount * 16, maxUlps,
+                                     maxColumnUlps));
+    return 0;
+}
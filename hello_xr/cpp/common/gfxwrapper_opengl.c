@@ -540,6 +540,7 @@ PFNGLUNIFORMMATRIX4X3FVPROC glUniformMatrix4x3fv;
 PFNGLUNIFORMMATRIX4FVPROC glUniformMatrix4fv;
 
 PFNGLDRAWELEMENTSINSTANCEDPROC glDrawElementsInstanced;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glMultiDrawElementsIndirect;
 PFNGLDISPATCHCOMPUTEPROC glDispatchCompute;
 PFNGLMEMORYBARRIERPROC glMemoryBarrier;
 
@@ -694,6 +695,7 @@ void GlInitExtensions() {
     glShaderStorageBlockBinding = (PFNGLSHADERSTORAGEBLOCKBINDINGPROC)GetExtension("glShaderStorageBlockBinding");
 
     glDrawElementsInstanced = (PFNGLDRAWELEMENTSINSTANCEDPROC)GetExtension("glDrawElementsInstanced");
+    glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)GetExtension("glMultiDrawElementsIndirect");
     glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)GetExtension("glDispatchCompute");
     glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)GetExtension("glMemoryBarrier");
 
@@ -1838,6 +1840,8 @@ bool ksGpuContext_CheckCurrent(ksGpuContext *context) {
 #endif
 }
 
+bool ksGpuContext_HasExtension(const char *extension) { return GlCheckExtension(extension); }
+
 static void ksGpuContext_GetLimits(ksGpuContext *context, ksGpuLimits *limits) {
     UNUSED_PARM(context);
 
@@ -585,6 +585,7 @@ extern PFNGLUNIFORMMATRIX4X3FVPROC glUniformMatrix4x3fv;
 extern PFNGLUNIFORMMATRIX4FVPROC glUniformMatrix4fv;
 
 extern PFNGLDRAWELEMENTSINSTANCEDPROC glDrawElementsInstanced;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glMultiDrawElementsIndirect;
 extern PFNGLDISPATCHCOMPUTEPROC glDispatchCompute;
 extern PFNGLMEMORYBARRIERPROC glMemoryBarrier;
 
@@ -894,6 +895,7 @@ void ksGpuContext_WaitIdle(ksGpuContext *context);
 void ksGpuContext_SetCurrent(ksGpuContext *context);
 void ksGpuContext_UnsetCurrent(ksGpuContext *context);
 bool ksGpuContext_CheckCurrent(ksGpuContext *context);
+bool ksGpuContext_HasExtension(const char *extension);  // Queries the current context.
 
 /*
 ================================================================================================================================
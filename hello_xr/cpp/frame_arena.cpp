@@ -0,0 +1,95 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "frame_arena.h"
+
+#include <cstdlib>
+#include <new>
+
+void LinearArena::Reserve(size_t capacity) {
+    CHECK_MSG(m_offset == 0, "LinearArena must be reset before it is resized");
+    m_storage.resize(capacity);
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment) {
+    const uintptr_t base = reinterpret_cast<uintptr_t>(m_storage.data());
+    const uintptr_t alignedAddress = (base + m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    const size_t alignedOffset = (size_t)(alignedAddress - base);
+
+    if (alignedOffset + size > m_storage.size()) {
+        m_highWater += size + alignment;
+        return nullptr;
+    }
+
+    m_offset = alignedOffset + size;
+    m_highWater = std::max(m_highWater, m_offset);
+    return reinterpret_cast<void*>(alignedAddress);
+}
+
+FrameArena::FrameArena(size_t capacityPerFrame) : m_arenas{{LinearArena(capacityPerFrame), LinearArena(capacityPerFrame)}} {}
+
+void FrameArena::BeginFrame() {
+    m_current = (m_current + 1) % m_arenas.size();
+    LinearArena& arena = m_arenas[m_current];
+
+    const size_t highWater = arena.HighWater();
+    arena.Reset();
+    if (highWater > arena.Capacity()) {
+        // Grow with headroom so a slowly growing scene does not reallocate every frame.
+        const size_t newCapacity = highWater + highWater / 2;
+        Log::Write(Log::Level::Warning, Fmt("Frame arena overflowed (%zu of %zu bytes), growing to %zu bytes", highWater,
+                                            arena.Capacity(), newCapacity));
+        arena.Reserve(newCapacity);
+    }
+}
+
+#if defined(HELLOXR_TRACK_ALLOCATIONS)
+
+namespace {
+thread_local bool g_trackingScope = false;
+thread_local uint64_t g_scopeAllocations = 0;
+
+void* TrackedAllocate(size_t size) {
+    if (g_trackingScope) {
+        g_scopeAllocations++;
+    }
+    if (void* p = std::malloc(size != 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+}  // namespace
+
+void* operator new(size_t size) { return TrackedAllocate(size); }
+void* operator new[](size_t size) { return TrackedAllocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace AllocationTracker {
+void BeginScope() {
+    g_scopeAllocations = 0;
+    g_trackingScope = true;
+}
+
+uint64_t EndScope() {
+    g_trackingScope = false;
+    return g_scopeAllocations;
+}
+
+bool IsEnabled() { return true; }
+}  // namespace AllocationTracker
+
+#else
+
+namespace AllocationTracker {
+void BeginScope() {}
+uint64_t EndScope() { return 0; }
+bool IsEnabled() { return false; }
+}  // namespace AllocationTracker
+
+#endif
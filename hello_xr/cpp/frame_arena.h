@@ -0,0 +1,105 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+// Linear allocator for data that only lives for one frame. Memory is reserved up front and handed out by bumping an
+// offset; individual allocations are never freed, the whole arena is rewound by Reset().
+struct LinearArena {
+    explicit LinearArena(size_t capacity = 0) { Reserve(capacity); }
+
+    void Reserve(size_t capacity);
+    void Reset() {
+        m_offset = 0;
+        m_highWater = 0;
+    }
+
+    // Returns null if the arena is exhausted, so the caller can fall back to the heap.
+    void* Allocate(size_t size, size_t alignment);
+
+    size_t Capacity() const { return m_storage.size(); }
+    size_t Used() const { return m_offset; }
+    // Bytes that would have been used since the last Reset had every request fit.
+    size_t HighWater() const { return m_highWater; }
+
+    bool Contains(const void* p) const {
+        const uint8_t* bytes = static_cast<const uint8_t*>(p);
+        return !m_storage.empty() && bytes >= m_storage.data() && bytes < m_storage.data() + m_storage.size();
+    }
+
+   private:
+    std::vector<uint8_t> m_storage;
+    size_t m_offset{0};
+    size_t m_highWater{0};
+};
+
+// Two linear arenas used alternately, one per frame. Data allocated for frame N is still valid while frame N+1 is being
+// built, so a frame that is in flight while the next one starts is never overwritten.
+struct FrameArena {
+    explicit FrameArena(size_t capacityPerFrame);
+
+    // Switch to the other arena and rewind it. Call once at the start of each frame. If that arena overflowed into the
+    // heap last time it was used it is grown here, while none of its data is live.
+    void BeginFrame();
+
+    LinearArena& Current() { return m_arenas[m_current]; }
+
+   private:
+    std::array<LinearArena, 2> m_arenas;
+    uint32_t m_current{0};
+};
+
+// std::allocator-compatible adapter so standard containers can draw from a LinearArena. Deallocation is a no-op for arena
+// memory; requests that do not fit fall back to the heap (and are freed normally) rather than failing.
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    explicit ArenaAllocator(LinearArena& arena) : m_arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.m_arena) {}
+
+    T* allocate(size_t n) {
+        void* p = m_arena->Allocate(n * sizeof(T), alignof(T));
+        return p != nullptr ? static_cast<T*>(p) : std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (!m_arena->Contains(p)) {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return m_arena == other.m_arena;
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return m_arena != other.m_arena;
+    }
+
+   private:
+    template <typename U>
+    friend struct ArenaAllocator;
+
+    LinearArena* m_arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Debug aid: counts heap allocations made by the current thread while a scope is open. Only active when the build
+// replaces the global operator new, which frame_arena.cpp does if HELLOXR_TRACK_ALLOCATIONS is defined (the
+// HELLO_XR_TRACK_ALLOCATIONS CMake option or the track_allocations meson option, both off by default); otherwise the
+// count is always zero.
+
+namespace AllocationTracker {
+void BeginScope();
+// Ends the scope and returns how many allocations the thread made inside it.
+uint64_t EndScope();
+bool IsEnabled();
+}  // namespace AllocationTracker
@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "frame_benchmark.h"
+
+namespace {
+#ifdef XR_USE_PLATFORM_WIN32
+uint64_t FileTimeToNanoseconds(const FILETIME& fileTime) {
+    // FILETIME counts 100ns intervals.
+    return ((uint64_t)fileTime.dwHighDateTime << 32 | fileTime.dwLowDateTime) * 100;
+}
+#else
+uint64_t ClockNanoseconds(clockid_t clock) {
+    timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+#endif
+}  // namespace
+
+FrameBenchmark::Sample FrameBenchmark::Now() {
+    Sample sample;
+    sample.wall = GetTimeNanoseconds();
+#ifdef XR_USE_PLATFORM_WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    sample.threadCpu = FileTimeToNanoseconds(kernel) + FileTimeToNanoseconds(user);
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    sample.processCpu = FileTimeToNanoseconds(kernel) + FileTimeToNanoseconds(user);
+#else
+    sample.threadCpu = ClockNanoseconds(CLOCK_THREAD_CPUTIME_ID);
+    sample.processCpu = ClockNanoseconds(CLOCK_PROCESS_CPUTIME_ID);
+#endif
+    return sample;
+}
+
+void FrameBenchmark::BeginFrame() {
+    if (!IsEnabled() || m_done) {
+        return;
+    }
+    if (m_framesSeen == WarmupFrames) {
+        Log::Write(Log::Level::Info, Fmt("Benchmark: measuring %u frames", m_frames));
+    }
+    m_frameStart = Now();
+}
+
+bool FrameBenchmark::EndFrame() {
+    if (!IsEnabled() || m_done) {
+        return false;
+    }
+    const Sample end = Now();
+    if (m_framesSeen++ < WarmupFrames) {
+        return false;
+    }
+
+    const Sample frame{end.wall - m_frameStart.wall, end.threadCpu - m_frameStart.threadCpu,
+                       end.processCpu - m_frameStart.processCpu};
+    m_wall.Add(frame.wall);
+    m_threadCpu.Add(frame.threadCpu);
+    m_processCpu.Add(frame.processCpu);
+    m_total.wall += frame.wall;
+    m_total.threadCpu += frame.threadCpu;
+    m_total.processCpu += frame.processCpu;
+
+    if (m_framesSeen - WarmupFrames < m_frames) {
+        return false;
+    }
+    LogReport();
+    m_done = true;
+    return true;
+}
+
+void FrameBenchmark::LogReport() {
+    const auto logLine = [&](const char* name, LatencyHistogram& histogram, uint64_t total) {
+        const LatencyHistogram::Summary summary = histogram.TakeSummary();
+        Log::Write(Log::Level::Info, Fmt("Benchmark: %-12s mean=%.3fms p50=%.3fms p95=%.3fms p99=%.3fms max=%.3fms", name,
+                                         total * 1e-6 / m_frames, summary.p50 * 1e-6, summary.p95 * 1e-6, summary.p99 * 1e-6,
+                                         summary.max * 1e-6));
+    };
+    Log::Write(Log::Level::Info, Fmt("Benchmark: %u frames in %.3fs", m_frames, m_total.wall * 1e-9));
+    logLine("Wall", m_wall, m_total.wall);
+    logLine("Thread CPU", m_threadCpu, m_total.threadCpu);
+    logLine("Process CPU", m_processCpu, m_total.processCpu);
+    // How many cores the process kept busy on average, e.g. to see what the job system's workers add.
+    const double cores = m_total.wall > 0 ? (double)m_total.processCpu / m_total.wall : 0.0;
+    Log::Write(Log::Level::Info, Fmt("Benchmark: process CPU / wall = %.2f", cores));
+}
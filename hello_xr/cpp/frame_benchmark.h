@@ -0,0 +1,48 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+#include "frame_stats.h"
+
+// What the frame loop costs the CPU per frame. After WarmupFrames frames, measures the given number of iterations of the
+// loop: wall time, CPU time of the thread running the loop, and CPU time of the whole process, which includes the job
+// system's workers and the runtime's threads. Then logs percentiles and means of each.
+//
+// Run against the mock runtime with HELLO_XR_MOCK_REFRESH_RATE=0 and xrWaitFrame never blocks, so the wall time is the
+// loop's own cost as well; at a real refresh rate it is the frame period.
+struct FrameBenchmark {
+    static constexpr uint32_t WarmupFrames = 60;
+
+    // With 0 frames nothing is measured.
+    explicit FrameBenchmark(uint32_t frames) : m_frames(frames) {}
+
+    bool IsEnabled() const { return m_frames > 0; }
+
+    // Bracket one iteration of the frame loop, on the thread that runs it. EndFrame returns true once the last frame was
+    // measured and the report logged.
+    void BeginFrame();
+    bool EndFrame();
+
+   private:
+    struct Sample {
+        uint64_t wall;
+        uint64_t threadCpu;
+        uint64_t processCpu;
+    };
+
+    static Sample Now();
+    void LogReport();
+
+    const uint32_t m_frames;
+    uint32_t m_framesSeen{0};
+    bool m_done{false};
+    Sample m_frameStart{};
+    // Sums of the measured frames, for the means.
+    Sample m_total{};
+    LatencyHistogram m_wall;
+    LatencyHistogram m_threadCpu;
+    LatencyHistogram m_processCpu;
+};
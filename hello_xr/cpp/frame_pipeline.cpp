@@ -0,0 +1,232 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "frame_pipeline.h"
+#include "trace.h"
+
+#include <utils/nanoseconds.h>
+
+void FramePipeline::StageTiming::Add(uint64_t ns) {
+    totalNs += ns;
+    count++;
+    uint64_t prevMax = maxNs.load();
+    while (ns > prevMax && !maxNs.compare_exchange_weak(prevMax, ns)) {
+    }
+}
+
+void FramePipeline::StageTiming::Reset() {
+    totalNs = 0;
+    maxNs = 0;
+    count = 0;
+}
+
+FramePipeline::FramePipeline(WaitFunction wait, SimulateFunction simulate)
+    : m_wait(std::move(wait)), m_simulate(std::move(simulate)) {
+    m_freePackets.reserve(PacketCount);
+}
+
+FramePipeline::~FramePipeline() {
+    // Stop() must have been called by the owner while the session was still running; this is a last resort so the
+    // threads are not left joinable.
+    if (m_pacingThread.joinable() || m_simulationThread.joinable()) {
+        Stop([](FramePacket&) {});
+    }
+}
+
+void FramePipeline::Start() {
+    CHECK(!m_running);
+
+    m_freePackets.clear();
+    for (int32_t i = PacketCount - 1; i >= 0; i--) {
+        m_freePackets.push_back(i);
+    }
+    m_waitedPacket = NoPacket;
+    m_simulatedPacket = NoPacket;
+    m_stopping = false;
+    m_pacingDone = false;
+    m_simulationDone = false;
+    m_error = nullptr;
+    for (StageTiming& timing : m_timings) {
+        timing.Reset();
+    }
+
+    m_running = true;
+    m_pacingThread = std::thread(&FramePipeline::PacingThread, this);
+    m_simulationThread = std::thread(&FramePipeline::SimulationThread, this);
+}
+
+void FramePipeline::Stop(const DiscardFunction& discard) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_cv.notify_all();
+
+    // Drain frames that already passed xrWaitFrame. The pacing thread may be blocked in xrWaitFrame until the previous
+    // frame is begun, so the stage threads cannot finish without this.
+    for (;;) {
+        m_cv.wait(lock, [&] {
+            return (m_pacingDone && m_simulationDone) || m_simulatedPacket != NoPacket ||
+                   (m_simulationDone && m_waitedPacket != NoPacket);
+        });
+
+        int32_t index = m_simulatedPacket;
+        if (index != NoPacket) {
+            m_simulatedPacket = NoPacket;
+        } else if (m_simulationDone && m_waitedPacket != NoPacket) {
+            index = m_waitedPacket;
+            m_waitedPacket = NoPacket;
+        } else {
+            break;
+        }
+
+        m_cv.notify_all();
+        lock.unlock();
+        try {
+            discard(m_packets[index]);
+        } catch (...) {
+            // The session is going away; keep draining so the threads can be joined.
+        }
+        lock.lock();
+        m_freePackets.push_back(index);
+        m_cv.notify_all();
+    }
+    lock.unlock();
+
+    if (m_pacingThread.joinable()) {
+        m_pacingThread.join();
+    }
+    if (m_simulationThread.joinable()) {
+        m_simulationThread.join();
+    }
+    m_running = false;
+}
+
+FramePacket* FramePipeline::AcquireFrame() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&] { return m_simulatedPacket != NoPacket || m_stopping; });
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+    if (m_simulatedPacket == NoPacket) {
+        return nullptr;
+    }
+
+    FramePacket* packet = &m_packets[m_simulatedPacket];
+    m_simulatedPacket = NoPacket;
+    m_cv.notify_all();
+    return packet;
+}
+
+void FramePipeline::ReleaseFrame(FramePacket* packet) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freePackets.push_back(static_cast<int32_t>(packet - m_packets.data()));
+    m_cv.notify_all();
+}
+
+void FramePipeline::Fail() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_error) {
+        m_error = std::current_exception();
+    }
+    m_stopping = true;
+    m_cv.notify_all();
+}
+
+void FramePipeline::PacingThread() {
+    TRACE_THREAD_NAME("Pacing");
+    try {
+        for (;;) {
+            int32_t index;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [&] { return !m_freePackets.empty() || m_stopping; });
+                if (m_stopping) {
+                    break;
+                }
+                index = m_freePackets.back();
+                m_freePackets.pop_back();
+            }
+
+            FramePacket& packet = m_packets[index];
+            packet.frameState = {XR_TYPE_FRAME_STATE};
+            const ksNanoseconds waitStart = GetTimeNanoseconds();
+            m_wait(packet.frameState);
+            m_timings[Wait].Add(GetTimeNanoseconds() - waitStart);
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Hand the frame on even when stopping: it has been waited on, so it must be begun and ended.
+            m_cv.wait(lock, [&] { return m_waitedPacket == NoPacket; });
+            m_waitedPacket = index;
+            m_cv.notify_all();
+        }
+    } catch (...) {
+        Fail();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pacingDone = true;
+    m_cv.notify_all();
+}
+
+void FramePipeline::SimulationThread() {
+    TRACE_THREAD_NAME("Simulation");
+    try {
+        for (;;) {
+            int32_t index;
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [&] { return m_waitedPacket != NoPacket || m_pacingDone; });
+                if (m_waitedPacket == NoPacket) {
+                    break;
+                }
+                index = m_waitedPacket;
+                m_waitedPacket = NoPacket;
+                stopping = m_stopping;
+                m_cv.notify_all();
+            }
+
+            FramePacket& packet = m_packets[index];
+            packet.cubes.clear();
+            if (!stopping) {
+                const ksNanoseconds simulateStart = GetTimeNanoseconds();
+                try {
+                    m_simulate(packet);
+                } catch (...) {
+                    // The frame has been waited on, so it still has to reach the render stage to be ended.
+                    packet.cubes.clear();
+                    Fail();
+                }
+                m_timings[Simulate].Add(GetTimeNanoseconds() - simulateStart);
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_simulatedPacket == NoPacket; });
+            m_simulatedPacket = index;
+            m_cv.notify_all();
+        }
+    } catch (...) {
+        Fail();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_simulationDone = true;
+    m_cv.notify_all();
+}
+
+void FramePipeline::LogTimings() {
+    static const char* const stageNames[StageCount] = {"Wait", "Simulate", "Render"};
+
+    std::string line;
+    for (uint32_t i = 0; i < StageCount; i++) {
+        StageTiming& timing = m_timings[i];
+        const uint64_t count = timing.count.exchange(0);
+        const uint64_t totalNs = timing.totalNs.exchange(0);
+        const uint64_t maxNs = timing.maxNs.exchange(0);
+        const double avgMs = count > 0 ? (double)totalNs / (double)count * 1e-6 : 0.0;
+        line += Fmt(" %s avg=%.2fms max=%.2fms", stageNames[i], avgMs, (double)maxNs * 1e-6);
+    }
+    Log::Write(Log::Level::Info, "Frame pipeline:" + line);
+}
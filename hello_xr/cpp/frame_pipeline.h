@@ -0,0 +1,93 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+#include "graphicsplugin.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// All the state one frame carries from xrWaitFrame through to xrEndFrame.
+struct FramePacket {
+    XrFrameState frameState{XR_TYPE_FRAME_STATE};
+    std::vector<Cube> cubes;
+};
+
+// Runs the frame loop as three overlapped stages:
+//   1. a frame-pacing thread that blocks in xrWaitFrame,
+//   2. a simulation thread that polls input and builds the scene for the predicted display time,
+//   3. the render/submit thread (the caller of AcquireFrame/ReleaseFrame) that does xrBeginFrame..xrEndFrame.
+// The render stage stays on the calling thread so graphics contexts bound to it (GL/GLES) remain valid.
+// Frame N+1's wait and simulation run while frame N is being recorded and submitted.
+struct FramePipeline {
+    using WaitFunction = std::function<void(XrFrameState& frameState)>;
+    using SimulateFunction = std::function<void(FramePacket& packet)>;
+    using DiscardFunction = std::function<void(FramePacket& packet)>;
+
+    FramePipeline(WaitFunction wait, SimulateFunction simulate);
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    void Start();
+
+    // Stop the stage threads. Any frame that already returned from xrWaitFrame is handed to discard() on the calling
+    // thread, which must begin and end it so a pacing thread blocked in xrWaitFrame is released.
+    void Stop(const DiscardFunction& discard);
+
+    bool IsRunning() const { return m_running; }
+
+    // Block until the next simulated frame is ready. Returns null if the pipeline stopped. Rethrows any exception
+    // raised on a stage thread.
+    FramePacket* AcquireFrame();
+    void ReleaseFrame(FramePacket* packet);
+
+    struct StageTiming {
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint64_t> count{0};
+
+        void Add(uint64_t ns);
+        void Reset();
+    };
+
+    enum Stage { Wait, Simulate, Render, StageCount };
+
+    void AddRenderTiming(uint64_t ns) { m_timings[Render].Add(ns); }
+    // Log average/max duration of each stage and reset the accumulators.
+    void LogTimings();
+
+   private:
+    static constexpr uint32_t PacketCount = 3;
+    static constexpr int32_t NoPacket = -1;
+
+    void PacingThread();
+    void SimulationThread();
+    void Fail();
+
+    WaitFunction m_wait;
+    SimulateFunction m_simulate;
+
+    std::array<FramePacket, PacketCount> m_packets;
+    std::vector<int32_t> m_freePackets;
+    int32_t m_waitedPacket{NoPacket};
+    int32_t m_simulatedPacket{NoPacket};
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_running{false};
+    bool m_stopping{false};
+    bool m_pacingDone{true};
+    bool m_simulationDone{true};
+    std::exception_ptr m_error;
+
+    std::thread m_pacingThread;
+    std::thread m_simulationThread;
+
+    std::array<StageTiming, StageCount> m_timings;
+};
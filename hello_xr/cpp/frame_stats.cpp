@@ -0,0 +1,244 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "frame_stats.h"
+
+#include <fstream>
+
+LatencyHistogram::LatencyHistogram() {
+    for (std::atomic<uint64_t>& bucket : m_buckets) {
+        bucket = 0;
+    }
+}
+
+uint32_t LatencyHistogram::BucketIndex(uint64_t ns) {
+    // Shift the value until it fits in [SubBuckets, 2 * SubBuckets); the shift is the octave and the remaining bits pick
+    // the bucket within it. Values below 2 * SubBuckets get a bucket each.
+    uint32_t octave = 0;
+    while ((ns >> octave) >= 2 * SubBuckets) {
+        octave++;
+    }
+    const uint64_t index = (ns >> octave) + (uint64_t)octave * SubBuckets;
+    return (uint32_t)std::min<uint64_t>(index, BucketCount - 1);
+}
+
+uint64_t LatencyHistogram::BucketValue(uint32_t index) {
+    if (index < 2 * SubBuckets) {
+        return index;
+    }
+    const uint32_t octave = index / SubBuckets - 1;
+    const uint64_t low = (uint64_t)(SubBuckets + index % SubBuckets) << octave;
+    return low + ((1ULL << octave) >> 1);
+}
+
+void LatencyHistogram::Add(uint64_t ns) {
+    m_buckets[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t prevMax = m_max.load(std::memory_order_relaxed);
+    while (ns > prevMax && !m_max.compare_exchange_weak(prevMax, ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::TakeSummary() {
+    std::array<uint64_t, BucketCount> counts;
+    Summary summary;
+    for (uint32_t i = 0; i < BucketCount; i++) {
+        counts[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+        summary.count += counts[i];
+    }
+    summary.max = m_max.exchange(0, std::memory_order_relaxed);
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    // The value below which the given fraction of the samples fall, no larger than the largest sample.
+    const auto percentile = [&](double fraction) {
+        const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(fraction * summary.count));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BucketCount; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(BucketValue(i), summary.max);
+            }
+        }
+        return summary.max;
+    };
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    return summary;
+}
+
+bool FrameStats::IsExtensionAvailable() {
+    const char* extensionName = ExtensionName();
+    if (extensionName == nullptr) {
+        return false;
+    }
+
+    uint32_t extensionCount;
+    CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionCount, nullptr));
+    std::vector<XrExtensionProperties> extensions(extensionCount, {XR_TYPE_EXTENSION_PROPERTIES});
+    CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, (uint32_t)extensions.size(), &extensionCount, extensions.data()));
+    return std::any_of(extensions.begin(), extensions.end(),
+                       [&](const XrExtensionProperties& extension) { return strcmp(extension.extensionName, extensionName) == 0; });
+}
+
+const char* FrameStats::ExtensionName() {
+#if defined(XR_USE_PLATFORM_WIN32) && defined(XR_KHR_win32_convert_performance_counter_time)
+    return XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME;
+#elif defined(XR_USE_TIMESPEC) && defined(XR_KHR_convert_timespec_time)
+    return XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME;
+#else
+    return nullptr;
+#endif
+}
+
+void FrameStats::Initialize(XrInstance instance, bool extensionEnabled, const std::string& path) {
+    m_instance = instance;
+    m_convertTime = nullptr;
+    if (extensionEnabled) {
+#if defined(XR_USE_PLATFORM_WIN32) && defined(XR_KHR_win32_convert_performance_counter_time)
+        CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrConvertWin32PerformanceCounterToTimeKHR", &m_convertTime));
+#elif defined(XR_USE_TIMESPEC) && defined(XR_KHR_convert_timespec_time)
+        CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrConvertTimespecTimeToTimeKHR", &m_convertTime));
+#endif
+    }
+    if (m_convertTime == nullptr) {
+        Log::Write(Log::Level::Info, "Frame statistics: no time conversion extension, display margins are not measured");
+    }
+
+    m_path = path;
+    const std::string jsonSuffix = ".json";
+    m_json = m_path.size() >= jsonSuffix.size() &&
+             EqualsIgnoreCase(m_path.substr(m_path.size() - jsonSuffix.size()), jsonSuffix);
+    if (!m_path.empty()) {
+        Log::Write(Log::Level::Info, Fmt("Writing frame statistics to %s", m_path.c_str()));
+    }
+}
+
+bool FrameStats::GetCurrentXrTime(XrTime* time) const {
+    if (m_convertTime == nullptr) {
+        return false;
+    }
+#if defined(XR_USE_PLATFORM_WIN32) && defined(XR_KHR_win32_convert_performance_counter_time)
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return XR_SUCCEEDED(
+        reinterpret_cast<PFN_xrConvertWin32PerformanceCounterToTimeKHR>(m_convertTime)(m_instance, &counter, time));
+#elif defined(XR_USE_TIMESPEC) && defined(XR_KHR_convert_timespec_time)
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return XR_SUCCEEDED(reinterpret_cast<PFN_xrConvertTimespecTimeToTimeKHR>(m_convertTime)(m_instance, &now, time));
+#else
+    (void)time;
+    return false;
+#endif
+}
+
+void FrameStats::OnWaitFrame(ksNanoseconds waitStart) {
+    const ksNanoseconds now = GetTimeNanoseconds();
+    Add(FramePhase::WaitFrame, now - waitStart);
+    const ksNanoseconds lastReturn = m_lastWaitFrameReturn.exchange(now);
+    if (lastReturn != 0) {
+        Add(FramePhase::FrameInterval, now - lastReturn);
+    }
+}
+
+void FrameStats::OnEndFrame(const XrFrameState& frameState) {
+    XrTime now;
+    if (GetCurrentXrTime(&now)) {
+        if (now <= frameState.predictedDisplayTime) {
+            m_displayMargin.Add(frameState.predictedDisplayTime - now);
+        } else {
+            m_displayOverrun.Add(now - frameState.predictedDisplayTime);
+        }
+    }
+
+    if (m_lastPredictedDisplayTime != 0 && frameState.predictedDisplayTime > m_lastPredictedDisplayTime) {
+        const XrDuration period = frameState.predictedDisplayTime - m_lastPredictedDisplayTime;
+        m_displayPeriod.Add(std::abs(period - frameState.predictedDisplayPeriod));
+    }
+    m_lastPredictedDisplayTime = frameState.predictedDisplayTime;
+}
+
+void FrameStats::Update() {
+    const ksNanoseconds now = GetTimeNanoseconds();
+    if (m_lastUpdate == 0) {
+        m_lastUpdate = now;
+    }
+    if (now - m_lastUpdate < UpdateInterval) {
+        return;
+    }
+    m_lastUpdate = now;
+
+    static const char* const phaseNames[] = {"WaitFrame",    "FrameInterval", "LocateSpaces", "BeginFrame",
+                                             "LocateViews",  "BuildPacket",   "AcquireImage", "WaitImage",
+                                             "RenderView",   "ReleaseImage",  "EndFrame"};
+    static_assert(ArraySize(phaseNames) == (size_t)FramePhase::Count, "Missing frame phase name");
+
+    std::vector<std::pair<const char*, LatencyHistogram::Summary>> summaries;
+    for (uint32_t i = 0; i < (uint32_t)FramePhase::Count; i++) {
+        summaries.emplace_back(phaseNames[i], m_phases[i].TakeSummary());
+    }
+    summaries.emplace_back("DisplayMargin", m_displayMargin.TakeSummary());
+    summaries.emplace_back("DisplayOverrun", m_displayOverrun.TakeSummary());
+    summaries.emplace_back("DisplayPeriod", m_displayPeriod.TakeSummary());
+
+    std::string line;
+    for (const auto& summary : summaries) {
+        if (summary.second.count > 0) {
+            line += Fmt(" %s p50=%.2fms p99=%.2fms", summary.first, summary.second.p50 * 1e-6, summary.second.p99 * 1e-6);
+        }
+    }
+    Log::Write(Log::Level::Verbose, "Frame statistics:" + line);
+
+    if (!m_path.empty()) {
+        WriteSummary(summaries, now * 1e-9);
+    }
+}
+
+void FrameStats::WriteSummary(const std::vector<std::pair<const char*, LatencyHistogram::Summary>>& summaries, double seconds) {
+    std::streamoff size = 0;
+    {
+        std::ifstream existing(m_path, std::ios::binary | std::ios::ate);
+        if (existing) {
+            size = existing.tellg();
+        }
+    }
+    // Keep one previous file, so a long run cannot fill the device.
+    if (size > MaxFileBytes) {
+        const std::string previousPath = m_path + ".1";
+        std::remove(previousPath.c_str());
+        if (std::rename(m_path.c_str(), previousPath.c_str()) == 0) {
+            size = 0;
+        }
+    }
+
+    std::ofstream file(m_path, std::ios::binary | std::ios::app);
+    if (!file) {
+        Log::Write(Log::Level::Warning, Fmt("Failed to open %s, frame statistics will only be logged", m_path.c_str()));
+        m_path.clear();
+        return;
+    }
+
+    if (m_json) {
+        file << Fmt("{\"time_s\":%.3f", seconds);
+        for (const auto& summary : summaries) {
+            const LatencyHistogram::Summary& s = summary.second;
+            file << Fmt(",\"%s\":{\"count\":%llu,\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}", summary.first,
+                        (unsigned long long)s.count, s.p50 * 1e-6, s.p95 * 1e-6, s.p99 * 1e-6, s.max * 1e-6);
+        }
+        file << "}\n";
+    } else {
+        if (size == 0) {
+            file << "time_s,phase,count,p50_ms,p95_ms,p99_ms,max_ms\n";
+        }
+        for (const auto& summary : summaries) {
+            const LatencyHistogram::Summary& s = summary.second;
+            file << Fmt("%.3f,%s,%llu,%.4f,%.4f,%.4f,%.4f\n", seconds, summary.first, (unsigned long long)s.count, s.p50 * 1e-6,
+                        s.p95 * 1e-6, s.p99 * 1e-6, s.max * 1e-6);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+
+#include <utils/nanoseconds.h>
+
+// The parts of a frame FrameStats times.
+enum class FramePhase : uint32_t {
+    WaitFrame,      // xrWaitFrame.
+    FrameInterval,  // From one return of xrWaitFrame to the next.
+    LocateSpaces,   // Locating the visualized spaces and the hands.
+    BeginFrame,     // xrBeginFrame.
+    LocateViews,    // xrLocateViews.
+    BuildPacket,    // Transforming the cubes and views into the frame's RenderPacket.
+    AcquireImage,   // xrAcquireSwapchainImage.
+    WaitImage,      // xrWaitSwapchainImage.
+    RenderView,     // IGraphicsPlugin::RenderView or RenderPacketViews.
+    ReleaseImage,   // xrReleaseSwapchainImage.
+    EndFrame,       // xrEndFrame.
+    Count
+};
+
+// Histogram of nanosecond durations that any number of threads may add to without locking. Every power of two is split
+// into SubBuckets buckets, so a percentile read back is within 1/SubBuckets of the true value.
+struct LatencyHistogram {
+    static constexpr uint32_t SubBucketBits = 4;
+    static constexpr uint32_t SubBuckets = 1u << SubBucketBits;
+    // Enough for durations up to 2^36ns (about a minute); longer ones land in the last bucket.
+    static constexpr uint32_t BucketCount = (36 - SubBucketBits + 1) * SubBuckets;
+
+    struct Summary {
+        uint64_t count{0};
+        uint64_t p50{0};
+        uint64_t p95{0};
+        uint64_t p99{0};
+        uint64_t max{0};
+    };
+
+    LatencyHistogram();
+
+    void Add(uint64_t ns);
+
+    // Summarize what was added since the last call and start over. A value added meanwhile counts towards this summary
+    // or the next one.
+    Summary TakeSummary();
+
+   private:
+    static uint32_t BucketIndex(uint64_t ns);
+    // Middle of the range of durations counted in a bucket.
+    static uint64_t BucketValue(uint32_t index);
+
+    std::array<std::atomic<uint64_t>, BucketCount> m_buckets;
+    std::atomic<uint64_t> m_max{0};
+};
+
+// Latency histograms of every phase of the frame loop, and how the runtime's predictedDisplayTime held up:
+//   DisplayMargin   - how long before predictedDisplayTime xrEndFrame returned,
+//   DisplayOverrun  - how long after it, for frames submitted too late to be shown in time,
+//   DisplayPeriod   - how far consecutive predictedDisplayTimes are from predictedDisplayPeriod apart.
+// The first two need the runtime's time conversion extension to compare XrTime with the local clock.
+// Every few seconds the histograms are summarized, logged and, if a path is set, appended to a file: CSV, or one JSON
+// object per line if the path ends in ".json". The file is rolled over to <path>.1 when it grows too large.
+struct FrameStats {
+    // True if the runtime can convert between XrTime and this platform's clock, i.e. the extension is worth enabling.
+    static bool IsExtensionAvailable();
+    // Name of the time conversion extension for this platform, or null if there is none.
+    static const char* ExtensionName();
+
+    // extensionEnabled must only be true if ExtensionName() was enabled on the instance. An empty path only logs.
+    void Initialize(XrInstance instance, bool extensionEnabled, const std::string& path);
+
+    // May be called from any thread.
+    void Add(FramePhase phase, ksNanoseconds duration) { m_phases[(uint32_t)phase].Add(duration); }
+
+    // Call when xrWaitFrame returns, with the time it was called.
+    void OnWaitFrame(ksNanoseconds waitStart);
+
+    // Call when xrEndFrame returns for a frame that was rendered.
+    void OnEndFrame(const XrFrameState& frameState);
+
+    // Summarize, log and write the statistics if the interval has passed. Call from one thread only.
+    void Update();
+
+   private:
+    bool GetCurrentXrTime(XrTime* time) const;
+    void WriteSummary(const std::vector<std::pair<const char*, LatencyHistogram::Summary>>& summaries, double seconds);
+
+    static constexpr ksNanoseconds UpdateInterval = 5ULL * 1000 * 1000 * 1000;
+    static constexpr std::streamoff MaxFileBytes = 4 * 1024 * 1024;
+
+    std::array<LatencyHistogram, (uint32_t)FramePhase::Count> m_phases;
+    LatencyHistogram m_displayMargin;
+    LatencyHistogram m_displayOverrun;
+    LatencyHistogram m_displayPeriod;
+
+    std::atomic<ksNanoseconds> m_lastWaitFrameReturn{0};
+    XrTime m_lastPredictedDisplayTime{0};
+    ksNanoseconds m_lastUpdate{0};
+
+    XrInstance m_instance{XR_NULL_HANDLE};
+    PFN_xrVoidFunction m_convertTime{nullptr};
+    std::string m_path;
+    bool m_json{false};
+};
+
+// Adds the time from construction to destruction to a phase.
+struct ScopedFramePhase {
+    ScopedFramePhase(FrameStats& stats, FramePhase phase) : m_stats(stats), m_phase(phase), m_start(GetTimeNanoseconds()) {}
+    ~ScopedFramePhase() { m_stats.Add(m_phase, GetTimeNanoseconds() - m_start); }
+
+    ScopedFramePhase(const ScopedFramePhase&) = delete;
+    ScopedFramePhase& operator=(const ScopedFramePhase&) = delete;
+
+   private:
+    FrameStats& m_stats;
+    const FramePhase m_phase;
+    const ksNanoseconds m_start;
+};
@@ -0,0 +1,92 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+// Shadow copy of the GL state the OpenGL and OpenGL ES plugins set for every view, so calls that would not change it
+// are never made. State starts out unknown and the first call always goes through. The cache only sees changes made
+// through it; call Invalidate() after anything else may have touched this state on the context. The plugins do so at the
+// start of every view, since the runtime may use the context between views.
+// Include after the GL headers.
+struct GLStateCache {
+    void Enable(GLenum capability) {
+        if (m_capabilities[capability].Set(true)) {
+            glEnable(capability);
+        }
+    }
+
+    void Disable(GLenum capability) {
+        if (m_capabilities[capability].Set(false)) {
+            glDisable(capability);
+        }
+    }
+
+    void FrontFace(GLenum mode) {
+        if (m_frontFace.Set(mode)) {
+            glFrontFace(mode);
+        }
+    }
+
+    void CullFace(GLenum mode) {
+        if (m_cullFace.Set(mode)) {
+            glCullFace(mode);
+        }
+    }
+
+    void UseProgram(GLuint program) {
+        if (m_program.Set(program)) {
+            glUseProgram(program);
+        }
+    }
+
+    void BindFramebuffer(GLuint framebuffer) {
+        if (m_framebuffer.Set(framebuffer)) {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+    }
+
+    void BindVertexArray(GLuint vertexArray) {
+        if (m_vertexArray.Set(vertexArray)) {
+            glBindVertexArray(vertexArray);
+        }
+    }
+
+    // Forget all cached state. Keeps the capability entries, so invalidating every view does not allocate.
+    void Invalidate() {
+        for (auto& capability : m_capabilities) {
+            capability.second.known = false;
+        }
+        m_frontFace.known = false;
+        m_cullFace.known = false;
+        m_program.known = false;
+        m_framebuffer.known = false;
+        m_vertexArray.known = false;
+    }
+
+   private:
+    template <typename T>
+    struct Cached {
+        T value{};
+        bool known{false};
+
+        // Returns false if the state already has this value.
+        bool Set(T newValue) {
+            if (known && value == newValue) {
+                return false;
+            }
+            value = newValue;
+            known = true;
+            return true;
+        }
+    };
+
+    std::map<GLenum, Cached<bool>> m_capabilities;
+    Cached<GLenum> m_frontFace;
+    Cached<GLenum> m_cullFace;
+    Cached<GLuint> m_program;
+    Cached<GLuint> m_framebuffer;
+    Cached<GLuint> m_vertexArray;
+};
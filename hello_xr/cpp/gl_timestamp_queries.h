@@ -0,0 +1,91 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+#include "gpu_timer.h"
+
+// Timestamp queries laid out by a GpuTimerRing, timing the passes of recent frames in the OpenGL and OpenGL ES plugins.
+// Passes are bracketed with glQueryCounter rather than GL_TIME_ELAPSED queries, which cannot overlap. Results are only
+// read once GL_QUERY_RESULT_AVAILABLE is set, so collecting them never stalls the pipeline.
+// Include after the GL headers.
+struct GLTimestampQueries {
+    static constexpr uint32_t NoQuery = ~0u;
+
+    // Nothing is timed unless available is true (GL_ARB_timer_query, GL 3.3 or GL_EXT_disjoint_timer_query).
+    void Create(bool available) {
+        if (!available || glQueryCounter == nullptr || glGetQueryObjectui64v == nullptr) {
+            Log::Write(Log::Level::Warning, "Timer queries are not supported, GPU timings are disabled");
+            return;
+        }
+        m_queries.resize(GpuTimerRing::QueryCount);
+        glGenQueries((GLsizei)m_queries.size(), m_queries.data());
+        m_timer.Init(1.0);
+    }
+
+    // Must be called while the context is still current.
+    void Release() {
+        if (!m_queries.empty()) {
+            glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+            m_queries.clear();
+        }
+    }
+
+    bool Enabled() const { return !m_queries.empty(); }
+
+    void BeginFrame(uint64_t frameIndex) {
+        if (!m_queries.empty()) {
+            m_timer.BeginFrame(frameIndex);
+        }
+    }
+
+    uint32_t AddViews(uint32_t viewCount) { return m_timer.AddViews(viewCount); }
+
+    // Returns the query to pass to EndPass, or NoQuery if the pass is not timed.
+    uint32_t BeginPass(const char* name, uint32_t firstView, uint32_t viewCount) {
+        uint32_t query;
+        if (m_queries.empty() || !m_timer.BeginPass(name, firstView, viewCount, &query)) {
+            return NoQuery;
+        }
+        glQueryCounter(m_queries[query], GL_TIMESTAMP);
+        return query;
+    }
+
+    void EndPass(uint32_t beginQuery) {
+        if (beginQuery != NoQuery) {
+            glQueryCounter(m_queries[beginQuery + 1], GL_TIMESTAMP);
+        }
+    }
+
+    void Collect(std::vector<GpuFrameTiming>* timings) {
+        if (m_queries.empty()) {
+            return;
+        }
+        m_timer.Collect(
+            [&](uint32_t /*slot*/, uint32_t firstQuery, uint32_t queryCount, uint64_t* timestamps) {
+                for (uint32_t i = 0; i < queryCount; i++) {
+                    GLuint available = GL_FALSE;
+                    glGetQueryObjectuiv(m_queries[firstQuery + i], GL_QUERY_RESULT_AVAILABLE, &available);
+                    if (available == GL_FALSE) {
+                        return false;
+                    }
+                }
+                for (uint32_t i = 0; i < queryCount; i++) {
+                    GLuint64 timestamp = 0;
+                    glGetQueryObjectui64v(m_queries[firstQuery + i], GL_QUERY_RESULT, &timestamp);
+                    timestamps[i] = timestamp;
+                }
+                return true;
+            },
+            timings);
+    }
+
+    // Forget the frames not collected yet, e.g. after GL_GPU_DISJOINT reported their timestamps as unreliable.
+    void DropPending() { m_timer.DropPending(); }
+
+   private:
+    GpuTimerRing m_timer;
+    std::vector<GLuint> m_queries;
+};
@@ -0,0 +1,125 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+#include "graphicsplugin.h"
+
+// API-independent bookkeeping for the GPU timestamp queries of the graphics plugins. The queries form a ring of FrameSlots
+// frames, each with room for MaxPassesPerFrame passes bracketed by a begin and an end timestamp; query q belongs to slot
+// q / QueriesPerSlot. The plugin writes and reads the timestamps, this only hands out query indices and turns the
+// timestamps of finished frames into GpuFrameTimings. Nothing here waits for the GPU: a frame is collected once its
+// timestamps are available, and dropped if that takes so long its slot is needed again.
+struct GpuTimerRing {
+    static constexpr uint32_t FrameSlots = 4;
+    static constexpr uint32_t MaxPassesPerFrame = 16;
+    static constexpr uint32_t QueriesPerSlot = 2 * MaxPassesPerFrame;
+    static constexpr uint32_t QueryCount = FrameSlots * QueriesPerSlot;
+
+    // nanosecondsPerTick converts timestamp differences to time; validBits is how many low bits of a timestamp count.
+    void Init(double nanosecondsPerTick, uint32_t validBits = 64) {
+        m_nanosecondsPerTick = nanosecondsPerTick;
+        m_timestampMask = validBits >= 64 ? ~0ULL : (1ULL << validBits) - 1;
+        m_slots = {};
+        m_current = FrameSlots - 1;
+        m_recording = false;
+    }
+
+    // Start recording frame frameIndex into the next slot, and return that slot. A frame still waiting in the slot is
+    // dropped.
+    uint32_t BeginFrame(uint64_t frameIndex) {
+        m_current = (m_current + 1) % FrameSlots;
+        Slot& slot = m_slots[m_current];
+        if (slot.pending) {
+            m_droppedFrames++;
+        }
+        slot.frameIndex = frameIndex;
+        slot.passCount = 0;
+        slot.viewCount = 0;
+        slot.pending = true;
+        m_recording = true;
+        return m_current;
+    }
+
+    // Number the views rendered in the current frame: returns the index of the first of the next viewCount views.
+    uint32_t AddViews(uint32_t viewCount) {
+        Slot& slot = m_slots[m_current];
+        const uint32_t firstView = slot.viewCount;
+        slot.viewCount += viewCount;
+        return firstView;
+    }
+
+    // Reserve the timestamps bracketing a pass of the current frame. The end timestamp is *beginQuery + 1. Returns false,
+    // and nothing should be written, if no frame has begun or the frame is out of queries. name must be a static string.
+    bool BeginPass(const char* name, uint32_t firstView, uint32_t viewCount, uint32_t* beginQuery) {
+        Slot& slot = m_slots[m_current];
+        if (!m_recording || slot.passCount == MaxPassesPerFrame) {
+            return false;
+        }
+        slot.passes[slot.passCount] = {name, firstView, viewCount, 0.0};
+        *beginQuery = m_current * QueriesPerSlot + 2 * slot.passCount++;
+        return true;
+    }
+
+    // Collect finished frames, oldest first, into timings. For each frame with passes,
+    // read(slot, firstQuery, queryCount, uint64_t* timestamps) must either fill in the timestamps and return true, or
+    // return false if they are not all available yet, which ends collection until the next call. The frame being recorded
+    // is never collected.
+    template <typename ReadTimestamps>
+    void Collect(ReadTimestamps read, std::vector<GpuFrameTiming>* timings) {
+        for (uint32_t i = 1; i <= FrameSlots; i++) {
+            const uint32_t index = (m_current + i) % FrameSlots;
+            Slot& slot = m_slots[index];
+            if (!slot.pending || (m_recording && index == m_current)) {
+                continue;
+            }
+            if (slot.passCount > 0) {
+                std::array<uint64_t, QueriesPerSlot> timestamps;
+                if (!read(index, index * QueriesPerSlot, 2 * slot.passCount, timestamps.data())) {
+                    return;
+                }
+                GpuFrameTiming timing{slot.frameIndex, {}};
+                timing.Passes.reserve(slot.passCount);
+                for (uint32_t p = 0; p < slot.passCount; p++) {
+                    const uint64_t ticks = (timestamps[2 * p + 1] - timestamps[2 * p]) & m_timestampMask;
+                    GpuPassTiming pass = slot.passes[p];
+                    pass.Milliseconds = ticks * m_nanosecondsPerTick * 1e-6;
+                    timing.Passes.push_back(pass);
+                }
+                timings->push_back(std::move(timing));
+            }
+            slot.pending = false;
+        }
+    }
+
+    // Forget every frame not yet collected, e.g. because its timestamps were invalidated.
+    void DropPending() {
+        for (uint32_t i = 0; i < FrameSlots; i++) {
+            if (m_slots[i].pending && !(m_recording && i == m_current)) {
+                m_slots[i].pending = false;
+                m_droppedFrames++;
+            }
+        }
+    }
+
+    // Frames whose timings were lost because they were not collected in time or were invalidated.
+    uint64_t DroppedFrames() const { return m_droppedFrames; }
+
+   private:
+    struct Slot {
+        uint64_t frameIndex{0};
+        std::array<GpuPassTiming, MaxPassesPerFrame> passes{};
+        uint32_t passCount{0};
+        uint32_t viewCount{0};
+        bool pending{false};
+    };
+
+    std::array<Slot, FrameSlots> m_slots{};
+    uint32_t m_current{FrameSlots - 1};
+    bool m_recording{false};
+    double m_nanosecondsPerTick{1.0};
+    uint64_t m_timestampMask{~0ULL};
+    uint64_t m_droppedFrames{0};
+};
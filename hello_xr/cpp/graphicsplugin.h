@@ -4,11 +4,50 @@
 
 #pragma once
 
+#include <common/xr_linear.h>
+
 struct Cube {
     XrPosef Pose;
     XrVector3f Scale;
 };
 
+// GPU time of one pass of a frame, measured with timestamp queries.
+struct GpuPassTiming {
+    const char* Pass;      // Static name of the pass, e.g. "Draw".
+    uint32_t FirstView;    // Index within the frame of the first view the pass rendered.
+    uint32_t ViewCount;    // More than one for a multiview pass.
+    double Milliseconds;
+};
+
+// GPU timings of the passes of one frame, in the order they were recorded.
+struct GpuFrameTiming {
+    uint64_t Frame;  // As given to BeginGpuFrame.
+    std::vector<GpuPassTiming> Passes;
+};
+
+// Graphics API work a plugin issued for one frame.
+struct GraphicsFrameCounters {
+    uint64_t Frame;         // As given to BeginGpuFrame.
+    uint64_t Draws;         // Draw calls; an instanced draw counts once.
+    uint64_t StateChanges;  // Render targets, viewports, pipelines and constants bound or set.
+    uint64_t UploadBytes;   // Bytes written to buffers for the GPU to read.
+};
+
+// Transforms of one frame, computed once per frame by the program and shared by every view the frame renders.
+struct RenderPacket {
+    uint64_t Frame;  // As given to BeginGpuFrame.
+
+    // Views of the frame, in the order of the projection layer.
+    const XrCompositionLayerProjectionView* LayerViews;
+    // View-projection transform of each view, in the clip space returned by SupportsRenderPacket.
+    const XrMatrix4x4f* ViewProjections;
+    uint32_t ViewCount;
+
+    // Model transform of every cube, packed so a plugin can copy them into an instance buffer as they are.
+    const XrMatrix4x4f* Models;
+    uint32_t ModelCount;
+};
+
 // Wraps a graphics API so the main openxr program can be graphics API-independent.
 struct IGraphicsPlugin {
     virtual ~IGraphicsPlugin() = default;
@@ -30,16 +69,51 @@ struct IGraphicsPlugin {
     virtual std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
         uint32_t capacity, const XrSwapchainCreateInfo& swapchainCreateInfo) = 0;
 
-    // Render to a swapchain image for a projection view.
+    // Render to a swapchain image for a projection view, transforming the cubes for that view alone. Plugins that
+    // SupportsRenderPacket are given the frame's packet with RenderPacketViews instead.
     virtual void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
                             int64_t swapchainFormat, const std::vector<Cube>& cubes) = 0;
 
+    // True if RenderPacketViews can render every view in a single pass into one swapchain image with an array layer per
+    // view. Only plugins that SupportsRenderPacket render multiview. Only valid after InitializeDevice.
+    virtual bool SupportsMultiview() const { return false; }
+
+    // True if the plugin renders frames from a RenderPacket with RenderPacketViews, instead of transforming the cubes
+    // given to RenderView itself for every view. Sets *projectionApi to the graphics API whose clip
+    // space the packet's view-projection transforms are built for. Only valid after InitializeDevice.
+    virtual bool SupportsRenderPacket(GraphicsAPI* /*projectionApi*/) const { return false; }
+
+    // Render views [firstView, firstView + viewCount) of the packet to a swapchain image. A single view is rendered as by
+    // RenderView. Several are rendered in a single pass when SupportsMultiview: all of them share swapchainImage, and
+    // packet.LayerViews[firstView + i].subImage.imageArrayIndex is i. Every view of a frame is rendered from the same
+    // packet.
+    virtual void RenderPacketViews(const RenderPacket& /*packet*/, uint32_t /*firstView*/, uint32_t /*viewCount*/,
+                                   const XrSwapchainImageBaseHeader* /*swapchainImage*/, int64_t /*swapchainFormat*/) {
+        THROW("Render packets are not supported by this graphics plugin");
+    }
+
     // Get recommended number of sub-data element samples in view (recommendedSwapchainSampleCount)
     // if supported by the graphics plugin. A supported value otherwise.
     virtual uint32_t GetSupportedSwapchainSampleCount(const XrViewConfigurationView& view) {
         return view.recommendedSwapchainSampleCount;
     }
 
+    // Start a new frame for GPU profiling. Passes recorded by RenderView and RenderPacketViews are timed
+    // as part of frame frameIndex until the next call. Plugins without timestamp queries ignore this.
+    virtual void BeginGpuFrame(uint64_t /*frameIndex*/) {}
+
+    // Append the GPU timings of frames that have finished on the GPU since the last call, oldest first. Never waits for
+    // the GPU, so a frame shows up a few frames after it was rendered; frames whose results take too long are skipped.
+    virtual void CollectGpuTimings(std::vector<GpuFrameTiming>* /*timings*/) {}
+
+    // Append the counters of frames that were rendered since the last call, oldest first. Plugins that do not count
+    // ignore this.
+    virtual void CollectFrameCounters(std::vector<GraphicsFrameCounters>* /*counters*/) {}
+
+    // Job system the plugin may spread CPU work of a frame over. Set before InitializeDevice; plugins with nothing to
+    // spread ignore it.
+    virtual void SetJobSystem(const std::shared_ptr<struct JobSystem>& /*jobSystem*/) {}
+
     // Perform required steps after updating Options
     virtual void UpdateOptions(const std::shared_ptr<struct Options>& options) = 0;
 };
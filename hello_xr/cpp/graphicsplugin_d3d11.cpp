@@ -7,6 +7,7 @@
 #include "geometry.h"
 #include "graphicsplugin.h"
 #include "options.h"
+#include "trace.h"
 
 #if defined(XR_USE_GRAPHICS_API_D3D11) && !defined(MISSING_DIRECTX_COLORS)
 
@@ -57,6 +58,7 @@ struct D3D11GraphicsPlugin : public IGraphicsPlugin {
     std::vector<std::string> GetInstanceExtensions() const override { return {XR_KHR_D3D11_ENABLE_EXTENSION_NAME}; }
 
     void InitializeDevice(XrInstance instance, XrSystemId systemId) override {
+        TRACE_ZONE("InitializeDevice");
         PFN_xrGetD3D11GraphicsRequirementsKHR pfnGetD3D11GraphicsRequirementsKHR = nullptr;
         CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrGetD3D11GraphicsRequirementsKHR",
                                           reinterpret_cast<PFN_xrVoidFunction*>(&pfnGetD3D11GraphicsRequirementsKHR)));
@@ -140,6 +142,7 @@ struct D3D11GraphicsPlugin : public IGraphicsPlugin {
 
     std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
         uint32_t capacity, const XrSwapchainCreateInfo& /*swapchainCreateInfo*/) override {
+        TRACE_ZONE("AllocateSwapchainImageStructs");
         // Allocate and initialize the buffer of image structs (must be sequential in memory for xrEnumerateSwapchainImages).
         // Return back an array of pointers to each swapchain image struct so the consumer doesn't need to know the type/size.
         std::vector<XrSwapchainImageD3D11KHR> swapchainImageBuffer(capacity);
@@ -188,6 +191,7 @@ struct D3D11GraphicsPlugin : public IGraphicsPlugin {
 
     void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
                     int64_t swapchainFormat, const std::vector<Cube>& cubes) override {
+        TRACE_ZONE("RenderView");
         CHECK(layerView.subImage.imageArrayIndex == 0);  // Texture arrays not supported.
 
         ID3D11Texture2D* const colorTexture = reinterpret_cast<const XrSwapchainImageD3D11KHR*>(swapchainImage)->texture;
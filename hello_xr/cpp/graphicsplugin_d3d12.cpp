@@ -7,6 +7,7 @@
 #include "geometry.h"
 #include "graphicsplugin.h"
 #include "options.h"
+#include "trace.h"
 
 #if defined(XR_USE_GRAPHICS_API_D3D12) && !defined(MISSING_DIRECTX_COLORS)
 
@@ -169,6 +170,7 @@ struct D3D12GraphicsPlugin : public IGraphicsPlugin {
     std::vector<std::string> GetInstanceExtensions() const override { return {XR_KHR_D3D12_ENABLE_EXTENSION_NAME}; }
 
     void InitializeDevice(XrInstance instance, XrSystemId systemId) override {
+        TRACE_ZONE("InitializeDevice");
         PFN_xrGetD3D12GraphicsRequirementsKHR pfnGetD3D12GraphicsRequirementsKHR = nullptr;
         CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrGetD3D12GraphicsRequirementsKHR",
                                           reinterpret_cast<PFN_xrVoidFunction*>(&pfnGetD3D12GraphicsRequirementsKHR)));
@@ -309,6 +311,7 @@ struct D3D12GraphicsPlugin : public IGraphicsPlugin {
 
     std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
         uint32_t capacity, const XrSwapchainCreateInfo& /*swapchainCreateInfo*/) override {
+        TRACE_ZONE("AllocateSwapchainImageStructs");
         // Allocate and initialize the buffer of image structs (must be sequential in memory for xrEnumerateSwapchainImages).
         // Return back an array of pointers to each swapchain image struct so the consumer doesn't need to know the type/size.
 
@@ -411,6 +414,7 @@ struct D3D12GraphicsPlugin : public IGraphicsPlugin {
 
     void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
                     int64_t swapchainFormat, const std::vector<Cube>& cubes) override {
+        TRACE_ZONE("RenderView");
         CHECK(layerView.subImage.imageArrayIndex == 0);  // Texture arrays not supported.
 
         auto& swapchainContext = *m_swapchainImageContextMap[swapchainImage];
@@ -9,6 +9,7 @@
 #include "options.h"
 #include "platformdata.h"
 #include "graphicsplugin.h"
+#include "trace.h"
 
 // Graphics API factories are forward declared here.
 #ifdef XR_USE_GRAPHICS_API_OPENGL_ES
@@ -34,6 +35,11 @@ std::shared_ptr<IGraphicsPlugin> CreateGraphicsPlugin_D3D11(const std::shared_pt
 std::shared_ptr<IGraphicsPlugin> CreateGraphicsPlugin_D3D12(const std::shared_ptr<Options>& options,
                                                             std::shared_ptr<IPlatformPlugin> platformPlugin);
 #endif
+std::shared_ptr<IGraphicsPlugin> CreateGraphicsPlugin_Software(const std::shared_ptr<Options>& options,
+                                                               std::shared_ptr<IPlatformPlugin> platformPlugin);
+
+std::shared_ptr<IGraphicsPlugin> CreateGraphicsPlugin_Null(const std::shared_ptr<Options>& options,
+                                                           std::shared_ptr<IPlatformPlugin> platformPlugin);
 
 namespace {
 using GraphicsPluginFactory = std::function<std::shared_ptr<IGraphicsPlugin>(const std::shared_ptr<Options>& options,
@@ -74,11 +80,20 @@ std::map<std::string, GraphicsPluginFactory, IgnoreCaseStringLess> graphicsPlugi
          return CreateGraphicsPlugin_D3D12(options, std::move(platformPlugin));
      }},
 #endif
+    {"Software",
+     [](const std::shared_ptr<Options>& options, std::shared_ptr<IPlatformPlugin> platformPlugin) {
+         return CreateGraphicsPlugin_Software(options, std::move(platformPlugin));
+     }},
+    {"Null",
+     [](const std::shared_ptr<Options>& options, std::shared_ptr<IPlatformPlugin> platformPlugin) {
+         return CreateGraphicsPlugin_Null(options, std::move(platformPlugin));
+     }},
 };
 }  // namespace
 
 std::shared_ptr<IGraphicsPlugin> CreateGraphicsPlugin(const std::shared_ptr<Options>& options,
                                                       std::shared_ptr<IPlatformPlugin> platformPlugin) {
+    TRACE_ZONE("CreateGraphicsPlugin");
     if (options->GraphicsPlugin.empty()) {
         throw std::invalid_argument("No graphics API specified");
     }
@@ -0,0 +1,194 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "graphicsplugin.h"
+#include "options.h"
+#include "render_packet.h"
+#include "trace.h"
+#include "mock_runtime/mock_runtime.h"
+
+#include <common/xr_linear.h>
+
+namespace {
+
+// Draws nothing, for profiling the application and the OpenXR runtime without any graphics driver. Does the CPU work of
+// a plugin that draws all cubes in one instanced draw per view: renders from the program's RenderPacket, copying the
+// model matrices of the cubes once per frame and the view-projection matrices once per pass, as the Vulkan plugin does.
+// Counts the draws, state changes and uploaded bytes such a plugin would issue, and reports them through
+// CollectFrameCounters.
+//
+// Sessions are created with the mock runtime's memory swapchains, whose images are never touched.
+struct NullGraphicsPlugin : public IGraphicsPlugin {
+    NullGraphicsPlugin(const std::shared_ptr<Options>& /*unused*/, const std::shared_ptr<IPlatformPlugin> /*unused*/&) {}
+
+    NullGraphicsPlugin(const NullGraphicsPlugin&) = delete;
+    NullGraphicsPlugin& operator=(const NullGraphicsPlugin&) = delete;
+    NullGraphicsPlugin(NullGraphicsPlugin&&) = delete;
+    NullGraphicsPlugin& operator=(NullGraphicsPlugin&&) = delete;
+
+    std::vector<std::string> GetInstanceExtensions() const override { return {XR_MOCK_MEMORY_SWAPCHAIN_EXTENSION_NAME}; }
+
+    void InitializeDevice(XrInstance /*instance*/, XrSystemId /*systemId*/) override {}
+
+    int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& runtimeFormats) const override {
+        // List of supported color swapchain formats.
+        constexpr int64_t SupportedColorSwapchainFormats[] = {
+            XR_MOCK_MEMORY_FORMAT_R8G8B8A8_SRGB,
+            XR_MOCK_MEMORY_FORMAT_R8G8B8A8_UNORM,
+        };
+
+        auto swapchainFormatIt =
+            std::find_first_of(runtimeFormats.begin(), runtimeFormats.end(), std::begin(SupportedColorSwapchainFormats),
+                               std::end(SupportedColorSwapchainFormats));
+        if (swapchainFormatIt == runtimeFormats.end()) {
+            THROW("No runtime swapchain format supported for color swapchain");
+        }
+
+        return *swapchainFormatIt;
+    }
+
+    const XrBaseInStructure* GetGraphicsBinding() const override {
+        return reinterpret_cast<const XrBaseInStructure*>(&m_graphicsBinding);
+    }
+
+    std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
+        uint32_t capacity, const XrSwapchainCreateInfo& /*swapchainCreateInfo*/) override {
+        TRACE_ZONE("AllocateSwapchainImageStructs");
+        // Allocate and initialize the buffer of image structs (must be sequential in memory for xrEnumerateSwapchainImages).
+        // Return back an array of pointers to each swapchain image struct so the consumer doesn't need to know the type/size.
+        std::vector<XrSwapchainImageMemoryMOCK> swapchainImageBuffer(capacity);
+        std::vector<XrSwapchainImageBaseHeader*> swapchainImageBase;
+        for (XrSwapchainImageMemoryMOCK& image : swapchainImageBuffer) {
+            image.type = XR_TYPE_SWAPCHAIN_IMAGE_MEMORY_MOCK;
+            swapchainImageBase.push_back(reinterpret_cast<XrSwapchainImageBaseHeader*>(&image));
+        }
+
+        // Keep the buffer alive by moving it into the list of buffers.
+        m_swapchainImageBuffers.push_back(std::move(swapchainImageBuffer));
+
+        return swapchainImageBase;
+    }
+
+    bool SupportsMultiview() const override { return true; }
+
+    bool SupportsRenderPacket(GraphicsAPI* projectionApi) const override {
+        *projectionApi = GRAPHICS_VULKAN;
+        return true;
+    }
+
+    void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
+                    int64_t swapchainFormat, const std::vector<Cube>& cubes) override {
+        RenderPacketViews(m_viewPacketBuilder.BuildView(layerView, GRAPHICS_VULKAN, cubes), 0, 1, swapchainImage, swapchainFormat);
+    }
+
+    void RenderPacketViews(const RenderPacket& packet, uint32_t firstView, uint32_t viewCount,
+                           const XrSwapchainImageBaseHeader* swapchainImage, int64_t /*swapchainFormat*/) override {
+        TRACE_ZONE("RenderPacketViews");
+        BeginPass(swapchainImage, packet.LayerViews[firstView].subImage.imageRect);
+        SetViewProjections(&packet.ViewProjections[firstView], viewCount);
+        UploadInstances(packet);
+        Draw(packet);
+    }
+
+    uint32_t GetSupportedSwapchainSampleCount(const XrViewConfigurationView&) override { return 1; }
+
+    void BeginGpuFrame(uint64_t frameIndex) override {
+        m_counters = {};
+        m_counters.Frame = frameIndex;
+        m_frameOpen = true;
+        // Every frame is recorded from scratch, as into a new command buffer.
+        m_boundImage = nullptr;
+        m_viewportBound = false;
+        m_pipelineBound = false;
+    }
+
+    void CollectFrameCounters(std::vector<GraphicsFrameCounters>* counters) override {
+        // Nothing waits on a GPU, so the frame is complete once rendered.
+        if (m_frameOpen) {
+            counters->push_back(m_counters);
+            m_frameOpen = false;
+        }
+    }
+
+    void UpdateOptions(const std::shared_ptr<Options>& /*options*/) override {}
+
+   private:
+    // Bind the render target, viewport and pipeline of a pass, counting only those that differ from what is bound, as
+    // a state cache would.
+    void BeginPass(const XrSwapchainImageBaseHeader* swapchainImage, const XrRect2Di& imageRect) {
+        if (swapchainImage != m_boundImage) {
+            m_boundImage = swapchainImage;
+            m_counters.StateChanges++;
+        }
+        if (!m_viewportBound || imageRect.offset.x != m_viewport.offset.x || imageRect.offset.y != m_viewport.offset.y ||
+            imageRect.extent.width != m_viewport.extent.width || imageRect.extent.height != m_viewport.extent.height) {
+            m_viewport = imageRect;
+            m_viewportBound = true;
+            m_counters.StateChanges++;
+        }
+        if (!m_pipelineBound) {
+            m_pipelineBound = true;
+            m_counters.StateChanges++;
+        }
+    }
+
+    // Push the view-projection matrices of the pass's views as one constant update.
+    void SetViewProjections(const XrMatrix4x4f* viewProjections, uint32_t viewCount) {
+        if (m_viewProjections.size() < viewCount) {
+            m_viewProjections.resize(viewCount);
+        }
+        std::copy(viewProjections, viewProjections + viewCount, m_viewProjections.begin());
+        m_counters.StateChanges++;
+        m_counters.UploadBytes += viewCount * sizeof(XrMatrix4x4f);
+    }
+
+    // Copy the model matrices of the packet's cubes, once per frame.
+    void UploadInstances(const RenderPacket& packet) {
+        if (m_instanceFrame == packet.Frame) {
+            return;
+        }
+        if (m_models.size() < packet.ModelCount) {
+            m_models.resize(packet.ModelCount);
+        }
+        std::copy(packet.Models, packet.Models + packet.ModelCount, m_models.begin());
+
+        m_instanceFrame = packet.Frame;
+        m_counters.UploadBytes += packet.ModelCount * sizeof(XrMatrix4x4f);
+    }
+
+    void Draw(const RenderPacket& packet) {
+        if (packet.ModelCount > 0) {
+            m_counters.Draws++;
+        }
+    }
+
+    XrGraphicsBindingMemoryMOCK m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_MEMORY_MOCK};
+    std::list<std::vector<XrSwapchainImageMemoryMOCK>> m_swapchainImageBuffers;
+    // Packets of the views given to RenderView.
+    RenderPacketBuilder m_viewPacketBuilder;
+
+    // Stand in for the uniform and instance buffers. Only grow, so steady-state frames do not touch the heap.
+    std::vector<XrMatrix4x4f> m_viewProjections;
+    std::vector<XrMatrix4x4f> m_models;
+    // Frame whose models are in m_models.
+    uint64_t m_instanceFrame{UINT64_MAX};
+
+    // What a GPU plugin would have bound while recording the current frame.
+    const XrSwapchainImageBaseHeader* m_boundImage{nullptr};
+    XrRect2Di m_viewport{};
+    bool m_viewportBound{false};
+    bool m_pipelineBound{false};
+
+    GraphicsFrameCounters m_counters{};
+    // True from BeginGpuFrame until the frame's counters are collected.
+    bool m_frameOpen{false};
+};
+}  // namespace
+
+std::shared_ptr<IGraphicsPlugin> CreateGraphicsPlugin_Null(const std::shared_ptr<Options>& options,
+                                                           std::shared_ptr<IPlatformPlugin> platformPlugin) {
+    return std::make_shared<NullGraphicsPlugin>(options, platformPlugin);
+}
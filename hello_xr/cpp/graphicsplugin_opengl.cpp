@@ -7,11 +7,15 @@
 #include "geometry.h"
 #include "graphicsplugin.h"
 #include "options.h"
+#include "render_packet.h"
+#include "trace.h"
 
 #ifdef XR_USE_GRAPHICS_API_OPENGL
 
 #include <common/gfxwrapper_opengl.h>
 #include <common/xr_linear.h>
+#include "gl_state_cache.h"
+#include "gl_timestamp_queries.h"
 
 namespace {
 
@@ -20,13 +24,34 @@ static const char* VertexShaderGlsl = R"_(
 
     in vec3 VertexPos;
     in vec3 VertexColor;
+    in mat4 Model;
 
     out vec3 PSVertexColor;
 
-    uniform mat4 ModelViewProjection;
+    uniform mat4 ViewProjection;
 
     void main() {
-       gl_Position = ModelViewProjection * vec4(VertexPos, 1.0);
+       gl_Position = ViewProjection * Model * vec4(VertexPos, 1.0);
+       PSVertexColor = VertexColor;
+    }
+    )_";
+
+static const char* MultiviewVertexShaderGlsl = R"_(
+    #version 410
+    #extension GL_OVR_multiview2 : require
+
+    layout(num_views = 2) in;
+
+    in vec3 VertexPos;
+    in vec3 VertexColor;
+    in mat4 Model;
+
+    out vec3 PSVertexColor;
+
+    uniform mat4 ViewProjection[2];
+
+    void main() {
+       gl_Position = ViewProjection[gl_ViewID_OVR] * Model * vec4(VertexPos, 1.0);
        PSVertexColor = VertexColor;
     }
     )_";
@@ -42,9 +67,175 @@ static const char* FragmentShaderGlsl = R"_(
     }
     )_";
 
+// Model matrices of the cubes, read as a per-instance vertex attribute so that a view is drawn with one call. They are
+// written once per frame and drawn by every view of the frame.
+// With ARB_buffer_storage and ARB_multi_draw_indirect the matrices and the draw command are written straight into
+// persistently mapped rings of one region per frame in flight. Every frame takes the next region, and a fence placed after
+// the frame's last draw keeps the CPU from overwriting a region the GPU may still be reading. Without them the buffer is
+// orphaned and refilled every frame, and views are drawn with plain instanced draws.
+struct InstanceBuffer {
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // Call with the vertex array bound; modelAttrib is the first of the four locations of the mat4 attribute, and every
+    // instance draws indexCount indices of the bound index buffer. With persistent mapping the rings hold regionCount
+    // frames.
+    void Init(GLint modelAttrib, GLsizei indexCount, bool persistent, uint32_t regionCount, size_t capacity) {
+        m_modelAttrib = modelAttrib;
+        m_indexCount = indexCount;
+        m_persistent = persistent;
+        m_regionCount = regionCount;
+        m_fences.assign(regionCount, nullptr);
+        Reserve(capacity);
+    }
+
+    // Writes the model matrices of the packet, unless they were already written for its frame. Call with the vertex
+    // array bound.
+    void Upload(const RenderPacket& packet) {
+        if (packet.Frame == m_frame) {
+            return;
+        }
+        m_frame = packet.Frame;
+        m_count = packet.ModelCount;
+        if (m_count == 0) {
+            return;
+        }
+        if (m_count > m_capacity) {
+            Reserve(std::max<size_t>(m_count, m_capacity * 2));
+        }
+
+        if (!m_persistent) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(XrMatrix4x4f), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, m_count * sizeof(XrMatrix4x4f), packet.Models);
+            return;
+        }
+
+        m_region = (m_region + 1) % m_regionCount;
+        WaitForRegion(m_region);
+
+        const size_t firstInstance = m_region * m_capacity;
+        std::copy(packet.Models, packet.Models + m_count, m_models + firstInstance);
+        m_commands[m_region] = {static_cast<GLuint>(m_indexCount), m_count, 0, 0, static_cast<GLuint>(firstInstance)};
+    }
+
+    // Draws the instances last uploaded. Call with the vertex array and program bound.
+    void Draw() {
+        if (m_count == 0) {
+            return;
+        }
+
+        if (!m_persistent) {
+            glDrawElementsInstanced(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(m_count));
+            return;
+        }
+
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT,
+                                    reinterpret_cast<const void*>(m_region * sizeof(DrawElementsIndirectCommand)), 1, 0);
+        // The fence of the frame's last draw replaces those of its earlier views.
+        GLsync& fence = m_fences[m_region];
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Must run while the GL context is still current, so it is not left to the destructor.
+    void Release() {
+        for (GLsync& fence : m_fences) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+        // Deleting a buffer also unmaps it.
+        if (m_buffer != 0) {
+            glDeleteBuffers(1, &m_buffer);
+            m_buffer = 0;
+        }
+        if (m_indirectBuffer != 0) {
+            glDeleteBuffers(1, &m_indirectBuffer);
+            m_indirectBuffer = 0;
+        }
+        m_models = nullptr;
+        m_commands = nullptr;
+        m_capacity = 0;
+    }
+
+   private:
+    void WaitForRegion(uint32_t region) {
+        GLsync& fence = m_fences[region];
+        if (fence != nullptr) {
+            // Regions advance once per upload, which is once per frame, so this only blocks when the GPU is more than
+            // m_regionCount frames behind.
+            CHECK(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX) != GL_WAIT_FAILED);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    // Replaces the buffers with ones holding capacity instances per region. Call with the vertex array bound.
+    void Reserve(size_t capacity) {
+        for (uint32_t region = 0; region < m_regionCount; region++) {
+            WaitForRegion(region);
+        }
+        Release();
+        m_capacity = capacity;
+
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        if (m_persistent) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            const GLsizeiptr size = m_regionCount * m_capacity * sizeof(XrMatrix4x4f);
+            glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+            m_models = static_cast<XrMatrix4x4f*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+            CHECK(m_models != nullptr);
+
+            // The indirect binding is not part of the vertex array and nothing else uses it, so it stays bound.
+            const GLsizeiptr commandsSize = m_regionCount * sizeof(DrawElementsIndirectCommand);
+            glGenBuffers(1, &m_indirectBuffer);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+            glBufferStorage(GL_DRAW_INDIRECT_BUFFER, commandsSize, nullptr, flags);
+            m_commands =
+                static_cast<DrawElementsIndirectCommand*>(glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, commandsSize, flags));
+            CHECK(m_commands != nullptr);
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(XrMatrix4x4f), nullptr, GL_STREAM_DRAW);
+        }
+
+        // A mat4 attribute takes one location per column. Draws select their region with the base instance.
+        for (GLint column = 0; column < 4; column++) {
+            glEnableVertexAttribArray(m_modelAttrib + column);
+            glVertexAttribPointer(m_modelAttrib + column, 4, GL_FLOAT, GL_FALSE, sizeof(XrMatrix4x4f),
+                                  reinterpret_cast<const void*>(column * 4 * sizeof(float)));
+            glVertexAttribDivisor(m_modelAttrib + column, 1);
+        }
+    }
+
+    GLint m_modelAttrib{0};
+    GLsizei m_indexCount{0};
+    bool m_persistent{false};
+    GLuint m_buffer{0};
+    GLuint m_indirectBuffer{0};
+    XrMatrix4x4f* m_models{nullptr};
+    DrawElementsIndirectCommand* m_commands{nullptr};
+    size_t m_capacity{0};
+    uint32_t m_regionCount{1};
+    uint32_t m_region{0};
+    std::vector<GLsync> m_fences;
+    // Frame whose models were last uploaded, and their count.
+    uint64_t m_frame{UINT64_MAX};
+    uint32_t m_count{0};
+};
+
 struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
     OpenGLGraphicsPlugin(const std::shared_ptr<Options>& options, const std::shared_ptr<IPlatformPlugin> /*unused*/&)
-        : m_clearColor(options->GetBackgroundClearColor()) {}
+        : m_framesInFlight(std::max(options->FramesInFlight, 1u)), m_clearColor(options->GetBackgroundClearColor()) {}
 
     OpenGLGraphicsPlugin(const OpenGLGraphicsPlugin&) = delete;
     OpenGLGraphicsPlugin& operator=(const OpenGLGraphicsPlugin&) = delete;
@@ -52,12 +243,19 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
     OpenGLGraphicsPlugin& operator=(OpenGLGraphicsPlugin&&) = delete;
 
     ~OpenGLGraphicsPlugin() override {
-        if (m_swapchainFramebuffer != 0) {
-            glDeleteFramebuffers(1, &m_swapchainFramebuffer);
+        m_instanceBuffer.Release();
+        m_timestampQueries.Release();
+        for (auto& colorToFramebuffer : m_colorToFramebufferMap) {
+            if (colorToFramebuffer.second != 0) {
+                glDeleteFramebuffers(1, &colorToFramebuffer.second);
+            }
         }
         if (m_program != 0) {
             glDeleteProgram(m_program);
         }
+        if (m_multiviewProgram != 0) {
+            glDeleteProgram(m_multiviewProgram);
+        }
         if (m_vao != 0) {
             glDeleteVertexArrays(1, &m_vao);
         }
@@ -68,9 +266,9 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
             glDeleteBuffers(1, &m_cubeIndexBuffer);
         }
 
-        for (auto& colorToDepth : m_colorToDepthMap) {
-            if (colorToDepth.second != 0) {
-                glDeleteTextures(1, &colorToDepth.second);
+        for (auto& sharedDepth : m_sharedDepthTextures) {
+            if (sharedDepth.second != 0) {
+                glDeleteTextures(1, &sharedDepth.second);
             }
         }
 
@@ -90,6 +288,7 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
     }
 
     void InitializeDevice(XrInstance instance, XrSystemId systemId) override {
+        TRACE_ZONE("InitializeDevice");
         // Extension function must be loaded by name
         PFN_xrGetOpenGLGraphicsRequirementsKHR pfnGetOpenGLGraphicsRequirementsKHR = nullptr;
         CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrGetOpenGLGraphicsRequirementsKHR",
@@ -153,8 +352,6 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
     }
 
     void InitializeResources() {
-        glGenFramebuffers(1, &m_swapchainFramebuffer);
-
         GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertexShader, 1, &VertexShaderGlsl, nullptr);
         glCompileShader(vertexShader);
@@ -174,10 +371,15 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
 
-        m_modelViewProjectionUniformLocation = glGetUniformLocation(m_program, "ModelViewProjection");
+        m_viewProjectionUniformLocation = glGetUniformLocation(m_program, "ViewProjection");
 
         m_vertexAttribCoords = glGetAttribLocation(m_program, "VertexPos");
         m_vertexAttribColor = glGetAttribLocation(m_program, "VertexColor");
+        m_vertexAttribModel = glGetAttribLocation(m_program, "Model");
+
+        if (ksGpuContext_HasExtension("GL_OVR_multiview2") && glFramebufferTextureMultiviewOVR != nullptr) {
+            InitializeMultiviewProgram();
+        }
 
         glGenBuffers(1, &m_cubeVertexBuffer);
         glBindBuffer(GL_ARRAY_BUFFER, m_cubeVertexBuffer);
@@ -196,6 +398,50 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
         glVertexAttribPointer(m_vertexAttribCoords, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), nullptr);
         glVertexAttribPointer(m_vertexAttribColor, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex),
                               reinterpret_cast<const void*>(sizeof(XrVector3f)));
+
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        const GLint version = major * 10 + minor;
+        const bool persistent = (version >= 44 || ksGpuContext_HasExtension("GL_ARB_buffer_storage")) &&
+                                (version >= 43 || ksGpuContext_HasExtension("GL_ARB_multi_draw_indirect")) &&
+                                (version >= 42 || ksGpuContext_HasExtension("GL_ARB_base_instance")) &&
+                                glBufferStorage != nullptr && glMultiDrawElementsIndirect != nullptr;
+        Log::Write(Log::Level::Info, persistent ? "Drawing cubes from persistently mapped buffers with multi-draw indirect"
+                                                : "Drawing cubes with instancing");
+        m_instanceBuffer.Init(m_vertexAttribModel, static_cast<GLsizei>(ArraySize(Geometry::c_cubeIndices)), persistent,
+                              m_framesInFlight, InitialInstanceCapacity);
+
+        m_timestampQueries.Create(version >= 33 || ksGpuContext_HasExtension("GL_ARB_timer_query"));
+    }
+
+    // Builds the single-pass stereo program. It shares the vertex array of the regular program, so the attributes are
+    // bound to the same locations before linking.
+    void InitializeMultiviewProgram() {
+        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &MultiviewVertexShaderGlsl, nullptr);
+        glCompileShader(vertexShader);
+        CheckShader(vertexShader);
+
+        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &FragmentShaderGlsl, nullptr);
+        glCompileShader(fragmentShader);
+        CheckShader(fragmentShader);
+
+        m_multiviewProgram = glCreateProgram();
+        glAttachShader(m_multiviewProgram, vertexShader);
+        glAttachShader(m_multiviewProgram, fragmentShader);
+        glBindAttribLocation(m_multiviewProgram, m_vertexAttribCoords, "VertexPos");
+        glBindAttribLocation(m_multiviewProgram, m_vertexAttribColor, "VertexColor");
+        glBindAttribLocation(m_multiviewProgram, m_vertexAttribModel, "Model");
+        glLinkProgram(m_multiviewProgram);
+        CheckProgram(m_multiviewProgram);
+
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        m_multiviewViewProjectionUniformLocation = glGetUniformLocation(m_multiviewProgram, "ViewProjection");
     }
 
     void CheckShader(GLuint shader) {
@@ -247,6 +493,7 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
 
     std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
         uint32_t capacity, const XrSwapchainCreateInfo& /*swapchainCreateInfo*/) override {
+        TRACE_ZONE("AllocateSwapchainImageStructs");
         // Allocate and initialize the buffer of image structs (must be sequential in memory for xrEnumerateSwapchainImages).
         // Return back an array of pointers to each swapchain image struct so the consumer doesn't need to know the type/size.
         std::vector<XrSwapchainImageOpenGLKHR> swapchainImageBuffer(capacity);
@@ -262,101 +509,166 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
         return swapchainImageBase;
     }
 
-    uint32_t GetDepthTexture(uint32_t colorTexture) {
-        // If a depth-stencil view has already been created for this back-buffer, use it.
+    // layerCount > 1 means colorTexture is a texture array, and the depth texture gets a matching number of layers.
+    uint32_t GetDepthTexture(uint32_t colorTexture, uint32_t layerCount = 1) {
+        // If a depth texture has already been picked for this back-buffer, use it.
         auto depthBufferIt = m_colorToDepthMap.find(colorTexture);
         if (depthBufferIt != m_colorToDepthMap.end()) {
             return depthBufferIt->second;
         }
 
-        // This back-buffer has no corresponding depth-stencil texture, so create one with matching dimensions.
-
+        // Depth is cleared at the start of every view and never read afterwards, and the GL executes the views in
+        // submission order, so every back-buffer with the same dimensions shares one depth texture rather than each
+        // swapchain image getting its own.
+        const GLenum target = layerCount > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
         GLint width;
         GLint height;
-        glBindTexture(GL_TEXTURE_2D, colorTexture);
-        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
-        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        glBindTexture(target, colorTexture);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_HEIGHT, &height);
+
+        const std::array<uint32_t, 3> key{(uint32_t)width, (uint32_t)height, layerCount};
+        const uint64_t depthTextureBytes = (uint64_t)width * height * layerCount * DepthTexelSize;
+        auto sharedIt = m_sharedDepthTextures.find(key);
+        if (sharedIt == m_sharedDepthTextures.end()) {
+            sharedIt = m_sharedDepthTextures.insert(std::make_pair(key, CreateDepthTexture(width, height, layerCount))).first;
+            m_depthTextureBytes += depthTextureBytes;
+        }
+        m_unsharedDepthTextureBytes += depthTextureBytes;
+        m_colorToDepthMap.insert(std::make_pair(colorTexture, sharedIt->second));
+
+        constexpr double MiB = 1024.0 * 1024.0;
+        Log::Write(Log::Level::Info, Fmt("%zu color images share %zu depth textures: %.1f MiB instead of %.1f MiB, %.1f MiB saved",
+                                         m_colorToDepthMap.size(), m_sharedDepthTextures.size(), m_depthTextureBytes / MiB,
+                                         m_unsharedDepthTextureBytes / MiB,
+                                         (m_unsharedDepthTextureBytes - m_depthTextureBytes) / MiB));
+
+        return sharedIt->second;
+    }
+
+    uint32_t CreateDepthTexture(GLint width, GLint height, uint32_t layerCount) {
+        const GLenum target = layerCount > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
 
         uint32_t depthTexture;
         glGenTextures(1, &depthTexture);
-        glBindTexture(GL_TEXTURE_2D, depthTexture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-
-        m_colorToDepthMap.insert(std::make_pair(colorTexture, depthTexture));
+        glBindTexture(target, depthTexture);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (layerCount > 1) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32, width, height, layerCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT,
+                         nullptr);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        }
 
         return depthTexture;
     }
 
+    // Returns the framebuffer that renders to colorTexture and its depth texture, creating it the first time the swapchain
+    // image is drawn to (the runtime only hands out the texture names after the image structs are allocated). The
+    // attachments never change afterwards, so the driver validates each framebuffer once instead of every view.
+    uint32_t GetSwapchainFramebuffer(uint32_t colorTexture, uint32_t layerCount = 1) {
+        auto framebufferIt = m_colorToFramebufferMap.find(colorTexture);
+        if (framebufferIt != m_colorToFramebufferMap.end()) {
+            return framebufferIt->second;
+        }
+
+        const uint32_t depthTexture = GetDepthTexture(colorTexture, layerCount);
+
+        uint32_t framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        m_stateCache.BindFramebuffer(framebuffer);
+        if (layerCount > 1) {
+            glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorTexture, 0, 0, layerCount);
+            glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, 0, layerCount);
+        } else {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        }
+        CHECK_MSG(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Incomplete swapchain framebuffer");
+
+        m_colorToFramebufferMap.insert(std::make_pair(colorTexture, framebuffer));
+
+        return framebuffer;
+    }
+
+    bool SupportsMultiview() const override { return m_multiviewProgram != 0; }
+
+    bool SupportsRenderPacket(GraphicsAPI* projectionApi) const override {
+        *projectionApi = GRAPHICS_OPENGL;
+        return true;
+    }
+
     void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
                     int64_t swapchainFormat, const std::vector<Cube>& cubes) override {
-        CHECK(layerView.subImage.imageArrayIndex == 0);  // Texture arrays not supported.
-        UNUSED_PARM(swapchainFormat);                    // Not used in this function for now.
+        RenderPacketViews(m_viewPacketBuilder.BuildView(layerView, GRAPHICS_OPENGL, cubes), 0, 1, swapchainImage, swapchainFormat);
+    }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, m_swapchainFramebuffer);
+    // Render a single view, or with multiview all views in one pass into the layers of the swapchain's array texture.
+    void RenderPacketViews(const RenderPacket& packet, uint32_t firstView, uint32_t viewCount,
+                           const XrSwapchainImageBaseHeader* swapchainImage, int64_t swapchainFormat) override {
+        TRACE_ZONE("RenderPacketViews");
+        CHECK(viewCount == 1 || viewCount == MultiviewCount);
+        for (uint32_t i = 0; i < viewCount; i++) {
+            // View i of the pass must be in layer i; a single view does not render to texture arrays.
+            CHECK(packet.LayerViews[firstView + i].subImage.imageArrayIndex == i);
+        }
+        UNUSED_PARM(swapchainFormat);  // Not used in this function for now.
 
         const uint32_t colorTexture = reinterpret_cast<const XrSwapchainImageOpenGLKHR*>(swapchainImage)->image;
 
-        glViewport(static_cast<GLint>(layerView.subImage.imageRect.offset.x),
-                   static_cast<GLint>(layerView.subImage.imageRect.offset.y),
-                   static_cast<GLsizei>(layerView.subImage.imageRect.extent.width),
-                   static_cast<GLsizei>(layerView.subImage.imageRect.extent.height));
+        // The runtime shares the context and may have changed any of the cached state since the last view.
+        m_stateCache.Invalidate();
+
+        const uint32_t query = m_timestampQueries.BeginPass("Draw", m_timestampQueries.AddViews(viewCount), viewCount);
 
-        glFrontFace(GL_CW);
-        glCullFace(GL_BACK);
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_DEPTH_TEST);
+        // All views of a pass share the dimensions of the swapchain image.
+        const XrRect2Di& imageRect = packet.LayerViews[firstView].subImage.imageRect;
+        glViewport(static_cast<GLint>(imageRect.offset.x), static_cast<GLint>(imageRect.offset.y),
+                   static_cast<GLsizei>(imageRect.extent.width), static_cast<GLsizei>(imageRect.extent.height));
 
-        const uint32_t depthTexture = GetDepthTexture(colorTexture);
+        m_stateCache.FrontFace(GL_CW);
+        m_stateCache.CullFace(GL_BACK);
+        m_stateCache.Enable(GL_CULL_FACE);
+        m_stateCache.Enable(GL_DEPTH_TEST);
 
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        m_stateCache.BindFramebuffer(GetSwapchainFramebuffer(colorTexture, viewCount));
 
-        // Clear swapchain and depth buffer.
+        // Clear every layer of the swapchain and depth buffer.
         glClearColor(m_clearColor[0], m_clearColor[1], m_clearColor[2], m_clearColor[3]);
         glClearDepth(1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-        // Set shaders and uniform variables.
-        glUseProgram(m_program);
-
-        const auto& pose = layerView.pose;
-        XrMatrix4x4f proj;
-        XrMatrix4x4f_CreateProjectionFov(&proj, GRAPHICS_OPENGL, layerView.fov, 0.05f, 100.0f);
-        XrMatrix4x4f toView;
-        XrVector3f scale{1.f, 1.f, 1.f};
-        XrMatrix4x4f_CreateTranslationRotationScale(&toView, &pose.position, &pose.orientation, &scale);
-        XrMatrix4x4f view;
-        XrMatrix4x4f_InvertRigidBody(&view, &toView);
-        XrMatrix4x4f vp;
-        XrMatrix4x4f_Multiply(&vp, &proj, &view);
+        // Set shaders and uniform variables. The multiview shader transforms the cubes by the matrix of the view being
+        // rasterized.
+        const bool multiview = viewCount > 1;
+        m_stateCache.UseProgram(multiview ? m_multiviewProgram : m_program);
+        glUniformMatrix4fv(multiview ? m_multiviewViewProjectionUniformLocation : m_viewProjectionUniformLocation, viewCount,
+                           GL_FALSE, reinterpret_cast<const GLfloat*>(&packet.ViewProjections[firstView]));
 
         // Set cube primitive data.
-        glBindVertexArray(m_vao);
+        m_stateCache.BindVertexArray(m_vao);
 
-        // Render each cube
-        for (const Cube& cube : cubes) {
-            // Compute the model-view-projection transform and set it..
-            XrMatrix4x4f model;
-            XrMatrix4x4f_CreateTranslationRotationScale(&model, &cube.Pose.position, &cube.Pose.orientation, &cube.Scale);
-            XrMatrix4x4f mvp;
-            XrMatrix4x4f_Multiply(&mvp, &vp, &model);
-            glUniformMatrix4fv(m_modelViewProjectionUniformLocation, 1, GL_FALSE, reinterpret_cast<const GLfloat*>(&mvp));
+        // Render all cubes in one draw, from model matrices written by the frame's first view.
+        m_instanceBuffer.Upload(packet);
+        m_instanceBuffer.Draw();
 
-            // Draw the cube.
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(ArraySize(Geometry::c_cubeIndices)), GL_UNSIGNED_SHORT, nullptr);
-        }
+        // Leave nothing of ours bound while the runtime uses the context.
+        m_stateCache.BindVertexArray(0);
+        m_stateCache.UseProgram(0);
+        m_stateCache.BindFramebuffer(0);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        m_timestampQueries.EndPass(query);
     }
 
     uint32_t GetSupportedSwapchainSampleCount(const XrViewConfigurationView&) override { return 1; }
 
+    void BeginGpuFrame(uint64_t frameIndex) override { m_timestampQueries.BeginFrame(frameIndex); }
+
+    void CollectGpuTimings(std::vector<GpuFrameTiming>* timings) override { m_timestampQueries.Collect(timings); }
+
     void UpdateOptions(const std::shared_ptr<Options>& options) override { m_clearColor = options->GetBackgroundClearColor(); }
 
    private:
@@ -370,18 +682,42 @@ struct OpenGLGraphicsPlugin : public IGraphicsPlugin {
     XrGraphicsBindingOpenGLWaylandKHR m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_OPENGL_WAYLAND_KHR};
 #endif
 
+    // All state changes made while rendering views go through this, so redundant ones are skipped.
+    GLStateCache m_stateCache;
     std::list<std::vector<XrSwapchainImageOpenGLKHR>> m_swapchainImageBuffers;
-    GLuint m_swapchainFramebuffer{0};
+    // Packets of the views given to RenderView.
+    RenderPacketBuilder m_viewPacketBuilder;
     GLuint m_program{0};
-    GLint m_modelViewProjectionUniformLocation{0};
+    GLint m_viewProjectionUniformLocation{0};
+    // Number of views MultiviewVertexShaderGlsl is compiled for.
+    static constexpr uint32_t MultiviewCount = 2;
+    // Zero unless GL_OVR_multiview2 is available.
+    GLuint m_multiviewProgram{0};
+    GLint m_multiviewViewProjectionUniformLocation{0};
     GLint m_vertexAttribCoords{0};
     GLint m_vertexAttribColor{0};
+    GLint m_vertexAttribModel{0};
     GLuint m_vao{0};
     GLuint m_cubeVertexBuffer{0};
     GLuint m_cubeIndexBuffer{0};
-
+    static constexpr size_t InitialInstanceCapacity = 64;
+    // Frames the instance buffer's rings hold before uploading waits for the GPU.
+    const uint32_t m_framesInFlight;
+    InstanceBuffer m_instanceBuffer;
+    // GPU time of every view, or of every multiview pass.
+    GLTimestampQueries m_timestampQueries;
+
+    // Map color buffer to the framebuffer rendering to it. This map is populated on demand.
+    std::map<uint32_t, uint32_t> m_colorToFramebufferMap;
     // Map color buffer to associated depth buffer. This map is populated on demand.
     std::map<uint32_t, uint32_t> m_colorToDepthMap;
+    // Depth textures shared by all color buffers of the same width, height and layer count; these own the textures.
+    std::map<std::array<uint32_t, 3>, uint32_t> m_sharedDepthTextures;
+    // Bytes per texel of GL_DEPTH_COMPONENT32.
+    static constexpr uint32_t DepthTexelSize = 4;
+    // Depth memory actually allocated, and what one depth texture per color buffer would have taken.
+    uint64_t m_depthTextureBytes{0};
+    uint64_t m_unsharedDepthTextureBytes{0};
     std::array<float, 4> m_clearColor;
 };
 }  // namespace
@@ -7,11 +7,15 @@
 #include "geometry.h"
 #include "graphicsplugin.h"
 #include "options.h"
+#include "render_packet.h"
+#include "trace.h"
 
 #ifdef XR_USE_GRAPHICS_API_OPENGL_ES
 
 #include "gfxwrapper_opengl.h"
 #include <common/xr_linear.h>
+#include "gl_state_cache.h"
+#include "gl_timestamp_queries.h"
 
 namespace {
 
@@ -31,6 +35,25 @@ static const char* VertexShaderGlsl = R"_(#version 320 es
     }
     )_";
 
+// The version statement has come on first line.
+static const char* MultiviewVertexShaderGlsl = R"_(#version 320 es
+    #extension GL_OVR_multiview2 : require
+
+    layout(num_views = 2) in;
+
+    in vec3 VertexPos;
+    in vec3 VertexColor;
+
+    out vec3 PSVertexColor;
+
+    uniform mat4 ModelViewProjection[2];
+
+    void main() {
+       gl_Position = ModelViewProjection[gl_ViewID_OVR] * vec4(VertexPos, 1.0);
+       PSVertexColor = VertexColor;
+    }
+    )_";
+
 // The version statement has come on first line.
 static const char* FragmentShaderGlsl = R"_(#version 320 es
 
@@ -44,7 +67,7 @@ static const char* FragmentShaderGlsl = R"_(#version 320 es
 
 struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
     OpenGLESGraphicsPlugin(const std::shared_ptr<Options>& options, const std::shared_ptr<IPlatformPlugin> /*unused*/&)
-        : m_clearColor(options->GetBackgroundClearColor()) {}
+        : m_clearColor(options->GetBackgroundClearColor()), m_msaaSamples(options->MsaaSamples), m_skipClear(options->SkipClear) {}
 
     OpenGLESGraphicsPlugin(const OpenGLESGraphicsPlugin&) = delete;
     OpenGLESGraphicsPlugin& operator=(const OpenGLESGraphicsPlugin&) = delete;
@@ -52,12 +75,18 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
     OpenGLESGraphicsPlugin& operator=(OpenGLESGraphicsPlugin&&) = delete;
 
     ~OpenGLESGraphicsPlugin() override {
-        if (m_swapchainFramebuffer != 0) {
-            glDeleteFramebuffers(1, &m_swapchainFramebuffer);
+        m_timestampQueries.Release();
+        for (auto& colorToFramebuffer : m_colorToFramebufferMap) {
+            if (colorToFramebuffer.second != 0) {
+                glDeleteFramebuffers(1, &colorToFramebuffer.second);
+            }
         }
         if (m_program != 0) {
             glDeleteProgram(m_program);
         }
+        if (m_multiviewProgram != 0) {
+            glDeleteProgram(m_multiviewProgram);
+        }
         if (m_vao != 0) {
             glDeleteVertexArrays(1, &m_vao);
         }
@@ -68,9 +97,14 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
             glDeleteBuffers(1, &m_cubeIndexBuffer);
         }
 
-        for (auto& colorToDepth : m_colorToDepthMap) {
-            if (colorToDepth.second != 0) {
-                glDeleteTextures(1, &colorToDepth.second);
+        for (auto& sharedDepth : m_sharedDepthTextures) {
+            if (sharedDepth.second != 0) {
+                glDeleteTextures(1, &sharedDepth.second);
+            }
+        }
+        for (auto& sharedDepth : m_sharedDepthRenderbuffers) {
+            if (sharedDepth.second != 0) {
+                glDeleteRenderbuffers(1, &sharedDepth.second);
             }
         }
 
@@ -90,6 +124,7 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
     }
 
     void InitializeDevice(XrInstance instance, XrSystemId systemId) override {
+        TRACE_ZONE("InitializeDevice");
         // Extension function must be loaded by name
         PFN_xrGetOpenGLESGraphicsRequirementsKHR pfnGetOpenGLESGraphicsRequirementsKHR = nullptr;
         CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrGetOpenGLESGraphicsRequirementsKHR",
@@ -138,8 +173,6 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
     }
 
     void InitializeResources() {
-        glGenFramebuffers(1, &m_swapchainFramebuffer);
-
         GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
         glShaderSource(vertexShader, 1, &VertexShaderGlsl, nullptr);
         glCompileShader(vertexShader);
@@ -164,6 +197,29 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
         m_vertexAttribCoords = glGetAttribLocation(m_program, "VertexPos");
         m_vertexAttribColor = glGetAttribLocation(m_program, "VertexColor");
 
+        if (ksGpuContext_HasExtension("GL_OVR_multiview2") && glFramebufferTextureMultiviewOVR != nullptr) {
+            InitializeMultiviewProgram();
+        }
+
+        // Multisample in tile memory and resolve as the tiles are written out, rather than in a separate resolve pass.
+        if (m_msaaSamples > 1) {
+            if (ksGpuContext_HasExtension("GL_EXT_multisampled_render_to_texture") &&
+                glFramebufferTexture2DMultisampleEXT != nullptr && glRenderbufferStorageMultisampleEXT != nullptr) {
+                GLint maxSamples = 1;
+                glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+                m_msaaSamples = std::min(m_msaaSamples, (uint32_t)maxSamples);
+                if (ksGpuContext_HasExtension("GL_OVR_multiview_multisampled_render_to_texture") &&
+                    glFramebufferTextureMultisampleMultiviewOVR != nullptr) {
+                    m_multiviewMsaaSamples = m_msaaSamples;
+                }
+                Log::Write(Log::Level::Info,
+                           Fmt("Rendering with %ux MSAA (%ux for multiview)", m_msaaSamples, m_multiviewMsaaSamples));
+            } else {
+                Log::Write(Log::Level::Warning, "GL_EXT_multisampled_render_to_texture is not supported; rendering without MSAA");
+                m_msaaSamples = 1;
+            }
+        }
+
         glGenBuffers(1, &m_cubeVertexBuffer);
         glBindBuffer(GL_ARRAY_BUFFER, m_cubeVertexBuffer);
         glBufferData(GL_ARRAY_BUFFER, sizeof(Geometry::c_cubeVertices), Geometry::c_cubeVertices, GL_STATIC_DRAW);
@@ -181,6 +237,35 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
         glVertexAttribPointer(m_vertexAttribCoords, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex), nullptr);
         glVertexAttribPointer(m_vertexAttribColor, 3, GL_FLOAT, GL_FALSE, sizeof(Geometry::Vertex),
                               reinterpret_cast<const void*>(sizeof(XrVector3f)));
+
+        m_timestampQueries.Create(ksGpuContext_HasExtension("GL_EXT_disjoint_timer_query"));
+    }
+
+    // Builds the single-pass stereo program. It shares the vertex array of the regular program, so the attributes are
+    // bound to the same locations before linking.
+    void InitializeMultiviewProgram() {
+        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &MultiviewVertexShaderGlsl, nullptr);
+        glCompileShader(vertexShader);
+        CheckShader(vertexShader);
+
+        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &FragmentShaderGlsl, nullptr);
+        glCompileShader(fragmentShader);
+        CheckShader(fragmentShader);
+
+        m_multiviewProgram = glCreateProgram();
+        glAttachShader(m_multiviewProgram, vertexShader);
+        glAttachShader(m_multiviewProgram, fragmentShader);
+        glBindAttribLocation(m_multiviewProgram, m_vertexAttribCoords, "VertexPos");
+        glBindAttribLocation(m_multiviewProgram, m_vertexAttribColor, "VertexColor");
+        glLinkProgram(m_multiviewProgram);
+        CheckProgram(m_multiviewProgram);
+
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        m_multiviewModelViewProjectionUniformLocation = glGetUniformLocation(m_multiviewProgram, "ModelViewProjection");
     }
 
     void CheckShader(GLuint shader) {
@@ -230,6 +315,7 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
 
     std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
         uint32_t capacity, const XrSwapchainCreateInfo& /*swapchainCreateInfo*/) override {
+        TRACE_ZONE("AllocateSwapchainImageStructs");
         // Allocate and initialize the buffer of image structs (must be sequential in memory for xrEnumerateSwapchainImages).
         // Return back an array of pointers to each swapchain image struct so the consumer doesn't need to know the type/size.
         std::vector<XrSwapchainImageOpenGLESKHR> swapchainImageBuffer(capacity);
@@ -245,14 +331,45 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
         return swapchainImageBase;
     }
 
-    uint32_t GetDepthTexture(uint32_t colorTexture) {
-        // If a depth-stencil view has already been created for this back-buffer, use it.
+    // layerCount > 1 means colorTexture is a texture array, and the depth texture gets a matching number of layers.
+    uint32_t GetDepthTexture(uint32_t colorTexture, uint32_t layerCount = 1) {
+        // If a depth texture has already been picked for this back-buffer, use it.
         auto depthBufferIt = m_colorToDepthMap.find(colorTexture);
         if (depthBufferIt != m_colorToDepthMap.end()) {
             return depthBufferIt->second;
         }
 
-        // This back-buffer has no corresponding depth-stencil texture, so create one with matching dimensions.
+        // Depth is cleared at the start of every view and never read afterwards, and the GL executes the views in
+        // submission order, so every back-buffer with the same dimensions shares one depth texture rather than each
+        // swapchain image getting its own.
+        const GLenum target = layerCount > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+        GLint width;
+        GLint height;
+        glBindTexture(target, colorTexture);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(target, 0, GL_TEXTURE_HEIGHT, &height);
+
+        const std::array<uint32_t, 3> key{(uint32_t)width, (uint32_t)height, layerCount};
+        const uint64_t depthTextureBytes = (uint64_t)width * height * layerCount * DepthTexelSize;
+        auto sharedIt = m_sharedDepthTextures.find(key);
+        if (sharedIt == m_sharedDepthTextures.end()) {
+            sharedIt = m_sharedDepthTextures.insert(std::make_pair(key, CreateDepthTexture(width, height, layerCount))).first;
+            m_depthTextureBytes += depthTextureBytes;
+        }
+        m_unsharedDepthTextureBytes += depthTextureBytes;
+        m_colorToDepthMap.insert(std::make_pair(colorTexture, sharedIt->second));
+        LogDepthMemory();
+
+        return sharedIt->second;
+    }
+
+    // Single-view rendering with EXT_multisampled_render_to_texture needs multisampled depth. Like the color samples it
+    // only ever lives in tile memory, so it is a renderbuffer, again shared by every back-buffer of the same size.
+    uint32_t GetMultisampledDepthRenderbuffer(uint32_t colorTexture) {
+        auto depthBufferIt = m_colorToDepthMap.find(colorTexture);
+        if (depthBufferIt != m_colorToDepthMap.end()) {
+            return depthBufferIt->second;
+        }
 
         GLint width;
         GLint height;
@@ -260,107 +377,258 @@ struct OpenGLESGraphicsPlugin : public IGraphicsPlugin {
         glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
         glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
 
+        const std::array<uint32_t, 3> key{(uint32_t)width, (uint32_t)height, m_msaaSamples};
+        const uint64_t depthBufferBytes = (uint64_t)width * height * m_msaaSamples * DepthTexelSize;
+        auto sharedIt = m_sharedDepthRenderbuffers.find(key);
+        if (sharedIt == m_sharedDepthRenderbuffers.end()) {
+            uint32_t depthRenderbuffer;
+            glGenRenderbuffers(1, &depthRenderbuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+            glRenderbufferStorageMultisampleEXT(GL_RENDERBUFFER, m_msaaSamples, GL_DEPTH_COMPONENT24, width, height);
+            sharedIt = m_sharedDepthRenderbuffers.insert(std::make_pair(key, depthRenderbuffer)).first;
+            m_depthTextureBytes += depthBufferBytes;
+        }
+        m_unsharedDepthTextureBytes += depthBufferBytes;
+        m_colorToDepthMap.insert(std::make_pair(colorTexture, sharedIt->second));
+        LogDepthMemory();
+
+        return sharedIt->second;
+    }
+
+    void LogDepthMemory() const {
+        constexpr double MiB = 1024.0 * 1024.0;
+        Log::Write(Log::Level::Info, Fmt("%zu color images share %zu depth buffers: %.1f MiB instead of %.1f MiB, %.1f MiB saved",
+                                         m_colorToDepthMap.size(), m_sharedDepthTextures.size() + m_sharedDepthRenderbuffers.size(),
+                                         m_depthTextureBytes / MiB, m_unsharedDepthTextureBytes / MiB,
+                                         (m_unsharedDepthTextureBytes - m_depthTextureBytes) / MiB));
+    }
+
+    uint32_t CreateDepthTexture(GLint width, GLint height, uint32_t layerCount) {
+        const GLenum target = layerCount > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+
         uint32_t depthTexture;
         glGenTextures(1, &depthTexture);
-        glBindTexture(GL_TEXTURE_2D, depthTexture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
-
-        m_colorToDepthMap.insert(std::make_pair(colorTexture, depthTexture));
+        glBindTexture(target, depthTexture);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (layerCount > 1) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, width, height, layerCount, 0, GL_DEPTH_COMPONENT,
+                         GL_UNSIGNED_INT, nullptr);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        }
 
         return depthTexture;
     }
 
+    // Returns the framebuffer that renders to colorTexture and its depth texture, creating it the first time the swapchain
+    // image is drawn to (the runtime only hands out the texture names after the image structs are allocated). The
+    // attachments never change afterwards, so the driver validates each framebuffer once instead of every view.
+    uint32_t GetSwapchainFramebuffer(uint32_t colorTexture, uint32_t layerCount = 1) {
+        auto framebufferIt = m_colorToFramebufferMap.find(colorTexture);
+        if (framebufferIt != m_colorToFramebufferMap.end()) {
+            return framebufferIt->second;
+        }
+
+        uint32_t framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        m_stateCache.BindFramebuffer(framebuffer);
+        if (layerCount > 1) {
+            const uint32_t depthTexture = GetDepthTexture(colorTexture, layerCount);
+            if (m_multiviewMsaaSamples > 1) {
+                glFramebufferTextureMultisampleMultiviewOVR(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorTexture, 0,
+                                                            m_multiviewMsaaSamples, 0, layerCount);
+                glFramebufferTextureMultisampleMultiviewOVR(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0,
+                                                            m_multiviewMsaaSamples, 0, layerCount);
+            } else {
+                glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorTexture, 0, 0, layerCount);
+                glFramebufferTextureMultiviewOVR(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, 0, layerCount);
+            }
+        } else if (m_msaaSamples > 1) {
+            const uint32_t depthRenderbuffer = GetMultisampledDepthRenderbuffer(colorTexture);
+            glFramebufferTexture2DMultisampleEXT(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0,
+                                                 m_msaaSamples);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        } else {
+            const uint32_t depthTexture = GetDepthTexture(colorTexture);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        }
+        CHECK_MSG(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Incomplete swapchain framebuffer");
+
+        m_colorToFramebufferMap.insert(std::make_pair(colorTexture, framebuffer));
+
+        return framebuffer;
+    }
+
+    // Clears the bound swapchain framebuffer. With SkipClear the scene is trusted to cover every pixel, so color is
+    // invalidated instead: a tiler then neither loads the old contents nor spends time clearing them.
+    void ClearSwapchainFramebuffer() {
+        if (m_skipClear) {
+            static const GLenum colorAttachment = GL_COLOR_ATTACHMENT0;
+            glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &colorAttachment);
+            glClearDepthf(1.0f);
+            glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        } else {
+            glClearColor(m_clearColor[0], m_clearColor[1], m_clearColor[2], m_clearColor[3]);
+            glClearDepthf(1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        }
+    }
+
+    // Depth is not needed once a view is drawn. Saying so lets a tiler drop it instead of writing it back to memory.
+    void InvalidateDepth() {
+        static const std::array<GLenum, 2> depthAttachments{{GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT}};
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, (GLsizei)depthAttachments.size(), depthAttachments.data());
+    }
+
+    bool SupportsMultiview() const override { return m_multiviewProgram != 0; }
+
+    bool SupportsRenderPacket(GraphicsAPI* projectionApi) const override {
+        *projectionApi = GRAPHICS_OPENGL_ES;
+        return true;
+    }
+
     void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
                     int64_t swapchainFormat, const std::vector<Cube>& cubes) override {
-        CHECK(layerView.subImage.imageArrayIndex == 0);  // Texture arrays not supported.
-        UNUSED_PARM(swapchainFormat);                    // Not used in this function for now.
+        const RenderPacket packet = m_viewPacketBuilder.BuildView(layerView, GRAPHICS_OPENGL_ES, cubes);
+        RenderPacketViews(packet, 0, 1, swapchainImage, swapchainFormat);
+    }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, m_swapchainFramebuffer);
+    // Render a single view, or with multiview all views in one pass into the layers of the swapchain's array texture.
+    void RenderPacketViews(const RenderPacket& packet, uint32_t firstView, uint32_t viewCount,
+                           const XrSwapchainImageBaseHeader* swapchainImage, int64_t swapchainFormat) override {
+        TRACE_ZONE("RenderPacketViews");
+        CHECK(viewCount == 1 || viewCount == MultiviewCount);
+        for (uint32_t i = 0; i < viewCount; i++) {
+            // View i of the pass must be in layer i; a single view does not render to texture arrays.
+            CHECK(packet.LayerViews[firstView + i].subImage.imageArrayIndex == i);
+        }
+        UNUSED_PARM(swapchainFormat);  // Not used in this function for now.
 
         const uint32_t colorTexture = reinterpret_cast<const XrSwapchainImageOpenGLESKHR*>(swapchainImage)->image;
 
-        glViewport(static_cast<GLint>(layerView.subImage.imageRect.offset.x),
-                   static_cast<GLint>(layerView.subImage.imageRect.offset.y),
-                   static_cast<GLsizei>(layerView.subImage.imageRect.extent.width),
-                   static_cast<GLsizei>(layerView.subImage.imageRect.extent.height));
+        // The runtime shares the context and may have changed any of the cached state since the last view.
+        m_stateCache.Invalidate();
+
+        const uint32_t query = m_timestampQueries.BeginPass("Draw", m_timestampQueries.AddViews(viewCount), viewCount);
 
-        glFrontFace(GL_CW);
-        glCullFace(GL_BACK);
-        glEnable(GL_CULL_FACE);
-        glEnable(GL_DEPTH_TEST);
+        // All views of a pass share the dimensions of the swapchain image.
+        const XrRect2Di& imageRect = packet.LayerViews[firstView].subImage.imageRect;
+        glViewport(static_cast<GLint>(imageRect.offset.x), static_cast<GLint>(imageRect.offset.y),
+                   static_cast<GLsizei>(imageRect.extent.width), static_cast<GLsizei>(imageRect.extent.height));
 
-        const uint32_t depthTexture = GetDepthTexture(colorTexture);
+        m_stateCache.FrontFace(GL_CW);
+        m_stateCache.CullFace(GL_BACK);
+        m_stateCache.Enable(GL_CULL_FACE);
+        m_stateCache.Enable(GL_DEPTH_TEST);
 
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        m_stateCache.BindFramebuffer(GetSwapchainFramebuffer(colorTexture, viewCount));
 
-        // Clear swapchain and depth buffer.
-        glClearColor(m_clearColor[0], m_clearColor[1], m_clearColor[2], m_clearColor[3]);
-        glClearDepthf(1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        // Clear every layer of the swapchain and depth buffer.
+        ClearSwapchainFramebuffer();
 
         // Set shaders and uniform variables.
-        glUseProgram(m_program);
-
-        const auto& pose = layerView.pose;
-        XrMatrix4x4f proj;
-        XrMatrix4x4f_CreateProjectionFov(&proj, GRAPHICS_OPENGL_ES, layerView.fov, 0.05f, 100.0f);
-        XrMatrix4x4f toView;
-        XrVector3f scale{1.f, 1.f, 1.f};
-        XrMatrix4x4f_CreateTranslationRotationScale(&toView, &pose.position, &pose.orientation, &scale);
-        XrMatrix4x4f view;
-        XrMatrix4x4f_InvertRigidBody(&view, &toView);
-        XrMatrix4x4f vp;
-        XrMatrix4x4f_Multiply(&vp, &proj, &view);
+        const bool multiview = viewCount > 1;
+        m_stateCache.UseProgram(multiview ? m_multiviewProgram : m_program);
+        const GLint mvpLocation =
+            multiview ? m_multiviewModelViewProjectionUniformLocation : m_modelViewProjectionUniformLocation;
 
         // Set cube primitive data.
-        glBindVertexArray(m_vao);
-
-        // Render each cube
-        for (const Cube& cube : cubes) {
-            // Compute the model-view-projection transform and set it..
-            XrMatrix4x4f model;
-            XrMatrix4x4f_CreateTranslationRotationScale(&model, &cube.Pose.position, &cube.Pose.orientation, &cube.Scale);
-            XrMatrix4x4f mvp;
-            XrMatrix4x4f_Multiply(&mvp, &vp, &model);
-            glUniformMatrix4fv(m_modelViewProjectionUniformLocation, 1, GL_FALSE, reinterpret_cast<const GLfloat*>(&mvp));
+        m_stateCache.BindVertexArray(m_vao);
+
+        // Render each cube once; the multiview shader transforms it by the matrix of the view being rasterized.
+        const XrMatrix4x4f* vp = &packet.ViewProjections[firstView];
+        std::array<XrMatrix4x4f, MultiviewCount> mvp;
+        for (uint32_t cube = 0; cube < packet.ModelCount; cube++) {
+            for (uint32_t i = 0; i < viewCount; i++) {
+                XrMatrix4x4f_Multiply(&mvp[i], &vp[i], &packet.Models[cube]);
+            }
+            glUniformMatrix4fv(mvpLocation, viewCount, GL_FALSE, reinterpret_cast<const GLfloat*>(mvp.data()));
 
             // Draw the cube.
             glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(ArraySize(Geometry::c_cubeIndices)), GL_UNSIGNED_SHORT, nullptr);
         }
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        InvalidateDepth();
+
+        // Leave nothing of ours bound while the runtime uses the context.
+        m_stateCache.BindVertexArray(0);
+        m_stateCache.UseProgram(0);
+        m_stateCache.BindFramebuffer(0);
+
+        m_timestampQueries.EndPass(query);
     }
 
     uint32_t GetSupportedSwapchainSampleCount(const XrViewConfigurationView&) override { return 1; }
 
-    void UpdateOptions(const std::shared_ptr<Options>& options) override { m_clearColor = options->GetBackgroundClearColor(); }
+    void BeginGpuFrame(uint64_t frameIndex) override { m_timestampQueries.BeginFrame(frameIndex); }
+
+    void CollectGpuTimings(std::vector<GpuFrameTiming>* timings) override {
+        if (!m_timestampQueries.Enabled()) {
+            return;
+        }
+        // Timestamps taken across a disjoint event, such as a GPU frequency change, cannot be compared.
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT, &disjoint);
+        if (disjoint != 0) {
+            m_timestampQueries.DropPending();
+        }
+        m_timestampQueries.Collect(timings);
+    }
+
+    void UpdateOptions(const std::shared_ptr<Options>& options) override {
+        m_clearColor = options->GetBackgroundClearColor();
+        m_skipClear = options->SkipClear;
+    }
 
    private:
 #ifdef XR_USE_PLATFORM_ANDROID
     XrGraphicsBindingOpenGLESAndroidKHR m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_OPENGL_ES_ANDROID_KHR};
 #endif
 
+    // All state changes made while rendering views go through this, so redundant ones are skipped.
+    GLStateCache m_stateCache;
     std::list<std::vector<XrSwapchainImageOpenGLESKHR>> m_swapchainImageBuffers;
-    GLuint m_swapchainFramebuffer{0};
+    // Packets of the views given to RenderView.
+    RenderPacketBuilder m_viewPacketBuilder;
     GLuint m_program{0};
     GLint m_modelViewProjectionUniformLocation{0};
+    // Number of views MultiviewVertexShaderGlsl is compiled for.
+    static constexpr uint32_t MultiviewCount = 2;
+    // Zero unless GL_OVR_multiview2 is available.
+    GLuint m_multiviewProgram{0};
+    GLint m_multiviewModelViewProjectionUniformLocation{0};
     GLint m_vertexAttribCoords{0};
     GLint m_vertexAttribColor{0};
     GLuint m_vao{0};
     GLuint m_cubeVertexBuffer{0};
     GLuint m_cubeIndexBuffer{0};
     GLint m_contextApiMajorVersion{0};
+    // GPU time of every view, or of every multiview pass.
+    GLTimestampQueries m_timestampQueries;
 
+    // Map color buffer to the framebuffer rendering to it. This map is populated on demand.
+    std::map<uint32_t, uint32_t> m_colorToFramebufferMap;
     // Map color buffer to associated depth buffer. This map is populated on demand.
     std::map<uint32_t, uint32_t> m_colorToDepthMap;
+    // Depth textures shared by all color buffers of the same width, height and layer count; these own the textures.
+    std::map<std::array<uint32_t, 3>, uint32_t> m_sharedDepthTextures;
+    // Multisampled depth renderbuffers, keyed by width, height and sample count.
+    std::map<std::array<uint32_t, 3>, uint32_t> m_sharedDepthRenderbuffers;
+    // Bytes per texel of GL_DEPTH_COMPONENT24, which is stored in 32 bits.
+    static constexpr uint32_t DepthTexelSize = 4;
+    // Depth memory actually allocated, and what one depth texture per color buffer would have taken.
+    uint64_t m_depthTextureBytes{0};
+    uint64_t m_unsharedDepthTextureBytes{0};
     std::array<float, 4> m_clearColor;
+    // Samples per pixel of single-view and multiview rendering; 1 unless EXT_multisampled_render_to_texture (and for
+    // multiview OVR_multiview_multisampled_render_to_texture) is available.
+    uint32_t m_msaaSamples;
+    uint32_t m_multiviewMsaaSamples{1};
+    bool m_skipClear;
 };
 }  // namespace
 
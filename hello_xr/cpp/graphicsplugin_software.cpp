@@ -0,0 +1,613 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "geometry.h"
+#include "graphicsplugin.h"
+#include "job_system.h"
+#include "options.h"
+#include "render_packet.h"
+#include "trace.h"
+#include "mock_runtime/mock_runtime.h"
+
+#include <common/xr_linear.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Adjacent pixels of a row, one per SIMD lane, on the widest vector unit the build targets. Float holds a value per pixel
+// and Mask a per-pixel condition; stores only write the lanes whose mask is set.
+#if defined(__AVX2__)
+struct Lanes {
+    static constexpr uint32_t Width = 8;
+    using Float = __m256;
+    using Mask = __m256;
+
+    static const char* Name() { return "AVX2"; }
+    static Float Broadcast(float value) { return _mm256_set1_ps(value); }
+    static Float Ramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+    static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float Load(const float* p) { return _mm256_load_ps(p); }
+    static Mask GreaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static Mask Less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+    static bool Any(Mask mask) { return _mm256_movemask_ps(mask) != 0; }
+    static void Store(float* p, Mask mask, Float value) { _mm256_store_ps(p, _mm256_blendv_ps(_mm256_load_ps(p), value, mask)); }
+    static void Store(uint32_t* p, Mask mask, uint32_t value) {
+        const __m256 old = _mm256_castsi256_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(p)));
+        const __m256 broadcast = _mm256_castsi256_ps(_mm256_set1_epi32((int)value));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(p), _mm256_castps_si256(_mm256_blendv_ps(old, broadcast, mask)));
+    }
+};
+#elif defined(SOFTWARE_RASTERIZER_SSE2)
+struct Lanes {
+    static constexpr uint32_t Width = 4;
+    using Float = __m128;
+    using Mask = __m128;
+
+    static const char* Name() { return "SSE2"; }
+    static Float Broadcast(float value) { return _mm_set1_ps(value); }
+    static Float Ramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+    static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float Load(const float* p) { return _mm_load_ps(p); }
+    static Mask GreaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+    static Mask Less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+    static Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+    static bool Any(Mask mask) { return _mm_movemask_ps(mask) != 0; }
+    static void Store(float* p, Mask mask, Float value) {
+        _mm_store_ps(p, _mm_or_ps(_mm_and_ps(mask, value), _mm_andnot_ps(mask, _mm_load_ps(p))));
+    }
+    static void Store(uint32_t* p, Mask mask, uint32_t value) {
+        const __m128i old = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i select = _mm_castps_si128(mask);
+        _mm_store_si128(reinterpret_cast<__m128i*>(p),
+                        _mm_or_si128(_mm_and_si128(select, _mm_set1_epi32((int)value)), _mm_andnot_si128(select, old)));
+    }
+};
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+struct Lanes {
+    static constexpr uint32_t Width = 4;
+    using Float = float32x4_t;
+    using Mask = uint32x4_t;
+
+    static const char* Name() { return "NEON"; }
+    static Float Broadcast(float value) { return vdupq_n_f32(value); }
+    static Float Ramp() {
+        static const float ramp[Width] = {0.0f, 1.0f, 2.0f, 3.0f};
+        return vld1q_f32(ramp);
+    }
+    static Float Add(Float a, Float b) { return vaddq_f32(a, b); }
+    static Float Mul(Float a, Float b) { return vmulq_f32(a, b); }
+    static Float Load(const float* p) { return vld1q_f32(p); }
+    static Mask GreaterEqual(Float a, Float b) { return vcgeq_f32(a, b); }
+    static Mask Less(Float a, Float b) { return vcltq_f32(a, b); }
+    static Mask And(Mask a, Mask b) { return vandq_u32(a, b); }
+    static bool Any(Mask mask) {
+        const uint32x2_t halves = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+        return (vget_lane_u32(halves, 0) | vget_lane_u32(halves, 1)) != 0;
+    }
+    static void Store(float* p, Mask mask, Float value) { vst1q_f32(p, vbslq_f32(mask, value, vld1q_f32(p))); }
+    static void Store(uint32_t* p, Mask mask, uint32_t value) { vst1q_u32(p, vbslq_u32(mask, vdupq_n_u32(value), vld1q_u32(p))); }
+};
+#else
+struct Lanes {
+    static constexpr uint32_t Width = 1;
+    using Float = float;
+    using Mask = bool;
+
+    static const char* Name() { return "scalar"; }
+    static Float Broadcast(float value) { return value; }
+    static Float Ramp() { return 0.0f; }
+    static Float Add(Float a, Float b) { return a + b; }
+    static Float Mul(Float a, Float b) { return a * b; }
+    static Float Load(const float* p) { return *p; }
+    static Mask GreaterEqual(Float a, Float b) { return a >= b; }
+    static Mask Less(Float a, Float b) { return a < b; }
+    static Mask And(Mask a, Mask b) { return a && b; }
+    static bool Any(Mask mask) { return mask; }
+    static void Store(float* p, Mask mask, Float value) {
+        if (mask) {
+            *p = value;
+        }
+    }
+    static void Store(uint32_t* p, Mask mask, uint32_t value) {
+        if (mask) {
+            *p = value;
+        }
+    }
+};
+#endif
+
+// Side of the square screen tiles the target is rasterized in. A tile's color and depth stay in the rasterizing thread's
+// cache until the tile is done, and every tile is rasterized by one job, so no two threads touch the same pixel.
+constexpr uint32_t TileSize = 64;
+static_assert(TileSize % Lanes::Width == 0, "Tile rows must hold whole groups of lanes");
+
+// Cubes whose triangles one job transforms, sets up and bins.
+constexpr uint32_t CubesPerChunk = 64;
+
+constexpr uint32_t CubeCornerCount = 8;
+constexpr uint32_t CubeTriangleCount = (uint32_t)ArraySize(Geometry::c_cubeIndices) / 3;
+
+// Corner i of the cube is at -0.5 or +0.5 on X, Y and Z as bits 0, 1 and 2 of i are clear or set.
+uint32_t CubeCornerIndex(const XrVector3f& position) {
+    return (position.x > 0 ? 1 : 0) | (position.y > 0 ? 2 : 0) | (position.z > 0 ? 4 : 0);
+}
+
+float EncodeSrgb(float linear) {
+    linear = std::min(std::max(linear, 0.0f), 1.0f);
+    return linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+// Pixel of an R8G8B8A8 swapchain image, as the 32-bit word it is stored as in little-endian memory.
+uint32_t PackColor(float r, float g, float b, float a, bool srgb) {
+    const auto toByte = [](float value) { return (uint32_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    if (srgb) {
+        r = EncodeSrgb(r);
+        g = EncodeSrgb(g);
+        b = EncodeSrgb(b);
+    }
+    return toByte(r) | toByte(g) << 8 | toByte(b) << 16 | toByte(a) << 24;
+}
+
+// A triangle set up for rasterizing, in pixels of the swapchain image with y pointing down.
+struct Triangle {
+    // Edge functions A * x + B * y + C, which are positive inside the triangle. A pixel center is covered when all three
+    // are at least Bias: zero for top and left edges and the smallest positive float for the others, so a pixel center on
+    // an edge shared by two triangles is drawn by one of them only.
+    float A[3];
+    float B[3];
+    float C[3];
+    float Bias[3];
+    // Depth plane: z = Zx * x + Zy * y + Z0.
+    float Zx;
+    float Zy;
+    float Z0;
+    // Pixels the triangle may cover, clipped to the viewport. Max is exclusive.
+    int32_t MinX;
+    int32_t MinY;
+    int32_t MaxX;
+    int32_t MaxY;
+    uint32_t Color;
+};
+
+// Clip space position, as computed by the view-projection and model matrices.
+struct ClipVertex {
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+// Bits of the clip volume planes a vertex is outside of. With the Vulkan projection the volume is -w <= x, y <= w and
+// 0 <= z <= w.
+constexpr uint32_t OutsideLeft = 1;
+constexpr uint32_t OutsideRight = 2;
+constexpr uint32_t OutsideTop = 4;
+constexpr uint32_t OutsideBottom = 8;
+constexpr uint32_t OutsideNear = 16;
+constexpr uint32_t OutsideFar = 32;
+
+uint32_t ComputeOutcode(const ClipVertex& v) {
+    return (v.x < -v.w ? OutsideLeft : 0u) | (v.x > v.w ? OutsideRight : 0u) | (v.y < -v.w ? OutsideTop : 0u) |
+           (v.y > v.w ? OutsideBottom : 0u) | (v.z < 0 ? OutsideNear : 0u) | (v.z > v.w ? OutsideFar : 0u);
+}
+
+// Clip a triangle against the near plane, z >= 0. Returns the vertex count of the resulting convex polygon, 0, 3 or 4, in
+// the winding order of the triangle.
+uint32_t ClipNear(const ClipVertex (&triangle)[3], ClipVertex (&polygon)[4]) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 3; i++) {
+        const ClipVertex& a = triangle[i];
+        const ClipVertex& b = triangle[(i + 1) % 3];
+        if (a.z >= 0) {
+            polygon[count++] = a;
+        }
+        if ((a.z >= 0) != (b.z >= 0)) {
+            const float t = a.z / (a.z - b.z);
+            polygon[count++] = {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, 0.0f, a.w + (b.w - a.w) * t};
+        }
+    }
+    return count;
+}
+
+// Triangles of a range of cubes, and which of them may cover each tile.
+struct TriangleChunk {
+    std::vector<Triangle> triangles;
+    // Per tile, indices into triangles in drawing order. Kept from frame to frame so the lists rarely reallocate.
+    std::vector<std::vector<uint32_t>> bins;
+};
+
+// Rasterizes the cubes on the CPU, into the memory swapchain images of the mock runtime. Each view is drawn in two
+// parallel passes over the job system: the cubes are split into chunks whose triangles are transformed, clipped, set up
+// and binned to the screen tiles they touch, then every tile clears its color and depth, rasterizes its bins in cube
+// order a group of SIMD lanes at a time, and copies the result to the swapchain image. Drawing follows the Vulkan
+// plugins: the same projection and clockwise front faces with back faces culled, and a depth test of less than.
+struct SoftwareGraphicsPlugin : public IGraphicsPlugin {
+    SoftwareGraphicsPlugin(const std::shared_ptr<Options>& options, const std::shared_ptr<IPlatformPlugin> /*unused*/&)
+        : m_clearColor(options->GetBackgroundClearColor()) {}
+
+    SoftwareGraphicsPlugin(const SoftwareGraphicsPlugin&) = delete;
+    SoftwareGraphicsPlugin& operator=(const SoftwareGraphicsPlugin&) = delete;
+    SoftwareGraphicsPlugin(SoftwareGraphicsPlugin&&) = delete;
+    SoftwareGraphicsPlugin& operator=(SoftwareGraphicsPlugin&&) = delete;
+
+    std::vector<std::string> GetInstanceExtensions() const override { return {XR_MOCK_MEMORY_SWAPCHAIN_EXTENSION_NAME}; }
+
+    void InitializeDevice(XrInstance /*instance*/, XrSystemId /*systemId*/) override {
+        TRACE_ZONE("InitializeDevice");
+        // Index the cube's triangles by corner, so each cube transforms its eight corners only once.
+        for (uint32_t i = 0; i < CubeTriangleCount; i++) {
+            for (uint32_t j = 0; j < 3; j++) {
+                const Geometry::Vertex& vertex = Geometry::c_cubeVertices[Geometry::c_cubeIndices[i * 3 + j]];
+                m_cubeTriangles[i].corners[j] = CubeCornerIndex(vertex.Position);
+                m_cubeTriangles[i].color = vertex.Color;
+            }
+        }
+        for (uint32_t i = 0; i < CubeCornerCount; i++) {
+            m_cubeCorners[i] = {i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f, 1.0f};
+        }
+
+        Log::Write(Log::Level::Info, Fmt("Software rasterizer: %s, %u lanes, %ux%u tiles", Lanes::Name(), Lanes::Width,
+                                         TileSize, TileSize));
+    }
+
+    int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& runtimeFormats) const override {
+        // List of supported color swapchain formats.
+        constexpr int64_t SupportedColorSwapchainFormats[] = {
+            XR_MOCK_MEMORY_FORMAT_R8G8B8A8_SRGB,
+            XR_MOCK_MEMORY_FORMAT_R8G8B8A8_UNORM,
+        };
+
+        auto swapchainFormatIt =
+            std::find_first_of(runtimeFormats.begin(), runtimeFormats.end(), std::begin(SupportedColorSwapchainFormats),
+                               std::end(SupportedColorSwapchainFormats));
+        if (swapchainFormatIt == runtimeFormats.end()) {
+            THROW("No runtime swapchain format supported for color swapchain");
+        }
+
+        return *swapchainFormatIt;
+    }
+
+    const XrBaseInStructure* GetGraphicsBinding() const override {
+        return reinterpret_cast<const XrBaseInStructure*>(&m_graphicsBinding);
+    }
+
+    std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
+        uint32_t capacity, const XrSwapchainCreateInfo& /*swapchainCreateInfo*/) override {
+        TRACE_ZONE("AllocateSwapchainImageStructs");
+        // Allocate and initialize the buffer of image structs (must be sequential in memory for xrEnumerateSwapchainImages).
+        // Return back an array of pointers to each swapchain image struct so the consumer doesn't need to know the type/size.
+        std::vector<XrSwapchainImageMemoryMOCK> swapchainImageBuffer(capacity);
+        std::vector<XrSwapchainImageBaseHeader*> swapchainImageBase;
+        for (XrSwapchainImageMemoryMOCK& image : swapchainImageBuffer) {
+            image.type = XR_TYPE_SWAPCHAIN_IMAGE_MEMORY_MOCK;
+            swapchainImageBase.push_back(reinterpret_cast<XrSwapchainImageBaseHeader*>(&image));
+        }
+
+        // Keep the buffer alive by moving it into the list of buffers.
+        m_swapchainImageBuffers.push_back(std::move(swapchainImageBuffer));
+
+        return swapchainImageBase;
+    }
+
+    bool SupportsRenderPacket(GraphicsAPI* projectionApi) const override {
+        *projectionApi = GRAPHICS_VULKAN;
+        return true;
+    }
+
+    void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
+                    int64_t swapchainFormat, const std::vector<Cube>& cubes) override {
+        RenderPacketViews(m_viewPacketBuilder.BuildView(layerView, GRAPHICS_VULKAN, cubes), 0, 1, swapchainImage, swapchainFormat);
+    }
+
+    void RenderPacketViews(const RenderPacket& packet, uint32_t firstView, uint32_t viewCount,
+                           const XrSwapchainImageBaseHeader* swapchainImage, int64_t swapchainFormat) override {
+        TRACE_ZONE("RenderPacketViews");
+        CHECK(viewCount == 1);  // Multiview not supported.
+        const XrCompositionLayerProjectionView& layerView = packet.LayerViews[firstView];
+        const auto& image = *reinterpret_cast<const XrSwapchainImageMemoryMOCK*>(swapchainImage);
+        const XrRect2Di& imageRect = layerView.subImage.imageRect;
+
+        Target target;
+        target.data = static_cast<uint8_t*>(image.data) + (size_t)image.slicePitch * layerView.subImage.imageArrayIndex;
+        target.rowPitch = image.rowPitch;
+        target.x = imageRect.offset.x;
+        target.y = imageRect.offset.y;
+        target.width = imageRect.extent.width;
+        target.height = imageRect.extent.height;
+        target.tilesX = (target.width + TileSize - 1) / TileSize;
+        target.tilesY = (target.height + TileSize - 1) / TileSize;
+
+        const bool srgb = swapchainFormat == XR_MOCK_MEMORY_FORMAT_R8G8B8A8_SRGB;
+        target.clearColor = PackColor(m_clearColor[0], m_clearColor[1], m_clearColor[2], m_clearColor[3], srgb);
+        for (uint32_t i = 0; i < CubeTriangleCount; i++) {
+            const XrVector3f& color = m_cubeTriangles[i].color;
+            target.triangleColors[i] = PackColor(color.x, color.y, color.z, 1.0f, srgb);
+        }
+
+        target.viewProjection = packet.ViewProjections[firstView];
+
+        const uint32_t chunkCount = (packet.ModelCount + CubesPerChunk - 1) / CubesPerChunk;
+        if (m_chunks.size() < chunkCount) {
+            m_chunks.resize(chunkCount);
+        }
+
+        {
+            TRACE_ZONE("Bin");
+            // Ranges start at multiples of CubesPerChunk, and span several chunks when run on this thread alone.
+            ParallelFor(packet.ModelCount, CubesPerChunk, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t chunk = begin / CubesPerChunk; chunk * CubesPerChunk < end; chunk++) {
+                    BinCubes(target, packet.Models, chunk * CubesPerChunk, std::min(end, (chunk + 1) * CubesPerChunk),
+                             m_chunks[chunk]);
+                }
+            });
+        }
+
+        {
+            TRACE_ZONE("Rasterize");
+            ParallelFor(target.tilesX * target.tilesY, 1, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t tile = begin; tile < end; tile++) {
+                    RasterizeTile(target, chunkCount, tile);
+                }
+            });
+        }
+    }
+
+    uint32_t GetSupportedSwapchainSampleCount(const XrViewConfigurationView&) override { return 1; }
+
+    void SetJobSystem(const std::shared_ptr<JobSystem>& jobSystem) override { m_jobSystem = jobSystem; }
+
+    void UpdateOptions(const std::shared_ptr<Options>& options) override { m_clearColor = options->GetBackgroundClearColor(); }
+
+   private:
+    // Where and how one view is drawn.
+    struct Target {
+        uint8_t* data;
+        uint32_t rowPitch;
+        // Image rect of the view, and the tiles covering it, row by row from its top left.
+        int32_t x;
+        int32_t y;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tilesX;
+        uint32_t tilesY;
+        uint32_t clearColor;
+        uint32_t triangleColors[CubeTriangleCount];
+        XrMatrix4x4f viewProjection;
+    };
+
+    struct CubeTriangle {
+        uint32_t corners[3];
+        XrVector3f color;
+    };
+
+    template <typename Function>
+    void ParallelFor(uint32_t count, uint32_t grainSize, const Function& function) {
+        if (m_jobSystem) {
+            m_jobSystem->ParallelFor(count, grainSize, function);
+        } else if (count > 0) {
+            function(0u, count);
+        }
+    }
+
+    // Transform, clip and set up the triangles of the cubes with models [begin, end) and bin them into the chunk.
+    void BinCubes(const Target& target, const XrMatrix4x4f* models, uint32_t begin, uint32_t end, TriangleChunk& chunk) const {
+        const uint32_t tileCount = target.tilesX * target.tilesY;
+        chunk.triangles.clear();
+        chunk.bins.resize(tileCount);
+        for (uint32_t tile = 0; tile < tileCount; tile++) {
+            chunk.bins[tile].clear();
+        }
+
+        for (uint32_t i = begin; i < end; i++) {
+            XrMatrix4x4f mvp;
+            XrMatrix4x4f_Multiply(&mvp, &target.viewProjection, &models[i]);
+
+            ClipVertex corners[CubeCornerCount];
+            uint32_t outcodes[CubeCornerCount];
+            for (uint32_t c = 0; c < CubeCornerCount; c++) {
+                XrVector4f position;
+                XrMatrix4x4f_TransformVector4f(&position, &mvp, &m_cubeCorners[c]);
+                corners[c] = {position.x, position.y, position.z, position.w};
+                outcodes[c] = ComputeOutcode(corners[c]);
+            }
+
+            for (uint32_t t = 0; t < CubeTriangleCount; t++) {
+                const uint32_t* index = m_cubeTriangles[t].corners;
+                // Entirely outside one of the planes.
+                if ((outcodes[index[0]] & outcodes[index[1]] & outcodes[index[2]]) != 0) {
+                    continue;
+                }
+
+                const ClipVertex triangle[3] = {corners[index[0]], corners[index[1]], corners[index[2]]};
+                const uint32_t color = target.triangleColors[t];
+                if (((outcodes[index[0]] | outcodes[index[1]] | outcodes[index[2]]) & OutsideNear) == 0) {
+                    SetUpTriangle(target, triangle[0], triangle[1], triangle[2], color, chunk);
+                    continue;
+                }
+
+                ClipVertex polygon[4];
+                const uint32_t count = ClipNear(triangle, polygon);
+                for (uint32_t v = 2; v < count; v++) {
+                    SetUpTriangle(target, polygon[0], polygon[v - 1], polygon[v], color, chunk);
+                }
+            }
+        }
+    }
+
+    // Project a triangle in front of the near plane to the viewport, cull it if it faces away, and add it to the bins of
+    // the tiles it may cover.
+    static void SetUpTriangle(const Target& target, const ClipVertex& c0, const ClipVertex& c1, const ClipVertex& c2,
+                              uint32_t color, TriangleChunk& chunk) {
+        const auto toScreen = [&](const ClipVertex& c) {
+            return XrVector3f{target.x + (c.x / c.w * 0.5f + 0.5f) * target.width,
+                              target.y + (c.y / c.w * 0.5f + 0.5f) * target.height, c.z / c.w};
+        };
+        const XrVector3f v[3] = {toScreen(c0), toScreen(c1), toScreen(c2)};
+
+        // Twice the signed area, positive for the clockwise front faces since y points down.
+        const float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if (!(area > 0)) {
+            return;
+        }
+
+        Triangle tri;
+        const float minX = std::max(std::floor(std::min({v[0].x, v[1].x, v[2].x})), (float)target.x);
+        const float minY = std::max(std::floor(std::min({v[0].y, v[1].y, v[2].y})), (float)target.y);
+        const float maxX = std::min(std::ceil(std::max({v[0].x, v[1].x, v[2].x})), (float)(target.x + target.width));
+        const float maxY = std::min(std::ceil(std::max({v[0].y, v[1].y, v[2].y})), (float)(target.y + target.height));
+        if (!(minX < maxX && minY < maxY)) {
+            return;
+        }
+        tri.MinX = (int32_t)minX;
+        tri.MinY = (int32_t)minY;
+        tri.MaxX = (int32_t)maxX;
+        tri.MaxY = (int32_t)maxY;
+
+        for (uint32_t i = 0; i < 3; i++) {
+            const XrVector3f& a = v[i];
+            const XrVector3f& b = v[(i + 1) % 3];
+            tri.A[i] = a.y - b.y;
+            tri.B[i] = b.x - a.x;
+            tri.C[i] = -(tri.A[i] * a.x + tri.B[i] * a.y);
+            // Edges going up are left edges, and horizontal ones going right are top edges.
+            const bool topLeft = tri.A[i] > 0 || (tri.A[i] == 0 && tri.B[i] > 0);
+            tri.Bias[i] = topLeft ? 0.0f : std::numeric_limits<float>::min();
+        }
+
+        tri.Zx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+        tri.Zy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+        tri.Z0 = v[0].z - tri.Zx * v[0].x - tri.Zy * v[0].y;
+        tri.Color = color;
+
+        const uint32_t index = (uint32_t)chunk.triangles.size();
+        chunk.triangles.push_back(tri);
+
+        const uint32_t tileMinX = (tri.MinX - target.x) / TileSize;
+        const uint32_t tileMinY = (tri.MinY - target.y) / TileSize;
+        const uint32_t tileMaxX = (tri.MaxX - 1 - target.x) / TileSize;
+        const uint32_t tileMaxY = (tri.MaxY - 1 - target.y) / TileSize;
+        for (uint32_t ty = tileMinY; ty <= tileMaxY; ty++) {
+            for (uint32_t tx = tileMinX; tx <= tileMaxX; tx++) {
+                // Skip tiles whose pixel centers are all outside one of the edges, which the bounding box alone misses
+                // for long thin triangles.
+                const float left = target.x + tx * TileSize + 0.5f;
+                const float top = target.y + ty * TileSize + 0.5f;
+                bool outside = false;
+                for (uint32_t i = 0; i < 3 && !outside; i++) {
+                    const float x = tri.A[i] > 0 ? left + TileSize - 1 : left;
+                    const float y = tri.B[i] > 0 ? top + TileSize - 1 : top;
+                    outside = tri.A[i] * x + tri.B[i] * y + tri.C[i] < tri.Bias[i];
+                }
+                if (!outside) {
+                    chunk.bins[ty * target.tilesX + tx].push_back(index);
+                }
+            }
+        }
+    }
+
+    void RasterizeTile(const Target& target, uint32_t chunkCount, uint32_t tile) const {
+        alignas(32) uint32_t color[TileSize * TileSize];
+        alignas(32) float depth[TileSize * TileSize];
+        std::fill(std::begin(color), std::end(color), target.clearColor);
+        std::fill(std::begin(depth), std::end(depth), 1.0f);
+
+        const int32_t tileX = target.x + (int32_t)((tile % target.tilesX) * TileSize);
+        const int32_t tileY = target.y + (int32_t)((tile / target.tilesX) * TileSize);
+        for (uint32_t c = 0; c < chunkCount; c++) {
+            const TriangleChunk& chunk = m_chunks[c];
+            for (uint32_t index : chunk.bins[tile]) {
+                RasterizeTriangle(chunk.triangles[index], tileX, tileY, color, depth);
+            }
+        }
+
+        const uint32_t width = std::min(TileSize, target.x + target.width - tileX);
+        const uint32_t height = std::min(TileSize, target.y + target.height - tileY);
+        for (uint32_t row = 0; row < height; row++) {
+            uint8_t* dst = target.data + (size_t)target.rowPitch * (tileY + row) + (size_t)tileX * sizeof(uint32_t);
+            memcpy(dst, color + row * TileSize, width * sizeof(uint32_t));
+        }
+    }
+
+    // Draw the part of a triangle inside the tile at (tileX, tileY) into its color and depth.
+    static void RasterizeTriangle(const Triangle& tri, int32_t tileX, int32_t tileY, uint32_t* color, float* depth) {
+        const int32_t minX = std::max(tri.MinX, tileX);
+        const int32_t minY = std::max(tri.MinY, tileY);
+        const int32_t maxX = std::min(tri.MaxX, tileX + (int32_t)TileSize);
+        const int32_t maxY = std::min(tri.MaxY, tileY + (int32_t)TileSize);
+        if (minX >= maxX || minY >= maxY) {
+            return;
+        }
+
+        // Start each row on a whole group of lanes, so loads and stores are aligned. The lanes left of minX are outside
+        // the triangle, and lanes right of the viewport are never copied out.
+        const int32_t startX = tileX + ((minX - tileX) & ~(int32_t)(Lanes::Width - 1));
+        const Lanes::Float ramp = Lanes::Ramp();
+        Lanes::Float step[3];
+        Lanes::Float bias[3];
+        for (uint32_t i = 0; i < 3; i++) {
+            step[i] = Lanes::Broadcast(tri.A[i] * Lanes::Width);
+            bias[i] = Lanes::Broadcast(tri.Bias[i]);
+        }
+        const Lanes::Float zStep = Lanes::Broadcast(tri.Zx * Lanes::Width);
+
+        for (int32_t y = minY; y < maxY; y++) {
+            // Sample at pixel centers.
+            const float px = startX + 0.5f;
+            const float py = y + 0.5f;
+            Lanes::Float e[3];
+            for (uint32_t i = 0; i < 3; i++) {
+                e[i] = Lanes::Add(Lanes::Broadcast(tri.A[i] * px + tri.B[i] * py + tri.C[i]),
+                                  Lanes::Mul(ramp, Lanes::Broadcast(tri.A[i])));
+            }
+            Lanes::Float z =
+                Lanes::Add(Lanes::Broadcast(tri.Zx * px + tri.Zy * py + tri.Z0), Lanes::Mul(ramp, Lanes::Broadcast(tri.Zx)));
+
+            for (int32_t x = startX; x < maxX; x += Lanes::Width) {
+                const Lanes::Mask inside =
+                    Lanes::And(Lanes::And(Lanes::GreaterEqual(e[0], bias[0]), Lanes::GreaterEqual(e[1], bias[1])),
+                               Lanes::GreaterEqual(e[2], bias[2]));
+                if (Lanes::Any(inside)) {
+                    const uint32_t pixel = (y - tileY) * TileSize + (x - tileX);
+                    const Lanes::Mask visible = Lanes::And(inside, Lanes::Less(z, Lanes::Load(depth + pixel)));
+                    Lanes::Store(depth + pixel, visible, z);
+                    Lanes::Store(color + pixel, visible, tri.Color);
+                }
+                for (uint32_t i = 0; i < 3; i++) {
+                    e[i] = Lanes::Add(e[i], step[i]);
+                }
+                z = Lanes::Add(z, zStep);
+            }
+        }
+    }
+
+    XrGraphicsBindingMemoryMOCK m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_MEMORY_MOCK};
+    std::list<std::vector<XrSwapchainImageMemoryMOCK>> m_swapchainImageBuffers;
+    // Packets of the views given to RenderView.
+    RenderPacketBuilder m_viewPacketBuilder;
+    std::shared_ptr<JobSystem> m_jobSystem;
+    XrVector4f m_cubeCorners[CubeCornerCount];
+    CubeTriangle m_cubeTriangles[CubeTriangleCount];
+    // Reused by every view; only the first chunkCount of them hold the cubes of the view being drawn.
+    std::vector<TriangleChunk> m_chunks;
+    std::array<float, 4> m_clearColor;
+};
+}  // namespace
+
+std::shared_ptr<IGraphicsPlugin> CreateGraphicsPlugin_Software(const std::shared_ptr<Options>& options,
+                                                               std::shared_ptr<IPlatformPlugin> platformPlugin) {
+    return std::make_shared<SoftwareGraphicsPlugin>(options, platformPlugin);
+}
@@ -6,11 +6,18 @@
 #include "common.h"
 #include "geometry.h"
 #include "graphicsplugin.h"
+#include "gpu_timer.h"
+#include "job_system.h"
 #include "options.h"
+#include "render_packet.h"
+#include "trace.h"
 
 #ifdef XR_USE_GRAPHICS_API_VULKAN
 
 #include <common/xr_linear.h>
+#include <utils/nanoseconds.h>
+
+#include <fstream>
 
 #ifdef USE_ONLINE_VULKAN_SHADERC
 #include <shaderc/shaderc.hpp>
@@ -112,11 +119,12 @@ constexpr char VertexShaderGlsl[] =
 
     layout (std140, push_constant) uniform buf
     {
-        mat4 mvp;
+        mat4 viewProjection;
     } ubuf;
 
     layout (location = 0) in vec3 Position;
     layout (location = 1) in vec3 Color;
+    layout (location = 2) in mat4 Model;
 
     layout (location = 0) out vec4 oColor;
     out gl_PerVertex
@@ -126,8 +134,38 @@ constexpr char VertexShaderGlsl[] =
 
     void main()
     {
-        oColor.rgba  = Color.rgba;
-        gl_Position = ubuf.mvp * Position;
+        oColor.rgb  = Color;
+        oColor.a  = 1.0;
+        gl_Position = ubuf.viewProjection * Model * vec4(Position, 1);
+    }
+)_";
+
+constexpr char MultiviewVertexShaderGlsl[] =
+    R"_(
+    #version 430
+    #extension GL_ARB_separate_shader_objects : enable
+    #extension GL_EXT_multiview : enable
+
+    layout (std140, push_constant) uniform buf
+    {
+        mat4 viewProjection[2];
+    } ubuf;
+
+    layout (location = 0) in vec3 Position;
+    layout (location = 1) in vec3 Color;
+    layout (location = 2) in mat4 Model;
+
+    layout (location = 0) out vec4 oColor;
+    out gl_PerVertex
+    {
+        vec4 gl_Position;
+    };
+
+    void main()
+    {
+        oColor.rgb  = Color;
+        oColor.a  = 1.0;
+        gl_Position = ubuf.viewProjection[gl_ViewIndex] * Model * vec4(Position, 1);
     }
 )_";
 
@@ -145,37 +183,345 @@ constexpr char FragmentShaderGlsl[] =
         FragColor = oColor;
     }
 )_";
+
+constexpr char CullComputeShaderGlsl[] =
+    R"_(
+    #version 450
+
+    layout (local_size_x = 64) in;
+
+    layout (std140, binding = 0) uniform CullParams
+    {
+        // Six inward facing, normalized planes per view. With a single view the second set repeats the first.
+        vec4 planes[12];
+        // Bounding sphere radius of an unscaled instance.
+        float radius;
+        uint instanceCount;
+    } params;
+
+    layout (std430, binding = 1) readonly buffer Instances
+    {
+        mat4 models[];
+    } instances;
+
+    layout (std430, binding = 2) writeonly buffer VisibleInstances
+    {
+        mat4 models[];
+    } visible;
+
+    layout (std430, binding = 3) buffer DrawCommand
+    {
+        uint indexCount;
+        uint instanceCount;
+        uint firstIndex;
+        int vertexOffset;
+        uint firstInstance;
+    } draw;
+
+    float PlaneDistance(int plane, vec3 point)
+    {
+        return dot(params.planes[plane].xyz, point) + params.planes[plane].w;
+    }
+
+    // True if a sphere is at least partly inside the six planes starting at first.
+    bool InsideFrustum(int first, vec3 center, float radius)
+    {
+        float d = min(min(min(PlaneDistance(first, center), PlaneDistance(first + 1, center)),
+                          min(PlaneDistance(first + 2, center), PlaneDistance(first + 3, center))),
+                      min(PlaneDistance(first + 4, center), PlaneDistance(first + 5, center)));
+        return d >= -radius;
+    }
+
+    void main()
+    {
+        uint index = gl_GlobalInvocationID.x;
+        if (index < params.instanceCount)
+        {
+            mat4 model = instances.models[index];
+            vec3 center = model[3].xyz;
+            float radius = params.radius * max(max(length(model[0].xyz), length(model[1].xyz)), length(model[2].xyz));
+            bool inside0 = InsideFrustum(0, center, radius);
+            bool inside1 = InsideFrustum(6, center, radius);
+            if (inside0 || inside1)
+            {
+                uint slot = atomicAdd(draw.instanceCount, 1u);
+                visible.models[slot] = model;
+            }
+        }
+    }
+)_";
 #endif  // USE_ONLINE_VULKAN_SHADERC
 
+struct MemoryBlock;
+
+// A range of device memory handed out by MemoryAllocator. Bind resources at memory + offset.
+struct MemoryAllocation {
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkDeviceSize offset{0};
+    VkDeviceSize size{0};
+    // Host address of the allocation if its memory is host visible, otherwise null. Host-visible blocks stay mapped.
+    void* mapped{nullptr};
+    MemoryBlock* block{nullptr};
+};
+
+// Whether a resource is linear (buffers) or an optimally tiled image. The two must not share a bufferImageGranularity
+// page, so when the device has a granularity above one they are kept in different blocks.
+enum class MemoryTiling { Linear, Optimal };
+
+// One vkAllocateMemory allocation carved up by first fit. Free ranges are kept sorted by offset and merged with their
+// neighbours on release, so the block never needs defragmenting.
+struct MemoryBlock {
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    VkDeviceSize size{0};
+    uint32_t memoryTypeIndex{0};
+    MemoryTiling tiling{MemoryTiling::Linear};
+    // Holds a single oversized allocation and is released with it.
+    bool dedicated{false};
+    uint8_t* mapped{nullptr};
+    // Offset to size of every free range.
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+    VkDeviceSize usedBytes{0};
+    uint32_t allocationCount{0};
+
+    bool Allocate(VkDeviceSize allocSize, VkDeviceSize alignment, VkDeviceSize* offset) {
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+            const VkDeviceSize rangeStart = it->first;
+            const VkDeviceSize rangeEnd = it->first + it->second;
+            const VkDeviceSize start = (rangeStart + alignment - 1) / alignment * alignment;
+            if (start + allocSize > rangeEnd) {
+                continue;
+            }
+
+            freeRanges.erase(it);
+            if (start > rangeStart) {
+                freeRanges[rangeStart] = start - rangeStart;
+            }
+            if (start + allocSize < rangeEnd) {
+                freeRanges[start + allocSize] = rangeEnd - (start + allocSize);
+            }
+            *offset = start;
+            usedBytes += allocSize;
+            allocationCount++;
+            return true;
+        }
+        return false;
+    }
+
+    void Free(VkDeviceSize offset, VkDeviceSize allocSize) {
+        usedBytes -= allocSize;
+        allocationCount--;
+
+        auto next = freeRanges.lower_bound(offset);
+        if (next != freeRanges.end() && offset + allocSize == next->first) {
+            allocSize += next->second;
+            next = freeRanges.erase(next);
+        }
+        if (next != freeRanges.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += allocSize;
+                return;
+            }
+        }
+        freeRanges[offset] = allocSize;
+    }
+
+    VkDeviceSize LargestFreeRange() const {
+        VkDeviceSize largest = 0;
+        for (const auto& range : freeRanges) {
+            largest = std::max(largest, range.second);
+        }
+        return largest;
+    }
+};
+
+// Sub-allocates device memory from large per memory type blocks, so the number of live vkAllocateMemory allocations
+// (capped by maxMemoryAllocationCount) grows with the amount of memory used rather than with the number of resources.
 struct MemoryAllocator {
+    // Size of the blocks shared by ordinary allocations. Anything larger than half a block gets a dedicated block.
+    static constexpr VkDeviceSize BlockSize = 32 * 1024 * 1024;
+
+    struct HeapStatistics {
+        VkDeviceSize heapSize{0};
+        VkMemoryHeapFlags flags{0};
+        uint32_t blockCount{0};
+        VkDeviceSize blockBytes{0};
+        uint32_t allocationCount{0};
+        VkDeviceSize usedBytes{0};
+        VkDeviceSize largestFreeRange{0};
+    };
+
+    MemoryAllocator() = default;
+
+    ~MemoryAllocator() {
+        if (m_vkDevice != nullptr) {
+            for (auto& block : m_blocks) {
+                ReleaseBlock(*block);
+            }
+        }
+        m_blocks.clear();
+        m_vkDevice = nullptr;
+    }
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+    MemoryAllocator(MemoryAllocator&&) = delete;
+    MemoryAllocator& operator=(MemoryAllocator&&) = delete;
+
     void Init(VkPhysicalDevice physicalDevice, VkDevice device) {
         m_vkDevice = device;
         vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memProps);
+
+        VkPhysicalDeviceProperties props{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+        m_bufferImageGranularity = props.limits.bufferImageGranularity;
+        m_maxAllocationCount = props.limits.maxMemoryAllocationCount;
     }
 
     static const VkFlags defaultFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
-    void Allocate(VkMemoryRequirements const& memReqs, VkDeviceMemory* mem, VkFlags flags = defaultFlags,
-                  const void* pNext = nullptr) const {
+    void Allocate(VkMemoryRequirements const& memReqs, MemoryAllocation* allocation, VkFlags flags = defaultFlags,
+                  MemoryTiling tiling = MemoryTiling::Linear) {
+        const uint32_t memoryTypeIndex = FindMemoryType(memReqs.memoryTypeBits, flags);
+        if (m_bufferImageGranularity <= 1) {
+            tiling = MemoryTiling::Linear;
+        }
+
+        // Lazily allocated memory is only backed as the GPU touches it, so it is not worth sharing a block.
+        const bool dedicated = memReqs.size > BlockSize / 2 || (flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+        VkDeviceSize offset = 0;
+        MemoryBlock* block = nullptr;
+        if (!dedicated) {
+            for (auto& candidate : m_blocks) {
+                if (!candidate->dedicated && candidate->memoryTypeIndex == memoryTypeIndex && candidate->tiling == tiling &&
+                    candidate->Allocate(memReqs.size, memReqs.alignment, &offset)) {
+                    block = candidate.get();
+                    break;
+                }
+            }
+        }
+        if (block == nullptr) {
+            // Small heaps (e.g. on integrated or software devices) get smaller blocks.
+            const VkDeviceSize heapSize = m_memProps.memoryHeaps[m_memProps.memoryTypes[memoryTypeIndex].heapIndex].size;
+            const VkDeviceSize blockSize = dedicated ? memReqs.size : std::max(std::min(BlockSize, heapSize / 8), memReqs.size);
+            block = CreateBlock(memoryTypeIndex, tiling, blockSize, dedicated);
+            CHECK(block->Allocate(memReqs.size, memReqs.alignment, &offset));
+        }
+
+        allocation->memory = block->memory;
+        allocation->offset = offset;
+        allocation->size = memReqs.size;
+        allocation->mapped = block->mapped != nullptr ? block->mapped + offset : nullptr;
+        allocation->block = block;
+    }
+
+    // Return an allocation to its block. Dedicated blocks are released at once; shared blocks are kept for reuse.
+    void Free(MemoryAllocation* allocation) {
+        MemoryBlock* block = allocation->block;
+        if (block != nullptr) {
+            block->Free(allocation->offset, allocation->size);
+            if (block->dedicated && block->allocationCount == 0) {
+                ReleaseBlock(*block);
+                m_blocks.erase(std::find_if(m_blocks.begin(), m_blocks.end(),
+                                            [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; }));
+            }
+        }
+        *allocation = {};
+    }
+
+    // Usage of every memory heap, indexed like VkPhysicalDeviceMemoryProperties::memoryHeaps.
+    std::vector<HeapStatistics> GetHeapStatistics() const {
+        std::vector<HeapStatistics> heaps(m_memProps.memoryHeapCount);
+        for (uint32_t i = 0; i < m_memProps.memoryHeapCount; i++) {
+            heaps[i].heapSize = m_memProps.memoryHeaps[i].size;
+            heaps[i].flags = m_memProps.memoryHeaps[i].flags;
+        }
+        for (const auto& block : m_blocks) {
+            HeapStatistics& heap = heaps[m_memProps.memoryTypes[block->memoryTypeIndex].heapIndex];
+            heap.blockCount++;
+            heap.blockBytes += block->size;
+            heap.allocationCount += block->allocationCount;
+            heap.usedBytes += block->usedBytes;
+            heap.largestFreeRange = std::max(heap.largestFreeRange, block->LargestFreeRange());
+        }
+        return heaps;
+    }
+
+    void LogStatistics(Log::Level level) const {
+        constexpr double MiB = 1024.0 * 1024.0;
+        const std::vector<HeapStatistics> heaps = GetHeapStatistics();
+        for (uint32_t i = 0; i < heaps.size(); i++) {
+            const HeapStatistics& heap = heaps[i];
+            if (heap.blockCount == 0) {
+                continue;
+            }
+            Log::Write(level, Fmt("Memory heap %u (%s, %.1f MiB): %u blocks, %.2f MiB reserved, %.2f MiB used by %u "
+                                  "allocations, largest free range %.2f MiB",
+                                  i, (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0 ? "device local" : "host",
+                                  heap.heapSize / MiB, heap.blockCount, heap.blockBytes / MiB, heap.usedBytes / MiB,
+                                  heap.allocationCount, heap.largestFreeRange / MiB));
+        }
+        Log::Write(level, Fmt("Device memory allocations: %zu of %u", m_blocks.size(), m_maxAllocationCount));
+    }
+
+    // True if one of the memory types in memoryTypeBits has all of flags.
+    bool HasMemoryType(uint32_t memoryTypeBits, VkFlags flags) const {
+        for (uint32_t i = 0; i < m_memProps.memoryTypeCount; ++i) {
+            if ((memoryTypeBits & (1 << i)) != 0u && (m_memProps.memoryTypes[i].propertyFlags & flags) == flags) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+   private:
+    uint32_t FindMemoryType(uint32_t memoryTypeBits, VkFlags flags) const {
         // Search memtypes to find first index with those properties
         for (uint32_t i = 0; i < m_memProps.memoryTypeCount; ++i) {
-            if ((memReqs.memoryTypeBits & (1 << i)) != 0u) {
+            if ((memoryTypeBits & (1 << i)) != 0u) {
                 // Type is available, does it match user properties?
                 if ((m_memProps.memoryTypes[i].propertyFlags & flags) == flags) {
-                    VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, pNext};
-                    memAlloc.allocationSize = memReqs.size;
-                    memAlloc.memoryTypeIndex = i;
-                    CHECK_VKCMD(vkAllocateMemory(m_vkDevice, &memAlloc, nullptr, mem));
-                    return;
+                    return i;
                 }
             }
         }
         THROW("Memory format not supported");
     }
 
-   private:
+    MemoryBlock* CreateBlock(uint32_t memoryTypeIndex, MemoryTiling tiling, VkDeviceSize size, bool dedicated) {
+        std::unique_ptr<MemoryBlock> block(new MemoryBlock());
+        block->size = size;
+        block->memoryTypeIndex = memoryTypeIndex;
+        block->tiling = tiling;
+        block->dedicated = dedicated;
+        block->freeRanges[0] = size;
+
+        VkMemoryAllocateInfo memAlloc{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        memAlloc.allocationSize = size;
+        memAlloc.memoryTypeIndex = memoryTypeIndex;
+        CHECK_VKCMD(vkAllocateMemory(m_vkDevice, &memAlloc, nullptr, &block->memory));
+        if ((m_memProps.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0) {
+            CHECK_VKCMD(vkMapMemory(m_vkDevice, block->memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&block->mapped)));
+        }
+
+        m_blocks.push_back(std::move(block));
+        return m_blocks.back().get();
+    }
+
+    void ReleaseBlock(MemoryBlock& block) {
+        if (block.mapped != nullptr) {
+            vkUnmapMemory(m_vkDevice, block.memory);
+        }
+        vkFreeMemory(m_vkDevice, block.memory, nullptr);
+        block.memory = VK_NULL_HANDLE;
+        block.mapped = nullptr;
+    }
+
     VkDevice m_vkDevice{VK_NULL_HANDLE};
     VkPhysicalDeviceMemoryProperties m_memProps{};
+    VkDeviceSize m_bufferImageGranularity{1};
+    uint32_t m_maxAllocationCount{0};
+    std::vector<std::unique_ptr<MemoryBlock>> m_blocks;
 };
 
 // CmdBuffer - manage VkCommandBuffer state
@@ -338,6 +684,279 @@ struct CmdBuffer {
 #undef LIST_CMDBUFFER_STATES
 };
 
+// Ring of command buffers so recording can run ahead of the GPU. Each submission takes the oldest buffer in the ring,
+// which only has to be waited on if the GPU has not yet finished the work it was last submitted with.
+// Every Begin() is numbered, so other per-frame resources can wait for the submission that last used them.
+struct CmdBufferRing {
+    CmdBufferRing() = default;
+
+    CmdBufferRing(const CmdBufferRing&) = delete;
+    CmdBufferRing& operator=(const CmdBufferRing&) = delete;
+
+    ~CmdBufferRing() {
+        // Command buffers must not be freed while the GPU may still be executing them.
+        WaitAll();
+    }
+
+    void Init(VkDevice device, uint32_t queueFamilyIndex) {
+        m_vkDevice = device;
+        m_queueFamilyIndex = queueFamilyIndex;
+    }
+
+    // Add count command buffers to the ring. Only valid while nothing is in flight.
+    void Grow(uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            m_cmdBuffers.emplace_back();
+            m_cmdBuffers.back().index = (uint32_t)m_cmdBuffers.size() - 1;
+            if (!m_cmdBuffers.back().cmdBuffer.Init(m_vkDevice, m_queueFamilyIndex)) THROW("Failed to create command buffer");
+        }
+        m_next = m_cmdBuffers.begin();
+    }
+
+    // Return the next command buffer in the ring, reset and ready for recording.
+    CmdBuffer& Begin() {
+        CHECK(!m_cmdBuffers.empty());
+        Slot& slot = *m_next;
+        if (++m_next == m_cmdBuffers.end()) {
+            m_next = m_cmdBuffers.begin();
+        }
+
+        CmdBuffer& cmdBuffer = slot.cmdBuffer;
+        slot.serial = ++m_acquireCount;
+        m_index = slot.index;
+        if (cmdBuffer.state == CmdBuffer::CmdBufferState::Executing &&
+            vkGetFenceStatus(m_vkDevice, cmdBuffer.execFence) == VK_NOT_READY) {
+            m_blockedCount++;
+        }
+
+        if (!cmdBuffer.Wait()) THROW("Failed to wait for command buffer");
+        if (!cmdBuffer.Reset()) THROW("Failed to reset command buffer");
+        if (!cmdBuffer.Begin()) THROW("Failed to begin command buffer");
+        return cmdBuffer;
+    }
+
+    // Wait for every submitted command buffer. One that is still being recorded is left alone.
+    void WaitAll() {
+        for (Slot& slot : m_cmdBuffers) {
+            if (slot.cmdBuffer.state == CmdBuffer::CmdBufferState::Executing) {
+                slot.cmdBuffer.Wait();
+            }
+        }
+    }
+
+    // Wait until the submission numbered serial has completed. A fence covers all earlier submissions on the queue, and a
+    // slot is only reused after waiting, so a serial no longer in the ring has already completed.
+    void Wait(uint64_t serial) {
+        for (Slot& slot : m_cmdBuffers) {
+            if (slot.serial == serial && slot.cmdBuffer.state == CmdBuffer::CmdBufferState::Executing) {
+                if (!slot.cmdBuffer.Wait()) THROW("Failed to wait for command buffer");
+            }
+        }
+    }
+
+    // True once the submission numbered serial has completed. Never waits.
+    bool IsComplete(uint64_t serial) const {
+        for (const Slot& slot : m_cmdBuffers) {
+            if (slot.serial == serial && slot.cmdBuffer.state == CmdBuffer::CmdBufferState::Executing) {
+                return vkGetFenceStatus(m_vkDevice, slot.cmdBuffer.execFence) == VK_SUCCESS;
+            }
+        }
+        return true;
+    }
+
+    // Number of the submission most recently begun.
+    uint64_t Serial() const { return m_acquireCount; }
+    // Position in the ring of the command buffer most recently begun. Its previous submission has completed.
+    uint32_t Index() const { return m_index; }
+    uint32_t Size() const { return (uint32_t)m_cmdBuffers.size(); }
+    // Number of times Begin() was called, and how many of those had to wait for the GPU.
+    uint64_t AcquireCount() const { return m_acquireCount; }
+    uint64_t BlockedCount() const { return m_blockedCount; }
+
+   private:
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    uint32_t m_queueFamilyIndex{0};
+    struct Slot {
+        CmdBuffer cmdBuffer;
+        uint64_t serial{0};
+        uint32_t index{0};
+    };
+    std::list<Slot> m_cmdBuffers;
+    std::list<Slot>::iterator m_next{m_cmdBuffers.end()};
+    uint32_t m_index{0};
+    uint64_t m_acquireCount{0};
+    uint64_t m_blockedCount{0};
+};
+
+// Command pools for recording secondary command buffers on several threads at once: one per recorder for every slot of
+// the command buffer ring. A recorder only touches its own pool, and a slot's pools are only reset once the ring has
+// waited for the slot's previous submission, so recording needs no locks.
+struct SecondaryCmdPools {
+    SecondaryCmdPools() = default;
+
+    SecondaryCmdPools(const SecondaryCmdPools&) = delete;
+    SecondaryCmdPools& operator=(const SecondaryCmdPools&) = delete;
+
+    ~SecondaryCmdPools() {
+        if (m_vkDevice != nullptr) {
+            for (Pool& pool : m_pools) {
+                vkDestroyCommandPool(m_vkDevice, pool.pool, nullptr);
+            }
+        }
+        m_pools.clear();
+        m_vkDevice = nullptr;
+    }
+
+    void Init(VkDevice device, uint32_t queueFamilyIndex, uint32_t recorderCount) {
+        m_vkDevice = device;
+        m_queueFamilyIndex = queueFamilyIndex;
+        m_recorderCount = recorderCount;
+    }
+
+    uint32_t RecorderCount() const { return m_recorderCount; }
+
+    // Reset the pools of ring slot slotIndex for a new submission. Creates them on first use.
+    void Begin(uint32_t slotIndex) {
+        const size_t first = (size_t)slotIndex * m_recorderCount;
+        if (m_pools.size() < first + m_recorderCount) {
+            const size_t oldSize = m_pools.size();
+            m_pools.resize(first + m_recorderCount);
+            for (size_t i = oldSize; i < m_pools.size(); i++) {
+                VkCommandPoolCreateInfo cmdPoolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+                cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                cmdPoolInfo.queueFamilyIndex = m_queueFamilyIndex;
+                CHECK_VKCMD(vkCreateCommandPool(m_vkDevice, &cmdPoolInfo, nullptr, &m_pools[i].pool));
+            }
+        }
+        for (size_t i = first; i < first + m_recorderCount; i++) {
+            if (m_pools[i].used > 0) {
+                CHECK_VKCMD(vkResetCommandPool(m_vkDevice, m_pools[i].pool, 0));
+                m_pools[i].used = 0;
+            }
+        }
+        m_slotIndex = slotIndex;
+    }
+
+    // Next unused secondary command buffer of recorder in the slot passed to Begin. Only that recorder's thread may call
+    // this until the next Begin.
+    VkCommandBuffer Allocate(uint32_t recorder) {
+        Pool& pool = m_pools[(size_t)m_slotIndex * m_recorderCount + recorder];
+        if (pool.used == pool.buffers.size()) {
+            VkCommandBufferAllocateInfo cmd{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            cmd.commandPool = pool.pool;
+            cmd.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            cmd.commandBufferCount = 1;
+            VkCommandBuffer buf;
+            CHECK_VKCMD(vkAllocateCommandBuffers(m_vkDevice, &cmd, &buf));
+            pool.buffers.push_back(buf);
+        }
+        return pool.buffers[pool.used++];
+    }
+
+   private:
+    struct Pool {
+        VkCommandPool pool{VK_NULL_HANDLE};
+        std::vector<VkCommandBuffer> buffers;  // Freed with the pool.
+        uint32_t used{0};
+    };
+
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    uint32_t m_queueFamilyIndex{0};
+    uint32_t m_recorderCount{0};
+    uint32_t m_slotIndex{0};
+    std::vector<Pool> m_pools;  // m_recorderCount pools per ring slot.
+};
+
+// Timestamp query pool laid out by a GpuTimerRing, timing the passes of recent frames. A frame's queries are reset by the
+// first command buffer that times a pass of it, and read back without waiting once its last submission has completed.
+struct TimestampQueries {
+    static constexpr uint32_t NoQuery = ~0u;
+
+    TimestampQueries() = default;
+
+    ~TimestampQueries() {
+        if (m_vkDevice != nullptr && pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_vkDevice, pool, nullptr);
+        }
+    }
+
+    TimestampQueries(const TimestampQueries&) = delete;
+    TimestampQueries& operator=(const TimestampQueries&) = delete;
+    TimestampQueries(TimestampQueries&&) = delete;
+    TimestampQueries& operator=(TimestampQueries&&) = delete;
+
+    // Nothing is timed if the queue does not support timestamps (timestampValidBits is 0).
+    void Create(VkDevice device, const VkPhysicalDeviceProperties& deviceProperties, uint32_t timestampValidBits) {
+        m_vkDevice = device;
+        if (timestampValidBits == 0 || deviceProperties.limits.timestampPeriod <= 0.0f) {
+            Log::Write(Log::Level::Warning, "The graphics queue does not support timestamps, GPU timings are disabled");
+            return;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = GpuTimerRing::QueryCount;
+        CHECK_VKCMD(vkCreateQueryPool(m_vkDevice, &queryPoolInfo, nullptr, &pool));
+        m_timer.Init(deviceProperties.limits.timestampPeriod, timestampValidBits);
+    }
+
+    void BeginFrame(uint64_t frameIndex) {
+        if (pool != VK_NULL_HANDLE) {
+            m_slot = m_timer.BeginFrame(frameIndex);
+            m_resetPending = true;
+        }
+    }
+
+    uint32_t AddViews(uint32_t viewCount) { return m_timer.AddViews(viewCount); }
+
+    // Record the begin timestamp of a pass into buf, which will be submitted as submission serial. Must be recorded outside
+    // a render pass. Returns the query to pass to EndPass, or NoQuery if the pass is not timed.
+    uint32_t BeginPass(VkCommandBuffer buf, uint64_t serial, const char* name, uint32_t firstView, uint32_t viewCount) {
+        uint32_t query;
+        if (pool == VK_NULL_HANDLE || !m_timer.BeginPass(name, firstView, viewCount, &query)) {
+            return NoQuery;
+        }
+        if (m_resetPending) {
+            vkCmdResetQueryPool(buf, pool, m_slot * GpuTimerRing::QueriesPerSlot, GpuTimerRing::QueriesPerSlot);
+            m_resetPending = false;
+        }
+        m_serials[m_slot] = serial;
+        vkCmdWriteTimestamp(buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, query);
+        return query;
+    }
+
+    void EndPass(VkCommandBuffer buf, uint32_t beginQuery) {
+        if (beginQuery != NoQuery) {
+            vkCmdWriteTimestamp(buf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, beginQuery + 1);
+        }
+    }
+
+    void Collect(const CmdBufferRing& cmdBufferRing, std::vector<GpuFrameTiming>* timings) {
+        if (pool == VK_NULL_HANDLE) {
+            return;
+        }
+        m_timer.Collect(
+            [&](uint32_t slot, uint32_t firstQuery, uint32_t queryCount, uint64_t* timestamps) {
+                if (!cmdBufferRing.IsComplete(m_serials[slot])) {
+                    return false;
+                }
+                return vkGetQueryPoolResults(m_vkDevice, pool, firstQuery, queryCount, queryCount * sizeof(uint64_t), timestamps,
+                                             sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+            },
+            timings);
+    }
+
+    VkQueryPool pool{VK_NULL_HANDLE};
+
+   private:
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    GpuTimerRing m_timer{};
+    uint32_t m_slot{0};
+    bool m_resetPending{false};
+    // Last submission that wrote timestamps of the frame in each slot.
+    std::array<uint64_t, GpuTimerRing::FrameSlots> m_serials{};
+};
+
 // ShaderProgram to hold a pair of vertex & fragment shaders
 struct ShaderProgram {
     std::array<VkPipelineShaderStageCreateInfo, 2> shaderInfo{
@@ -405,9 +1024,9 @@ struct ShaderProgram {
 // VertexBuffer base class
 struct VertexBufferBase {
     VkBuffer idxBuf{VK_NULL_HANDLE};
-    VkDeviceMemory idxMem{VK_NULL_HANDLE};
+    MemoryAllocation idxMem{};
     VkBuffer vtxBuf{VK_NULL_HANDLE};
-    VkDeviceMemory vtxMem{VK_NULL_HANDLE};
+    MemoryAllocation vtxMem{};
     VkVertexInputBindingDescription bindDesc{};
     std::vector<VkVertexInputAttributeDescription> attrDesc{};
     struct {
@@ -422,20 +1041,14 @@ struct VertexBufferBase {
             if (idxBuf != VK_NULL_HANDLE) {
                 vkDestroyBuffer(m_vkDevice, idxBuf, nullptr);
             }
-            if (idxMem != VK_NULL_HANDLE) {
-                vkFreeMemory(m_vkDevice, idxMem, nullptr);
-            }
+            m_memAllocator->Free(&idxMem);
             if (vtxBuf != VK_NULL_HANDLE) {
                 vkDestroyBuffer(m_vkDevice, vtxBuf, nullptr);
             }
-            if (vtxMem != VK_NULL_HANDLE) {
-                vkFreeMemory(m_vkDevice, vtxMem, nullptr);
-            }
+            m_memAllocator->Free(&vtxMem);
         }
         idxBuf = VK_NULL_HANDLE;
-        idxMem = VK_NULL_HANDLE;
         vtxBuf = VK_NULL_HANDLE;
-        vtxMem = VK_NULL_HANDLE;
         bindDesc = {};
         attrDesc.clear();
         count = {0, 0};
@@ -446,7 +1059,7 @@ struct VertexBufferBase {
     VertexBufferBase& operator=(const VertexBufferBase&) = delete;
     VertexBufferBase(VertexBufferBase&&) = delete;
     VertexBufferBase& operator=(VertexBufferBase&&) = delete;
-    void Init(VkDevice device, const MemoryAllocator* memAllocator, const std::vector<VkVertexInputAttributeDescription>& attr) {
+    void Init(VkDevice device, MemoryAllocator* memAllocator, const std::vector<VkVertexInputAttributeDescription>& attr) {
         m_vkDevice = device;
         m_memAllocator = memAllocator;
         attrDesc = attr;
@@ -454,14 +1067,14 @@ struct VertexBufferBase {
 
    protected:
     VkDevice m_vkDevice{VK_NULL_HANDLE};
-    void AllocateBufferMemory(VkBuffer buf, VkDeviceMemory* mem) const {
+    void AllocateBufferMemory(VkBuffer buf, MemoryAllocation* mem) const {
         VkMemoryRequirements memReq = {};
         vkGetBufferMemoryRequirements(m_vkDevice, buf, &memReq);
         m_memAllocator->Allocate(memReq, mem);
     }
 
    private:
-    const MemoryAllocator* m_memAllocator{nullptr};
+    MemoryAllocator* m_memAllocator{nullptr};
 };
 
 // VertexBuffer template to wrap the indices and vertices
@@ -473,13 +1086,13 @@ struct VertexBuffer : public VertexBufferBase {
         bufInfo.size = sizeof(uint16_t) * idxCount;
         CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, &idxBuf));
         AllocateBufferMemory(idxBuf, &idxMem);
-        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, idxBuf, idxMem, 0));
+        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, idxBuf, idxMem.memory, idxMem.offset));
 
         bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
         bufInfo.size = sizeof(T) * vtxCount;
         CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, &vtxBuf));
         AllocateBufferMemory(vtxBuf, &vtxMem);
-        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, vtxBuf, vtxMem, 0));
+        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, vtxBuf, vtxMem.memory, vtxMem.offset));
 
         bindDesc.binding = 0;
         bindDesc.stride = sizeof(T);
@@ -491,36 +1104,116 @@ struct VertexBuffer : public VertexBufferBase {
     }
 
     void UpdateIndices(const uint16_t* data, uint32_t elements, uint32_t offset = 0) {
-        uint16_t* map = nullptr;
-        CHECK_VKCMD(vkMapMemory(m_vkDevice, idxMem, sizeof(map[0]) * offset, sizeof(map[0]) * elements, 0, (void**)&map));
+        uint16_t* map = static_cast<uint16_t*>(idxMem.mapped) + offset;
         for (size_t i = 0; i < elements; ++i) {
             map[i] = data[i];
         }
-        vkUnmapMemory(m_vkDevice, idxMem);
     }
 
     void UpdateVertices(const T* data, uint32_t elements, uint32_t offset = 0) {
-        T* map = nullptr;
-        CHECK_VKCMD(vkMapMemory(m_vkDevice, vtxMem, sizeof(map[0]) * offset, sizeof(map[0]) * elements, 0, (void**)&map));
+        T* map = static_cast<T*>(vtxMem.mapped) + offset;
         for (size_t i = 0; i < elements; ++i) {
             map[i] = data[i];
         }
-        vkUnmapMemory(m_vkDevice, vtxMem);
     }
 };
 
+// Per-instance model transforms, read by the vertex shader through a second, per-instance vertex binding. The buffer is
+// host-visible and stays mapped for its whole life. It is split into regions so the CPU can fill one while the GPU still
+// reads the others.
+struct InstanceBuffer {
+    static constexpr uint32_t Binding = 1;
+    // First vertex shader input location of the model matrix, which takes four consecutive locations.
+    static constexpr uint32_t FirstLocation = 2;
+
+    VkBuffer buf{VK_NULL_HANDLE};
+    MemoryAllocation mem{};
+    VkVertexInputBindingDescription bindDesc{Binding, sizeof(XrMatrix4x4f), VK_VERTEX_INPUT_RATE_INSTANCE};
+    std::array<VkVertexInputAttributeDescription, 4> attrDesc{{
+        {FirstLocation + 0, Binding, VK_FORMAT_R32G32B32A32_SFLOAT, 0 * sizeof(XrVector4f)},
+        {FirstLocation + 1, Binding, VK_FORMAT_R32G32B32A32_SFLOAT, 1 * sizeof(XrVector4f)},
+        {FirstLocation + 2, Binding, VK_FORMAT_R32G32B32A32_SFLOAT, 2 * sizeof(XrVector4f)},
+        {FirstLocation + 3, Binding, VK_FORMAT_R32G32B32A32_SFLOAT, 3 * sizeof(XrVector4f)},
+    }};
+
+    InstanceBuffer() = default;
+
+    ~InstanceBuffer() { Release(); }
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    void Init(VkDevice device, MemoryAllocator* memAllocator, uint32_t regionCount) {
+        m_vkDevice = device;
+        m_memAllocator = memAllocator;
+        m_regionCount = regionCount;
+    }
+
+    // (Re)create the buffer with room for capacity instances per region. The GPU must not be using the old buffer.
+    void Reserve(uint32_t capacity) {
+        Release();
+
+        // The buffer is also read by the culling compute shader, one region at a time. Keeping regions a multiple of four
+        // instances (256 bytes) keeps their offsets within any device's minStorageBufferOffsetAlignment.
+        capacity = (capacity + 3) & ~3u;
+
+        VkBufferCreateInfo bufInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufInfo.size = sizeof(XrMatrix4x4f) * capacity * m_regionCount;
+        CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, &buf));
+
+        VkMemoryRequirements memReq{};
+        vkGetBufferMemoryRequirements(m_vkDevice, buf, &memReq);
+        m_memAllocator->Allocate(memReq, &mem);
+        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, buf, mem.memory, mem.offset));
+        m_mapped = static_cast<XrMatrix4x4f*>(mem.mapped);
+
+        m_regionCapacity = capacity;
+    }
+
+    uint32_t RegionCount() const { return m_regionCount; }
+    uint32_t RegionCapacity() const { return m_regionCapacity; }
+    XrMatrix4x4f* Region(uint32_t region) { return m_mapped + RegionStart(region); }
+    VkDeviceSize RegionOffset(uint32_t region) const { return sizeof(XrMatrix4x4f) * RegionStart(region); }
+    VkDeviceSize RegionSize() const { return sizeof(XrMatrix4x4f) * m_regionCapacity; }
+
+   private:
+    size_t RegionStart(uint32_t region) const { return (size_t)region * m_regionCapacity; }
+
+    void Release() {
+        if (m_vkDevice != nullptr) {
+            if (buf != VK_NULL_HANDLE) {
+                vkDestroyBuffer(m_vkDevice, buf, nullptr);
+            }
+            m_memAllocator->Free(&mem);
+        }
+        buf = VK_NULL_HANDLE;
+        m_mapped = nullptr;
+        m_regionCapacity = 0;
+    }
+
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    MemoryAllocator* m_memAllocator{nullptr};
+    XrMatrix4x4f* m_mapped{nullptr};
+    uint32_t m_regionCount{1};
+    uint32_t m_regionCapacity{0};
+};
+
 // RenderPass wrapper
 struct RenderPass {
     VkFormat colorFmt{};
     VkFormat depthFmt{};
+    uint32_t viewCount{1};
     VkRenderPass pass{VK_NULL_HANDLE};
 
     RenderPass() = default;
 
-    bool Create(VkDevice device, VkFormat aColorFmt, VkFormat aDepthFmt) {
+    // With viewCount > 1 the pass renders every view to its own attachment layer in one go (Vulkan 1.1 multiview).
+    bool Create(VkDevice device, VkFormat aColorFmt, VkFormat aDepthFmt, uint32_t aViewCount = 1) {
         m_vkDevice = device;
         colorFmt = aColorFmt;
         depthFmt = aDepthFmt;
+        viewCount = aViewCount;
 
         VkSubpassDescription subpass = {};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
@@ -558,7 +1251,8 @@ struct RenderPass {
             at[depthRef.attachment].format = depthFmt;
             at[depthRef.attachment].samples = VK_SAMPLE_COUNT_1_BIT;
             at[depthRef.attachment].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-            at[depthRef.attachment].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            // Depth is never read after the pass, which lets it live in transient memory.
+            at[depthRef.attachment].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
             at[depthRef.attachment].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
             at[depthRef.attachment].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
             at[depthRef.attachment].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
@@ -567,6 +1261,29 @@ struct RenderPass {
             subpass.pDepthStencilAttachment = &depthRef;
         }
 
+        // Several frames may be in flight and they all render to the same depth buffer, so order this pass's attachment
+        // accesses after those of any earlier submission.
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        rpInfo.dependencyCount = 1;
+        rpInfo.pDependencies = &dependency;
+
+        const uint32_t viewMask = (1u << viewCount) - 1;
+        VkRenderPassMultiviewCreateInfo multiviewInfo{VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO};
+        multiviewInfo.subpassCount = 1;
+        multiviewInfo.pViewMasks = &viewMask;
+        multiviewInfo.correlationMaskCount = 1;
+        multiviewInfo.pCorrelationMasks = &viewMask;
+        if (viewCount > 1) {
+            rpInfo.pNext = &multiviewInfo;
+        }
+
         CHECK_VKCMD(vkCreateRenderPass(m_vkDevice, &rpInfo, nullptr, &pass));
 
         return true;
@@ -660,7 +1377,7 @@ struct RenderTarget {
         if (colorImage != VK_NULL_HANDLE) {
             VkImageViewCreateInfo colorViewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
             colorViewInfo.image = colorImage;
-            colorViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            colorViewInfo.viewType = renderPass.viewCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
             colorViewInfo.format = renderPass.colorFmt;
             colorViewInfo.components.r = VK_COMPONENT_SWIZZLE_R;
             colorViewInfo.components.g = VK_COMPONENT_SWIZZLE_G;
@@ -670,7 +1387,7 @@ struct RenderTarget {
             colorViewInfo.subresourceRange.baseMipLevel = 0;
             colorViewInfo.subresourceRange.levelCount = 1;
             colorViewInfo.subresourceRange.baseArrayLayer = 0;
-            colorViewInfo.subresourceRange.layerCount = 1;
+            colorViewInfo.subresourceRange.layerCount = renderPass.viewCount;
             CHECK_VKCMD(vkCreateImageView(m_vkDevice, &colorViewInfo, nullptr, &colorView));
             attachments[attachmentCount++] = colorView;
         }
@@ -679,7 +1396,7 @@ struct RenderTarget {
         if (depthImage != VK_NULL_HANDLE) {
             VkImageViewCreateInfo depthViewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
             depthViewInfo.image = depthImage;
-            depthViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            depthViewInfo.viewType = renderPass.viewCount > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
             depthViewInfo.format = renderPass.depthFmt;
             depthViewInfo.components.r = VK_COMPONENT_SWIZZLE_R;
             depthViewInfo.components.g = VK_COMPONENT_SWIZZLE_G;
@@ -689,7 +1406,7 @@ struct RenderTarget {
             depthViewInfo.subresourceRange.baseMipLevel = 0;
             depthViewInfo.subresourceRange.levelCount = 1;
             depthViewInfo.subresourceRange.baseArrayLayer = 0;
-            depthViewInfo.subresourceRange.layerCount = 1;
+            depthViewInfo.subresourceRange.layerCount = renderPass.viewCount;
             CHECK_VKCMD(vkCreateImageView(m_vkDevice, &depthViewInfo, nullptr, &depthView));
             attachments[attachmentCount++] = depthView;
         }
@@ -700,6 +1417,7 @@ struct RenderTarget {
         fbInfo.pAttachments = attachments.data();
         fbInfo.width = size.width;
         fbInfo.height = size.height;
+        // Multiview framebuffers still have one layer; the view mask of the render pass selects the attachment layers.
         fbInfo.layers = 1;
         CHECK_VKCMD(vkCreateFramebuffer(m_vkDevice, &fbInfo, nullptr, &fb));
     }
@@ -711,8 +1429,151 @@ struct RenderTarget {
     VkDevice m_vkDevice{VK_NULL_HANDLE};
 };
 
+// 64-bit FNV-1a, used to key and check the on-disk caches.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+inline bool ReadCacheFile(const std::string& path, std::vector<uint8_t>* data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    data->resize((size_t)file.tellg());
+    file.seekg(0);
+    return (bool)file.read(reinterpret_cast<char*>(data->data()), data->size());
+}
+
+// Write to a temporary file and rename it over path, so a reader never sees a partially written cache.
+inline bool WriteCacheFile(const std::string& path, const std::vector<uint8_t>& data) {
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            return false;
+        }
+    }
+    (void)std::remove(path.c_str());
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+// VkPipelineCache persisted across runs. The driver's cache data is saved behind a header naming the device and driver
+// version that produced it, and data from any other device or driver is discarded instead of being handed to the driver.
+struct PipelineCache {
+    VkPipelineCache cache{VK_NULL_HANDLE};
+
+    PipelineCache() = default;
+
+    ~PipelineCache() {
+        if (m_vkDevice != nullptr && cache != VK_NULL_HANDLE) {
+            vkDestroyPipelineCache(m_vkDevice, cache, nullptr);
+        }
+        cache = VK_NULL_HANDLE;
+        m_vkDevice = nullptr;
+    }
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+    PipelineCache(PipelineCache&&) = delete;
+    PipelineCache& operator=(PipelineCache&&) = delete;
+
+    // Create the cache, seeded from the file at path if it was saved on this device and driver. With an empty path the
+    // cache only lives in memory.
+    void Create(VkDevice device, const VkPhysicalDeviceProperties& props, const std::string& path) {
+        m_vkDevice = device;
+        m_path = path;
+
+        m_header.magic = FileMagic;
+        m_header.vendorID = props.vendorID;
+        m_header.deviceID = props.deviceID;
+        m_header.driverVersion = props.driverVersion;
+        memcpy(m_header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+
+        std::vector<uint8_t> file;
+        const uint8_t* initialData = nullptr;
+        if (!m_path.empty() && ReadCacheFile(m_path, &file)) {
+            FileHeader header{};
+            if (file.size() >= sizeof(header)) {
+                memcpy(&header, file.data(), sizeof(header));
+            }
+            const uint8_t* data = file.data() + sizeof(header);
+            if (file.size() < sizeof(header) || !IsSameSource(header)) {
+                Log::Write(Log::Level::Info, Fmt("Ignoring pipeline cache %s from another device or driver", m_path.c_str()));
+            } else if (header.dataSize != file.size() - sizeof(header) || header.dataHash != HashBytes(data, header.dataSize)) {
+                Log::Write(Log::Level::Warning, Fmt("Ignoring corrupt pipeline cache %s", m_path.c_str()));
+            } else {
+                initialData = data;
+                m_loadedSize = (size_t)header.dataSize;
+            }
+        }
+
+        VkPipelineCacheCreateInfo cacheInfo{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+        cacheInfo.initialDataSize = m_loadedSize;
+        cacheInfo.pInitialData = initialData;
+        CHECK_VKCMD(vkCreatePipelineCache(m_vkDevice, &cacheInfo, nullptr, &cache));
+
+        Log::Write(Log::Level::Info, m_loadedSize > 0 ? Fmt("Pipeline cache: loaded %zu bytes (warm start)", m_loadedSize)
+                                                      : std::string("Pipeline cache: empty (cold start)"));
+    }
+
+    // True if the cache was seeded with data from an earlier run.
+    bool IsWarm() const { return m_loadedSize > 0; }
+
+    // Write the current cache contents to disk. Cheap enough to call whenever new pipelines were created.
+    void Save() {
+        if (m_path.empty() || cache == VK_NULL_HANDLE) {
+            return;
+        }
+
+        size_t size = 0;
+        CHECK_VKCMD(vkGetPipelineCacheData(m_vkDevice, cache, &size, nullptr));
+        std::vector<uint8_t> file(sizeof(FileHeader) + size);
+        CHECK_VKCMD(vkGetPipelineCacheData(m_vkDevice, cache, &size, file.data() + sizeof(FileHeader)));
+        file.resize(sizeof(FileHeader) + size);
+
+        FileHeader header = m_header;
+        header.dataSize = size;
+        header.dataHash = HashBytes(file.data() + sizeof(FileHeader), size);
+        memcpy(file.data(), &header, sizeof(header));
+
+        if (!WriteCacheFile(m_path, file)) {
+            Log::Write(Log::Level::Warning, Fmt("Failed to write pipeline cache %s", m_path.c_str()));
+        }
+    }
+
+   private:
+    static constexpr uint32_t FileMagic = 0x43505848;  // "HXPC"
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    bool IsSameSource(const FileHeader& header) const {
+        return header.magic == m_header.magic && header.vendorID == m_header.vendorID && header.deviceID == m_header.deviceID &&
+               header.driverVersion == m_header.driverVersion &&
+               memcmp(header.pipelineCacheUUID, m_header.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    std::string m_path;
+    FileHeader m_header{};
+    size_t m_loadedSize{0};
+};
+
 // Simple vertex MVP xform & color fragment shader layout
 struct PipelineLayout {
+    static constexpr uint32_t MaxViewCount = 2;
+
     VkPipelineLayout layout{VK_NULL_HANDLE};
 
     PipelineLayout() = default;
@@ -730,11 +1591,12 @@ struct PipelineLayout {
     void Create(VkDevice device) {
         m_vkDevice = device;
 
-        // MVP matrix is a push_constant
+        // View-projection matrix is a push_constant, one per view when rendering multiview. 128 bytes is the minimum push
+        // constant size every implementation supports.
         VkPushConstantRange pcr = {};
         pcr.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         pcr.offset = 0;
-        pcr.size = 4 * 4 * sizeof(float);
+        pcr.size = MaxViewCount * 4 * 4 * sizeof(float);
 
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
         pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
@@ -762,18 +1624,23 @@ struct Pipeline {
     void Dynamic(VkDynamicState state) { dynamicStateEnables.emplace_back(state); }
 
     void Create(VkDevice device, VkExtent2D size, const PipelineLayout& layout, const RenderPass& rp, const ShaderProgram& sp,
-                const VertexBufferBase& vb) {
+                const VertexBufferBase& vb, const InstanceBuffer& ib, VkPipelineCache pipelineCache) {
         m_vkDevice = device;
 
         VkPipelineDynamicStateCreateInfo dynamicState{VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
         dynamicState.dynamicStateCount = (uint32_t)dynamicStateEnables.size();
         dynamicState.pDynamicStates = dynamicStateEnables.data();
 
+        // Per-vertex geometry plus per-instance model transforms.
+        const std::array<VkVertexInputBindingDescription, 2> bindings{{vb.bindDesc, ib.bindDesc}};
+        std::vector<VkVertexInputAttributeDescription> attributes(vb.attrDesc);
+        attributes.insert(attributes.end(), ib.attrDesc.begin(), ib.attrDesc.end());
+
         VkPipelineVertexInputStateCreateInfo vi{VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
-        vi.vertexBindingDescriptionCount = 1;
-        vi.pVertexBindingDescriptions = &vb.bindDesc;
-        vi.vertexAttributeDescriptionCount = (uint32_t)vb.attrDesc.size();
-        vi.pVertexAttributeDescriptions = vb.attrDesc.data();
+        vi.vertexBindingDescriptionCount = (uint32_t)bindings.size();
+        vi.pVertexBindingDescriptions = bindings.data();
+        vi.vertexAttributeDescriptionCount = (uint32_t)attributes.size();
+        vi.pVertexAttributeDescriptions = attributes.data();
 
         VkPipelineInputAssemblyStateCreateInfo ia{VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
         ia.primitiveRestartEnable = VK_FALSE;
@@ -860,7 +1727,7 @@ struct Pipeline {
         pipeInfo.layout = layout.layout;
         pipeInfo.renderPass = rp.pass;
         pipeInfo.subpass = 0;
-        CHECK_VKCMD(vkCreateGraphicsPipelines(m_vkDevice, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe));
+        CHECK_VKCMD(vkCreateGraphicsPipelines(m_vkDevice, pipelineCache, 1, &pipeInfo, nullptr, &pipe));
     }
 
     void Release() {
@@ -877,9 +1744,260 @@ struct Pipeline {
     VkDevice m_vkDevice{VK_NULL_HANDLE};
 };
 
+// GPU frustum culling. A compute shader tests the bounding sphere of every instance in one region of the instance buffer
+// against the view frusta, appends the visible ones to its own instance list and counts them into an indexed indirect
+// draw command. The CPU never looks at individual instances. The parameters of each dispatch are written into the
+// command buffer with vkCmdUpdateBuffer, so nothing here is touched by the host while the GPU may be using it.
+struct CullPass {
+    // Must match local_size_x in comp_cull.glsl.
+    static constexpr uint32_t GroupSize = 64;
+    static constexpr uint32_t MaxViewCount = 2;
+    static constexpr uint32_t PlanesPerView = 6;
+
+    // Mirrors the CullParams uniform block (std140) of comp_cull.glsl.
+    struct Params {
+        XrVector4f planes[PlanesPerView * MaxViewCount];
+        float radius;
+        uint32_t instanceCount;
+    };
+    static_assert(sizeof(Params) == 200, "CullParams layout mismatch");
+
+    // Compacted visible instances, bound in place of the instance buffer when drawing.
+    VkBuffer visibleBuf{VK_NULL_HANDLE};
+    // A single VkDrawIndexedIndirectCommand.
+    VkBuffer drawBuf{VK_NULL_HANDLE};
+
+    CullPass() = default;
+
+    ~CullPass() {
+        if (m_vkDevice != nullptr) {
+            ReleaseVisible();
+            if (drawBuf != VK_NULL_HANDLE) {
+                vkDestroyBuffer(m_vkDevice, drawBuf, nullptr);
+                m_memAllocator->Free(&m_drawMem);
+            }
+            if (m_paramsBuf != VK_NULL_HANDLE) {
+                vkDestroyBuffer(m_vkDevice, m_paramsBuf, nullptr);
+                m_memAllocator->Free(&m_paramsMem);
+            }
+            if (m_pipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(m_vkDevice, m_pipeline, nullptr);
+            }
+            if (m_pipelineLayout != VK_NULL_HANDLE) {
+                vkDestroyPipelineLayout(m_vkDevice, m_pipelineLayout, nullptr);
+            }
+            if (m_descriptorPool != VK_NULL_HANDLE) {
+                vkDestroyDescriptorPool(m_vkDevice, m_descriptorPool, nullptr);
+            }
+            if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+                vkDestroyDescriptorSetLayout(m_vkDevice, m_descriptorSetLayout, nullptr);
+            }
+            if (m_shaderModule != VK_NULL_HANDLE) {
+                vkDestroyShaderModule(m_vkDevice, m_shaderModule, nullptr);
+            }
+        }
+        m_vkDevice = nullptr;
+    }
+
+    CullPass(const CullPass&) = delete;
+    CullPass& operator=(const CullPass&) = delete;
+    CullPass(CullPass&&) = delete;
+    CullPass& operator=(CullPass&&) = delete;
+
+    bool IsCreated() const { return m_pipeline != VK_NULL_HANDLE; }
+
+    void Create(VkDevice device, MemoryAllocator* memAllocator, const std::vector<uint32_t>& code,
+                VkPipelineCache pipelineCache) {
+        m_vkDevice = device;
+        m_memAllocator = memAllocator;
+
+        VkShaderModuleCreateInfo modInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+        modInfo.codeSize = code.size() * sizeof(code[0]);
+        modInfo.pCode = code.data();
+        CHECK_MSG(modInfo.codeSize > 0, "Invalid culling compute shader");
+        CHECK_VKCMD(vkCreateShaderModule(m_vkDevice, &modInfo, nullptr, &m_shaderModule));
+
+        // Bindings as declared in comp_cull.glsl. The instances are read through a dynamic offset so every region of the
+        // instance buffer can be culled with the same descriptor set.
+        const std::array<VkDescriptorSetLayoutBinding, 4> bindings{{
+            {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+        }};
+        VkDescriptorSetLayoutCreateInfo setLayoutInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+        setLayoutInfo.bindingCount = (uint32_t)bindings.size();
+        setLayoutInfo.pBindings = bindings.data();
+        CHECK_VKCMD(vkCreateDescriptorSetLayout(m_vkDevice, &setLayoutInfo, nullptr, &m_descriptorSetLayout));
+
+        const std::array<VkDescriptorPoolSize, 3> poolSizes{{
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2},
+        }};
+        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+        poolInfo.pPoolSizes = poolSizes.data();
+        CHECK_VKCMD(vkCreateDescriptorPool(m_vkDevice, &poolInfo, nullptr, &m_descriptorPool));
+
+        VkDescriptorSetAllocateInfo setInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        setInfo.descriptorPool = m_descriptorPool;
+        setInfo.descriptorSetCount = 1;
+        setInfo.pSetLayouts = &m_descriptorSetLayout;
+        CHECK_VKCMD(vkAllocateDescriptorSets(m_vkDevice, &setInfo, &m_descriptorSet));
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+        CHECK_VKCMD(vkCreatePipelineLayout(m_vkDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+
+        VkComputePipelineCreateInfo pipeInfo{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeInfo.stage.module = m_shaderModule;
+        pipeInfo.stage.pName = "main";
+        pipeInfo.layout = m_pipelineLayout;
+        CHECK_VKCMD(vkCreateComputePipelines(m_vkDevice, pipelineCache, 1, &pipeInfo, nullptr, &m_pipeline));
+
+        CreateBuffer(sizeof(Params), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &m_paramsBuf,
+                     &m_paramsMem);
+        CreateBuffer(sizeof(VkDrawIndexedIndirectCommand),
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     &drawBuf, &m_drawMem);
+
+        Log::Write(Log::Level::Info, "Loaded culling compute shader");
+    }
+
+    // Size the visible list for the instance buffer and point the descriptors at it. Has to be repeated whenever the
+    // instance buffer is recreated, while the GPU is not using either of them.
+    void Bind(const InstanceBuffer& ib) {
+        ReleaseVisible();
+        CreateBuffer(ib.RegionSize(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &visibleBuf,
+                     &m_visibleMem);
+
+        const VkDescriptorBufferInfo paramsInfo{m_paramsBuf, 0, sizeof(Params)};
+        const VkDescriptorBufferInfo instancesInfo{ib.buf, 0, ib.RegionSize()};
+        const VkDescriptorBufferInfo visibleInfo{visibleBuf, 0, ib.RegionSize()};
+        const VkDescriptorBufferInfo drawInfo{drawBuf, 0, sizeof(VkDrawIndexedIndirectCommand)};
+        std::array<VkWriteDescriptorSet, 4> writes{};
+        const std::array<std::pair<VkDescriptorType, const VkDescriptorBufferInfo*>, 4> descriptors{{
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &paramsInfo},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, &instancesInfo},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &visibleInfo},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &drawInfo},
+        }};
+        for (uint32_t i = 0; i < writes.size(); i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = m_descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = descriptors[i].first;
+            writes[i].pBufferInfo = descriptors[i].second;
+        }
+        vkUpdateDescriptorSets(m_vkDevice, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+    }
+
+    // Record the culling of params.instanceCount instances found at instanceOffset in the instance buffer. Must be
+    // recorded outside a render pass; afterwards visibleBuf and drawBuf are ready for vkCmdDrawIndexedIndirect.
+    void Record(VkCommandBuffer buf, VkDeviceSize instanceOffset, const Params& params, uint32_t indexCount) {
+        // The previous draw must be done reading the outputs before they are reset and rewritten.
+        VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(buf,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                             nullptr);
+
+        VkDrawIndexedIndirectCommand draw{};
+        draw.indexCount = indexCount;
+        vkCmdUpdateBuffer(buf, m_paramsBuf, 0, sizeof(params), &params);
+        vkCmdUpdateBuffer(buf, drawBuf, 0, sizeof(draw), &draw);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(buf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr,
+                             0, nullptr);
+
+        const uint32_t dynamicOffset = (uint32_t)instanceOffset;
+        vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(buf, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 1, &dynamicOffset);
+        vkCmdDispatch(buf, (params.instanceCount + GroupSize - 1) / GroupSize, 1, 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        vkCmdPipelineBarrier(buf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr,
+                             0, nullptr);
+    }
+
+    // Extract the six inward facing, normalized clip planes of a view-projection matrix (Vulkan clip space, z in [0, w]).
+    static void GetFrustumPlanes(const XrMatrix4x4f& vp, XrVector4f* planes) {
+        // Rows of the column-major matrix.
+        XrVector4f row[4];
+        for (int r = 0; r < 4; r++) {
+            row[r] = {vp.m[r], vp.m[4 + r], vp.m[8 + r], vp.m[12 + r]};
+        }
+        const auto add = [](const XrVector4f& a, const XrVector4f& b, float sign) {
+            return XrVector4f{a.x + sign * b.x, a.y + sign * b.y, a.z + sign * b.z, a.w + sign * b.w};
+        };
+        planes[0] = add(row[3], row[0], 1.0f);   // Left
+        planes[1] = add(row[3], row[0], -1.0f);  // Right
+        planes[2] = add(row[3], row[1], 1.0f);   // Bottom
+        planes[3] = add(row[3], row[1], -1.0f);  // Top
+        planes[4] = row[2];                      // Near
+        planes[5] = add(row[3], row[2], -1.0f);  // Far
+        for (int i = 0; i < 6; i++) {
+            const float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+            if (length > 0.0f) {
+                planes[i] = {planes[i].x / length, planes[i].y / length, planes[i].z / length, planes[i].w / length};
+            }
+        }
+    }
+
+   private:
+    void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* buffer, MemoryAllocation* memory) {
+        VkBufferCreateInfo bufInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        bufInfo.usage = usage;
+        bufInfo.size = size;
+        CHECK_VKCMD(vkCreateBuffer(m_vkDevice, &bufInfo, nullptr, buffer));
+
+        VkMemoryRequirements memReq{};
+        vkGetBufferMemoryRequirements(m_vkDevice, *buffer, &memReq);
+        m_memAllocator->Allocate(memReq, memory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        CHECK_VKCMD(vkBindBufferMemory(m_vkDevice, *buffer, memory->memory, memory->offset));
+    }
+
+    void ReleaseVisible() {
+        if (visibleBuf != VK_NULL_HANDLE) {
+            vkDestroyBuffer(m_vkDevice, visibleBuf, nullptr);
+            m_memAllocator->Free(&m_visibleMem);
+        }
+        visibleBuf = VK_NULL_HANDLE;
+    }
+
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    MemoryAllocator* m_memAllocator{nullptr};
+    VkShaderModule m_shaderModule{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet m_descriptorSet{VK_NULL_HANDLE};
+    VkPipelineLayout m_pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline m_pipeline{VK_NULL_HANDLE};
+    VkBuffer m_paramsBuf{VK_NULL_HANDLE};
+    MemoryAllocation m_paramsMem{};
+    MemoryAllocation m_drawMem{};
+    MemoryAllocation m_visibleMem{};
+};
+
 struct DepthBuffer {
-    VkDeviceMemory depthMemory{VK_NULL_HANDLE};
+    MemoryAllocation depthMemory{};
     VkImage depthImage{VK_NULL_HANDLE};
+    VkFormat depthFormat{VK_FORMAT_UNDEFINED};
+    // Bound to lazily allocated memory, which tiled GPUs may never need to back.
+    bool transient{false};
 
     DepthBuffer() = default;
 
@@ -888,12 +2006,9 @@ struct DepthBuffer {
             if (depthImage != VK_NULL_HANDLE) {
                 vkDestroyImage(m_vkDevice, depthImage, nullptr);
             }
-            if (depthMemory != VK_NULL_HANDLE) {
-                vkFreeMemory(m_vkDevice, depthMemory, nullptr);
-            }
+            m_memAllocator->Free(&depthMemory);
         }
         depthImage = VK_NULL_HANDLE;
-        depthMemory = VK_NULL_HANDLE;
         m_vkDevice = nullptr;
     }
 
@@ -902,7 +2017,12 @@ struct DepthBuffer {
 
         swap(depthImage, other.depthImage);
         swap(depthMemory, other.depthMemory);
+        swap(depthFormat, other.depthFormat);
+        swap(transient, other.transient);
+        swap(m_layerCount, other.m_layerCount);
         swap(m_vkDevice, other.m_vkDevice);
+        swap(m_memAllocator, other.m_memAllocator);
+        swap(m_vkLayout, other.m_vkLayout);
     }
     DepthBuffer& operator=(DepthBuffer&& other) noexcept {
         if (&other == this) {
@@ -914,36 +2034,57 @@ struct DepthBuffer {
 
         swap(depthImage, other.depthImage);
         swap(depthMemory, other.depthMemory);
+        swap(depthFormat, other.depthFormat);
+        swap(transient, other.transient);
+        swap(m_layerCount, other.m_layerCount);
         swap(m_vkDevice, other.m_vkDevice);
+        swap(m_memAllocator, other.m_memAllocator);
+        swap(m_vkLayout, other.m_vkLayout);
         return *this;
     }
 
-    void Create(VkDevice device, MemoryAllocator* memAllocator, VkFormat depthFormat,
+    void Create(VkDevice device, MemoryAllocator* memAllocator, VkFormat aDepthFormat,
                 const XrSwapchainCreateInfo& swapchainCreateInfo) {
         m_vkDevice = device;
+        m_memAllocator = memAllocator;
+        m_layerCount = swapchainCreateInfo.arraySize;
+        depthFormat = aDepthFormat;
 
         VkExtent2D size = {swapchainCreateInfo.width, swapchainCreateInfo.height};
 
-        // Create a D32 depthbuffer
+        // The contents are only needed during a render pass, so on devices with lazily allocated memory (tilers) the
+        // image may stay in tile memory entirely.
+        const bool lazyMemory = memAllocator->HasMemoryType(~0u, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+        // Create a D32 depthbuffer with a layer for each layer of the color swapchain
         VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
         imageInfo.extent.width = size.width;
         imageInfo.extent.height = size.height;
         imageInfo.extent.depth = 1;
         imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
+        imageInfo.arrayLayers = m_layerCount;
         imageInfo.format = depthFormat;
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (lazyMemory) {
+            imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        }
         imageInfo.samples = (VkSampleCountFlagBits)swapchainCreateInfo.sampleCount;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         CHECK_VKCMD(vkCreateImage(device, &imageInfo, nullptr, &depthImage));
 
         VkMemoryRequirements memRequirements{};
         vkGetImageMemoryRequirements(device, depthImage, &memRequirements);
-        memAllocator->Allocate(memRequirements, &depthMemory, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        CHECK_VKCMD(vkBindImageMemory(device, depthImage, depthMemory, 0));
+        VkFlags memFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        transient = lazyMemory && memAllocator->HasMemoryType(memRequirements.memoryTypeBits,
+                                                              memFlags | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+        if (transient) {
+            memFlags |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        }
+        memAllocator->Allocate(memRequirements, &depthMemory, memFlags, MemoryTiling::Optimal);
+        CHECK_VKCMD(vkBindImageMemory(device, depthImage, depthMemory.memory, depthMemory.offset));
     }
 
     void TransitionLayout(CmdBuffer* cmdBuffer, VkImageLayout newLayout) {
@@ -957,7 +2098,7 @@ struct DepthBuffer {
         depthBarrier.oldLayout = m_vkLayout;
         depthBarrier.newLayout = newLayout;
         depthBarrier.image = depthImage;
-        depthBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+        depthBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, m_layerCount};
         vkCmdPipelineBarrier(cmdBuffer->buf, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr,
                              0, nullptr, 1, &depthBarrier);
 
@@ -969,7 +2110,51 @@ struct DepthBuffer {
 
    private:
     VkDevice m_vkDevice{VK_NULL_HANDLE};
+    MemoryAllocator* m_memAllocator{nullptr};
     VkImageLayout m_vkLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    uint32_t m_layerCount{1};
+};
+
+// Hands out depth buffers shared by every swapchain of the same size, layer count and sample count, e.g. the left and
+// right eye. Each render pass clears depth and discards it at the end, and all passes are submitted to one queue where
+// the render pass's external dependency orders them, so any number of frames in flight can use the same image.
+struct DepthBufferPool {
+    static constexpr VkFormat DepthFormat = VK_FORMAT_D32_SFLOAT;
+
+    void Init(VkDevice device, MemoryAllocator* memAllocator) {
+        m_vkDevice = device;
+        m_memAllocator = memAllocator;
+    }
+
+    DepthBuffer* Acquire(const XrSwapchainCreateInfo& swapchainCreateInfo) {
+        const std::array<uint32_t, 4> key{{swapchainCreateInfo.width, swapchainCreateInfo.height, swapchainCreateInfo.arraySize,
+                                           swapchainCreateInfo.sampleCount}};
+        auto it = m_depthBuffers.find(key);
+        if (it == m_depthBuffers.end()) {
+            it = m_depthBuffers.emplace(key, DepthBuffer{}).first;
+            it->second.Create(m_vkDevice, m_memAllocator, DepthFormat, swapchainCreateInfo);
+            m_allocatedBytes += it->second.depthMemory.size;
+        }
+        m_requestCount++;
+        m_requestedBytes += it->second.depthMemory.size;
+
+        constexpr double MiB = 1024.0 * 1024.0;
+        Log::Write(Log::Level::Info,
+                   Fmt("%u swapchains share %zu depth buffers (%s): %.1f MiB instead of %.1f MiB, %.1f MiB saved", m_requestCount,
+                       m_depthBuffers.size(), it->second.transient ? "transient" : "device local", m_allocatedBytes / MiB,
+                       m_requestedBytes / MiB, (m_requestedBytes - m_allocatedBytes) / MiB));
+        return &it->second;
+    }
+
+   private:
+    VkDevice m_vkDevice{VK_NULL_HANDLE};
+    MemoryAllocator* m_memAllocator{nullptr};
+    // Keyed by width, height, layer count and sample count.
+    std::map<std::array<uint32_t, 4>, DepthBuffer> m_depthBuffers;
+    // Number of swapchains given a depth buffer, and the memory one depth buffer per swapchain would have taken.
+    uint32_t m_requestCount{0};
+    VkDeviceSize m_requestedBytes{0};
+    VkDeviceSize m_allocatedBytes{0};
 };
 
 struct SwapchainImageContext {
@@ -979,26 +2164,30 @@ struct SwapchainImageContext {
     std::vector<XrSwapchainImageVulkan2KHR> swapchainImages;
     std::vector<RenderTarget> renderTarget;
     VkExtent2D size{};
-    DepthBuffer depthBuffer{};
+    // Number of views rendered in one pass, one per swapchain array layer.
+    uint32_t viewCount{1};
+    // Shared with other swapchains of the same size; owned by the DepthBufferPool.
+    DepthBuffer* depthBuffer{nullptr};
     RenderPass rp{};
     Pipeline pipe{};
     XrStructureType swapchainImageType;
 
     SwapchainImageContext() = default;
 
-    std::vector<XrSwapchainImageBaseHeader*> Create(VkDevice device, MemoryAllocator* memAllocator, uint32_t capacity,
+    std::vector<XrSwapchainImageBaseHeader*> Create(VkDevice device, DepthBuffer* sharedDepthBuffer, uint32_t capacity,
                                                     const XrSwapchainCreateInfo& swapchainCreateInfo, const PipelineLayout& layout,
-                                                    const ShaderProgram& sp, const VertexBuffer<Geometry::Vertex>& vb) {
+                                                    const ShaderProgram& sp, const VertexBuffer<Geometry::Vertex>& vb,
+                                                    const InstanceBuffer& ib, VkPipelineCache pipelineCache) {
         m_vkDevice = device;
 
         size = {swapchainCreateInfo.width, swapchainCreateInfo.height};
+        viewCount = swapchainCreateInfo.arraySize;
         VkFormat colorFormat = (VkFormat)swapchainCreateInfo.format;
-        VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
         // XXX handle swapchainCreateInfo.sampleCount
 
-        depthBuffer.Create(m_vkDevice, memAllocator, depthFormat, swapchainCreateInfo);
-        rp.Create(m_vkDevice, colorFormat, depthFormat);
-        pipe.Create(m_vkDevice, size, layout, rp, sp, vb);
+        depthBuffer = sharedDepthBuffer;
+        rp.Create(m_vkDevice, colorFormat, depthBuffer->depthFormat, viewCount);
+        pipe.Create(m_vkDevice, size, layout, rp, sp, vb, ib, pipelineCache);
 
         swapchainImages.resize(capacity);
         renderTarget.resize(capacity);
@@ -1018,7 +2207,7 @@ struct SwapchainImageContext {
 
     void BindRenderTarget(uint32_t index, VkRenderPassBeginInfo* renderPassBeginInfo) {
         if (renderTarget[index].fb == VK_NULL_HANDLE) {
-            renderTarget[index].Create(m_vkDevice, swapchainImages[index].image, depthBuffer.depthImage, size, rp);
+            renderTarget[index].Create(m_vkDevice, swapchainImages[index].image, depthBuffer->depthImage, size, rp);
         }
         renderPassBeginInfo->renderPass = rp.pass;
         renderPassBeginInfo->framebuffer = renderTarget[index].fb;
@@ -1261,7 +2450,11 @@ void Swapchain::Present(VkQueue queue, VkSemaphore drawComplete) {
 
 struct VulkanGraphicsPlugin : public IGraphicsPlugin {
     VulkanGraphicsPlugin(const std::shared_ptr<Options>& options, std::shared_ptr<IPlatformPlugin> /*unused*/)
-        : m_clearColor(options->GetBackgroundClearColor()) {
+        : m_cacheDirectory(options->CacheDirectory),
+          m_clearColor(options->GetBackgroundClearColor()),
+          m_gpuCulling(options->GpuCulling),
+          m_framesInFlight(std::max(options->FramesInFlight, 1u)),
+          m_parallelRecording(options->ParallelRecording) {
         m_graphicsBinding.type = GetGraphicsBindingType();
     };
 
@@ -1306,6 +2499,7 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
     }
 
     void InitializeDevice(XrInstance instance, XrSystemId systemId) override {
+        TRACE_ZONE("InitializeDevice");
         // Create the Vulkan device for the adapter associated with the system.
         // Extension function must be loaded by name
         XrGraphicsRequirementsVulkan2KHR graphicsRequirements{XR_TYPE_GRAPHICS_REQUIREMENTS_VULKAN2_KHR};
@@ -1339,7 +2533,17 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         appInfo.applicationVersion = 1;
         appInfo.pEngineName = "hello_xr";
         appInfo.engineVersion = 1;
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // The multiview vertex shader is SPIR-V 1.3, which needs Vulkan 1.1. Ask for 1.1 when both the loader and the runtime
+        // allow it, otherwise stay on 1.0 without multiview.
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        auto pfnEnumerateInstanceVersion =
+            (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion");
+        if (pfnEnumerateInstanceVersion != nullptr) {
+            CHECK_VKCMD(pfnEnumerateInstanceVersion(&loaderVersion));
+        }
+        const bool vulkan11Instance =
+            loaderVersion >= VK_API_VERSION_1_1 && graphicsRequirements.maxApiVersionSupported >= XR_MAKE_VERSION(1, 1, 0);
+        appInfo.apiVersion = vulkan11Instance ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
 
         VkInstanceCreateInfo instInfo{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
         instInfo.pApplicationInfo = &appInfo;
@@ -1389,6 +2593,7 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
             // Only need graphics (not presentation) for draw queue
             if ((queueFamilyProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0u) {
                 m_queueFamilyIndex = queueInfo.queueFamilyIndex = i;
+                m_timestampValidBits = queueFamilyProps[i].timestampValidBits;
                 break;
             }
         }
@@ -1402,6 +2607,13 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 #endif
 
+        // Multiview is core in Vulkan 1.1 and every 1.1 device supports the multiview feature.
+        VkPhysicalDeviceProperties physicalDeviceProperties{};
+        vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &physicalDeviceProperties);
+        VkPhysicalDeviceMultiviewFeatures multiviewFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES};
+        multiviewFeatures.multiview = VK_TRUE;
+        m_multiviewSupported = vulkan11Instance && physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_1;
+
         VkDeviceCreateInfo deviceInfo{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
         deviceInfo.queueCreateInfoCount = 1;
         deviceInfo.pQueueCreateInfos = &queueInfo;
@@ -1410,6 +2622,9 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         deviceInfo.enabledExtensionCount = (uint32_t)deviceExtensions.size();
         deviceInfo.ppEnabledExtensionNames = deviceExtensions.empty() ? nullptr : deviceExtensions.data();
         deviceInfo.pEnabledFeatures = &features;
+        if (m_multiviewSupported) {
+            deviceInfo.pNext = &multiviewFeatures;
+        }
 
         XrVulkanDeviceCreateInfoKHR deviceCreateInfo{XR_TYPE_VULKAN_DEVICE_CREATE_INFO_KHR};
         deviceCreateInfo.systemId = systemId;
@@ -1423,6 +2638,7 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         vkGetDeviceQueue(m_vkDevice, queueInfo.queueFamilyIndex, 0, &m_vkQueue);
 
         m_memAllocator.Init(m_vkPhysicalDevice, m_vkDevice);
+        m_depthBufferPool.Init(m_vkDevice, &m_memAllocator);
 
         InitializeResources();
 
@@ -1434,12 +2650,36 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
     }
 
 #ifdef USE_ONLINE_VULKAN_SHADERC
-    // Compile a shader to a SPIR-V binary.
-    std::vector<uint32_t> CompileGlslShader(const std::string& name, shaderc_shader_kind kind, const std::string& source) {
+    // Compile a shader to a SPIR-V binary, or fetch it from the SPIR-V cache, which is keyed by a hash of the source and
+    // the compile settings.
+    std::vector<uint32_t> CompileGlslShader(const std::string& name, shaderc_shader_kind kind, const std::string& source,
+                                            shaderc_env_version vulkanVersion = shaderc_env_version_vulkan_1_0) {
+        m_spirvCacheRequests++;
+        std::string cachePath;
+        if (!m_cacheDirectory.empty()) {
+            const shaderc_optimization_level optimizationLevel = shaderc_optimization_level_size;
+            uint64_t key = HashBytes(source.data(), source.size());
+            key = HashBytes(&kind, sizeof(kind), key);
+            key = HashBytes(&optimizationLevel, sizeof(optimizationLevel), key);
+            key = HashBytes(&vulkanVersion, sizeof(vulkanVersion), key);
+            cachePath = Fmt("%s/spirv_%016llx.spv", m_cacheDirectory.c_str(), (unsigned long long)key);
+
+            std::vector<uint8_t> cached;
+            if (ReadCacheFile(cachePath, &cached) && cached.size() >= sizeof(uint32_t) && cached.size() % sizeof(uint32_t) == 0) {
+                std::vector<uint32_t> spirv(cached.size() / sizeof(uint32_t));
+                memcpy(spirv.data(), cached.data(), cached.size());
+                if (spirv[0] == SpirvMagic) {
+                    m_spirvCacheHits++;
+                    return spirv;
+                }
+            }
+        }
+
         shaderc::Compiler compiler;
         shaderc::CompileOptions options;
 
         options.SetOptimizationLevel(shaderc_optimization_level_size);
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, vulkanVersion);
 
         shaderc::SpvCompilationResult module = compiler.CompileGlslToSpv(source, kind, name.c_str(), options);
 
@@ -1448,14 +2688,26 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
             return std::vector<uint32_t>();
         }
 
-        return {module.cbegin(), module.cend()};
+        std::vector<uint32_t> spirv{module.cbegin(), module.cend()};
+        if (!cachePath.empty()) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(spirv.data());
+            if (!WriteCacheFile(cachePath, std::vector<uint8_t>(bytes, bytes + spirv.size() * sizeof(uint32_t)))) {
+                Log::Write(Log::Level::Warning, Fmt("Failed to write SPIR-V cache %s", cachePath.c_str()));
+            }
+        }
+        return spirv;
     }
 #endif
 
     void InitializeResources() {
+        const ksNanoseconds shaderStart = GetTimeNanoseconds();
 #ifdef USE_ONLINE_VULKAN_SHADERC
         auto vertexSPIRV = CompileGlslShader("vertex", shaderc_glsl_default_vertex_shader, VertexShaderGlsl);
         auto fragmentSPIRV = CompileGlslShader("fragment", shaderc_glsl_default_fragment_shader, FragmentShaderGlsl);
+        auto multiviewVertexSPIRV =
+            CompileGlslShader("multiview vertex", shaderc_glsl_default_vertex_shader, MultiviewVertexShaderGlsl,
+                              shaderc_env_version_vulkan_1_1);
+        auto cullSPIRV = CompileGlslShader("culling", shaderc_glsl_default_compute_shader, CullComputeShaderGlsl);
 #else
         std::vector<uint32_t> vertexSPIRV = SPV_PREFIX
 #include "vert.spv"
@@ -1463,19 +2715,47 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         std::vector<uint32_t> fragmentSPIRV = SPV_PREFIX
 #include "frag.spv"
             SPV_SUFFIX;
+        std::vector<uint32_t> multiviewVertexSPIRV = SPV_PREFIX
+#include "vert_multiview.spv"
+            SPV_SUFFIX;
+        std::vector<uint32_t> cullSPIRV = SPV_PREFIX
+#include "comp_cull.spv"
+            SPV_SUFFIX;
 #endif
         if (vertexSPIRV.empty()) THROW("Failed to compile vertex shader");
         if (fragmentSPIRV.empty()) THROW("Failed to compile fragment shader");
+#ifdef USE_ONLINE_VULKAN_SHADERC
+        Log::Write(Log::Level::Info, Fmt("Shaders compiled in %.2fms, %u of %u from the SPIR-V cache",
+                                         (GetTimeNanoseconds() - shaderStart) * 1e-6, m_spirvCacheHits, m_spirvCacheRequests));
+#else
+        Log::Write(Log::Level::Info, Fmt("Shaders loaded in %.2fms", (GetTimeNanoseconds() - shaderStart) * 1e-6));
+#endif
+
+        VkPhysicalDeviceProperties deviceProperties{};
+        vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &deviceProperties);
+        m_pipelineCache.Create(m_vkDevice, deviceProperties,
+                               m_cacheDirectory.empty() ? std::string() : m_cacheDirectory + "/vulkan_pipeline.cache");
+        m_timestampQueries.Create(m_vkDevice, deviceProperties, m_timestampValidBits);
 
         m_shaderProgram.Init(m_vkDevice);
         m_shaderProgram.LoadVertexShader(vertexSPIRV);
         m_shaderProgram.LoadFragmentShader(fragmentSPIRV);
 
+        if (m_multiviewSupported) {
+            if (multiviewVertexSPIRV.empty()) THROW("Failed to compile multiview vertex shader");
+            m_multiviewShaderProgram.Init(m_vkDevice);
+            m_multiviewShaderProgram.LoadVertexShader(multiviewVertexSPIRV);
+            m_multiviewShaderProgram.LoadFragmentShader(fragmentSPIRV);
+        }
+
         // Semaphore to block on draw complete
         VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
         CHECK_VKCMD(vkCreateSemaphore(m_vkDevice, &semInfo, nullptr, &m_vkDrawDone));
 
-        if (!m_cmdBuffer.Init(m_vkDevice, m_queueFamilyIndex)) THROW("Failed to create command buffer");
+        // Starts empty; AllocateSwapchainImageStructs adds the slots of every swapchain.
+        m_cmdBufferRing.Init(m_vkDevice, m_queueFamilyIndex);
+        // One recorder per worker plus the render thread, which records while it waits for them.
+        m_secondaryCmdPools.Init(m_vkDevice, m_queueFamilyIndex, m_jobSystem ? m_jobSystem->WorkerCount() + 1 : 1);
 
         m_pipelineLayout.Create(m_vkDevice);
 
@@ -1489,15 +2769,27 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
         m_drawBuffer.UpdateIndices(Geometry::c_cubeIndices, numCubeIdicies, 0);
         m_drawBuffer.UpdateVertices(Geometry::c_cubeVertices, numCubeVerticies, 0);
 
+        m_instanceBuffer.Init(m_vkDevice, &m_memAllocator, m_framesInFlight);
+        m_instanceBuffer.Reserve(InitialInstanceCapacity);
+        m_instanceRegionSerials.assign(m_framesInFlight, 0);
+
+        if (cullSPIRV.empty()) THROW("Failed to compile culling compute shader");
+        const ksNanoseconds cullStart = GetTimeNanoseconds();
+        m_cullPass.Create(m_vkDevice, &m_memAllocator, cullSPIRV, m_pipelineCache.cache);
+        LogPipelineCreation("Culling", GetTimeNanoseconds() - cullStart);
+        m_cullPass.Bind(m_instanceBuffer);
+
 #if defined(USE_MIRROR_WINDOW)
         m_swapchain.Create(m_vkInstance, m_vkPhysicalDevice, m_vkDevice, m_graphicsBinding.queueFamilyIndex);
 
-        m_cmdBuffer.Reset();
-        m_cmdBuffer.Begin();
-        m_swapchain.Prepare(m_cmdBuffer.buf);
-        m_cmdBuffer.End();
-        m_cmdBuffer.Exec(m_vkQueue);
-        m_cmdBuffer.Wait();
+        // One-off setup work, kept out of the ring so it does not shift the ring's per-frame layout.
+        CmdBuffer setupCmdBuffer;
+        if (!setupCmdBuffer.Init(m_vkDevice, m_queueFamilyIndex)) THROW("Failed to create command buffer");
+        setupCmdBuffer.Begin();
+        m_swapchain.Prepare(setupCmdBuffer.buf);
+        setupCmdBuffer.End();
+        setupCmdBuffer.Exec(m_vkQueue);
+        setupCmdBuffer.Wait();
 #endif
     }
 
@@ -1522,37 +2814,139 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
 
     std::vector<XrSwapchainImageBaseHeader*> AllocateSwapchainImageStructs(
         uint32_t capacity, const XrSwapchainCreateInfo& swapchainCreateInfo) override {
+        TRACE_ZONE("AllocateSwapchainImageStructs");
         // Allocate and initialize the buffer of image structs (must be sequential in memory for xrEnumerateSwapchainImages).
         // Return back an array of pointers to each swapchain image struct so the consumer doesn't need to know the type/size.
         // Keep the buffer alive by adding it into the list of buffers.
         m_swapchainImageContexts.emplace_back(GetSwapchainImageType());
         SwapchainImageContext& swapchainImageContext = m_swapchainImageContexts.back();
 
+        const bool multiview = swapchainCreateInfo.arraySize > 1;
+        CHECK_MSG(!multiview || (m_multiviewSupported && swapchainCreateInfo.arraySize <= PipelineLayout::MaxViewCount),
+                  "Array swapchains are only supported for multiview rendering");
+        const ksNanoseconds createStart = GetTimeNanoseconds();
         std::vector<XrSwapchainImageBaseHeader*> bases = swapchainImageContext.Create(
-            m_vkDevice, &m_memAllocator, capacity, swapchainCreateInfo, m_pipelineLayout, m_shaderProgram, m_drawBuffer);
+            m_vkDevice, m_depthBufferPool.Acquire(swapchainCreateInfo), capacity, swapchainCreateInfo, m_pipelineLayout,
+            multiview ? m_multiviewShaderProgram : m_shaderProgram, m_drawBuffer, m_instanceBuffer, m_pipelineCache.cache);
+        LogPipelineCreation("Swapchain", GetTimeNanoseconds() - createStart);
+
+        // Persist the pipelines as soon as they exist; the process may not get to shut down cleanly.
+        m_pipelineCache.Save();
+
+        m_memAllocator.LogStatistics(Log::Level::Verbose);
 
         // Map every swapchainImage base pointer to this context
         for (auto& base : bases) {
             m_swapchainImageContextMap[base] = &swapchainImageContext;
         }
 
+        // Every frame renders each swapchain with one submission, in the order the swapchains were created. With
+        // m_framesInFlight slots per swapchain the ring holds m_framesInFlight whole frames, so a slot is reused by the
+        // same swapchain exactly m_framesInFlight frames later. Growing restarts the ring at its first slot.
+        m_cmdBufferRing.WaitAll();
+        m_cmdBufferRing.Grow(m_framesInFlight);
+
         return bases;
     }
 
+    bool SupportsMultiview() const override { return m_multiviewSupported; }
+
+    bool SupportsRenderPacket(GraphicsAPI* projectionApi) const override {
+        *projectionApi = GRAPHICS_VULKAN;
+        return true;
+    }
+
     void RenderView(const XrCompositionLayerProjectionView& layerView, const XrSwapchainImageBaseHeader* swapchainImage,
-                    int64_t /*swapchainFormat*/, const std::vector<Cube>& cubes) override {
-        CHECK(layerView.subImage.imageArrayIndex == 0);  // Texture arrays not supported.
+                    int64_t swapchainFormat, const std::vector<Cube>& cubes) override {
+        RenderPacketViews(m_viewPacketBuilder.BuildView(layerView, GRAPHICS_VULKAN, cubes), 0, 1, swapchainImage, swapchainFormat);
+    }
+
+    void LogPipelineCreation(const char* name, ksNanoseconds duration) const {
+        Log::Write(Log::Level::Info, Fmt("%s pipeline created in %.2fms (%s pipeline cache)", name, duration * 1e-6,
+                                         m_pipelineCache.IsWarm() ? "warm" : "cold"));
+    }
+
+    // Copy the packet's model transforms into the next region of the instance buffer.
+    void UploadInstances(const RenderPacket& packet) {
+        m_instanceRegion = (m_instanceRegion + 1) % m_instanceBuffer.RegionCount();
+        // The region was last read by a submission m_framesInFlight frames ago; normally it has long finished.
+        m_cmdBufferRing.Wait(m_instanceRegionSerials[m_instanceRegion]);
+
+        if (packet.ModelCount > m_instanceBuffer.RegionCapacity()) {
+            // Growing replaces the buffer, so nothing in flight may still read any region of it.
+            m_cmdBufferRing.WaitAll();
+            m_instanceBuffer.Reserve(std::max(packet.ModelCount, 2 * m_instanceBuffer.RegionCapacity()));
+            m_cullPass.Bind(m_instanceBuffer);
+            Log::Writef<Log::Level::Verbose>("Instance buffer grown to %u instances", m_instanceBuffer.RegionCapacity());
+            m_memAllocator.LogStatistics(Log::Level::Verbose);
+        }
+
+        XrMatrix4x4f* models = m_instanceBuffer.Region(m_instanceRegion);
+        const auto copyModels = [&](uint32_t begin, uint32_t end) {
+            std::copy(packet.Models + begin, packet.Models + end, models + begin);
+        };
+        if (m_jobSystem) {
+            m_jobSystem->ParallelFor(packet.ModelCount, InstancesPerJob, copyModels);
+        } else {
+            copyModels(0, packet.ModelCount);
+        }
+
+        m_instanceFrame = packet.Frame;
+    }
+
+    // Render viewCount views of the packet in a single render pass. With more than one view the swapchain image must be an
+    // array with a layer per view, and the multiview pipeline picks each view's transform from the pushed array by
+    // gl_ViewIndex. All cubes are drawn with one instanced draw; their model transforms come from the instance buffer,
+    // filled once per frame. With GPU culling a compute pass first reduces them to the ones inside a view frustum and the
+    // draw is issued indirectly.
+    void RenderPacketViews(const RenderPacket& packet, uint32_t firstView, uint32_t viewCount,
+                           const XrSwapchainImageBaseHeader* swapchainImage, int64_t /*swapchainFormat*/) override {
+        TRACE_ZONE("RenderPacketViews");
+        for (uint32_t i = 0; i < viewCount; i++) {
+            // View i of the pass must be in layer i; a single view does not render to texture arrays.
+            CHECK(packet.LayerViews[firstView + i].subImage.imageArrayIndex == i);
+        }
 
         auto swapchainContext = m_swapchainImageContextMap[swapchainImage];
         uint32_t imageIndex = swapchainContext->ImageIndex(swapchainImage);
+        CHECK(viewCount == swapchainContext->viewCount);
+
+        // Only blocks if the GPU is more than m_framesInFlight frames behind.
+        CmdBuffer& cmdBuffer = m_cmdBufferRing.Begin();
+        const uint64_t serial = m_cmdBufferRing.Serial();
+        const uint32_t firstTimedView = m_timestampQueries.AddViews(viewCount);
 
-        // XXX Should double-buffer the command buffers, for now just flush
-        m_cmdBuffer.Wait();
-        m_cmdBuffer.Reset();
-        m_cmdBuffer.Begin();
+        // View-projection transform of each view of the pass.
+        // Note all matrixes (including OpenXR's) are column-major, right-handed.
+        const XrMatrix4x4f* vp = &packet.ViewProjections[firstView];
+        const uint32_t instanceCount = packet.ModelCount;
+
+        if (instanceCount > 0) {
+            // Views of the same frame share one upload.
+            if (packet.Frame != m_instanceFrame) {
+                UploadInstances(packet);
+            }
+            m_instanceRegionSerials[m_instanceRegion] = m_cmdBufferRing.Serial();
+
+            if (m_gpuCulling) {
+                // Cull against every view rendered by this pass; a single view fills both plane sets.
+                CullPass::Params params{};
+                for (uint32_t i = 0; i < CullPass::MaxViewCount; i++) {
+                    CullPass::GetFrustumPlanes(vp[std::min(i, viewCount - 1)], &params.planes[i * CullPass::PlanesPerView]);
+                }
+                params.radius = CubeBoundingRadius;
+                params.instanceCount = instanceCount;
+                const uint32_t cullQuery = m_timestampQueries.BeginPass(cmdBuffer.buf, serial, "Cull", firstTimedView, viewCount);
+                m_cullPass.Record(cmdBuffer.buf, m_instanceBuffer.RegionOffset(m_instanceRegion), params,
+                                  m_drawBuffer.count.idx);
+                m_timestampQueries.EndPass(cmdBuffer.buf, cullQuery);
+            }
+        }
+
+        const uint32_t drawQuery = m_timestampQueries.BeginPass(cmdBuffer.buf, serial, "Draw", firstTimedView, viewCount);
 
         // Ensure depth is in the right layout
-        swapchainContext->depthBuffer.TransitionLayout(&m_cmdBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+        swapchainContext->depthBuffer->TransitionLayout(&cmdBuffer, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 
         // Bind and clear eye render target
         static std::array<VkClearValue, 2> clearValues;
@@ -1568,45 +2962,35 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
 
         swapchainContext->BindRenderTarget(imageIndex, &renderPassBeginInfo);
 
-        vkCmdBeginRenderPass(m_cmdBuffer.buf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        // Culled instances are drawn by a single indirect draw, which leaves nothing to split.
+        uint32_t recorderCount = 1;
+        if (m_parallelRecording && !m_gpuCulling) {
+            recorderCount = std::min(m_secondaryCmdPools.RecorderCount(),
+                                     (instanceCount + MinInstancesPerRecorder - 1) / MinInstancesPerRecorder);
+        }
+
+        if (recorderCount > 1) {
+            vkCmdBeginRenderPass(cmdBuffer.buf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            RecordParallelDraws(renderPassBeginInfo, swapchainContext->pipe.pipe, vp, viewCount, instanceCount, recorderCount);
+            vkCmdExecuteCommands(cmdBuffer.buf, recorderCount, m_secondaryCmdBuffers.data());
+        } else {
+            vkCmdBeginRenderPass(cmdBuffer.buf, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+            // Draw every cube in one call.
+            RecordDraw(cmdBuffer.buf, swapchainContext->pipe.pipe, vp, viewCount, 0, instanceCount,
+                       instanceCount > 0 && m_gpuCulling);
+        }
 
-        vkCmdBindPipeline(m_cmdBuffer.buf, VK_PIPELINE_BIND_POINT_GRAPHICS, swapchainContext->pipe.pipe);
+        vkCmdEndRenderPass(cmdBuffer.buf);
+        m_timestampQueries.EndPass(cmdBuffer.buf, drawQuery);
 
-        // Bind index and vertex buffers
-        vkCmdBindIndexBuffer(m_cmdBuffer.buf, m_drawBuffer.idxBuf, 0, VK_INDEX_TYPE_UINT16);
-        VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(m_cmdBuffer.buf, 0, 1, &m_drawBuffer.vtxBuf, &offset);
+        cmdBuffer.End();
+        cmdBuffer.Exec(m_vkQueue);
 
-        // Compute the view-projection transform.
-        // Note all matrixes (including OpenXR's) are column-major, right-handed.
-        const auto& pose = layerView.pose;
-        XrMatrix4x4f proj;
-        XrMatrix4x4f_CreateProjectionFov(&proj, GRAPHICS_VULKAN, layerView.fov, 0.05f, 100.0f);
-        XrMatrix4x4f toView;
-        XrVector3f scale{1.f, 1.f, 1.f};
-        XrMatrix4x4f_CreateTranslationRotationScale(&toView, &pose.position, &pose.orientation, &scale);
-        XrMatrix4x4f view;
-        XrMatrix4x4f_InvertRigidBody(&view, &toView);
-        XrMatrix4x4f vp;
-        XrMatrix4x4f_Multiply(&vp, &proj, &view);
-
-        // Render each cube
-        for (const Cube& cube : cubes) {
-            // Compute the model-view-projection transform and push it.
-            XrMatrix4x4f model;
-            XrMatrix4x4f_CreateTranslationRotationScale(&model, &cube.Pose.position, &cube.Pose.orientation, &cube.Scale);
-            XrMatrix4x4f mvp;
-            XrMatrix4x4f_Multiply(&mvp, &vp, &model);
-            vkCmdPushConstants(m_cmdBuffer.buf, m_pipelineLayout.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mvp.m), &mvp.m[0]);
-
-            // Draw the cube.
-            vkCmdDrawIndexed(m_cmdBuffer.buf, m_drawBuffer.count.idx, 1, 0, 0, 0);
-        }
-
-        vkCmdEndRenderPass(m_cmdBuffer.buf);
-
-        m_cmdBuffer.End();
-        m_cmdBuffer.Exec(m_vkQueue);
+        if (m_cmdBufferRing.AcquireCount() % CmdBufferStatsInterval == 0) {
+            Log::Writef<Log::Level::Verbose>("Command buffer ring: %u buffers, CPU blocked on %llu of %llu submissions",
+                                             m_cmdBufferRing.Size(), (unsigned long long)m_cmdBufferRing.BlockedCount(),
+                                             (unsigned long long)m_cmdBufferRing.AcquireCount());
+        }
 
 #if defined(USE_MIRROR_WINDOW)
         // Cycle the window's swapchain on the last view rendered
@@ -1617,12 +3001,83 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
 #endif
     }
 
+    // Bind the cube pipeline and geometry, push the view-projection transforms and draw instanceCount instances starting
+    // at firstInstance, or with culled, the instances that survived GPU culling.
+    void RecordDraw(VkCommandBuffer buf, VkPipeline pipe, const XrMatrix4x4f* vp, uint32_t viewCount, uint32_t firstInstance,
+                    uint32_t instanceCount, bool culled) {
+        vkCmdBindPipeline(buf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe);
+
+        // Bind index and vertex buffers
+        vkCmdBindIndexBuffer(buf, m_drawBuffer.idxBuf, 0, VK_INDEX_TYPE_UINT16);
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(buf, 0, 1, &m_drawBuffer.vtxBuf, &offset);
+
+        // Push the view-projection transforms.
+        vkCmdPushConstants(buf, m_pipelineLayout.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, viewCount * sizeof(vp[0].m), &vp[0].m[0]);
+
+        if (culled) {
+            const VkDeviceSize visibleOffset = 0;
+            vkCmdBindVertexBuffers(buf, InstanceBuffer::Binding, 1, &m_cullPass.visibleBuf, &visibleOffset);
+            vkCmdDrawIndexedIndirect(buf, m_cullPass.drawBuf, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+        } else if (instanceCount > 0) {
+            const VkDeviceSize instanceOffset = m_instanceBuffer.RegionOffset(m_instanceRegion);
+            vkCmdBindVertexBuffers(buf, InstanceBuffer::Binding, 1, &m_instanceBuffer.buf, &instanceOffset);
+            vkCmdDrawIndexed(buf, m_drawBuffer.count.idx, instanceCount, 0, 0, firstInstance);
+        }
+    }
+
+    // Split the instances into recorderCount ranges and record the draw of each into a secondary command buffer on its
+    // own job, for the render pass begun with renderPassBeginInfo. Leaves them in m_secondaryCmdBuffers, in order.
+    void RecordParallelDraws(const VkRenderPassBeginInfo& renderPassBeginInfo, VkPipeline pipe, const XrMatrix4x4f* vp,
+                             uint32_t viewCount, uint32_t instanceCount, uint32_t recorderCount) {
+        m_secondaryCmdPools.Begin(m_cmdBufferRing.Index());
+        m_secondaryCmdBuffers.resize(recorderCount);
+
+        VkCommandBufferInheritanceInfo inheritance{VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+        inheritance.renderPass = renderPassBeginInfo.renderPass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = renderPassBeginInfo.framebuffer;
+
+        m_jobSystem->ParallelFor(recorderCount, 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t recorder = begin; recorder < end; recorder++) {
+                const uint32_t first = (uint32_t)((uint64_t)instanceCount * recorder / recorderCount);
+                const uint32_t last = (uint32_t)((uint64_t)instanceCount * (recorder + 1) / recorderCount);
+
+                VkCommandBuffer buf = m_secondaryCmdPools.Allocate(recorder);
+                VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                beginInfo.pInheritanceInfo = &inheritance;
+                CHECK_VKCMD(vkBeginCommandBuffer(buf, &beginInfo));
+                RecordDraw(buf, pipe, vp, viewCount, first, last - first, false);
+                CHECK_VKCMD(vkEndCommandBuffer(buf));
+                m_secondaryCmdBuffers[recorder] = buf;
+            }
+        });
+    }
+
     uint32_t GetSupportedSwapchainSampleCount(const XrViewConfigurationView&) override { return VK_SAMPLE_COUNT_1_BIT; }
 
-    void UpdateOptions(const std::shared_ptr<Options>& options) override { m_clearColor = options->GetBackgroundClearColor(); }
+    void BeginGpuFrame(uint64_t frameIndex) override { m_timestampQueries.BeginFrame(frameIndex); }
+
+    void CollectGpuTimings(std::vector<GpuFrameTiming>* timings) override { m_timestampQueries.Collect(m_cmdBufferRing, timings); }
+
+    void SetJobSystem(const std::shared_ptr<JobSystem>& jobSystem) override { m_jobSystem = jobSystem; }
+
+    void UpdateOptions(const std::shared_ptr<Options>& options) override {
+        m_clearColor = options->GetBackgroundClearColor();
+        if (m_gpuCulling != options->GpuCulling) {
+            Log::Write(Log::Level::Info, Fmt("GPU culling %s", options->GpuCulling ? "enabled" : "disabled"));
+        }
+        m_gpuCulling = options->GpuCulling;
+        m_parallelRecording = options->ParallelRecording;
+    }
 
    protected:
     XrGraphicsBindingVulkan2KHR m_graphicsBinding{XR_TYPE_GRAPHICS_BINDING_VULKAN2_KHR};
+    // Declared before everything that allocates from it, so it is destroyed last.
+    MemoryAllocator m_memAllocator{};
+    // Declared before the swapchain image contexts, which render to its depth buffers.
+    DepthBufferPool m_depthBufferPool{};
     std::list<SwapchainImageContext> m_swapchainImageContexts;
     std::map<const XrSwapchainImageBaseHeader*, SwapchainImageContext*> m_swapchainImageContextMap;
 
@@ -1630,16 +3085,60 @@ struct VulkanGraphicsPlugin : public IGraphicsPlugin {
     VkPhysicalDevice m_vkPhysicalDevice{VK_NULL_HANDLE};
     VkDevice m_vkDevice{VK_NULL_HANDLE};
     uint32_t m_queueFamilyIndex = 0;
+    uint32_t m_timestampValidBits{0};
     VkQueue m_vkQueue{VK_NULL_HANDLE};
     VkSemaphore m_vkDrawDone{VK_NULL_HANDLE};
 
-    MemoryAllocator m_memAllocator{};
+    // Directory holding the pipeline and SPIR-V caches; empty if caching is disabled.
+    std::string m_cacheDirectory;
+    PipelineCache m_pipelineCache{};
+#ifdef USE_ONLINE_VULKAN_SHADERC
+    static constexpr uint32_t SpirvMagic = 0x07230203;
+    uint32_t m_spirvCacheRequests{0};
+    uint32_t m_spirvCacheHits{0};
+#endif
     ShaderProgram m_shaderProgram{};
-    CmdBuffer m_cmdBuffer{};
+    ShaderProgram m_multiviewShaderProgram{};
+    bool m_multiviewSupported{false};
     PipelineLayout m_pipelineLayout{};
     VertexBuffer<Geometry::Vertex> m_drawBuffer{};
     std::array<float, 4> m_clearColor;
 
+    // Model transforms of the cubes, one region per frame in flight.
+    InstanceBuffer m_instanceBuffer{};
+    static constexpr uint32_t InitialInstanceCapacity = 64;
+    // Transforms copied per job when filling a region; fewer cubes than this are copied on the calling thread.
+    static constexpr uint32_t InstancesPerJob = 256;
+    std::shared_ptr<JobSystem> m_jobSystem;
+    uint32_t m_instanceRegion{0};
+    // Serial of the last submission that read each region.
+    std::vector<uint64_t> m_instanceRegionSerials;
+    // Frame whose packet the current region was filled from.
+    uint64_t m_instanceFrame{UINT64_MAX};
+    // Packets of the views given to RenderView.
+    RenderPacketBuilder m_viewPacketBuilder;
+
+    // Cull the instances on the GPU and draw the survivors indirectly, instead of drawing every instance.
+    CullPass m_cullPass{};
+    bool m_gpuCulling;
+    // Radius of the sphere around a unit cube centered on its origin.
+    static constexpr float CubeBoundingRadius = 0.8660254f;
+
+    // Frames that may be recorded ahead of the GPU.
+    uint32_t m_framesInFlight;
+    // Record the draws of a view on several threads, into secondary command buffers the primary one executes.
+    bool m_parallelRecording;
+    // Fewer instances than this per recorder are not worth a secondary command buffer of their own.
+    static constexpr uint32_t MinInstancesPerRecorder = 1024;
+    SecondaryCmdPools m_secondaryCmdPools{};
+    std::vector<VkCommandBuffer> m_secondaryCmdBuffers;
+    // GPU time of the cull and draw pass of every submission.
+    TimestampQueries m_timestampQueries{};
+    // Declared after the resources its command buffers reference, so it is destroyed (and waits for the GPU) first.
+    CmdBufferRing m_cmdBufferRing{};
+    // How many submissions apart the command buffer ring statistics are logged.
+    static constexpr uint64_t CmdBufferStatsInterval = 1000;
+
 #if defined(USE_MIRROR_WINDOW)
     Swapchain m_swapchain{};
 #endif
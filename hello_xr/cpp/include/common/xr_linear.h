@@ -105,12 +105,18 @@ inline static void XrMatrix4x4f_TransformBounds(XrVector3f* resultMins, XrVector
                                                 const XrVector3f* mins, const XrVector3f* maxs);
 inline static bool XrMatrix4x4f_CullBounds(const XrMatrix4x4f* mvp, const XrVector3f* mins, const XrVector3f* maxs);
 
+inline static void XrMatrix4x4f_CreateModelViewProjectionBatch(XrMatrix4x4f* results, const XrMatrix4x4f* viewProjection,
+                                                               const XrPosef* poses, const size_t poseStride,
+                                                               const XrVector3f* scales, const size_t scaleStride,
+                                                               const size_t count);
+
 ================================================================================================
 */
 
 #include <assert.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #define MATH_PI 3.14159265358979323846f
 
@@ -784,4 +790,263 @@ inline static bool XrMatrix4x4f_CullBounds(const XrMatrix4x4f* mvp, const XrVect
     return i == 8;
 }
 
+/*
+================================================================================================
+
+Batched model-view-projection transforms
+
+XrMatrix4x4f_CreateModelViewProjectionBatch computes, for count instances,
+
+    results[i] = viewProjection * TranslationRotationScale(poses[i].position, poses[i].orientation, scales[i])
+
+or just the model matrices if viewProjection is NULL. Instances are transformed XR_LINEAR_SIMD_WIDTH at a time, one per
+SIMD lane, with the widest instruction set the compiler targets: AVX2 (e.g. -mavx2 or /arch:AVX2), SSE2, NEON, or plain
+scalar code otherwise.
+
+Every element is computed with the same operations, in the same order, as XrMatrix4x4f_CreateTranslationRotationScale
+followed by XrMatrix4x4f_Multiply, leaving out only the products with the zeros and ones of the translation, scale and
+model matrices, which are exact. For finite inputs the results are therefore bit-for-bit equal to the scalar functions',
+except that an element of zero may differ in sign. This holds as long as the compiler does not contract the scalar
+functions' multiplies and adds into fused multiply-adds: -ffp-contract=off, which GCC defaults to in ISO C and C++ modes
+but not in GNU modes, and Clang does not default to at all; MSVC only contracts with /fp:contract. With contraction the
+scalar functions and the batch may fuse different operations and so round differently, and an element may differ by up
+to 11 ULP of the largest of the four products summed into it. The xr_linear_benchmark target measures the difference on
+random transforms, in ULP of the largest element of each column; a few, typically.
+
+================================================================================================
+*/
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define XR_LINEAR_SIMD_NAME "AVX2"
+#define XR_LINEAR_SIMD_WIDTH 8
+typedef __m256 XrSimdFloat;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XR_LINEAR_SIMD_NAME "SSE2"
+#define XR_LINEAR_SIMD_WIDTH 4
+typedef __m128 XrSimdFloat;
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define XR_LINEAR_SIMD_NAME "NEON"
+#define XR_LINEAR_SIMD_WIDTH 4
+typedef float32x4_t XrSimdFloat;
+#else
+#define XR_LINEAR_SIMD_NAME "scalar"
+#define XR_LINEAR_SIMD_WIDTH 1
+typedef float XrSimdFloat;
+#endif
+
+// The float stride bytes after the one at base, for lane.
+#define XR_LINEAR_STRIDED(base, stride, lane) (*(const float*)((const char*)(base) + (size_t)(lane) * (stride)))
+
+#if defined(__AVX2__)
+inline static XrSimdFloat XrSimdFloat_Set1(const float value) { return _mm256_set1_ps(value); }
+inline static XrSimdFloat XrSimdFloat_Add(const XrSimdFloat a, const XrSimdFloat b) { return _mm256_add_ps(a, b); }
+inline static XrSimdFloat XrSimdFloat_Sub(const XrSimdFloat a, const XrSimdFloat b) { return _mm256_sub_ps(a, b); }
+inline static XrSimdFloat XrSimdFloat_Mul(const XrSimdFloat a, const XrSimdFloat b) { return _mm256_mul_ps(a, b); }
+
+// Loads lane i from the float stride * i bytes after base.
+inline static XrSimdFloat XrSimdFloat_LoadStrided(const float* base, const size_t stride) {
+    return _mm256_setr_ps(XR_LINEAR_STRIDED(base, stride, 0), XR_LINEAR_STRIDED(base, stride, 1),
+                          XR_LINEAR_STRIDED(base, stride, 2), XR_LINEAR_STRIDED(base, stride, 3),
+                          XR_LINEAR_STRIDED(base, stride, 4), XR_LINEAR_STRIDED(base, stride, 5),
+                          XR_LINEAR_STRIDED(base, stride, 6), XR_LINEAR_STRIDED(base, stride, 7));
+}
+
+// Stores lane i of a, b, c and d to results[i].m[offset + 0..3].
+inline static void XrSimdFloat_StoreTransposed(XrMatrix4x4f* results, const int offset, const XrSimdFloat a, const XrSimdFloat b,
+                                               const XrSimdFloat c, const XrSimdFloat d) {
+    // Transposes the 4x4 blocks of lanes 0-3 and 4-7 side by side.
+    const __m256 ab01 = _mm256_unpacklo_ps(a, b);
+    const __m256 ab23 = _mm256_unpackhi_ps(a, b);
+    const __m256 cd01 = _mm256_unpacklo_ps(c, d);
+    const __m256 cd23 = _mm256_unpackhi_ps(c, d);
+    const __m256 lanes[4] = {
+        _mm256_shuffle_ps(ab01, cd01, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(ab01, cd01, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(ab23, cd23, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(ab23, cd23, _MM_SHUFFLE(3, 2, 3, 2)),
+    };
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_ps(&results[i].m[offset], _mm256_castps256_ps128(lanes[i]));
+        _mm_storeu_ps(&results[i + 4].m[offset], _mm256_extractf128_ps(lanes[i], 1));
+    }
+}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+inline static XrSimdFloat XrSimdFloat_Set1(const float value) { return _mm_set1_ps(value); }
+inline static XrSimdFloat XrSimdFloat_Add(const XrSimdFloat a, const XrSimdFloat b) { return _mm_add_ps(a, b); }
+inline static XrSimdFloat XrSimdFloat_Sub(const XrSimdFloat a, const XrSimdFloat b) { return _mm_sub_ps(a, b); }
+inline static XrSimdFloat XrSimdFloat_Mul(const XrSimdFloat a, const XrSimdFloat b) { return _mm_mul_ps(a, b); }
+
+// Loads lane i from the float stride * i bytes after base.
+inline static XrSimdFloat XrSimdFloat_LoadStrided(const float* base, const size_t stride) {
+    return _mm_setr_ps(XR_LINEAR_STRIDED(base, stride, 0), XR_LINEAR_STRIDED(base, stride, 1), XR_LINEAR_STRIDED(base, stride, 2),
+                       XR_LINEAR_STRIDED(base, stride, 3));
+}
+
+// Stores lane i of a, b, c and d to results[i].m[offset + 0..3].
+inline static void XrSimdFloat_StoreTransposed(XrMatrix4x4f* results, const int offset, XrSimdFloat a, XrSimdFloat b, XrSimdFloat c,
+                                               XrSimdFloat d) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(&results[0].m[offset], a);
+    _mm_storeu_ps(&results[1].m[offset], b);
+    _mm_storeu_ps(&results[2].m[offset], c);
+    _mm_storeu_ps(&results[3].m[offset], d);
+}
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+inline static XrSimdFloat XrSimdFloat_Set1(const float value) { return vdupq_n_f32(value); }
+inline static XrSimdFloat XrSimdFloat_Add(const XrSimdFloat a, const XrSimdFloat b) { return vaddq_f32(a, b); }
+inline static XrSimdFloat XrSimdFloat_Sub(const XrSimdFloat a, const XrSimdFloat b) { return vsubq_f32(a, b); }
+inline static XrSimdFloat XrSimdFloat_Mul(const XrSimdFloat a, const XrSimdFloat b) { return vmulq_f32(a, b); }
+
+// Loads lane i from the float stride * i bytes after base.
+inline static XrSimdFloat XrSimdFloat_LoadStrided(const float* base, const size_t stride) {
+    const float lanes[4] = {XR_LINEAR_STRIDED(base, stride, 0), XR_LINEAR_STRIDED(base, stride, 1),
+                            XR_LINEAR_STRIDED(base, stride, 2), XR_LINEAR_STRIDED(base, stride, 3)};
+    return vld1q_f32(lanes);
+}
+
+// Stores lane i of a, b, c and d to results[i].m[offset + 0..3].
+inline static void XrSimdFloat_StoreTransposed(XrMatrix4x4f* results, const int offset, const XrSimdFloat a, const XrSimdFloat b,
+                                               const XrSimdFloat c, const XrSimdFloat d) {
+    const float32x4x2_t ab = vtrnq_f32(a, b);
+    const float32x4x2_t cd = vtrnq_f32(c, d);
+    vst1q_f32(&results[0].m[offset], vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0])));
+    vst1q_f32(&results[1].m[offset], vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1])));
+    vst1q_f32(&results[2].m[offset], vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0])));
+    vst1q_f32(&results[3].m[offset], vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1])));
+}
+#else
+inline static XrSimdFloat XrSimdFloat_Set1(const float value) { return value; }
+inline static XrSimdFloat XrSimdFloat_Add(const XrSimdFloat a, const XrSimdFloat b) { return a + b; }
+inline static XrSimdFloat XrSimdFloat_Sub(const XrSimdFloat a, const XrSimdFloat b) { return a - b; }
+inline static XrSimdFloat XrSimdFloat_Mul(const XrSimdFloat a, const XrSimdFloat b) { return a * b; }
+
+inline static XrSimdFloat XrSimdFloat_LoadStrided(const float* base, const size_t stride) {
+    (void)stride;
+    return *base;
+}
+
+inline static void XrSimdFloat_StoreTransposed(XrMatrix4x4f* results, const int offset, const XrSimdFloat a, const XrSimdFloat b,
+                                               const XrSimdFloat c, const XrSimdFloat d) {
+    results->m[offset + 0] = a;
+    results->m[offset + 1] = b;
+    results->m[offset + 2] = c;
+    results->m[offset + 3] = d;
+}
+#endif
+
+// Transforms exactly XR_LINEAR_SIMD_WIDTH instances. viewProjection holds the elements of the view-projection matrix,
+// each in every lane, or is NULL.
+inline static void XrMatrix4x4f_CreateModelViewProjectionLanes(XrMatrix4x4f* results, const XrSimdFloat* viewProjection,
+                                                               const XrPosef* poses, const size_t poseStride,
+                                                               const XrVector3f* scales, const size_t scaleStride) {
+    const XrSimdFloat qx = XrSimdFloat_LoadStrided(&poses->orientation.x, poseStride);
+    const XrSimdFloat qy = XrSimdFloat_LoadStrided(&poses->orientation.y, poseStride);
+    const XrSimdFloat qz = XrSimdFloat_LoadStrided(&poses->orientation.z, poseStride);
+    const XrSimdFloat qw = XrSimdFloat_LoadStrided(&poses->orientation.w, poseStride);
+
+    // As XrMatrix4x4f_CreateFromQuaternion.
+    const XrSimdFloat x2 = XrSimdFloat_Add(qx, qx);
+    const XrSimdFloat y2 = XrSimdFloat_Add(qy, qy);
+    const XrSimdFloat z2 = XrSimdFloat_Add(qz, qz);
+
+    const XrSimdFloat xx2 = XrSimdFloat_Mul(qx, x2);
+    const XrSimdFloat yy2 = XrSimdFloat_Mul(qy, y2);
+    const XrSimdFloat zz2 = XrSimdFloat_Mul(qz, z2);
+
+    const XrSimdFloat yz2 = XrSimdFloat_Mul(qy, z2);
+    const XrSimdFloat wx2 = XrSimdFloat_Mul(qw, x2);
+    const XrSimdFloat xy2 = XrSimdFloat_Mul(qx, y2);
+    const XrSimdFloat wz2 = XrSimdFloat_Mul(qw, z2);
+    const XrSimdFloat xz2 = XrSimdFloat_Mul(qx, z2);
+    const XrSimdFloat wy2 = XrSimdFloat_Mul(qw, y2);
+
+    const XrSimdFloat one = XrSimdFloat_Set1(1.0f);
+    const XrSimdFloat sx = XrSimdFloat_LoadStrided(&scales->x, scaleStride);
+    const XrSimdFloat sy = XrSimdFloat_LoadStrided(&scales->y, scaleStride);
+    const XrSimdFloat sz = XrSimdFloat_LoadStrided(&scales->z, scaleStride);
+
+    // Rows 0-2 of the columns of the model matrix; row 3 is (0, 0, 0, 1).
+    XrSimdFloat model[4][3];
+    model[0][0] = XrSimdFloat_Mul(XrSimdFloat_Sub(XrSimdFloat_Sub(one, yy2), zz2), sx);
+    model[0][1] = XrSimdFloat_Mul(XrSimdFloat_Add(xy2, wz2), sx);
+    model[0][2] = XrSimdFloat_Mul(XrSimdFloat_Sub(xz2, wy2), sx);
+
+    model[1][0] = XrSimdFloat_Mul(XrSimdFloat_Sub(xy2, wz2), sy);
+    model[1][1] = XrSimdFloat_Mul(XrSimdFloat_Sub(XrSimdFloat_Sub(one, xx2), zz2), sy);
+    model[1][2] = XrSimdFloat_Mul(XrSimdFloat_Add(yz2, wx2), sy);
+
+    model[2][0] = XrSimdFloat_Mul(XrSimdFloat_Add(xz2, wy2), sz);
+    model[2][1] = XrSimdFloat_Mul(XrSimdFloat_Sub(yz2, wx2), sz);
+    model[2][2] = XrSimdFloat_Mul(XrSimdFloat_Sub(XrSimdFloat_Sub(one, xx2), yy2), sz);
+
+    model[3][0] = XrSimdFloat_LoadStrided(&poses->position.x, poseStride);
+    model[3][1] = XrSimdFloat_LoadStrided(&poses->position.y, poseStride);
+    model[3][2] = XrSimdFloat_LoadStrided(&poses->position.z, poseStride);
+
+    if (viewProjection == NULL) {
+        const XrSimdFloat zero = XrSimdFloat_Set1(0.0f);
+        for (int column = 0; column < 4; column++) {
+            XrSimdFloat_StoreTransposed(results, column * 4, model[column][0], model[column][1], model[column][2],
+                                        column == 3 ? one : zero);
+        }
+        return;
+    }
+
+    // As XrMatrix4x4f_Multiply, with the products of the model matrix's last row left out of the first three columns
+    // and the last one added as is to the fourth.
+    for (int column = 0; column < 4; column++) {
+        XrSimdFloat rows[4];
+        for (int row = 0; row < 4; row++) {
+            XrSimdFloat sum = XrSimdFloat_Add(XrSimdFloat_Mul(viewProjection[row], model[column][0]),
+                                              XrSimdFloat_Mul(viewProjection[4 + row], model[column][1]));
+            sum = XrSimdFloat_Add(sum, XrSimdFloat_Mul(viewProjection[8 + row], model[column][2]));
+            rows[row] = column == 3 ? XrSimdFloat_Add(sum, viewProjection[12 + row]) : sum;
+        }
+        XrSimdFloat_StoreTransposed(results, column * 4, rows[0], rows[1], rows[2], rows[3]);
+    }
+}
+
+// Creates results[i] = viewProjection * translation(poses[i].position) * rotation(poses[i].orientation) * scale(scales[i])
+// for count instances, or just the model matrices if viewProjection is NULL. Consecutive poses and scales are poseStride
+// and scaleStride bytes apart, so they can be read straight out of an array of structures.
+inline static void XrMatrix4x4f_CreateModelViewProjectionBatch(XrMatrix4x4f* results, const XrMatrix4x4f* viewProjection,
+                                                               const XrPosef* poses, const size_t poseStride,
+                                                               const XrVector3f* scales, const size_t scaleStride,
+                                                               const size_t count) {
+    XrSimdFloat broadcast[16];
+    if (viewProjection != NULL) {
+        for (int i = 0; i < 16; i++) {
+            broadcast[i] = XrSimdFloat_Set1(viewProjection->m[i]);
+        }
+    }
+    const XrSimdFloat* lanesViewProjection = viewProjection != NULL ? broadcast : NULL;
+
+    size_t i = 0;
+    for (; i + XR_LINEAR_SIMD_WIDTH <= count; i += XR_LINEAR_SIMD_WIDTH) {
+        XrMatrix4x4f_CreateModelViewProjectionLanes(&results[i], lanesViewProjection,
+                                                    (const XrPosef*)((const char*)poses + i * poseStride), poseStride,
+                                                    (const XrVector3f*)((const char*)scales + i * scaleStride), scaleStride);
+    }
+
+    // Run the last few instances through all lanes, repeating the last instance in the lanes left over.
+    if (i < count) {
+        XrPosef tailPoses[XR_LINEAR_SIMD_WIDTH];
+        XrVector3f tailScales[XR_LINEAR_SIMD_WIDTH];
+        XrMatrix4x4f tailResults[XR_LINEAR_SIMD_WIDTH];
+        for (size_t lane = 0; lane < XR_LINEAR_SIMD_WIDTH; lane++) {
+            const size_t instance = i + lane < count ? i + lane : count - 1;
+            tailPoses[lane] = *(const XrPosef*)((const char*)poses + instance * poseStride);
+            tailScales[lane] = *(const XrVector3f*)((const char*)scales + instance * scaleStride);
+        }
+        XrMatrix4x4f_CreateModelViewProjectionLanes(tailResults, lanesViewProjection, tailPoses, sizeof(XrPosef), tailScales,
+                                                    sizeof(XrVector3f));
+        for (size_t lane = 0; i + lane < count; lane++) {
+            results[i + lane] = tailResults[lane];
+        }
+    }
+}
+
 #endif  // XR_LINEAR_H_
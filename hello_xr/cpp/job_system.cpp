@@ -0,0 +1,258 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "job_system.h"
+#include "trace.h"
+
+#include <utils/threading.h>
+
+static_assert(JobSystem::AnyCores == THREAD_AFFINITY_BIG_CORES, "AnyCores must match utils/threading.h");
+
+// Fixed-size Chase-Lev deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Le et al. 2013). The owning
+// thread calls Push and Pop; any thread may call Steal.
+struct JobSystem::WorkDeque {
+    static constexpr int64_t Capacity = 4096;
+
+    // Returns false if the deque is full.
+    bool Push(const Job& job) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= Capacity) {
+            return false;
+        }
+        m_jobs[bottom % Capacity] = job;
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(Job& job) {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        job = m_jobs[bottom % Capacity];
+        if (top == bottom) {
+            // Last job: race the thieves for it.
+            const bool won =
+                m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool Steal(Job& job) {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+
+        // The copy is only used if no one else took the job first, in which case the owner cannot have reused the slot.
+        job = m_jobs[top % Capacity];
+        return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<int64_t> m_top{0};
+    std::atomic<int64_t> m_bottom{0};
+    Job m_jobs[Capacity];
+};
+
+namespace {
+// The deque of the calling thread, and the job system it belongs to.
+thread_local JobSystem* t_jobSystem{nullptr};
+thread_local uint32_t t_dequeIndex{0};
+}  // namespace
+
+JobSystem::JobSystem(uint32_t workerCount, int affinityMask, int realTimePriority)
+    : m_deques(new WorkDeque[workerCount + MaxSubmittingThreads]), m_dequeCount(workerCount) {
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&JobSystem::WorkerThread, this, i, affinityMask, realTimePriority);
+    }
+    Log::Write(Log::Level::Info, Fmt("Job system started with %u workers", workerCount));
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::WorkerThread(uint32_t index, int affinityMask, int realTimePriority) {
+    const std::string name = Fmt("Worker %u", index);
+    ksThread_SetName(name.c_str());
+    TRACE_THREAD_NAME(name.c_str());
+    ksThread_SetAffinity(affinityMask);
+    if (realTimePriority > 0) {
+        ksThread_SetRealTimePriority(realTimePriority);
+    }
+
+    t_jobSystem = this;
+    t_dequeIndex = index;
+    WorkDeque& own = m_deques[index];
+
+    while (!m_stop.load(std::memory_order_relaxed)) {
+        Job job;
+        if (FindJob(own, job)) {
+            Run(job);
+            continue;
+        }
+
+        // Jobs may be queued but all taken by the time this worker looked; only sleep once none are left.
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepingCount++;
+        if (m_queuedCount.load() <= 0 && !m_stop) {
+            m_wake.wait(lock);
+        }
+        m_sleepingCount--;
+    }
+}
+
+JobSystem::WorkDeque& JobSystem::ThreadDeque() {
+    if (t_jobSystem != this) {
+        std::lock_guard<std::mutex> lock(m_registerMutex);
+        const uint32_t index = m_dequeCount.load();
+        CHECK_MSG(index < m_workers.size() + MaxSubmittingThreads, "Too many threads submitting jobs");
+        t_jobSystem = this;
+        t_dequeIndex = index;
+        m_dequeCount.store(index + 1, std::memory_order_release);
+    }
+    return m_deques[t_dequeIndex];
+}
+
+void JobSystem::Push(const Job& job) {
+    if (!ThreadDeque().Push(job)) {
+        Run(job);
+        return;
+    }
+
+    m_queuedCount++;
+    if (m_sleepingCount.load() > 0) {
+        // Taking the lock orders this with a worker between checking m_queuedCount and going to sleep.
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+bool JobSystem::FindJob(WorkDeque& own, Job& job) {
+    if (own.Pop(job)) {
+        m_queuedCount--;
+        return true;
+    }
+
+    // Steal starting after our own deque, so thieves spread over the victims.
+    const uint32_t dequeCount = m_dequeCount.load(std::memory_order_acquire);
+    const uint32_t first = t_dequeIndex;
+    for (uint32_t i = 1; i < dequeCount; i++) {
+        if (m_deques[(first + i) % dequeCount].Steal(job)) {
+            m_queuedCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::Run(const Job& job) {
+    try {
+        TRACE_ZONE("Job");
+        job.function(job.data, job.begin, job.end);
+    } catch (...) {
+        if (job.counter != nullptr) {
+            std::lock_guard<std::mutex> lock(job.counter->m_mutex);
+            if (!job.counter->m_error) {
+                job.counter->m_error = std::current_exception();
+            }
+        } else {
+            Log::Write(Log::Level::Error, "Uncounted job threw an exception");
+        }
+    }
+    Finish(job.counter);
+}
+
+void JobSystem::Finish(JobCounter* counter) {
+    if (counter == nullptr) {
+        return;
+    }
+
+    uint32_t pending = counter->m_pending.load(std::memory_order_relaxed);
+    while (pending > 1) {
+        if (counter->m_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel,
+                                                     std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    // Probably the last job. Lock before the count reaches zero: Wait takes the lock once it sees zero, so the counter is
+    // not destroyed while this still uses it.
+    std::vector<Job> released;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            released.swap(counter->m_held);
+        }
+    }
+    for (const Job& job : released) {
+        Push(job);
+    }
+}
+
+void JobSystem::Submit(Job::Function function, void* data, uint32_t begin, uint32_t end, JobCounter* counter,
+                       JobCounter* after) {
+    Job job;
+    job.function = function;
+    job.data = data;
+    job.begin = begin;
+    job.end = end;
+    job.counter = counter;
+    if (counter != nullptr) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (after != nullptr) {
+        // Checked under the lock Finish takes to release held jobs, so the job is either held and released, or pushed.
+        std::lock_guard<std::mutex> lock(after->m_mutex);
+        if (!after->IsDone()) {
+            after->m_held.push_back(job);
+            return;
+        }
+    }
+    Push(job);
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    WorkDeque& own = ThreadDeque();
+    while (!counter.IsDone()) {
+        Job job;
+        if (FindJob(own, job)) {
+            Run(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    // Also waits for the thread that finished the last job to be done with the counter.
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        std::swap(error, counter.m_error);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+struct JobSystem;
+
+// A unit of work: function(data, begin, end). Jobs are small and copied by value; data must outlive the job.
+struct Job {
+    using Function = void (*)(void* data, uint32_t begin, uint32_t end);
+
+    Function function{nullptr};
+    void* data{nullptr};
+    uint32_t begin{0};
+    uint32_t end{0};
+    struct JobCounter* counter{nullptr};
+};
+
+// Counts the unfinished jobs submitted with it. Jobs may be submitted to start only once a counter reaches zero, which
+// chains dependent work without blocking a thread; JobSystem::Wait runs other jobs until it does.
+struct JobCounter {
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+   private:
+    friend struct JobSystem;
+
+    std::atomic<uint32_t> m_pending{0};
+    std::mutex m_mutex;  // Guards m_held and m_error.
+    std::vector<Job> m_held;  // Jobs waiting for this counter to reach zero.
+    std::exception_ptr m_error;  // First exception thrown by a job counted here.
+};
+
+// Work-stealing job scheduler. Every thread that submits jobs owns a Chase-Lev deque: it pushes and pops jobs at the
+// bottom without locks, while idle workers steal from the top of other threads' deques. Threads that wait for jobs
+// run queued jobs meanwhile, so the main thread contributes instead of blocking. Workers sleep only when no job is
+// queued anywhere.
+struct JobSystem {
+    // Affinity mask meaning "leave the affinity alone" (THREAD_AFFINITY_BIG_CORES in utils/threading.h).
+    static constexpr int AnyCores = -1;
+
+    // Start workerCount threads. Each sets its affinity with ksThread_SetAffinity and, if realTimePriority is above 0,
+    // its priority with ksThread_SetRealTimePriority. With no workers, jobs run on the threads that wait for them.
+    explicit JobSystem(uint32_t workerCount, int affinityMask = AnyCores, int realTimePriority = 0);
+    // Jobs still queued are dropped; wait for them first.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    uint32_t WorkerCount() const { return (uint32_t)m_workers.size(); }
+
+    // Queue function(data, begin, end), counted by counter if there is one. With after, the job is held until after
+    // reaches zero. A thread whose deque is full runs the job right away instead.
+    void Submit(Job::Function function, void* data, uint32_t begin, uint32_t end, JobCounter* counter,
+                JobCounter* after = nullptr);
+
+    // Run queued jobs on the calling thread until counter reaches zero. Rethrows the first exception a job counted by it
+    // threw.
+    void Wait(JobCounter& counter);
+
+    // Call function(begin, end) over [0, count) in ranges of at most grainSize items, spread over the workers and the
+    // calling thread, and return once all have run.
+    template <typename Function>
+    void ParallelFor(uint32_t count, uint32_t grainSize, const Function& function) {
+        if (count <= grainSize || m_workers.empty()) {
+            if (count > 0) {
+                function(0u, count);
+            }
+            return;
+        }
+
+        const Job::Function run = [](void* data, uint32_t begin, uint32_t end) {
+            (*static_cast<const Function*>(data))(begin, end);
+        };
+        JobCounter counter;
+        for (uint32_t begin = 0; begin < count; begin += grainSize) {
+            const uint32_t end = count - begin > grainSize ? begin + grainSize : count;
+            Submit(run, const_cast<Function*>(&function), begin, end, &counter);
+        }
+        Wait(counter);
+    }
+
+   private:
+    struct WorkDeque;
+
+    static constexpr uint32_t MaxSubmittingThreads = 8;  // Threads other than the workers that may submit jobs.
+
+    void WorkerThread(uint32_t index, int affinityMask, int realTimePriority);
+    WorkDeque& ThreadDeque();
+    void Push(const Job& job);
+    bool FindJob(WorkDeque& own, Job& job);
+    void Run(const Job& job);
+    void Finish(JobCounter* counter);
+
+    std::unique_ptr<WorkDeque[]> m_deques;  // The workers' deques, then those of other submitting threads.
+    std::atomic<uint32_t> m_dequeCount{0};
+    std::mutex m_registerMutex;
+
+    std::atomic<int32_t> m_queuedCount{0};  // Jobs in all deques, so workers know whether to keep looking.
+    std::atomic<uint32_t> m_sleepingCount{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stop{false};
+
+    std::vector<std::thread> m_workers;
+};
@@ -5,6 +5,8 @@
 #include "pch.h"
 #include "logger.h"
 
+#include <condition_variable>
+#include <mutex>
 #include <sstream>
 
 #if defined(ANDROID)
@@ -13,20 +15,12 @@
 #endif
 
 namespace {
-Log::Level g_minSeverity{Log::Level::Info};
-std::mutex g_logLock;
-}  // namespace
-
-namespace Log {
-void SetLevel(Level minSeverity) { g_minSeverity = minSeverity; }
+using Clock = std::chrono::system_clock;
 
-void Write(Level severity, const std::string& msg) {
-    if (severity < g_minSeverity) {
-        return;
-    }
+std::mutex g_logLock;
 
-    const auto now = std::chrono::system_clock::now();
-    const time_t now_time = std::chrono::system_clock::to_time_t(now);
+std::string FormatLine(Log::Level severity, Clock::time_point now, const std::string& msg) {
+    const time_t now_time = Clock::to_time_t(now);
     tm now_tm;
 #ifdef _WIN32
     localtime_s(&now_tm, &now_time);
@@ -34,28 +28,225 @@ void Write(Level severity, const std::string& msg) {
     localtime_r(&now_time, &now_tm);
 #endif
     // time_t only has second precision. Use the rounding error to get sub-second precision.
-    const auto secondRemainder = now - std::chrono::system_clock::from_time_t(now_time);
+    const auto secondRemainder = now - Clock::from_time_t(now_time);
     const int64_t milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(secondRemainder).count();
 
-    static std::map<Level, const char*> severityName = {
-        {Level::Verbose, "Verbose"}, {Level::Info, "Info   "}, {Level::Warning, "Warning"}, {Level::Error, "Error  "}};
+    static const std::map<Log::Level, const char*> severityName = {{Log::Level::Verbose, "Verbose"},
+                                                                   {Log::Level::Info, "Info   "},
+                                                                   {Log::Level::Warning, "Warning"},
+                                                                   {Log::Level::Error, "Error  "}};
 
     std::ostringstream out;
     out.fill('0');
     out << "[" << std::setw(2) << now_tm.tm_hour << ":" << std::setw(2) << now_tm.tm_min << ":" << std::setw(2) << now_tm.tm_sec
         << "." << std::setw(3) << milliseconds << "]"
-        << "[" << severityName[severity] << "] " << msg << std::endl;
+        << "[" << severityName.at(severity) << "] " << msg << "\n";
+    return out.str();
+}
 
-    std::lock_guard<std::mutex> lock(g_logLock);  // Ensure output is serialized
-    ((severity == Level::Error) ? std::clog : std::cout) << out.str();
+// Caller holds g_logLock and flushes the streams when done.
+void Output(Log::Level severity, const std::string& line) {
+    ((severity == Log::Level::Error) ? std::clog : std::cout) << line;
 #if defined(_WIN32)
-    OutputDebugStringA(out.str().c_str());
+    OutputDebugStringA(line.c_str());
 #endif
 #if defined(ANDROID)
-    if (severity == Level::Error)
-        ALOGE("%s", out.str().c_str());
+    if (severity == Log::Level::Error)
+        ALOGE("%s", line.c_str());
     else
-        ALOGV("%s", out.str().c_str());
+        ALOGV("%s", line.c_str());
 #endif
 }
+
+// Messages one thread queued for the log thread. The owning thread is the only producer and whoever holds g_drainLock
+// the only consumer. Slots keep their string's capacity, so queueing a message does not allocate once slots have
+// held one as long.
+struct MessageRing {
+    static constexpr uint64_t Capacity = 1024;
+
+    struct Message {
+        Log::Level severity;
+        Clock::time_point time;
+        std::string text;  // The arguments for formatter, if there is one.
+        const char* format;
+        Log::DeferredFormatter formatter;
+    };
+
+    std::unique_ptr<Message[]> messages{new Message[Capacity]};
+    std::atomic<uint64_t> head{0};  // Next slot the producer writes.
+    std::atomic<uint64_t> tail{0};  // Next slot the consumer reads.
+};
+
+std::atomic<bool> g_async{false};
+std::atomic<uint64_t> g_droppedCount{0};
+
+// Guards the list of rings. Rings live until the process exits, since their threads keep pointers to them.
+std::mutex g_ringsLock;
+std::vector<std::unique_ptr<MessageRing>> g_rings;
+thread_local MessageRing* t_ring{nullptr};
+
+// Held while reading the rings, making its holder their single consumer.
+std::mutex g_drainLock;
+
+std::mutex g_logThreadLock;
+std::condition_variable g_logThreadWake;
+bool g_stopLogThread{false};
+std::thread g_logThread;
+
+void Enqueue(Log::Level severity, Clock::time_point time, const std::string& msg, const char* format = nullptr,
+             Log::DeferredFormatter formatter = nullptr) {
+    if (t_ring == nullptr) {
+        std::unique_ptr<MessageRing> ring(new MessageRing());
+        std::lock_guard<std::mutex> lock(g_ringsLock);
+        t_ring = ring.get();
+        g_rings.push_back(std::move(ring));
+    }
+
+    const uint64_t head = t_ring->head.load(std::memory_order_relaxed);
+    if (head - t_ring->tail.load(std::memory_order_acquire) == MessageRing::Capacity) {
+        g_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    MessageRing::Message& message = t_ring->messages[head % MessageRing::Capacity];
+    message.severity = severity;
+    message.time = time;
+    message.text.assign(msg);
+    message.format = format;
+    message.formatter = formatter;
+    t_ring->head.store(head + 1, std::memory_order_release);
+}
+
+// Write every queued message in time order and flush once. Caller holds g_drainLock.
+void Drain() {
+    struct Pending {
+        Log::Level severity;
+        Clock::time_point time;
+        std::string text;
+    };
+    static std::vector<Pending> pending;
+
+    {
+        std::lock_guard<std::mutex> lock(g_ringsLock);
+        for (const std::unique_ptr<MessageRing>& ring : g_rings) {
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            for (; tail != head; tail++) {
+                const MessageRing::Message& message = ring->messages[tail % MessageRing::Capacity];
+                pending.push_back({message.severity, message.time,
+                                   message.formatter != nullptr ? message.formatter(message.format, message.text.data())
+                                                                : message.text});
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+    }
+
+    const uint64_t droppedCount = g_droppedCount.exchange(0, std::memory_order_relaxed);
+    if (pending.empty() && droppedCount == 0) {
+        return;
+    }
+
+    std::stable_sort(pending.begin(), pending.end(), [](const Pending& a, const Pending& b) { return a.time < b.time; });
+
+    std::lock_guard<std::mutex> lock(g_logLock);
+    for (const Pending& message : pending) {
+        Output(message.severity, FormatLine(message.severity, message.time, message.text));
+    }
+    if (droppedCount > 0) {
+        Output(Log::Level::Warning, FormatLine(Log::Level::Warning, Clock::now(),
+                                               std::to_string(droppedCount) + " log messages dropped: a queue was full"));
+    }
+    std::cout.flush();
+    std::clog.flush();
+    pending.clear();
+}
+
+void LogThread() {
+    constexpr std::chrono::milliseconds FlushInterval{20};
+
+    std::unique_lock<std::mutex> lock(g_logThreadLock);
+    while (!g_stopLogThread) {
+        g_logThreadWake.wait_for(lock, FlushInterval, [] { return g_stopLogThread; });
+        lock.unlock();
+        Log::Flush();
+        lock.lock();
+    }
+}
+}  // namespace
+
+namespace Log {
+Level g_minSeverity{Level::Info};
+
+void SetLevel(Level minSeverity) { g_minSeverity = minSeverity; }
+
+void Write(Level severity, const std::string& msg) {
+    if (severity < CompiledMinLevel || severity < g_minSeverity) {
+        return;
+    }
+
+    const auto now = Clock::now();
+    if (!g_async.load(std::memory_order_relaxed)) {
+        const std::string line = FormatLine(severity, now, msg);
+        std::lock_guard<std::mutex> lock(g_logLock);  // Ensure output is serialized
+        Output(severity, line);
+        ((severity == Level::Error) ? std::clog : std::cout).flush();
+        return;
+    }
+
+    if (severity != Level::Error) {
+        Enqueue(severity, now, msg);
+        return;
+    }
+
+    // An error is often the last thing logged before the app exits or crashes, so it and everything queued before it
+    // are written before returning.
+    std::lock_guard<std::mutex> drainLock(g_drainLock);
+    Drain();
+    const std::string line = FormatLine(severity, now, msg);
+    std::lock_guard<std::mutex> lock(g_logLock);
+    Output(severity, line);
+    std::clog.flush();
+}
+
+void SetAsync(bool async) {
+    if (async == g_async.load()) {
+        return;
+    }
+
+    if (async) {
+        g_stopLogThread = false;
+        g_logThread = std::thread(LogThread);
+        g_async = true;
+        return;
+    }
+
+    // A thread that saw g_async set just before this may still queue a message after the final flush; it is written by
+    // the next Flush, or not at all.
+    g_async = false;
+    {
+        std::lock_guard<std::mutex> lock(g_logThreadLock);
+        g_stopLogThread = true;
+    }
+    g_logThreadWake.notify_one();
+    g_logThread.join();
+    Flush();
+}
+
+void Flush() {
+    std::lock_guard<std::mutex> lock(g_drainLock);
+    Drain();
+}
+
+void WriteDeferred(Level severity, const char* format, DeferredFormatter formatter, const std::string& args) {
+    if (g_async.load(std::memory_order_relaxed) && severity != Level::Error) {
+        Enqueue(severity, Clock::now(), args, format, formatter);
+        return;
+    }
+    Write(severity, formatter(format, args.data()));
+}
+
+std::string& DeferredArgBuffer() {
+    thread_local std::string buffer;
+    return buffer;
+}
 }  // namespace Log
@@ -4,9 +4,127 @@
 
 #pragma once
 
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Lowest level that Log::Writef compiles in, e.g. -DLOG_MIN_LEVEL=Info. Messages below it cost nothing at run time.
+#if !defined(LOG_MIN_LEVEL)
+#define LOG_MIN_LEVEL Verbose
+#endif
+
 namespace Log {
 enum class Level { Verbose, Info, Warning, Error };
 
+constexpr Level CompiledMinLevel = Level::LOG_MIN_LEVEL;
+
+// Set by SetLevel; read directly so Writef can filter without a call.
+extern Level g_minSeverity;
+
 void SetLevel(Level minSeverity);
 void Write(Level severity, const std::string& msg);
+
+// Queue messages below Error in per-thread ring buffers and write them in batches from a background thread, instead of
+// formatting, writing and flushing each one on the calling thread. Messages that find their thread's ring full are
+// dropped and counted. An Error writes everything queued before it synchronously. Disabling writes what is left.
+void SetAsync(bool async);
+
+// Write every queued message now.
+void Flush();
+
+// Formats the arguments that Writef captured into args, a buffer laid out by EncodeArg.
+using DeferredFormatter = std::string (*)(const char* format, const char* args);
+
+// Write a message from a format string and its captured arguments. In async mode the message is formatted on the log
+// thread; otherwise formatter runs right away.
+void WriteDeferred(Level severity, const char* format, DeferredFormatter formatter, const std::string& args);
+
+// Per-thread scratch buffer Writef encodes arguments into before handing them to WriteDeferred.
+std::string& DeferredArgBuffer();
+
+// Arguments are captured by value: numbers, enums and pointers as their bytes, strings (const char* or std::string) as
+// their characters, since the caller's string may be gone by the time the message is formatted.
+template <typename T>
+struct DeferredArg {
+    static_assert(std::is_trivially_copyable<T>::value, "Log::Writef arguments must be numbers, pointers or strings");
+    using Type = T;
+};
+template <>
+struct DeferredArg<char*> {
+    using Type = const char*;
+};
+template <>
+struct DeferredArg<const char*> {
+    using Type = const char*;
+};
+template <>
+struct DeferredArg<std::string> {
+    using Type = const char*;
+};
+
+template <typename T>
+void EncodeArg(std::string& args, const T& value) {
+    args.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+inline void EncodeArg(std::string& args, const char* value) { args.append(value, strlen(value) + 1); }
+inline void EncodeArg(std::string& args, char* value) { EncodeArg(args, (const char*)value); }
+inline void EncodeArg(std::string& args, const std::string& value) { args.append(value.c_str(), value.size() + 1); }
+
+struct DeferredArgReader {
+    const char* next;
+
+    template <typename T>
+    T Read() {
+        T value;
+        memcpy(&value, next, sizeof(T));
+        next += sizeof(T);
+        return value;
+    }
+};
+template <>
+inline const char* DeferredArgReader::Read<const char*>() {
+    const char* value = next;
+    next += strlen(value) + 1;
+    return value;
+}
+
+template <typename... Args, size_t... Indices>
+std::string FormatTuple(const char* format, const std::tuple<Args...>& values, std::index_sequence<Indices...>) {
+    const int size = std::snprintf(nullptr, 0, format, std::get<Indices>(values)...);
+    if (size < 0) {
+        return format;
+    }
+    std::string text(size, '\0');
+    std::snprintf(&text[0], size + 1, format, std::get<Indices>(values)...);
+    return text;
+}
+
+template <typename... Args>
+std::string FormatDeferred(const char* format, const char* args) {
+    DeferredArgReader reader{args};
+    (void)reader;
+    // A braced initializer evaluates its elements in order, so the arguments are read back in the order they were written.
+    const std::tuple<typename DeferredArg<Args>::Type...> values{reader.Read<typename DeferredArg<Args>::Type>()...};
+    return FormatTuple(format, values, std::index_sequence_for<Args...>{});
+}
+
+// printf-style logging that filters before doing any work: below CompiledMinLevel the call compiles to nothing, and below
+// the level set by SetLevel it costs one branch. The arguments are captured in binary form and, in async mode, formatted
+// on the log thread. format must be a string literal.
+//   Log::Writef<Log::Level::Verbose>("Located %u spaces", count);
+template <Level Severity, typename... Args>
+void Writef(const char* format, const Args&... args) {
+    if (Severity < CompiledMinLevel || Severity < g_minSeverity) {
+        return;
+    }
+
+    std::string& buffer = DeferredArgBuffer();
+    buffer.clear();
+    // Expands EncodeArg for each argument in order.
+    const int expand[] = {0, (EncodeArg(buffer, args), 0)...};
+    (void)expand;
+    WriteDeferred(Severity, format, &FormatDeferred<typename std::decay<Args>::type...>, buffer);
+}
 }  // namespace Log
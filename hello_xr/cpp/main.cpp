@@ -9,6 +9,9 @@
 #include "platformplugin.h"
 #include "graphicsplugin.h"
 #include "openxr_program.h"
+#include "job_system.h"
+#include "trace.h"
+#include "frame_benchmark.h"
 
 #if defined(_WIN32)
 // Favor the high performance NVIDIA or AMD GPUs
@@ -28,6 +31,33 @@ void ShowHelp() {
     Log::Write(Log::Level::Info, "adb shell setprop debug.xr.formFactor Hmd|Handheld");
     Log::Write(Log::Level::Info, "adb shell setprop debug.xr.viewConfiguration Stereo|Mono");
     Log::Write(Log::Level::Info, "adb shell setprop debug.xr.blendMode Opaque|Additive|AlphaBlend");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.framePipeline true|false");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.multiview true|false");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.framesInFlight <count>");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.gpuCulling true|false");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.cacheDirectory <directory>");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.msaaSamples <count>");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.skipClear true|false");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.frameStatsFile <file>");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.traceFile <file>");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.asyncLog true|false");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.jobWorkers <count>");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.parallelRecording true|false");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.benchmarkFrames <count>");
+    Log::Write(Log::Level::Info, "adb shell setprop debug.xr.gridCubes <count>");
+}
+
+// Re-read the options that may change while a session is running. Returns true if any of them changed.
+bool UpdateRuntimeOptionsFromSystemProperties(Options& options) {
+    char value[PROP_VALUE_MAX] = {};
+    if (__system_property_get("debug.xr.gpuCulling", value) != 0) {
+        const bool gpuCulling = EqualsIgnoreCase(value, "true") || EqualsIgnoreCase(value, "1");
+        if (gpuCulling != options.GpuCulling) {
+            options.GpuCulling = gpuCulling;
+            return true;
+        }
+    }
+    return false;
 }
 
 bool UpdateOptionsFromSystemProperties(Options& options) {
@@ -54,6 +84,60 @@ bool UpdateOptionsFromSystemProperties(Options& options) {
         options.EnvironmentBlendMode = value;
     }
 
+    if (__system_property_get("debug.xr.framePipeline", value) != 0) {
+        options.FramePipelining = EqualsIgnoreCase(value, "true") || EqualsIgnoreCase(value, "1");
+    }
+
+    if (__system_property_get("debug.xr.multiview", value) != 0) {
+        options.Multiview = EqualsIgnoreCase(value, "true") || EqualsIgnoreCase(value, "1");
+    }
+
+    if (__system_property_get("debug.xr.framesInFlight", value) != 0) {
+        options.FramesInFlight = (uint32_t)strtoul(value, nullptr, 10);
+    }
+
+    if (__system_property_get("debug.xr.cacheDirectory", value) != 0) {
+        options.CacheDirectory = value;
+    }
+
+    if (__system_property_get("debug.xr.msaaSamples", value) != 0) {
+        options.MsaaSamples = (uint32_t)strtoul(value, nullptr, 10);
+    }
+
+    if (__system_property_get("debug.xr.skipClear", value) != 0) {
+        options.SkipClear = EqualsIgnoreCase(value, "true") || EqualsIgnoreCase(value, "1");
+    }
+
+    if (__system_property_get("debug.xr.frameStatsFile", value) != 0) {
+        options.FrameStatsFile = value;
+    }
+
+    if (__system_property_get("debug.xr.traceFile", value) != 0) {
+        options.TraceFile = value;
+    }
+
+    if (__system_property_get("debug.xr.asyncLog", value) != 0) {
+        options.AsyncLog = EqualsIgnoreCase(value, "true") || EqualsIgnoreCase(value, "1");
+    }
+
+    if (__system_property_get("debug.xr.jobWorkers", value) != 0) {
+        options.JobWorkers = (uint32_t)strtoul(value, nullptr, 10);
+    }
+
+    if (__system_property_get("debug.xr.parallelRecording", value) != 0) {
+        options.ParallelRecording = EqualsIgnoreCase(value, "true") || EqualsIgnoreCase(value, "1");
+    }
+
+    if (__system_property_get("debug.xr.benchmarkFrames", value) != 0) {
+        options.BenchmarkFrames = (uint32_t)strtoul(value, nullptr, 10);
+    }
+
+    if (__system_property_get("debug.xr.gridCubes", value) != 0) {
+        options.GridCubes = (uint32_t)strtoul(value, nullptr, 10);
+    }
+
+    UpdateRuntimeOptionsFromSystemProperties(options);
+
     try {
         options.ParseStrings();
     } catch (std::invalid_argument& ia) {
@@ -68,12 +152,18 @@ void ShowHelp() {
     // TODO: Improve/update when things are more settled.
     Log::Write(Log::Level::Info,
                "HelloXr --graphics|-g <Graphics API> [--formfactor|-ff <Form factor>] [--viewconfig|-vc <View config>] "
-               "[--blendmode|-bm <Blend mode>] [--space|-s <Space>] [--verbose|-v]");
-    Log::Write(Log::Level::Info, "Graphics APIs:            D3D11, D3D12, OpenGLES, OpenGL, Vulkan2, Vulkan");
+               "[--blendmode|-bm <Blend mode>] [--space|-s <Space>] [--pipeline|-pl] [--multiview|-mv] "
+               "[--framesinflight|-fif <count>] [--gpuculling|-gc] [--cachedir|-cd <directory>] [--msaa|-ms <count>] "
+               "[--skipclear|-sc] [--framestats|-fs <file>] [--trace|-tr <file>] [--asynclog|-al] "
+               "[--jobworkers|-jw <count>] [--parallelrecord|-pr] [--benchmark|-bf <frames>] [--cubes|-cu <count>] "
+               "[--verbose|-v]");
+    Log::Write(Log::Level::Info, "Graphics APIs:            D3D11, D3D12, OpenGLES, OpenGL, Vulkan2, Vulkan, Software, Null");
     Log::Write(Log::Level::Info, "Form factors:             Hmd, Handheld");
     Log::Write(Log::Level::Info, "View configurations:      Mono, Stereo");
     Log::Write(Log::Level::Info, "Environment blend modes:  Opaque, Additive, AlphaBlend");
     Log::Write(Log::Level::Info, "Spaces:                   View, Local, Stage");
+    Log::Write(Log::Level::Info, "Multiview:                Vulkan, OpenGL, OpenGLES, Null (needs render packets)");
+    Log::Write(Log::Level::Info, "While running, enter 'c' to toggle GPU culling; any other input quits.");
 }
 
 bool UpdateOptionsFromCommandLine(Options& options, int argc, char* argv[]) {
@@ -99,6 +189,34 @@ bool UpdateOptionsFromCommandLine(Options& options, int argc, char* argv[]) {
             options.EnvironmentBlendMode = getNextArg();
         } else if (EqualsIgnoreCase(arg, "--space") || EqualsIgnoreCase(arg, "-s")) {
             options.AppSpace = getNextArg();
+        } else if (EqualsIgnoreCase(arg, "--pipeline") || EqualsIgnoreCase(arg, "-pl")) {
+            options.FramePipelining = true;
+        } else if (EqualsIgnoreCase(arg, "--multiview") || EqualsIgnoreCase(arg, "-mv")) {
+            options.Multiview = true;
+        } else if (EqualsIgnoreCase(arg, "--framesinflight") || EqualsIgnoreCase(arg, "-fif")) {
+            options.FramesInFlight = (uint32_t)std::stoul(getNextArg());
+        } else if (EqualsIgnoreCase(arg, "--gpuculling") || EqualsIgnoreCase(arg, "-gc")) {
+            options.GpuCulling = true;
+        } else if (EqualsIgnoreCase(arg, "--cachedir") || EqualsIgnoreCase(arg, "-cd")) {
+            options.CacheDirectory = getNextArg();
+        } else if (EqualsIgnoreCase(arg, "--msaa") || EqualsIgnoreCase(arg, "-ms")) {
+            options.MsaaSamples = (uint32_t)std::stoul(getNextArg());
+        } else if (EqualsIgnoreCase(arg, "--skipclear") || EqualsIgnoreCase(arg, "-sc")) {
+            options.SkipClear = true;
+        } else if (EqualsIgnoreCase(arg, "--framestats") || EqualsIgnoreCase(arg, "-fs")) {
+            options.FrameStatsFile = getNextArg();
+        } else if (EqualsIgnoreCase(arg, "--trace") || EqualsIgnoreCase(arg, "-tr")) {
+            options.TraceFile = getNextArg();
+        } else if (EqualsIgnoreCase(arg, "--asynclog") || EqualsIgnoreCase(arg, "-al")) {
+            options.AsyncLog = true;
+        } else if (EqualsIgnoreCase(arg, "--jobworkers") || EqualsIgnoreCase(arg, "-jw")) {
+            options.JobWorkers = (uint32_t)std::stoul(getNextArg());
+        } else if (EqualsIgnoreCase(arg, "--parallelrecord") || EqualsIgnoreCase(arg, "-pr")) {
+            options.ParallelRecording = true;
+        } else if (EqualsIgnoreCase(arg, "--benchmark") || EqualsIgnoreCase(arg, "-bf")) {
+            options.BenchmarkFrames = (uint32_t)std::stoul(getNextArg());
+        } else if (EqualsIgnoreCase(arg, "--cubes") || EqualsIgnoreCase(arg, "-cu")) {
+            options.GridCubes = (uint32_t)std::stoul(getNextArg());
         } else if (EqualsIgnoreCase(arg, "--verbose") || EqualsIgnoreCase(arg, "-v")) {
             Log::SetLevel(Log::Level::Verbose);
         } else if (EqualsIgnoreCase(arg, "--help") || EqualsIgnoreCase(arg, "-h")) {
@@ -197,20 +315,29 @@ void android_main(struct android_app* app) {
     try {
         JNIEnv* Env;
         app->activity->vm->AttachCurrentThread(&Env, nullptr);
+        TRACE_THREAD_NAME("Main");
 
         AndroidAppState appState = {};
         app->userData = &appState;
         app->onAppCmd = app_handle_cmd;
 
         std::shared_ptr<Options> options = std::make_shared<Options>();
+        // Caches go to the app's private storage unless a system property says otherwise.
+        options->CacheDirectory = app->activity->internalDataPath != nullptr ? app->activity->internalDataPath : "";
         if (!UpdateOptionsFromSystemProperties(*options)) {
             return;
         }
+        if (!options->TraceFile.empty()) {
+            Trace::Start(options->TraceFile);
+        }
+        Log::SetAsync(options->AsyncLog);
 
         std::shared_ptr<PlatformData> data = std::make_shared<PlatformData>();
         data->applicationVM = app->activity->vm;
         data->applicationActivity = app->activity->clazz;
 
+        std::shared_ptr<JobSystem> jobSystem = std::make_shared<JobSystem>(options->JobWorkers);
+
         bool requestRestart = false;
         bool exitRenderLoop = false;
 
@@ -218,14 +345,17 @@ void android_main(struct android_app* app) {
         std::shared_ptr<IPlatformPlugin> platformPlugin = CreatePlatformPlugin(options, data);
         // Create graphics API implementation.
         std::shared_ptr<IGraphicsPlugin> graphicsPlugin = CreateGraphicsPlugin(options, platformPlugin);
+        graphicsPlugin->SetJobSystem(jobSystem);
 
         // Initialize the OpenXR program.
         std::shared_ptr<OpenXrProgram> program = CreateOpenXrProgram(options, platformPlugin, graphicsPlugin);
+        program->SetJobSystem(jobSystem);
 
         // Initialize the loader for this platform
         PFN_xrInitializeLoaderKHR initializeLoader = nullptr;
         if (XR_SUCCEEDED(
                 xrGetInstanceProcAddr(XR_NULL_HANDLE, "xrInitializeLoaderKHR", (PFN_xrVoidFunction*)(&initializeLoader)))) {
+            TRACE_ZONE("InitializeLoader");
             XrLoaderInitInfoAndroidKHR loaderInitInfoAndroid;
             memset(&loaderInitInfoAndroid, 0, sizeof(loaderInitInfoAndroid));
             loaderInitInfoAndroid.type = XR_TYPE_LOADER_INIT_INFO_ANDROID_KHR;
@@ -247,6 +377,7 @@ void android_main(struct android_app* app) {
         program->InitializeSession();
         program->CreateSwapchains();
 
+        FrameBenchmark benchmark(options->BenchmarkFrames);
         while (app->destroyRequested == 0) {
             // Read all pending events.
             for (;;) {
@@ -277,15 +408,29 @@ void android_main(struct android_app* app) {
                 continue;
             }
 
+            if (UpdateRuntimeOptionsFromSystemProperties(*options)) {
+                graphicsPlugin->UpdateOptions(options);
+            }
+
+            benchmark.BeginFrame();
             program->PollActions();
             program->RenderFrame();
+            if (benchmark.EndFrame()) {
+                program->RequestExitSession();
+            }
         }
 
+        Trace::Stop();
+        Log::SetAsync(false);
         app->activity->vm->DetachCurrentThread();
     } catch (const std::exception& ex) {
         Log::Write(Log::Level::Error, ex.what());
+        Trace::Stop();
+        Log::SetAsync(false);
     } catch (...) {
         Log::Write(Log::Level::Error, "Unknown Error");
+        Trace::Stop();
+        Log::SetAsync(false);
     }
 }
 #else
@@ -296,14 +441,24 @@ int main(int argc, char* argv[]) {
         if (!UpdateOptionsFromCommandLine(*options, argc, argv)) {
             return 1;
         }
+        TRACE_THREAD_NAME("Main");
+        if (!options->TraceFile.empty()) {
+            Trace::Start(options->TraceFile);
+        }
+        Log::SetAsync(options->AsyncLog);
 
         std::shared_ptr<PlatformData> data = std::make_shared<PlatformData>();
+        std::shared_ptr<JobSystem> jobSystem = std::make_shared<JobSystem>(options->JobWorkers);
 
-        // Spawn a thread to wait for a keypress
-        static bool quitKeyPressed = false;
+        // Spawn a thread to wait for a keypress. A line starting with 'c' toggles GPU culling instead.
+        static std::atomic<bool> quitKeyPressed{false};
+        static std::atomic<bool> toggleGpuCulling{false};
         auto exitPollingThread = std::thread{[] {
             Log::Write(Log::Level::Info, "Press any key to shutdown...");
-            (void)getchar();
+            char line[64];
+            while (fgets(line, sizeof(line), stdin) != nullptr && (line[0] == 'c' || line[0] == 'C')) {
+                toggleGpuCulling = true;
+            }
             quitKeyPressed = true;
         }};
         exitPollingThread.detach();
@@ -315,9 +470,11 @@ int main(int argc, char* argv[]) {
 
             // Create graphics API implementation.
             std::shared_ptr<IGraphicsPlugin> graphicsPlugin = CreateGraphicsPlugin(options, platformPlugin);
+            graphicsPlugin->SetJobSystem(jobSystem);
 
             // Initialize the OpenXR program.
             std::shared_ptr<OpenXrProgram> program = CreateOpenXrProgram(options, platformPlugin, graphicsPlugin);
+            program->SetJobSystem(jobSystem);
 
             program->CreateInstance();
             program->InitializeSystem();
@@ -331,6 +488,7 @@ int main(int argc, char* argv[]) {
             program->InitializeSession();
             program->CreateSwapchains();
 
+            FrameBenchmark benchmark(options->BenchmarkFrames);
             while (!quitKeyPressed) {
                 bool exitRenderLoop = false;
                 program->PollEvents(&exitRenderLoop, &requestRestart);
@@ -338,9 +496,18 @@ int main(int argc, char* argv[]) {
                     break;
                 }
 
+                if (toggleGpuCulling.exchange(false)) {
+                    options->GpuCulling = !options->GpuCulling;
+                    graphicsPlugin->UpdateOptions(options);
+                }
+
                 if (program->IsSessionRunning()) {
+                    benchmark.BeginFrame();
                     program->PollActions();
                     program->RenderFrame();
+                    if (benchmark.EndFrame()) {
+                        program->RequestExitSession();
+                    }
                 } else {
                     // Throttle loop since xrWaitFrame won't be called.
                     std::this_thread::sleep_for(std::chrono::milliseconds(250));
@@ -349,12 +516,18 @@ int main(int argc, char* argv[]) {
 
         } while (!quitKeyPressed && requestRestart);
 
+        Trace::Stop();
+        Log::SetAsync(false);
         return 0;
     } catch (const std::exception& ex) {
         Log::Write(Log::Level::Error, ex.what());
+        Trace::Stop();
+        Log::SetAsync(false);
         return 1;
     } catch (...) {
         Log::Write(Log::Level::Error, "Unknown Error");
+        Trace::Stop();
+        Log::SetAsync(false);
         return 1;
     }
 }
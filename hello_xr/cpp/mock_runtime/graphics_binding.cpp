@@ -0,0 +1,495 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "graphics_binding.h"
+#include "mock_runtime.h"
+
+#ifdef XR_USE_GRAPHICS_API_OPENGL
+#include <GL/glext.h>
+#endif
+
+namespace {
+uint32_t AlignUp(uint32_t value, uint32_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+// Check that the application passed structs of the expected type for every image.
+bool HasImageType(const XrSwapchainImageBaseHeader* images, size_t stride, uint32_t count, XrStructureType type) {
+    for (uint32_t i = 0; i < count; i++) {
+        const auto* image =
+            reinterpret_cast<const XrSwapchainImageBaseHeader*>(reinterpret_cast<const uint8_t*>(images) + i * stride);
+        if (image->type != type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsSupportedFormat(const std::vector<int64_t>& formats, int64_t format) {
+    return std::find(formats.begin(), formats.end(), format) != formats.end();
+}
+
+//
+// XR_MOCK_memory_swapchain
+//
+
+struct MemorySwapchainImages : SwapchainImages {
+    MemorySwapchainImages(const XrSwapchainCreateInfo& createInfo, uint32_t imageCount)
+        : m_rowPitch(AlignUp(createInfo.width * 4, XR_MOCK_MEMORY_ROW_ALIGNMENT)),
+          m_slicePitch(m_rowPitch * createInfo.height),
+          m_imageBytes((size_t)m_slicePitch * createInfo.arraySize),
+          m_imageCount(imageCount) {
+        // One zeroed block for all images, with room to move the first row onto an aligned address. Every image takes
+        // a multiple of the row alignment, so the others start aligned too.
+        m_storage.reset(new uint8_t[m_imageBytes * imageCount + XR_MOCK_MEMORY_ROW_ALIGNMENT]());
+        const size_t misalignment = reinterpret_cast<uintptr_t>(m_storage.get()) % XR_MOCK_MEMORY_ROW_ALIGNMENT;
+        m_data = m_storage.get() + (misalignment == 0 ? 0 : XR_MOCK_MEMORY_ROW_ALIGNMENT - misalignment);
+    }
+
+    uint32_t Count() const override { return m_imageCount; }
+
+    XrResult Enumerate(XrSwapchainImageBaseHeader* images) const override {
+        if (!HasImageType(images, sizeof(XrSwapchainImageMemoryMOCK), m_imageCount, XR_TYPE_SWAPCHAIN_IMAGE_MEMORY_MOCK)) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        auto* memoryImages = reinterpret_cast<XrSwapchainImageMemoryMOCK*>(images);
+        for (uint32_t i = 0; i < m_imageCount; i++) {
+            memoryImages[i].data = m_data + i * m_imageBytes;
+            memoryImages[i].rowPitch = m_rowPitch;
+            memoryImages[i].slicePitch = m_slicePitch;
+        }
+        return XR_SUCCESS;
+    }
+
+   private:
+    const uint32_t m_rowPitch;
+    const uint32_t m_slicePitch;
+    const size_t m_imageBytes;
+    const uint32_t m_imageCount;
+    std::unique_ptr<uint8_t[]> m_storage;
+    uint8_t* m_data{nullptr};
+};
+
+struct MemoryBinding : GraphicsBinding {
+    std::vector<int64_t> SwapchainFormats() const override {
+        return {XR_MOCK_MEMORY_FORMAT_R8G8B8A8_SRGB, XR_MOCK_MEMORY_FORMAT_R8G8B8A8_UNORM, XR_MOCK_MEMORY_FORMAT_D32_SFLOAT};
+    }
+
+    XrResult CreateSwapchainImages(const XrSwapchainCreateInfo& createInfo, uint32_t imageCount,
+                                   std::unique_ptr<SwapchainImages>* images) override {
+        if (!IsSupportedFormat(SwapchainFormats(), createInfo.format)) {
+            return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+        }
+        if (createInfo.sampleCount != 1 || createInfo.mipCount != 1 || createInfo.faceCount != 1) {
+            return XR_ERROR_FEATURE_UNSUPPORTED;
+        }
+        images->reset(new MemorySwapchainImages(createInfo, imageCount));
+        return XR_SUCCESS;
+    }
+};
+
+//
+// XR_KHR_opengl_enable
+//
+
+#ifdef XR_USE_GRAPHICS_API_OPENGL
+template <typename T>
+T GetGLFunction(const char* name) {
+#ifdef XR_USE_PLATFORM_WIN32
+    return reinterpret_cast<T>(wglGetProcAddress(name));
+#else
+    return reinterpret_cast<T>(glXGetProcAddress(reinterpret_cast<const GLubyte*>(name)));
+#endif
+}
+
+// Textures are created on the context current on the thread that creates the swapchain, which must share objects with
+// the session's context. Destroying the swapchain has the same requirement.
+struct OpenGLSwapchainImages : SwapchainImages {
+    explicit OpenGLSwapchainImages(uint32_t imageCount) : m_textures(imageCount) {
+        glGenTextures((GLsizei)imageCount, m_textures.data());
+    }
+
+    ~OpenGLSwapchainImages() override { glDeleteTextures((GLsizei)m_textures.size(), m_textures.data()); }
+
+    uint32_t Count() const override { return (uint32_t)m_textures.size(); }
+
+    XrResult Enumerate(XrSwapchainImageBaseHeader* images) const override {
+        if (!HasImageType(images, sizeof(XrSwapchainImageOpenGLKHR), Count(), XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_KHR)) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        auto* glImages = reinterpret_cast<XrSwapchainImageOpenGLKHR*>(images);
+        for (uint32_t i = 0; i < Count(); i++) {
+            glImages[i].image = m_textures[i];
+        }
+        return XR_SUCCESS;
+    }
+
+    const std::vector<GLuint>& Textures() const { return m_textures; }
+
+   private:
+    std::vector<GLuint> m_textures;
+};
+
+struct OpenGLBinding : GraphicsBinding {
+    std::vector<int64_t> SwapchainFormats() const override {
+        return {GL_SRGB8_ALPHA8,       GL_RGBA8,            GL_RGB10_A2, GL_RGBA16F,
+                GL_DEPTH_COMPONENT32F, GL_DEPTH24_STENCIL8, GL_DEPTH_COMPONENT16};
+    }
+
+    XrResult CreateSwapchainImages(const XrSwapchainCreateInfo& createInfo, uint32_t imageCount,
+                                   std::unique_ptr<SwapchainImages>* images) override {
+        if (!IsSupportedFormat(SwapchainFormats(), createInfo.format)) {
+            return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+        }
+        if (createInfo.faceCount != 1 || (createInfo.sampleCount > 1 && createInfo.mipCount > 1)) {
+            return XR_ERROR_FEATURE_UNSUPPORTED;
+        }
+
+        // Immutable storage needs OpenGL 4.3, which xrGetOpenGLGraphicsRequirementsKHR asks for.
+        const auto texStorage2D = GetGLFunction<PFNGLTEXSTORAGE2DPROC>("glTexStorage2D");
+        const auto texStorage3D = GetGLFunction<PFNGLTEXSTORAGE3DPROC>("glTexStorage3D");
+        const auto texStorage2DMultisample = GetGLFunction<PFNGLTEXSTORAGE2DMULTISAMPLEPROC>("glTexStorage2DMultisample");
+        const auto texStorage3DMultisample = GetGLFunction<PFNGLTEXSTORAGE3DMULTISAMPLEPROC>("glTexStorage3DMultisample");
+        if (texStorage2D == nullptr || texStorage3D == nullptr || texStorage2DMultisample == nullptr ||
+            texStorage3DMultisample == nullptr) {
+            return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+        }
+
+        const GLenum format = (GLenum)createInfo.format;
+        const GLsizei width = (GLsizei)createInfo.width;
+        const GLsizei height = (GLsizei)createInfo.height;
+        const GLsizei layers = (GLsizei)createInfo.arraySize;
+        const bool array = createInfo.arraySize > 1;
+        const bool multisample = createInfo.sampleCount > 1;
+        const GLenum target = multisample ? (array ? GL_TEXTURE_2D_MULTISAMPLE_ARRAY : GL_TEXTURE_2D_MULTISAMPLE)
+                                          : (array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D);
+
+        std::unique_ptr<OpenGLSwapchainImages> glImages(new OpenGLSwapchainImages(imageCount));
+        for (GLuint texture : glImages->Textures()) {
+            glBindTexture(target, texture);
+            if (multisample && array) {
+                texStorage3DMultisample(target, (GLsizei)createInfo.sampleCount, format, width, height, layers, GL_TRUE);
+            } else if (multisample) {
+                texStorage2DMultisample(target, (GLsizei)createInfo.sampleCount, format, width, height, GL_TRUE);
+            } else if (array) {
+                texStorage3D(target, (GLsizei)createInfo.mipCount, format, width, height, layers);
+            } else {
+                texStorage2D(target, (GLsizei)createInfo.mipCount, format, width, height);
+            }
+        }
+        glBindTexture(target, 0);
+
+        *images = std::move(glImages);
+        return XR_SUCCESS;
+    }
+};
+#endif
+
+//
+// XR_KHR_vulkan_enable and XR_KHR_vulkan_enable2
+//
+
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+bool IsDepthFormat(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D16_UNORM;
+}
+
+VkImageUsageFlags ToVkImageUsage(XrSwapchainUsageFlags usage) {
+    // A compositor would sample every image.
+    VkImageUsageFlags vkUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+    if ((usage & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) != 0) {
+        vkUsage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    }
+    if ((usage & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0) {
+        vkUsage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    }
+    if ((usage & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) != 0) {
+        vkUsage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    }
+    if ((usage & XR_SWAPCHAIN_USAGE_TRANSFER_SRC_BIT) != 0) {
+        vkUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    if ((usage & XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT) != 0) {
+        vkUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+#ifdef XR_KHR_swapchain_usage_input_attachment_bit
+    if ((usage & XR_SWAPCHAIN_USAGE_INPUT_ATTACHMENT_BIT_KHR) != 0) {
+        vkUsage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+    }
+#endif
+    return vkUsage;
+}
+
+struct VulkanSwapchainImages : SwapchainImages {
+    explicit VulkanSwapchainImages(VkDevice device) : m_device(device) {}
+
+    ~VulkanSwapchainImages() override {
+        // The application destroys swapchains once it stopped rendering, so nothing else uses the device's queues.
+        vkDeviceWaitIdle(m_device);
+        for (VkImage image : m_images) {
+            vkDestroyImage(m_device, image, nullptr);
+        }
+        for (VkDeviceMemory memory : m_memory) {
+            vkFreeMemory(m_device, memory, nullptr);
+        }
+    }
+
+    uint32_t Count() const override { return (uint32_t)m_images.size(); }
+
+    XrResult Enumerate(XrSwapchainImageBaseHeader* images) const override {
+        if (!HasImageType(images, sizeof(XrSwapchainImageVulkanKHR), Count(), XR_TYPE_SWAPCHAIN_IMAGE_VULKAN_KHR)) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        auto* vkImages = reinterpret_cast<XrSwapchainImageVulkanKHR*>(images);
+        for (uint32_t i = 0; i < Count(); i++) {
+            vkImages[i].image = m_images[i];
+        }
+        return XR_SUCCESS;
+    }
+
+    VkDevice m_device;
+    std::vector<VkImage> m_images;
+    std::vector<VkDeviceMemory> m_memory;
+};
+
+struct VulkanBinding : GraphicsBinding {
+    explicit VulkanBinding(const XrGraphicsBindingVulkanKHR& binding) : m_binding(binding) {
+        vkGetPhysicalDeviceMemoryProperties(m_binding.physicalDevice, &m_memoryProperties);
+        vkGetDeviceQueue(m_binding.device, m_binding.queueFamilyIndex, m_binding.queueIndex, &m_queue);
+    }
+
+    std::vector<int64_t> SwapchainFormats() const override {
+        return {VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_SRGB,   VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM,
+                VK_FORMAT_D32_SFLOAT,    VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM};
+    }
+
+    XrResult CreateSwapchainImages(const XrSwapchainCreateInfo& createInfo, uint32_t imageCount,
+                                   std::unique_ptr<SwapchainImages>* images) override {
+        if (!IsSupportedFormat(SwapchainFormats(), createInfo.format)) {
+            return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+        }
+        if (createInfo.faceCount != 1) {
+            return XR_ERROR_FEATURE_UNSUPPORTED;
+        }
+
+        VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        if ((createInfo.usageFlags & XR_SWAPCHAIN_USAGE_MUTABLE_FORMAT_BIT) != 0) {
+            imageInfo.flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+        }
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = (VkFormat)createInfo.format;
+        imageInfo.extent = {createInfo.width, createInfo.height, 1};
+        imageInfo.mipLevels = createInfo.mipCount;
+        imageInfo.arrayLayers = createInfo.arraySize;
+        imageInfo.samples = (VkSampleCountFlagBits)createInfo.sampleCount;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = ToVkImageUsage(createInfo.usageFlags);
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        std::unique_ptr<VulkanSwapchainImages> vkImages(new VulkanSwapchainImages(m_binding.device));
+        for (uint32_t i = 0; i < imageCount; i++) {
+            VkImage image;
+            if (vkCreateImage(m_binding.device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+                return XR_ERROR_RUNTIME_FAILURE;
+            }
+            vkImages->m_images.push_back(image);
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(m_binding.device, image, &requirements);
+            VkMemoryAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+            allocateInfo.allocationSize = requirements.size;
+            allocateInfo.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits);
+            VkDeviceMemory memory;
+            if (vkAllocateMemory(m_binding.device, &allocateInfo, nullptr, &memory) != VK_SUCCESS) {
+                return XR_ERROR_RUNTIME_FAILURE;
+            }
+            vkImages->m_memory.push_back(memory);
+            if (vkBindImageMemory(m_binding.device, image, memory, 0) != VK_SUCCESS) {
+                return XR_ERROR_RUNTIME_FAILURE;
+            }
+        }
+
+        if (!TransitionToAttachmentLayout(vkImages->m_images, createInfo)) {
+            return XR_ERROR_RUNTIME_FAILURE;
+        }
+
+        *images = std::move(vkImages);
+        return XR_SUCCESS;
+    }
+
+   private:
+    uint32_t FindMemoryType(uint32_t typeBits) const {
+        // Prefer device local memory, but take any type the image allows.
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+            if ((typeBits & (1u << i)) != 0 &&
+                (m_memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0) {
+                return i;
+            }
+        }
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+            if ((typeBits & (1u << i)) != 0) {
+                return i;
+            }
+        }
+        THROW("No memory type for swapchain image");
+    }
+
+    // The application expects images in the attachment layout when it acquires them. Submitted to the session's queue,
+    // which only happens while the application creates swapchains and so does not submit itself.
+    bool TransitionToAttachmentLayout(const std::vector<VkImage>& images, const XrSwapchainCreateInfo& createInfo) {
+        const VkFormat format = (VkFormat)createInfo.format;
+        const bool depth = IsDepthFormat(format);
+
+        std::vector<VkImageMemoryBarrier> barriers;
+        for (VkImage image : images) {
+            VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            barrier.dstAccessMask = depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = !depth                              ? VK_IMAGE_ASPECT_COLOR_BIT
+                                                  : format == VK_FORMAT_D24_UNORM_S8_UINT ? VK_IMAGE_ASPECT_DEPTH_BIT |
+                                                                                            VK_IMAGE_ASPECT_STENCIL_BIT
+                                                                                      : VK_IMAGE_ASPECT_DEPTH_BIT;
+            barrier.subresourceRange.levelCount = createInfo.mipCount;
+            barrier.subresourceRange.layerCount = createInfo.arraySize;
+            barriers.push_back(barrier);
+        }
+
+        VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = m_binding.queueFamilyIndex;
+        VkCommandPool pool;
+        if (vkCreateCommandPool(m_binding.device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            return false;
+        }
+        auto poolGuard = MakeScopeGuard([&] { vkDestroyCommandPool(m_binding.device, pool, nullptr); });
+
+        VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool = pool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VkCommandBuffer cmdBuffer;
+        if (vkAllocateCommandBuffers(m_binding.device, &allocateInfo, &cmdBuffer) != VK_SUCCESS) {
+            return false;
+        }
+
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmdBuffer, &beginInfo);
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             depth ? VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             0, 0, nullptr, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+        if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
+            return false;
+        }
+
+        VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        VkFence fence;
+        if (vkCreateFence(m_binding.device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            return false;
+        }
+        auto fenceGuard = MakeScopeGuard([&] { vkDestroyFence(m_binding.device, fence, nullptr); });
+
+        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &cmdBuffer;
+        return vkQueueSubmit(m_queue, 1, &submitInfo, fence) == VK_SUCCESS &&
+               vkWaitForFences(m_binding.device, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+    }
+
+    const XrGraphicsBindingVulkanKHR m_binding;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkQueue m_queue{VK_NULL_HANDLE};
+};
+#endif
+
+template <typename T>
+const T* FindChained(const void* next, XrStructureType type) {
+    for (auto* entry = reinterpret_cast<const XrBaseInStructure*>(next); entry != nullptr; entry = entry->next) {
+        if (entry->type == type) {
+            return reinterpret_cast<const T*>(entry);
+        }
+    }
+    return nullptr;
+}
+}  // namespace
+
+std::vector<std::pair<const char*, uint32_t>> GetGraphicsBindingExtensions() {
+    std::vector<std::pair<const char*, uint32_t>> extensions;
+#ifdef XR_USE_GRAPHICS_API_OPENGL
+    extensions.emplace_back(XR_KHR_OPENGL_ENABLE_EXTENSION_NAME, XR_KHR_opengl_enable_SPEC_VERSION);
+#endif
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+    extensions.emplace_back(XR_KHR_VULKAN_ENABLE_EXTENSION_NAME, XR_KHR_vulkan_enable_SPEC_VERSION);
+    extensions.emplace_back(XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME, XR_KHR_vulkan_enable2_SPEC_VERSION);
+#endif
+    extensions.emplace_back(XR_MOCK_MEMORY_SWAPCHAIN_EXTENSION_NAME, XR_MOCK_memory_swapchain_SPEC_VERSION);
+    extensions.emplace_back(XR_MND_HEADLESS_EXTENSION_NAME, XR_MND_headless_SPEC_VERSION);
+    return extensions;
+}
+
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+VkPhysicalDevice SelectVulkanPhysicalDevice(VkInstance vkInstance) {
+    uint32_t deviceCount = 0;
+    if (vkEnumeratePhysicalDevices(vkInstance, &deviceCount, nullptr) != VK_SUCCESS || deviceCount == 0) {
+        return VK_NULL_HANDLE;
+    }
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    if (vkEnumeratePhysicalDevices(vkInstance, &deviceCount, devices.data()) < VK_SUCCESS || deviceCount == 0) {
+        return VK_NULL_HANDLE;
+    }
+    return devices[0];
+}
+#endif
+
+XrResult CreateGraphicsBinding(const XrSessionCreateInfo& createInfo, const std::set<std::string>& enabledExtensions,
+                               std::unique_ptr<GraphicsBinding>* binding) {
+    const auto isEnabled = [&](const char* extension) { return enabledExtensions.count(extension) != 0; };
+
+#ifdef XR_USE_GRAPHICS_API_OPENGL
+#ifdef XR_USE_PLATFORM_WIN32
+    const auto* glBinding =
+        FindChained<XrGraphicsBindingOpenGLWin32KHR>(createInfo.next, XR_TYPE_GRAPHICS_BINDING_OPENGL_WIN32_KHR);
+    const bool hasGLContext = glBinding != nullptr && glBinding->hGLRC != nullptr;
+#elif defined(XR_USE_PLATFORM_XLIB)
+    const auto* glBinding = FindChained<XrGraphicsBindingOpenGLXlibKHR>(createInfo.next, XR_TYPE_GRAPHICS_BINDING_OPENGL_XLIB_KHR);
+    const bool hasGLContext = glBinding != nullptr && glBinding->glxContext != nullptr;
+#endif
+    if (glBinding != nullptr && isEnabled(XR_KHR_OPENGL_ENABLE_EXTENSION_NAME)) {
+        if (!hasGLContext) {
+            return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+        }
+        binding->reset(new OpenGLBinding());
+        return XR_SUCCESS;
+    }
+#endif
+
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+    const auto* vkBinding = FindChained<XrGraphicsBindingVulkanKHR>(createInfo.next, XR_TYPE_GRAPHICS_BINDING_VULKAN_KHR);
+    if (vkBinding != nullptr &&
+        (isEnabled(XR_KHR_VULKAN_ENABLE_EXTENSION_NAME) || isEnabled(XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME))) {
+        if (vkBinding->physicalDevice == VK_NULL_HANDLE || vkBinding->device == VK_NULL_HANDLE) {
+            return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+        }
+        binding->reset(new VulkanBinding(*vkBinding));
+        return XR_SUCCESS;
+    }
+#endif
+
+    if (FindChained<XrGraphicsBindingMemoryMOCK>(createInfo.next, XR_TYPE_GRAPHICS_BINDING_MEMORY_MOCK) != nullptr &&
+        isEnabled(XR_MOCK_MEMORY_SWAPCHAIN_EXTENSION_NAME)) {
+        binding->reset(new MemoryBinding());
+        return XR_SUCCESS;
+    }
+
+    if (isEnabled(XR_MND_HEADLESS_EXTENSION_NAME)) {
+        binding->reset();
+        return XR_SUCCESS;
+    }
+    return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+}
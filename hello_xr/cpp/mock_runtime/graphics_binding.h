@@ -0,0 +1,43 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+// Images of one swapchain, allocated with the graphics API of the session.
+struct SwapchainImages {
+    virtual ~SwapchainImages() = default;
+
+    virtual uint32_t Count() const = 0;
+
+    // Fill images[0, Count()) with the API's image structs. Fails if the application passed structs of another API.
+    virtual XrResult Enumerate(XrSwapchainImageBaseHeader* images) const = 0;
+};
+
+// The graphics API a session was created with, as far as the mock runtime uses it: to allocate swapchain images. Nothing
+// is ever composited, so the images are never read.
+struct GraphicsBinding {
+    virtual ~GraphicsBinding() = default;
+
+    // In order of preference.
+    virtual std::vector<int64_t> SwapchainFormats() const = 0;
+
+    // Returns XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED or XR_ERROR_FEATURE_UNSUPPORTED if the images cannot be made.
+    virtual XrResult CreateSwapchainImages(const XrSwapchainCreateInfo& createInfo, uint32_t imageCount,
+                                           std::unique_ptr<SwapchainImages>* images) = 0;
+};
+
+// Extensions of the graphics APIs this build supports, with their spec versions.
+std::vector<std::pair<const char*, uint32_t>> GetGraphicsBindingExtensions();
+
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+// The physical device sessions must use: the first one the instance enumerates.
+VkPhysicalDevice SelectVulkanPhysicalDevice(VkInstance vkInstance);
+#endif
+
+// Create the binding chained to XrSessionCreateInfo::next. A session without one gets a null binding if XR_MND_headless
+// is enabled: it may not create swapchains.
+XrResult CreateGraphicsBinding(const XrSessionCreateInfo& createInfo, const std::set<std::string>& enabledExtensions,
+                               std::unique_ptr<GraphicsBinding>* binding);
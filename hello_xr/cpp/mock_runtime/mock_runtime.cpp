@@ -0,0 +1,2183 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "graphics_binding.h"
+#include "mock_runtime.h"
+#include "pose_script.h"
+
+#include <common/loader_interfaces.h>
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+
+#if defined(_WIN32)
+#define MOCK_RUNTIME_EXPORT extern "C" __declspec(dllexport)
+#else
+#define MOCK_RUNTIME_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+MAKE_TO_STRING_FUNC(XrStructureType);
+
+namespace {
+constexpr const char* RuntimeName = "hello_xr mock runtime";
+constexpr const char* SystemName = "hello_xr mock HMD";
+constexpr XrSystemId MockSystemId = 1;
+constexpr uint32_t SwapchainImageCount = 3;
+constexpr uint32_t MaxLayerCount = 16;
+constexpr uint32_t MaxSwapchainSize = 4096;
+constexpr uint32_t MaxSampleCount = 4;
+constexpr size_t MaxQueuedEvents = 64;
+// Frame period reported when xrWaitFrame does not pace.
+constexpr double NominalRefreshRate = 90.0;
+constexpr float InterpupillaryDistance = 0.063f;
+
+const XrEnvironmentBlendMode BlendModes[] = {XR_ENVIRONMENT_BLEND_MODE_OPAQUE, XR_ENVIRONMENT_BLEND_MODE_ADDITIVE,
+                                             XR_ENVIRONMENT_BLEND_MODE_ALPHA_BLEND};
+
+struct Settings {
+    double refreshRate{90.0};
+    uint32_t viewWidth{1440};
+    uint32_t viewHeight{1600};
+    std::string poseScript;
+    uint64_t exitAfterFrames{0};
+};
+
+Settings ReadSettings() {
+    Settings settings;
+    if (const char* value = std::getenv("HELLO_XR_MOCK_REFRESH_RATE")) {
+        settings.refreshRate = std::max(0.0, std::atof(value));
+    }
+    if (const char* value = std::getenv("HELLO_XR_MOCK_VIEW_SIZE")) {
+        unsigned width = 0;
+        unsigned height = 0;
+        if (sscanf(value, "%ux%u", &width, &height) == 2 && width > 0 && height > 0 && width <= MaxSwapchainSize &&
+            height <= MaxSwapchainSize) {
+            settings.viewWidth = width;
+            settings.viewHeight = height;
+        } else {
+            Log::Write(Log::Level::Warning, Fmt("Mock runtime: ignoring view size '%s'", value));
+        }
+    }
+    if (const char* value = std::getenv("HELLO_XR_MOCK_POSE_SCRIPT")) {
+        settings.poseScript = value;
+    }
+    if (const char* value = std::getenv("HELLO_XR_MOCK_EXIT_AFTER_FRAMES")) {
+        settings.exitAfterFrames = std::strtoull(value, nullptr, 10);
+    }
+    return settings;
+}
+
+// XrTime is nanoseconds of the clock the time conversion extensions convert from.
+#ifdef XR_USE_PLATFORM_WIN32
+XrTime CounterToTime(int64_t counter, int64_t frequency) {
+    return counter / frequency * 1000000000 + counter % frequency * 1000000000 / frequency;
+}
+
+int64_t TimeToCounter(XrTime time, int64_t frequency) {
+    return time / 1000000000 * frequency + time % 1000000000 * frequency / 1000000000;
+}
+
+int64_t CounterFrequency() {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return frequency.QuadPart;
+}
+#endif
+
+XrTime Now() {
+#ifdef XR_USE_PLATFORM_WIN32
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return CounterToTime(counter.QuadPart, CounterFrequency());
+#else
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (XrTime)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+//
+// Objects behind the handles.
+//
+
+enum class ObjectType { Instance, Session, Space, Swapchain, ActionSet, Action };
+
+// All state is guarded by g_mutex, which every function holds while it runs. xrWaitFrame releases it while it waits on
+// g_frameCondition.
+std::mutex g_mutex;
+std::condition_variable g_frameCondition;
+// Objects whose handles are valid.
+std::map<const void*, ObjectType> g_objects;
+
+struct Object {
+    explicit Object(ObjectType type) { g_objects[this] = type; }
+    virtual ~Object() { g_objects.erase(this); }
+
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+};
+
+template <typename Handle>
+Handle ToHandle(const Object* object) {
+    return (Handle)(uintptr_t)object;
+}
+
+// Returns nullptr unless the handle is a live object of type T.
+template <typename T, typename Handle>
+T* Lookup(Handle handle) {
+    const Object* object = (const Object*)(uintptr_t)handle;
+    const auto it = g_objects.find(object);
+    if (it == g_objects.end() || it->second != T::Type) {
+        return nullptr;
+    }
+    return static_cast<T*>(const_cast<Object*>(object));
+}
+
+struct Instance;
+struct Session;
+struct ActionSet;
+
+struct Action : Object {
+    static constexpr ObjectType Type = ObjectType::Action;
+    Action(ActionSet* actionSet, const XrActionCreateInfo& createInfo)
+        : Object(Type),
+          actionSet(actionSet),
+          name(createInfo.actionName),
+          actionType(createInfo.actionType),
+          subactionPaths(createInfo.subactionPaths, createInfo.subactionPaths + createInfo.countSubactionPaths) {}
+
+    ActionSet* const actionSet;
+    const std::string name;
+    const XrActionType actionType;
+    const std::vector<XrPath> subactionPaths;
+};
+
+struct ActionSet : Object {
+    static constexpr ObjectType Type = ObjectType::ActionSet;
+    ActionSet(Instance* instance, const XrActionSetCreateInfo& createInfo)
+        : Object(Type), instance(instance), name(createInfo.actionSetName) {}
+
+    Instance* const instance;
+    const std::string name;
+    bool attached{false};
+    std::vector<std::unique_ptr<Action>> actions;
+};
+
+struct Space : Object {
+    static constexpr ObjectType Type = ObjectType::Space;
+    explicit Space(Session* session) : Object(Type), session(session) {}
+
+    Session* const session;
+    // Action spaces follow a hand; reference spaces have a reference space type.
+    bool isActionSpace{false};
+    MockDevice hand{MockDevice::LeftHand};
+    XrReferenceSpaceType referenceSpaceType{XR_REFERENCE_SPACE_TYPE_STAGE};
+    XrPosef offset{};
+};
+
+struct Swapchain : Object {
+    static constexpr ObjectType Type = ObjectType::Swapchain;
+    Swapchain(Session* session, const XrSwapchainCreateInfo& createInfo) : Object(Type), session(session), createInfo(createInfo) {}
+
+    Session* const session;
+    const XrSwapchainCreateInfo createInfo;
+    std::unique_ptr<SwapchainImages> images;
+    uint32_t nextImage{0};
+    // Acquired images in the order they have to be released; the first one is waited on if waited is set.
+    std::deque<uint32_t> acquired;
+    bool waited{false};
+    // A swapchain may only be submitted once one of its images was released.
+    bool released{false};
+};
+
+struct Session : Object {
+    static constexpr ObjectType Type = ObjectType::Session;
+    explicit Session(Instance* instance) : Object(Type), instance(instance), epoch(Now()) {}
+
+    Instance* const instance;
+    std::unique_ptr<GraphicsBinding> binding;
+    XrSessionState state{XR_SESSION_STATE_UNKNOWN};
+    bool running{false};
+    bool exitRequested{false};
+    XrViewConfigurationType viewConfigurationType{XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO};
+
+    // Frame loop. Frame n is displayed at epoch + n * DisplayPeriod(); the pose script starts at the epoch.
+    XrTime epoch;
+    int64_t lastDisplaySlot{0};
+    XrTime lastPredictedDisplayTime{0};
+    uint64_t waitedFrames{0};
+    uint64_t begunFrames{0};
+    uint64_t endedFrames{0};
+    bool frameInProgress{false};
+
+    // Actions, sampled at the predicted display time of the frame waited for last when actions are synced.
+    XrPath interactionProfile{XR_NULL_PATH};
+    bool actionSetsAttached{false};
+    bool actionsActive{false};
+    XrTime syncTime{0};
+    XrTime previousSyncTime{0};
+
+    std::vector<std::unique_ptr<Space>> spaces;
+    std::vector<std::unique_ptr<Swapchain>> swapchains;
+};
+
+struct Instance : Object {
+    static constexpr ObjectType Type = ObjectType::Instance;
+    Instance() : Object(Type) {}
+
+    std::set<std::string> extensions;
+
+    // XrPath n is paths[n - 1].
+    std::vector<std::string> paths;
+    std::map<std::string, XrPath> pathIds;
+    XrPath leftHandPath{XR_NULL_PATH};
+    XrPath rightHandPath{XR_NULL_PATH};
+
+    std::deque<XrEventDataBuffer> events;
+    uint32_t lostEventCount{0};
+
+    // Interaction profiles in the order bindings were first suggested for them; sessions use the first.
+    std::vector<XrPath> suggestedProfiles;
+    std::map<XrPath, std::vector<XrActionSuggestedBinding>> suggestedBindings;
+
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+    VkInstance vkInstance{VK_NULL_HANDLE};
+#endif
+
+    // Sessions refer to the actions, so they go first.
+    std::vector<std::unique_ptr<ActionSet>> actionSets;
+    std::unique_ptr<Session> session;
+};
+
+struct Runtime {
+    Settings settings;
+    PoseScript poseScript;
+    // The runtime supports a single instance at a time.
+    Instance* instance{nullptr};
+};
+Runtime g_runtime;
+
+//
+// Helpers.
+//
+
+// Log failures that are not the application's fault; the application only sees the result.
+template <typename Function>
+XrResult Guarded(const char* functionName, Function&& function) {
+    try {
+        return function();
+    } catch (const std::exception& ex) {
+        Log::Write(Log::Level::Error, Fmt("Mock runtime: %s failed: %s", functionName, ex.what()));
+        return XR_ERROR_RUNTIME_FAILURE;
+    }
+}
+
+XrResult WriteString(const std::string& value, uint32_t capacity, uint32_t* countOutput, char* buffer) {
+    if (countOutput == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *countOutput = (uint32_t)value.size() + 1;
+    if (capacity == 0) {
+        return XR_SUCCESS;
+    }
+    if (capacity < *countOutput) {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    if (buffer == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    memcpy(buffer, value.c_str(), value.size() + 1);
+    return XR_SUCCESS;
+}
+
+// The two-call idiom: report the count, then fill output[i] with fill(output[i], i) if there is room for all of them.
+template <typename T, typename Fill>
+XrResult WriteArray(uint32_t count, uint32_t capacity, uint32_t* countOutput, T* output, Fill&& fill) {
+    if (countOutput == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *countOutput = count;
+    if (capacity == 0) {
+        return XR_SUCCESS;
+    }
+    if (capacity < count) {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    if (output == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        fill(output[i], i);
+    }
+    return XR_SUCCESS;
+}
+
+std::vector<std::pair<const char*, uint32_t>> SupportedExtensions() {
+    std::vector<std::pair<const char*, uint32_t>> extensions = GetGraphicsBindingExtensions();
+#if defined(XR_USE_PLATFORM_WIN32) && defined(XR_KHR_win32_convert_performance_counter_time)
+    extensions.emplace_back(XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME,
+                            XR_KHR_win32_convert_performance_counter_time_SPEC_VERSION);
+#elif defined(XR_USE_TIMESPEC) && defined(XR_KHR_convert_timespec_time)
+    extensions.emplace_back(XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME, XR_KHR_convert_timespec_time_SPEC_VERSION);
+#endif
+    extensions.emplace_back(XR_KHR_LOCATE_SPACES_EXTENSION_NAME, XR_KHR_locate_spaces_SPEC_VERSION);
+    return extensions;
+}
+
+bool IsValidSystem(XrSystemId systemId) { return systemId == MockSystemId; }
+
+bool IsSupportedViewConfiguration(XrViewConfigurationType type) {
+    return type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO || type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_MONO;
+}
+
+uint32_t ViewCount(XrViewConfigurationType type) { return type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO ? 2 : 1; }
+
+XrDuration DisplayPeriod() {
+    const double refreshRate = g_runtime.settings.refreshRate > 0.0 ? g_runtime.settings.refreshRate : NominalRefreshRate;
+    return (XrDuration)(1e9 / refreshRate);
+}
+
+// Lowercase letters, digits, '-', '_' and '.' in components separated by single slashes, starting with one.
+bool IsWellFormedPath(const char* path) {
+    if (path == nullptr || path[0] != '/') {
+        return false;
+    }
+    for (const char* c = path; *c != '\0'; c++) {
+        const bool valid = (*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9') || *c == '-' || *c == '_' || *c == '.' ||
+                           (*c == '/' && c[1] != '/' && c[1] != '\0');
+        if (!valid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+XrPath InternPath(Instance& instance, const std::string& path) {
+    const auto it = instance.pathIds.find(path);
+    if (it != instance.pathIds.end()) {
+        return it->second;
+    }
+    instance.paths.push_back(path);
+    const XrPath id = instance.paths.size();
+    instance.pathIds[path] = id;
+    return id;
+}
+
+const std::string* PathString(const Instance& instance, XrPath path) {
+    return path != XR_NULL_PATH && path <= instance.paths.size() ? &instance.paths[path - 1] : nullptr;
+}
+
+void PushEvent(Instance& instance, const void* event, size_t size) {
+    if (instance.events.size() >= MaxQueuedEvents) {
+        instance.events.pop_front();
+        instance.lostEventCount++;
+    }
+    XrEventDataBuffer buffer{};
+    memcpy(&buffer, event, std::min(size, sizeof(buffer)));
+    instance.events.push_back(buffer);
+}
+
+void SetSessionState(Session& session, XrSessionState state) {
+    session.state = state;
+    XrEventDataSessionStateChanged event{XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED};
+    event.session = ToHandle<XrSession>(&session);
+    event.state = state;
+    event.time = Now();
+    PushEvent(*session.instance, &event, sizeof(event));
+}
+
+// Take a running session down to STOPPING through every state in between, as when the user quits.
+void StopSession(Session& session) {
+    session.exitRequested = true;
+    if (session.state == XR_SESSION_STATE_FOCUSED) {
+        SetSessionState(session, XR_SESSION_STATE_VISIBLE);
+    }
+    if (session.state == XR_SESSION_STATE_VISIBLE) {
+        SetSessionState(session, XR_SESSION_STATE_SYNCHRONIZED);
+    }
+    if (session.state == XR_SESSION_STATE_SYNCHRONIZED) {
+        SetSessionState(session, XR_SESSION_STATE_STOPPING);
+    }
+}
+
+double ScriptSeconds(const Session& session, XrTime time) { return (double)(time - session.epoch) * 1e-9; }
+
+XrPosef DevicePose(const Session& session, MockDevice device, XrTime time) {
+    return g_runtime.poseScript.Locate(device, ScriptSeconds(session, time));
+}
+
+// Pose of a space in stage space.
+XrPosef SpaceToStage(const Space& space, XrTime time) {
+    XrPosef origin = PoseMath::Identity();
+    if (space.isActionSpace) {
+        origin = DevicePose(*space.session, space.hand, time);
+    } else if (space.referenceSpaceType == XR_REFERENCE_SPACE_TYPE_VIEW) {
+        origin = DevicePose(*space.session, MockDevice::Head, time);
+    } else if (space.referenceSpaceType == XR_REFERENCE_SPACE_TYPE_LOCAL) {
+        // Where the head started, at its height and facing -Z.
+        origin.position = g_runtime.poseScript.Locate(MockDevice::Head, 0.0).position;
+    }
+    return PoseMath::Multiply(origin, space.offset);
+}
+
+XrSpaceLocationFlags LocateSpace(const Space& space, const Space& baseSpace, XrTime time, XrPosef* pose) {
+    const Session& session = *space.session;
+    // Hands are only tracked while the application's actions are.
+    if ((space.isActionSpace || baseSpace.isActionSpace) && !session.actionsActive) {
+        *pose = PoseMath::Identity();
+        return 0;
+    }
+    *pose = PoseMath::Multiply(PoseMath::Invert(SpaceToStage(baseSpace, time)), SpaceToStage(space, time));
+    return XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT |
+           XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT;
+}
+
+XrFovf ViewFov(XrViewConfigurationType type, uint32_t view) {
+    if (type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_MONO) {
+        return {-0.85f, 0.85f, 0.85f, -0.85f};
+    }
+    // Canted outwards a little, like most headsets.
+    return view == 0 ? XrFovf{-0.9f, 0.8f, 0.85f, -0.9f} : XrFovf{-0.8f, 0.9f, 0.85f, -0.9f};
+}
+
+bool IsHandPath(const Instance& instance, XrPath path) {
+    return path == instance.leftHandPath || path == instance.rightHandPath;
+}
+
+// Find the action of an action state query and check it has the expected type and subaction path.
+XrResult GetActionForState(const XrActionStateGetInfo* getInfo, XrActionType actionType, Action** action) {
+    if (getInfo == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *action = Lookup<Action>(getInfo->action);
+    if (*action == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!(*action)->actionSet->attached) {
+        return XR_ERROR_ACTIONSET_NOT_ATTACHED;
+    }
+    if ((*action)->actionType != actionType) {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    const std::vector<XrPath>& subactionPaths = (*action)->subactionPaths;
+    if (getInfo->subactionPath != XR_NULL_PATH &&
+        std::find(subactionPaths.begin(), subactionPaths.end(), getInfo->subactionPath) == subactionPaths.end()) {
+        return XR_ERROR_PATH_UNSUPPORTED;
+    }
+    return XR_SUCCESS;
+}
+
+// How far the hands selected by a subaction path squeeze at a time; both hands without one.
+float Squeeze(const Session& session, XrPath subactionPath, XrTime time) {
+    const double seconds = ScriptSeconds(session, time);
+    const float left = g_runtime.poseScript.Squeeze(MockDevice::LeftHand, seconds);
+    const float right = g_runtime.poseScript.Squeeze(MockDevice::RightHand, seconds);
+    if (subactionPath == session.instance->leftHandPath) {
+        return left;
+    }
+    if (subactionPath == session.instance->rightHandPath) {
+        return right;
+    }
+    return std::max(left, right);
+}
+
+//
+// Instance and system.
+//
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateApiLayerProperties(uint32_t propertyCapacityInput, uint32_t* propertyCountOutput,
+                                                               XrApiLayerProperties* properties) {
+    // API layers are the loader's business.
+    return WriteArray(0, propertyCapacityInput, propertyCountOutput, properties, [](XrApiLayerProperties&, uint32_t) {});
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateInstanceExtensionProperties(const char* layerName, uint32_t propertyCapacityInput,
+                                                                        uint32_t* propertyCountOutput,
+                                                                        XrExtensionProperties* properties) {
+    if (layerName != nullptr) {
+        return XR_ERROR_API_LAYER_NOT_PRESENT;
+    }
+    const std::vector<std::pair<const char*, uint32_t>> extensions = SupportedExtensions();
+    return WriteArray((uint32_t)extensions.size(), propertyCapacityInput, propertyCountOutput, properties,
+                      [&](XrExtensionProperties& property, uint32_t i) {
+                          strncpy(property.extensionName, extensions[i].first, XR_MAX_EXTENSION_NAME_SIZE - 1);
+                          property.extensionName[XR_MAX_EXTENSION_NAME_SIZE - 1] = '\0';
+                          property.extensionVersion = extensions[i].second;
+                      });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateInstance(const XrInstanceCreateInfo* createInfo, XrInstance* instance) {
+    return Guarded("xrCreateInstance", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (createInfo == nullptr || createInfo->type != XR_TYPE_INSTANCE_CREATE_INFO || instance == nullptr) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (XR_VERSION_MAJOR(createInfo->applicationInfo.apiVersion) != 1) {
+            return XR_ERROR_API_VERSION_UNSUPPORTED;
+        }
+        if (createInfo->enabledApiLayerCount != 0) {
+            return XR_ERROR_API_LAYER_NOT_PRESENT;
+        }
+        if (g_runtime.instance != nullptr) {
+            return XR_ERROR_LIMIT_REACHED;
+        }
+
+        const std::vector<std::pair<const char*, uint32_t>> supported = SupportedExtensions();
+        std::set<std::string> extensions;
+        for (uint32_t i = 0; i < createInfo->enabledExtensionCount; i++) {
+            const char* name = createInfo->enabledExtensionNames[i];
+            if (std::none_of(supported.begin(), supported.end(), [&](const std::pair<const char*, uint32_t>& extension) {
+                    return strcmp(extension.first, name) == 0;
+                })) {
+                return XR_ERROR_EXTENSION_NOT_PRESENT;
+            }
+            extensions.insert(name);
+        }
+
+        g_runtime.settings = ReadSettings();
+        try {
+            g_runtime.poseScript.Load(g_runtime.settings.poseScript);
+        } catch (const std::exception& ex) {
+            Log::Write(Log::Level::Error, Fmt("Mock runtime: %s", ex.what()));
+            return XR_ERROR_INITIALIZATION_FAILED;
+        }
+        Log::Write(Log::Level::Info,
+                   Fmt("Mock runtime: %s, %ux%u views, %s poses", g_runtime.settings.refreshRate > 0.0
+                                                                      ? Fmt("%.0f Hz", g_runtime.settings.refreshRate).c_str()
+                                                                      : "unpaced",
+                       g_runtime.settings.viewWidth, g_runtime.settings.viewHeight,
+                       g_runtime.settings.poseScript.empty() ? "built-in" : g_runtime.settings.poseScript.c_str()));
+
+        std::unique_ptr<Instance> newInstance(new Instance());
+        newInstance->extensions = std::move(extensions);
+        newInstance->leftHandPath = InternPath(*newInstance, "/user/hand/left");
+        newInstance->rightHandPath = InternPath(*newInstance, "/user/hand/right");
+        g_runtime.instance = newInstance.release();
+        *instance = ToHandle<XrInstance>(g_runtime.instance);
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroyInstance(XrInstance instance) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Instance* object = Lookup<Instance>(instance);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    delete object;
+    g_runtime.instance = nullptr;
+    g_frameCondition.notify_all();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (instanceProperties == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+    strncpy(instanceProperties->runtimeName, RuntimeName, XR_MAX_RUNTIME_NAME_SIZE - 1);
+    instanceProperties->runtimeName[XR_MAX_RUNTIME_NAME_SIZE - 1] = '\0';
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockPollEvent(XrInstance instance, XrEventDataBuffer* eventData) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Instance* object = Lookup<Instance>(instance);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (eventData == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (object->lostEventCount > 0) {
+        XrEventDataEventsLost lost{XR_TYPE_EVENT_DATA_EVENTS_LOST};
+        lost.lostEventCount = object->lostEventCount;
+        object->lostEventCount = 0;
+        memcpy(eventData, &lost, sizeof(lost));
+        return XR_SUCCESS;
+    }
+    if (object->events.empty()) {
+        return XR_EVENT_UNAVAILABLE;
+    }
+    *eventData = object->events.front();
+    object->events.pop_front();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockResultToString(XrInstance instance, XrResult value, char buffer[XR_MAX_RESULT_STRING_SIZE]) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    const char* name = to_string(value);
+    if (strncmp(name, "Unknown", 7) == 0) {
+        snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, XR_SUCCEEDED(value) ? "XR_UNKNOWN_SUCCESS_%d" : "XR_UNKNOWN_FAILURE_%d",
+                 (int)value);
+    } else {
+        snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "%s", name);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockStructureTypeToString(XrInstance instance, XrStructureType value,
+                                                         char buffer[XR_MAX_STRUCTURE_NAME_SIZE]) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    const char* name = to_string(value);
+    if (strncmp(name, "Unknown", 7) == 0) {
+        snprintf(buffer, XR_MAX_STRUCTURE_NAME_SIZE, "XR_UNKNOWN_STRUCTURE_TYPE_%d", (int)value);
+    } else {
+        snprintf(buffer, XR_MAX_STRUCTURE_NAME_SIZE, "%s", name);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (getInfo == nullptr || getInfo->type != XR_TYPE_SYSTEM_GET_INFO || systemId == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (getInfo->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY) {
+        return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+    }
+    *systemId = MockSystemId;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetSystemProperties(XrInstance instance, XrSystemId systemId, XrSystemProperties* properties) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (properties == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    properties->systemId = systemId;
+    properties->vendorId = 0;
+    strncpy(properties->systemName, SystemName, XR_MAX_SYSTEM_NAME_SIZE - 1);
+    properties->systemName[XR_MAX_SYSTEM_NAME_SIZE - 1] = '\0';
+    properties->graphicsProperties.maxSwapchainImageWidth = MaxSwapchainSize;
+    properties->graphicsProperties.maxSwapchainImageHeight = MaxSwapchainSize;
+    properties->graphicsProperties.maxLayerCount = MaxLayerCount;
+    properties->trackingProperties.orientationTracking = XR_TRUE;
+    properties->trackingProperties.positionTracking = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateEnvironmentBlendModes(XrInstance instance, XrSystemId systemId,
+                                                                  XrViewConfigurationType viewConfigurationType,
+                                                                  uint32_t environmentBlendModeCapacityInput,
+                                                                  uint32_t* environmentBlendModeCountOutput,
+                                                                  XrEnvironmentBlendMode* environmentBlendModes) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (!IsSupportedViewConfiguration(viewConfigurationType)) {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    // Nothing is displayed, so every blend mode is as good as any other.
+    return WriteArray((uint32_t)ArraySize(BlendModes), environmentBlendModeCapacityInput, environmentBlendModeCountOutput,
+                      environmentBlendModes, [](XrEnvironmentBlendMode& mode, uint32_t i) { mode = BlendModes[i]; });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateViewConfigurations(XrInstance instance, XrSystemId systemId,
+                                                               uint32_t viewConfigurationTypeCapacityInput,
+                                                               uint32_t* viewConfigurationTypeCountOutput,
+                                                               XrViewConfigurationType* viewConfigurationTypes) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    const XrViewConfigurationType types[] = {XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_MONO};
+    return WriteArray(2, viewConfigurationTypeCapacityInput, viewConfigurationTypeCountOutput, viewConfigurationTypes,
+                      [&](XrViewConfigurationType& type, uint32_t i) { type = types[i]; });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetViewConfigurationProperties(XrInstance instance, XrSystemId systemId,
+                                                                  XrViewConfigurationType viewConfigurationType,
+                                                                  XrViewConfigurationProperties* configurationProperties) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (!IsSupportedViewConfiguration(viewConfigurationType)) {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    if (configurationProperties == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    configurationProperties->viewConfigurationType = viewConfigurationType;
+    configurationProperties->fovMutable = XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateViewConfigurationViews(XrInstance instance, XrSystemId systemId,
+                                                                   XrViewConfigurationType viewConfigurationType,
+                                                                   uint32_t viewCapacityInput, uint32_t* viewCountOutput,
+                                                                   XrViewConfigurationView* views) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (!IsSupportedViewConfiguration(viewConfigurationType)) {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    return WriteArray(ViewCount(viewConfigurationType), viewCapacityInput, viewCountOutput, views,
+                      [](XrViewConfigurationView& view, uint32_t) {
+                          view.recommendedImageRectWidth = g_runtime.settings.viewWidth;
+                          view.maxImageRectWidth = MaxSwapchainSize;
+                          view.recommendedImageRectHeight = g_runtime.settings.viewHeight;
+                          view.maxImageRectHeight = MaxSwapchainSize;
+                          view.recommendedSwapchainSampleCount = 1;
+                          view.maxSwapchainSampleCount = MaxSampleCount;
+                      });
+}
+
+//
+// Paths.
+//
+
+XRAPI_ATTR XrResult XRAPI_CALL MockStringToPath(XrInstance instance, const char* pathString, XrPath* path) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Instance* object = Lookup<Instance>(instance);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (path == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!IsWellFormedPath(pathString)) {
+        return XR_ERROR_PATH_FORMAT_INVALID;
+    }
+    *path = InternPath(*object, pathString);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockPathToString(XrInstance instance, XrPath path, uint32_t bufferCapacityInput,
+                                                uint32_t* bufferCountOutput, char* buffer) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Instance* object = Lookup<Instance>(instance);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    const std::string* pathString = PathString(*object, path);
+    if (pathString == nullptr) {
+        return XR_ERROR_PATH_INVALID;
+    }
+    return WriteString(*pathString, bufferCapacityInput, bufferCountOutput, buffer);
+}
+
+//
+// Sessions and the frame loop.
+//
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateSession(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session) {
+    return Guarded("xrCreateSession", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Instance* object = Lookup<Instance>(instance);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (createInfo == nullptr || createInfo->type != XR_TYPE_SESSION_CREATE_INFO || session == nullptr) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (!IsValidSystem(createInfo->systemId)) {
+            return XR_ERROR_SYSTEM_INVALID;
+        }
+        if (object->session != nullptr) {
+            return XR_ERROR_LIMIT_REACHED;
+        }
+
+        std::unique_ptr<Session> newSession(new Session(object));
+        const XrResult result = CreateGraphicsBinding(*createInfo, object->extensions, &newSession->binding);
+        if (XR_FAILED(result)) {
+            return result;
+        }
+        object->session = std::move(newSession);
+        *session = ToHandle<XrSession>(object->session.get());
+
+        SetSessionState(*object->session, XR_SESSION_STATE_IDLE);
+        SetSessionState(*object->session, XR_SESSION_STATE_READY);
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroySession(XrSession session) {
+    return Guarded("xrDestroySession", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Session* object = Lookup<Session>(session);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        object->instance->session.reset();
+        g_frameCondition.notify_all();
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockBeginSession(XrSession session, const XrSessionBeginInfo* beginInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (beginInfo == nullptr || beginInfo->type != XR_TYPE_SESSION_BEGIN_INFO) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!IsSupportedViewConfiguration(beginInfo->primaryViewConfigurationType)) {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    if (object->running) {
+        return XR_ERROR_SESSION_RUNNING;
+    }
+    if (object->state != XR_SESSION_STATE_READY) {
+        return XR_ERROR_SESSION_NOT_READY;
+    }
+
+    object->running = true;
+    object->exitRequested = false;
+    object->viewConfigurationType = beginInfo->primaryViewConfigurationType;
+    object->epoch = Now();
+    object->lastDisplaySlot = 0;
+    object->lastPredictedDisplayTime = object->epoch;
+    object->waitedFrames = 0;
+    object->begunFrames = 0;
+    object->endedFrames = 0;
+    object->frameInProgress = false;
+    // Visible and focused once the first frame was submitted.
+    SetSessionState(*object, XR_SESSION_STATE_SYNCHRONIZED);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEndSession(XrSession session) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!object->running) {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    if (object->state != XR_SESSION_STATE_STOPPING) {
+        return XR_ERROR_SESSION_NOT_STOPPING;
+    }
+
+    object->running = false;
+    object->actionsActive = false;
+    g_frameCondition.notify_all();
+    SetSessionState(*object, XR_SESSION_STATE_IDLE);
+    SetSessionState(*object, object->exitRequested ? XR_SESSION_STATE_EXITING : XR_SESSION_STATE_READY);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockRequestExitSession(XrSession session) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!object->running) {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    StopSession(*object);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
+    std::unique_lock<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if ((frameWaitInfo != nullptr && frameWaitInfo->type != XR_TYPE_FRAME_WAIT_INFO) || frameState == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!object->running) {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+
+    // The session may end or be destroyed by another thread while this one waits.
+    const auto stopped = [&] { return Lookup<Session>(session) != object || !object->running; };
+
+    // A frame may only be waited for once the one waited for before it has begun.
+    g_frameCondition.wait(lock, [&] { return stopped() || object->begunFrames == object->waitedFrames; });
+    if (stopped()) {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+
+    const XrDuration period = DisplayPeriod();
+    int64_t slot = object->lastDisplaySlot + 1;
+    if (g_runtime.settings.refreshRate > 0.0) {
+        // Like a compositor that wakes the application at the start of the display period before the one the frame is
+        // shown at. Frames that started too late skip display periods.
+        const XrTime now = Now();
+        slot = std::max<int64_t>(slot, (now - object->epoch) / period + 1);
+        const XrTime wakeTime = object->epoch + (slot - 1) * period;
+        if (wakeTime > now) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(wakeTime - now);
+            g_frameCondition.wait_until(lock, deadline, stopped);
+            if (stopped()) {
+                return XR_ERROR_SESSION_NOT_RUNNING;
+            }
+        }
+    }
+
+    object->lastDisplaySlot = slot;
+    object->lastPredictedDisplayTime = object->epoch + slot * period;
+    object->waitedFrames++;
+    frameState->predictedDisplayTime = object->lastPredictedDisplayTime;
+    frameState->predictedDisplayPeriod = period;
+    frameState->shouldRender =
+        object->state == XR_SESSION_STATE_VISIBLE || object->state == XR_SESSION_STATE_FOCUSED ? XR_TRUE : XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (frameBeginInfo != nullptr && frameBeginInfo->type != XR_TYPE_FRAME_BEGIN_INFO) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!object->running) {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    if (object->begunFrames == object->waitedFrames) {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+
+    const bool discarded = object->frameInProgress;
+    object->frameInProgress = true;
+    object->begunFrames++;
+    g_frameCondition.notify_all();
+    return discarded ? XR_FRAME_DISCARDED : XR_SUCCESS;
+}
+
+XrResult ValidateSubImage(const XrSwapchainSubImage& subImage) {
+    const Swapchain* swapchain = Lookup<Swapchain>(subImage.swapchain);
+    if (swapchain == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!swapchain->released) {
+        return XR_ERROR_LAYER_INVALID;
+    }
+    if (subImage.imageArrayIndex >= swapchain->createInfo.arraySize) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    const XrRect2Di& rect = subImage.imageRect;
+    if (rect.offset.x < 0 || rect.offset.y < 0 || rect.extent.width <= 0 || rect.extent.height <= 0 ||
+        rect.offset.x + rect.extent.width > (int32_t)swapchain->createInfo.width ||
+        rect.offset.y + rect.extent.height > (int32_t)swapchain->createInfo.height) {
+        return XR_ERROR_SWAPCHAIN_RECT_INVALID;
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (frameEndInfo == nullptr || frameEndInfo->type != XR_TYPE_FRAME_END_INFO) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!object->running) {
+        return XR_ERROR_SESSION_NOT_RUNNING;
+    }
+    if (!object->frameInProgress) {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    if (frameEndInfo->displayTime <= 0) {
+        return XR_ERROR_TIME_INVALID;
+    }
+    if (std::find(std::begin(BlendModes), std::end(BlendModes), frameEndInfo->environmentBlendMode) == std::end(BlendModes)) {
+        return XR_ERROR_ENVIRONMENT_BLEND_MODE_UNSUPPORTED;
+    }
+    if (frameEndInfo->layerCount > MaxLayerCount) {
+        return XR_ERROR_LAYER_LIMIT_EXCEEDED;
+    }
+
+    // Nothing is composited, but the layers are checked as a compositor would read them.
+    for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+        const XrCompositionLayerBaseHeader* layer = frameEndInfo->layers[i];
+        if (layer == nullptr) {
+            return XR_ERROR_LAYER_INVALID;
+        }
+        if (Lookup<Space>(layer->space) == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+            const auto* projection = reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+            if (projection->viewCount != ViewCount(object->viewConfigurationType)) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            for (uint32_t view = 0; view < projection->viewCount; view++) {
+                const XrResult result = ValidateSubImage(projection->views[view].subImage);
+                if (XR_FAILED(result)) {
+                    return result;
+                }
+            }
+        } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+            const XrResult result = ValidateSubImage(reinterpret_cast<const XrCompositionLayerQuad*>(layer)->subImage);
+            if (XR_FAILED(result)) {
+                return result;
+            }
+        }
+    }
+
+    object->frameInProgress = false;
+    object->endedFrames++;
+    if (object->state == XR_SESSION_STATE_SYNCHRONIZED && !object->exitRequested) {
+        SetSessionState(*object, XR_SESSION_STATE_VISIBLE);
+        SetSessionState(*object, XR_SESSION_STATE_FOCUSED);
+    }
+    if (g_runtime.settings.exitAfterFrames != 0 && object->endedFrames == g_runtime.settings.exitAfterFrames) {
+        Log::Write(Log::Level::Info, Fmt("Mock runtime: stopping the session after %llu frames",
+                                         (unsigned long long)g_runtime.settings.exitAfterFrames));
+        StopSession(*object);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockLocateViews(XrSession session, const XrViewLocateInfo* viewLocateInfo, XrViewState* viewState,
+                                               uint32_t viewCapacityInput, uint32_t* viewCountOutput, XrView* views) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (viewLocateInfo == nullptr || viewLocateInfo->type != XR_TYPE_VIEW_LOCATE_INFO || viewState == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!IsSupportedViewConfiguration(viewLocateInfo->viewConfigurationType)) {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    if (viewLocateInfo->displayTime <= 0) {
+        return XR_ERROR_TIME_INVALID;
+    }
+    const Space* baseSpace = Lookup<Space>(viewLocateInfo->space);
+    if (baseSpace == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+
+    const XrViewConfigurationType type = viewLocateInfo->viewConfigurationType;
+    const XrTime time = viewLocateInfo->displayTime;
+    const XrPosef stageToBase = PoseMath::Invert(SpaceToStage(*baseSpace, time));
+    const XrPosef head = DevicePose(*object, MockDevice::Head, time);
+    viewState->viewStateFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT |
+                                XR_VIEW_STATE_ORIENTATION_TRACKED_BIT | XR_VIEW_STATE_POSITION_TRACKED_BIT;
+    return WriteArray(ViewCount(type), viewCapacityInput, viewCountOutput, views, [&](XrView& view, uint32_t i) {
+        XrPosef eye = PoseMath::Identity();
+        if (type == XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+            eye.position.x = (i == 0 ? -0.5f : 0.5f) * InterpupillaryDistance;
+        }
+        view.pose = PoseMath::Multiply(stageToBase, PoseMath::Multiply(head, eye));
+        view.fov = ViewFov(type, i);
+    });
+}
+
+//
+// Spaces.
+//
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateReferenceSpaces(XrSession session, uint32_t spaceCapacityInput,
+                                                            uint32_t* spaceCountOutput, XrReferenceSpaceType* spaces) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Session>(session) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    const XrReferenceSpaceType types[] = {XR_REFERENCE_SPACE_TYPE_VIEW, XR_REFERENCE_SPACE_TYPE_LOCAL,
+                                          XR_REFERENCE_SPACE_TYPE_STAGE};
+    return WriteArray(3, spaceCapacityInput, spaceCountOutput, spaces,
+                      [&](XrReferenceSpaceType& type, uint32_t i) { type = types[i]; });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateReferenceSpace(XrSession session, const XrReferenceSpaceCreateInfo* createInfo,
+                                                        XrSpace* space) {
+    return Guarded("xrCreateReferenceSpace", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Session* object = Lookup<Session>(session);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (createInfo == nullptr || createInfo->type != XR_TYPE_REFERENCE_SPACE_CREATE_INFO || space == nullptr) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        const XrReferenceSpaceType type = createInfo->referenceSpaceType;
+        if (type != XR_REFERENCE_SPACE_TYPE_VIEW && type != XR_REFERENCE_SPACE_TYPE_LOCAL &&
+            type != XR_REFERENCE_SPACE_TYPE_STAGE) {
+            return XR_ERROR_REFERENCE_SPACE_UNSUPPORTED;
+        }
+
+        std::unique_ptr<Space> newSpace(new Space(object));
+        newSpace->referenceSpaceType = type;
+        newSpace->offset = createInfo->poseInReferenceSpace;
+        *space = ToHandle<XrSpace>(newSpace.get());
+        object->spaces.push_back(std::move(newSpace));
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetReferenceSpaceBoundsRect(XrSession session, XrReferenceSpaceType referenceSpaceType,
+                                                               XrExtent2Df* bounds) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Session>(session) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (bounds == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (referenceSpaceType == XR_REFERENCE_SPACE_TYPE_STAGE) {
+        *bounds = {3.0f, 3.0f};
+        return XR_SUCCESS;
+    }
+    *bounds = {0.0f, 0.0f};
+    return XR_SPACE_BOUNDS_UNAVAILABLE;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateActionSpace(XrSession session, const XrActionSpaceCreateInfo* createInfo, XrSpace* space) {
+    return Guarded("xrCreateActionSpace", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Session* object = Lookup<Session>(session);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (createInfo == nullptr || createInfo->type != XR_TYPE_ACTION_SPACE_CREATE_INFO || space == nullptr) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        const Action* action = Lookup<Action>(createInfo->action);
+        if (action == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (action->actionType != XR_ACTION_TYPE_POSE_INPUT) {
+            return XR_ERROR_ACTION_TYPE_MISMATCH;
+        }
+        const XrPath subactionPath = createInfo->subactionPath;
+        if (subactionPath != XR_NULL_PATH && std::find(action->subactionPaths.begin(), action->subactionPaths.end(),
+                                                       subactionPath) == action->subactionPaths.end()) {
+            return XR_ERROR_PATH_UNSUPPORTED;
+        }
+
+        std::unique_ptr<Space> newSpace(new Space(object));
+        newSpace->isActionSpace = true;
+        newSpace->hand = subactionPath == object->instance->rightHandPath ? MockDevice::RightHand : MockDevice::LeftHand;
+        newSpace->offset = createInfo->poseInActionSpace;
+        *space = ToHandle<XrSpace>(newSpace.get());
+        object->spaces.push_back(std::move(newSpace));
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Space* object = Lookup<Space>(space);
+    const Space* baseObject = Lookup<Space>(baseSpace);
+    if (object == nullptr || baseObject == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (location == nullptr || location->type != XR_TYPE_SPACE_LOCATION) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (time <= 0) {
+        return XR_ERROR_TIME_INVALID;
+    }
+    location->locationFlags = LocateSpace(*object, *baseObject, time, &location->pose);
+    for (auto* next = reinterpret_cast<XrBaseOutStructure*>(location->next); next != nullptr; next = next->next) {
+        if (next->type == XR_TYPE_SPACE_VELOCITY) {
+            reinterpret_cast<XrSpaceVelocity*>(next)->velocityFlags = 0;
+        }
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockLocateSpacesKHR(XrSession session, const XrSpacesLocateInfoKHR* locateInfo,
+                                                   XrSpaceLocationsKHR* spaceLocations) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Session>(session) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (locateInfo == nullptr || locateInfo->type != XR_TYPE_SPACES_LOCATE_INFO_KHR || spaceLocations == nullptr ||
+        spaceLocations->type != XR_TYPE_SPACE_LOCATIONS_KHR || spaceLocations->locationCount != locateInfo->spaceCount) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (locateInfo->time <= 0) {
+        return XR_ERROR_TIME_INVALID;
+    }
+    const Space* baseSpace = Lookup<Space>(locateInfo->baseSpace);
+    if (baseSpace == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    for (uint32_t i = 0; i < locateInfo->spaceCount; i++) {
+        const Space* space = Lookup<Space>(locateInfo->spaces[i]);
+        if (space == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        XrSpaceLocationDataKHR& location = spaceLocations->locations[i];
+        location.locationFlags = LocateSpace(*space, *baseSpace, locateInfo->time, &location.pose);
+    }
+    for (auto* next = reinterpret_cast<XrBaseOutStructure*>(spaceLocations->next); next != nullptr; next = next->next) {
+        if (next->type == XR_TYPE_SPACE_VELOCITIES_KHR) {
+            auto* velocities = reinterpret_cast<XrSpaceVelocitiesKHR*>(next);
+            for (uint32_t i = 0; i < velocities->velocityCount; i++) {
+                velocities->velocities[i].velocityFlags = 0;
+            }
+        }
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroySpace(XrSpace space) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Space* object = Lookup<Space>(space);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    std::vector<std::unique_ptr<Space>>& spaces = object->session->spaces;
+    spaces.erase(std::find_if(spaces.begin(), spaces.end(), [&](const std::unique_ptr<Space>& s) { return s.get() == object; }));
+    return XR_SUCCESS;
+}
+
+//
+// Swapchains.
+//
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateSwapchainFormats(XrSession session, uint32_t formatCapacityInput,
+                                                             uint32_t* formatCountOutput, int64_t* formats) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    // Headless sessions have no swapchains.
+    const std::vector<int64_t> supported =
+        object->binding != nullptr ? object->binding->SwapchainFormats() : std::vector<int64_t>{};
+    return WriteArray((uint32_t)supported.size(), formatCapacityInput, formatCountOutput, formats,
+                      [&](int64_t& format, uint32_t i) { format = supported[i]; });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateSwapchain(XrSession session, const XrSwapchainCreateInfo* createInfo,
+                                                   XrSwapchain* swapchain) {
+    return Guarded("xrCreateSwapchain", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Session* object = Lookup<Session>(session);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (createInfo == nullptr || createInfo->type != XR_TYPE_SWAPCHAIN_CREATE_INFO || swapchain == nullptr ||
+            createInfo->width == 0 || createInfo->height == 0 || createInfo->faceCount == 0 || createInfo->arraySize == 0 ||
+            createInfo->mipCount == 0 || createInfo->sampleCount == 0) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (object->binding == nullptr) {
+            return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+        }
+        if (createInfo->width > MaxSwapchainSize || createInfo->height > MaxSwapchainSize ||
+            createInfo->sampleCount > MaxSampleCount) {
+            return XR_ERROR_FEATURE_UNSUPPORTED;
+        }
+
+        std::unique_ptr<Swapchain> newSwapchain(new Swapchain(object, *createInfo));
+        const XrResult result = object->binding->CreateSwapchainImages(*createInfo, SwapchainImageCount, &newSwapchain->images);
+        if (XR_FAILED(result)) {
+            return result;
+        }
+        *swapchain = ToHandle<XrSwapchain>(newSwapchain.get());
+        object->swapchains.push_back(std::move(newSwapchain));
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroySwapchain(XrSwapchain swapchain) {
+    return Guarded("xrDestroySwapchain", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Swapchain* object = Lookup<Swapchain>(swapchain);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        std::vector<std::unique_ptr<Swapchain>>& swapchains = object->session->swapchains;
+        swapchains.erase(std::find_if(swapchains.begin(), swapchains.end(),
+                                      [&](const std::unique_ptr<Swapchain>& s) { return s.get() == object; }));
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateSwapchainImages(XrSwapchain swapchain, uint32_t imageCapacityInput,
+                                                            uint32_t* imageCountOutput, XrSwapchainImageBaseHeader* images) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Swapchain* object = Lookup<Swapchain>(swapchain);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (imageCountOutput == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *imageCountOutput = object->images->Count();
+    if (imageCapacityInput == 0) {
+        return XR_SUCCESS;
+    }
+    if (imageCapacityInput < *imageCountOutput) {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    if (images == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    return object->images->Enumerate(images);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockAcquireSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageAcquireInfo* acquireInfo,
+                                                         uint32_t* index) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Swapchain* object = Lookup<Swapchain>(swapchain);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if ((acquireInfo != nullptr && acquireInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO) || index == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (object->acquired.size() == object->images->Count()) {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    *index = object->nextImage;
+    object->acquired.push_back(object->nextImage);
+    object->nextImage = (object->nextImage + 1) % object->images->Count();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Swapchain* object = Lookup<Swapchain>(swapchain);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (waitInfo == nullptr || waitInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (object->acquired.empty() || object->waited) {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    // Nothing ever reads the images, so they are always ready.
+    object->waited = true;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Swapchain* object = Lookup<Swapchain>(swapchain);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (releaseInfo != nullptr && releaseInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!object->waited) {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    object->acquired.pop_front();
+    object->waited = false;
+    object->released = true;
+    return XR_SUCCESS;
+}
+
+//
+// Actions.
+//
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateActionSet(XrInstance instance, const XrActionSetCreateInfo* createInfo,
+                                                   XrActionSet* actionSet) {
+    return Guarded("xrCreateActionSet", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Instance* object = Lookup<Instance>(instance);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (createInfo == nullptr || createInfo->type != XR_TYPE_ACTION_SET_CREATE_INFO || actionSet == nullptr) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (createInfo->actionSetName[0] == '\0') {
+            return XR_ERROR_NAME_INVALID;
+        }
+        if (std::any_of(object->actionSets.begin(), object->actionSets.end(),
+                        [&](const std::unique_ptr<ActionSet>& set) { return set->name == createInfo->actionSetName; })) {
+            return XR_ERROR_NAME_DUPLICATED;
+        }
+
+        object->actionSets.emplace_back(new ActionSet(object, *createInfo));
+        *actionSet = ToHandle<XrActionSet>(object->actionSets.back().get());
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroyActionSet(XrActionSet actionSet) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    ActionSet* object = Lookup<ActionSet>(actionSet);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    std::vector<std::unique_ptr<ActionSet>>& actionSets = object->instance->actionSets;
+    actionSets.erase(std::find_if(actionSets.begin(), actionSets.end(),
+                                  [&](const std::unique_ptr<ActionSet>& set) { return set.get() == object; }));
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateAction(XrActionSet actionSet, const XrActionCreateInfo* createInfo, XrAction* action) {
+    return Guarded("xrCreateAction", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        ActionSet* object = Lookup<ActionSet>(actionSet);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (createInfo == nullptr || createInfo->type != XR_TYPE_ACTION_CREATE_INFO || action == nullptr ||
+            (createInfo->countSubactionPaths != 0 && createInfo->subactionPaths == nullptr)) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (object->attached) {
+            return XR_ERROR_ACTIONSETS_ALREADY_ATTACHED;
+        }
+        if (createInfo->actionName[0] == '\0') {
+            return XR_ERROR_NAME_INVALID;
+        }
+        if (std::any_of(object->actions.begin(), object->actions.end(),
+                        [&](const std::unique_ptr<Action>& a) { return a->name == createInfo->actionName; })) {
+            return XR_ERROR_NAME_DUPLICATED;
+        }
+        for (uint32_t i = 0; i < createInfo->countSubactionPaths; i++) {
+            if (PathString(*object->instance, createInfo->subactionPaths[i]) == nullptr) {
+                return XR_ERROR_PATH_INVALID;
+            }
+            if (!IsHandPath(*object->instance, createInfo->subactionPaths[i])) {
+                return XR_ERROR_PATH_UNSUPPORTED;
+            }
+        }
+
+        object->actions.emplace_back(new Action(object, *createInfo));
+        *action = ToHandle<XrAction>(object->actions.back().get());
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockDestroyAction(XrAction action) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Action* object = Lookup<Action>(action);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    std::vector<std::unique_ptr<Action>>& actions = object->actionSet->actions;
+    actions.erase(
+        std::find_if(actions.begin(), actions.end(), [&](const std::unique_ptr<Action>& a) { return a.get() == object; }));
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+MockSuggestInteractionProfileBindings(XrInstance instance, const XrInteractionProfileSuggestedBinding* suggestedBindings) {
+    return Guarded("xrSuggestInteractionProfileBindings", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        Instance* object = Lookup<Instance>(instance);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (suggestedBindings == nullptr || suggestedBindings->type != XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING ||
+            suggestedBindings->countSuggestedBindings == 0 || suggestedBindings->suggestedBindings == nullptr) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (object->session != nullptr && object->session->actionSetsAttached) {
+            return XR_ERROR_ACTIONSETS_ALREADY_ATTACHED;
+        }
+        if (PathString(*object, suggestedBindings->interactionProfile) == nullptr) {
+            return XR_ERROR_PATH_INVALID;
+        }
+        const XrActionSuggestedBinding* suggested = suggestedBindings->suggestedBindings;
+        std::vector<XrActionSuggestedBinding> bindings(suggested, suggested + suggestedBindings->countSuggestedBindings);
+        for (const XrActionSuggestedBinding& binding : bindings) {
+            if (Lookup<Action>(binding.action) == nullptr) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (PathString(*object, binding.binding) == nullptr) {
+                return XR_ERROR_PATH_INVALID;
+            }
+        }
+
+        // The mock controllers accept every profile and binding.
+        const XrPath profile = suggestedBindings->interactionProfile;
+        if (object->suggestedBindings.count(profile) == 0) {
+            object->suggestedProfiles.push_back(profile);
+        }
+        object->suggestedBindings[profile] = std::move(bindings);
+        return XR_SUCCESS;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockAttachSessionActionSets(XrSession session, const XrSessionActionSetsAttachInfo* attachInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (attachInfo == nullptr || attachInfo->type != XR_TYPE_SESSION_ACTION_SETS_ATTACH_INFO || attachInfo->countActionSets == 0) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (object->actionSetsAttached) {
+        return XR_ERROR_ACTIONSETS_ALREADY_ATTACHED;
+    }
+    for (uint32_t i = 0; i < attachInfo->countActionSets; i++) {
+        if (Lookup<ActionSet>(attachInfo->actionSets[i]) == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+    }
+
+    for (uint32_t i = 0; i < attachInfo->countActionSets; i++) {
+        Lookup<ActionSet>(attachInfo->actionSets[i])->attached = true;
+    }
+    object->actionSetsAttached = true;
+    const Instance& instance = *object->instance;
+    if (!instance.suggestedProfiles.empty()) {
+        object->interactionProfile = instance.suggestedProfiles.front();
+        XrEventDataInteractionProfileChanged event{XR_TYPE_EVENT_DATA_INTERACTION_PROFILE_CHANGED};
+        event.session = session;
+        PushEvent(*object->instance, &event, sizeof(event));
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetCurrentInteractionProfile(XrSession session, XrPath topLevelUserPath,
+                                                                XrInteractionProfileState* interactionProfile) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (interactionProfile == nullptr || interactionProfile->type != XR_TYPE_INTERACTION_PROFILE_STATE) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (PathString(*object->instance, topLevelUserPath) == nullptr) {
+        return XR_ERROR_PATH_INVALID;
+    }
+    if (!object->actionSetsAttached) {
+        return XR_ERROR_ACTIONSET_NOT_ATTACHED;
+    }
+    interactionProfile->interactionProfile =
+        IsHandPath(*object->instance, topLevelUserPath) ? object->interactionProfile : XR_NULL_PATH;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockSyncActions(XrSession session, const XrActionsSyncInfo* syncInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (syncInfo == nullptr || syncInfo->type != XR_TYPE_ACTIONS_SYNC_INFO ||
+        (syncInfo->countActiveActionSets != 0 && syncInfo->activeActionSets == nullptr)) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    for (uint32_t i = 0; i < syncInfo->countActiveActionSets; i++) {
+        const ActionSet* actionSet = Lookup<ActionSet>(syncInfo->activeActionSets[i].actionSet);
+        if (actionSet == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!actionSet->attached) {
+            return XR_ERROR_ACTIONSET_NOT_ATTACHED;
+        }
+    }
+
+    // Sample the script at the frame being rendered, not the wall clock, so actions are as reproducible as poses.
+    object->previousSyncTime = object->syncTime;
+    object->syncTime = object->lastPredictedDisplayTime;
+    const bool focused = object->state == XR_SESSION_STATE_FOCUSED;
+    object->actionsActive = focused && syncInfo->countActiveActionSets > 0;
+    return focused ? XR_SUCCESS : XR_SESSION_NOT_FOCUSED;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStateBoolean(XrSession session, const XrActionStateGetInfo* getInfo,
+                                                         XrActionStateBoolean* state) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (state == nullptr || state->type != XR_TYPE_ACTION_STATE_BOOLEAN) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    Action* action;
+    const XrResult result = GetActionForState(getInfo, XR_ACTION_TYPE_BOOLEAN_INPUT, &action);
+    if (XR_FAILED(result)) {
+        return result;
+    }
+    // Buttons are never pressed: the only button hello_xr binds quits.
+    state->currentState = XR_FALSE;
+    state->changedSinceLastSync = XR_FALSE;
+    state->lastChangeTime = 0;
+    state->isActive = object->actionsActive ? XR_TRUE : XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStateFloat(XrSession session, const XrActionStateGetInfo* getInfo,
+                                                       XrActionStateFloat* state) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (state == nullptr || state->type != XR_TYPE_ACTION_STATE_FLOAT) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    Action* action;
+    const XrResult result = GetActionForState(getInfo, XR_ACTION_TYPE_FLOAT_INPUT, &action);
+    if (XR_FAILED(result)) {
+        return result;
+    }
+    if (!object->actionsActive) {
+        *state = {XR_TYPE_ACTION_STATE_FLOAT, state->next};
+        return XR_SUCCESS;
+    }
+    const float previous = Squeeze(*object, getInfo->subactionPath, object->previousSyncTime);
+    state->currentState = Squeeze(*object, getInfo->subactionPath, object->syncTime);
+    state->changedSinceLastSync = state->currentState != previous ? XR_TRUE : XR_FALSE;
+    state->lastChangeTime = object->syncTime;
+    state->isActive = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStateVector2f(XrSession session, const XrActionStateGetInfo* getInfo,
+                                                          XrActionStateVector2f* state) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (state == nullptr || state->type != XR_TYPE_ACTION_STATE_VECTOR2F) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    Action* action;
+    const XrResult result = GetActionForState(getInfo, XR_ACTION_TYPE_VECTOR2F_INPUT, &action);
+    if (XR_FAILED(result)) {
+        return result;
+    }
+    state->currentState = {0.0f, 0.0f};
+    state->changedSinceLastSync = XR_FALSE;
+    state->lastChangeTime = 0;
+    state->isActive = object->actionsActive ? XR_TRUE : XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetActionStatePose(XrSession session, const XrActionStateGetInfo* getInfo,
+                                                      XrActionStatePose* state) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (state == nullptr || state->type != XR_TYPE_ACTION_STATE_POSE) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    Action* action;
+    const XrResult result = GetActionForState(getInfo, XR_ACTION_TYPE_POSE_INPUT, &action);
+    if (XR_FAILED(result)) {
+        return result;
+    }
+    state->isActive = object->actionsActive ? XR_TRUE : XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockEnumerateBoundSourcesForAction(XrSession session,
+                                                                  const XrBoundSourcesForActionEnumerateInfo* enumerateInfo,
+                                                                  uint32_t sourceCapacityInput, uint32_t* sourceCountOutput,
+                                                                  XrPath* sources) {
+    return Guarded("xrEnumerateBoundSourcesForAction", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        const Session* object = Lookup<Session>(session);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (enumerateInfo == nullptr || enumerateInfo->type != XR_TYPE_BOUND_SOURCES_FOR_ACTION_ENUMERATE_INFO) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        const Action* action = Lookup<Action>(enumerateInfo->action);
+        if (action == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!action->actionSet->attached) {
+            return XR_ERROR_ACTIONSET_NOT_ATTACHED;
+        }
+
+        std::vector<XrPath> bound;
+        const auto bindings = object->instance->suggestedBindings.find(object->interactionProfile);
+        if (bindings != object->instance->suggestedBindings.end()) {
+            for (const XrActionSuggestedBinding& binding : bindings->second) {
+                if (Lookup<Action>(binding.action) == action &&
+                    std::find(bound.begin(), bound.end(), binding.binding) == bound.end()) {
+                    bound.push_back(binding.binding);
+                }
+            }
+        }
+        return WriteArray((uint32_t)bound.size(), sourceCapacityInput, sourceCountOutput, sources,
+                          [&](XrPath& source, uint32_t i) { source = bound[i]; });
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInputSourceLocalizedName(XrSession session, const XrInputSourceLocalizedNameGetInfo* getInfo,
+                                                               uint32_t bufferCapacityInput, uint32_t* bufferCountOutput,
+                                                               char* buffer) {
+    return Guarded("xrGetInputSourceLocalizedName", [&] {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        const Session* object = Lookup<Session>(session);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (getInfo == nullptr || getInfo->type != XR_TYPE_INPUT_SOURCE_LOCALIZED_NAME_GET_INFO || getInfo->whichComponents == 0) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        const std::string* source = PathString(*object->instance, getInfo->sourcePath);
+        if (source == nullptr) {
+            return XR_ERROR_PATH_INVALID;
+        }
+
+        // E.g. "/user/hand/left/input/select/click" is "Left Hand Mock Controller select click".
+        std::vector<std::string> parts;
+        if ((getInfo->whichComponents & XR_INPUT_SOURCE_LOCALIZED_NAME_USER_PATH_BIT) != 0) {
+            parts.push_back(source->compare(0, 15, "/user/hand/left") == 0 ? "Left Hand" : "Right Hand");
+        }
+        if ((getInfo->whichComponents & XR_INPUT_SOURCE_LOCALIZED_NAME_INTERACTION_PROFILE_BIT) != 0) {
+            parts.push_back("Mock Controller");
+        }
+        if ((getInfo->whichComponents & XR_INPUT_SOURCE_LOCALIZED_NAME_COMPONENT_BIT) != 0) {
+            std::string component = *source;
+            for (const char* identifier : {"/input/", "/output/"}) {
+                const size_t start = component.find(identifier);
+                if (start != std::string::npos) {
+                    component = component.substr(start + strlen(identifier));
+                    break;
+                }
+            }
+            std::replace(component.begin(), component.end(), '/', ' ');
+            parts.push_back(component);
+        }
+
+        std::string name;
+        for (const std::string& part : parts) {
+            name += (name.empty() ? "" : " ") + part;
+        }
+        return WriteString(name, bufferCapacityInput, bufferCountOutput, buffer);
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockApplyHapticFeedback(XrSession session, const XrHapticActionInfo* hapticActionInfo,
+                                                       const XrHapticBaseHeader* hapticFeedback) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (hapticActionInfo == nullptr || hapticActionInfo->type != XR_TYPE_HAPTIC_ACTION_INFO || hapticFeedback == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    const Action* action = Lookup<Action>(hapticActionInfo->action);
+    if (action == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (action->actionType != XR_ACTION_TYPE_VIBRATION_OUTPUT) {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    return object->state == XR_SESSION_STATE_FOCUSED ? XR_SUCCESS : XR_SESSION_NOT_FOCUSED;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockStopHapticFeedback(XrSession session, const XrHapticActionInfo* hapticActionInfo) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Session* object = Lookup<Session>(session);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (hapticActionInfo == nullptr || hapticActionInfo->type != XR_TYPE_HAPTIC_ACTION_INFO) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    const Action* action = Lookup<Action>(hapticActionInfo->action);
+    if (action == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (action->actionType != XR_ACTION_TYPE_VIBRATION_OUTPUT) {
+        return XR_ERROR_ACTION_TYPE_MISMATCH;
+    }
+    return object->state == XR_SESSION_STATE_FOCUSED ? XR_SUCCESS : XR_SESSION_NOT_FOCUSED;
+}
+
+//
+// Extensions.
+//
+
+#if defined(XR_USE_PLATFORM_WIN32) && defined(XR_KHR_win32_convert_performance_counter_time)
+XRAPI_ATTR XrResult XRAPI_CALL MockConvertWin32PerformanceCounterToTimeKHR(XrInstance instance,
+                                                                          const LARGE_INTEGER* performanceCounter, XrTime* time) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (performanceCounter == nullptr || time == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *time = CounterToTime(performanceCounter->QuadPart, CounterFrequency());
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockConvertTimeToWin32PerformanceCounterKHR(XrInstance instance, XrTime time,
+                                                                          LARGE_INTEGER* performanceCounter) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (performanceCounter == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (time <= 0) {
+        return XR_ERROR_TIME_INVALID;
+    }
+    performanceCounter->QuadPart = TimeToCounter(time, CounterFrequency());
+    return XR_SUCCESS;
+}
+#elif defined(XR_USE_TIMESPEC) && defined(XR_KHR_convert_timespec_time)
+XRAPI_ATTR XrResult XRAPI_CALL MockConvertTimespecTimeToTimeKHR(XrInstance instance, const struct timespec* timespecTime,
+                                                                XrTime* time) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (timespecTime == nullptr || time == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *time = (XrTime)timespecTime->tv_sec * 1000000000 + timespecTime->tv_nsec;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockConvertTimeToTimespecTimeKHR(XrInstance instance, XrTime time, struct timespec* timespecTime) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (timespecTime == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (time <= 0) {
+        return XR_ERROR_TIME_INVALID;
+    }
+    timespecTime->tv_sec = (time_t)(time / 1000000000);
+    timespecTime->tv_nsec = (long)(time % 1000000000);
+    return XR_SUCCESS;
+}
+#endif
+
+#ifdef XR_USE_GRAPHICS_API_OPENGL
+XRAPI_ATTR XrResult XRAPI_CALL MockGetOpenGLGraphicsRequirementsKHR(XrInstance instance, XrSystemId systemId,
+                                                                    XrGraphicsRequirementsOpenGLKHR* graphicsRequirements) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (graphicsRequirements == nullptr || graphicsRequirements->type != XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_KHR) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    // Swapchain textures use immutable multisample storage.
+    graphicsRequirements->minApiVersionSupported = XR_MAKE_VERSION(4, 3, 0);
+    graphicsRequirements->maxApiVersionSupported = XR_MAKE_VERSION(4, 6, 0);
+    return XR_SUCCESS;
+}
+#endif
+
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+XRAPI_ATTR XrResult XRAPI_CALL MockGetVulkanGraphicsRequirementsKHR(XrInstance instance, XrSystemId systemId,
+                                                                    XrGraphicsRequirementsVulkanKHR* graphicsRequirements) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (graphicsRequirements == nullptr || graphicsRequirements->type != XR_TYPE_GRAPHICS_REQUIREMENTS_VULKAN_KHR) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    graphicsRequirements->minApiVersionSupported = XR_MAKE_VERSION(1, 0, 0);
+    graphicsRequirements->maxApiVersionSupported = XR_MAKE_VERSION(1, 3, 0);
+    return XR_SUCCESS;
+}
+
+// The runtime needs no Vulkan extensions of its own: it never presents or shares images with another process.
+XRAPI_ATTR XrResult XRAPI_CALL MockGetVulkanInstanceExtensionsKHR(XrInstance instance, XrSystemId systemId,
+                                                                  uint32_t bufferCapacityInput, uint32_t* bufferCountOutput,
+                                                                  char* buffer) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    return WriteString("", bufferCapacityInput, bufferCountOutput, buffer);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetVulkanDeviceExtensionsKHR(XrInstance instance, XrSystemId systemId,
+                                                                uint32_t bufferCapacityInput, uint32_t* bufferCountOutput,
+                                                                char* buffer) {
+    return MockGetVulkanInstanceExtensionsKHR(instance, systemId, bufferCapacityInput, bufferCountOutput, buffer);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetVulkanGraphicsDeviceKHR(XrInstance instance, XrSystemId systemId, VkInstance vkInstance,
+                                                              VkPhysicalDevice* vkPhysicalDevice) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Instance* object = Lookup<Instance>(instance);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (!IsValidSystem(systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    if (vkInstance == VK_NULL_HANDLE || vkPhysicalDevice == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    object->vkInstance = vkInstance;
+    *vkPhysicalDevice = SelectVulkanPhysicalDevice(vkInstance);
+    return *vkPhysicalDevice != VK_NULL_HANDLE ? XR_SUCCESS : XR_ERROR_RUNTIME_FAILURE;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateVulkanInstanceKHR(XrInstance instance, const XrVulkanInstanceCreateInfoKHR* createInfo,
+                                                           VkInstance* vulkanInstance, VkResult* vulkanResult) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (Lookup<Instance>(instance) == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (createInfo == nullptr || createInfo->type != XR_TYPE_VULKAN_INSTANCE_CREATE_INFO_KHR ||
+        createInfo->pfnGetInstanceProcAddr == nullptr || vulkanInstance == nullptr || vulkanResult == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!IsValidSystem(createInfo->systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    const auto createInstance =
+        reinterpret_cast<PFN_vkCreateInstance>(createInfo->pfnGetInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance"));
+    *vulkanResult = createInstance(createInfo->vulkanCreateInfo, createInfo->vulkanAllocator, vulkanInstance);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetVulkanGraphicsDevice2KHR(XrInstance instance, const XrVulkanGraphicsDeviceGetInfoKHR* getInfo,
+                                                               VkPhysicalDevice* vulkanPhysicalDevice) {
+    if (getInfo == nullptr || getInfo->type != XR_TYPE_VULKAN_GRAPHICS_DEVICE_GET_INFO_KHR) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    return MockGetVulkanGraphicsDeviceKHR(instance, getInfo->systemId, getInfo->vulkanInstance, vulkanPhysicalDevice);
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL MockCreateVulkanDeviceKHR(XrInstance instance, const XrVulkanDeviceCreateInfoKHR* createInfo,
+                                                         VkDevice* vulkanDevice, VkResult* vulkanResult) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Instance* object = Lookup<Instance>(instance);
+    if (object == nullptr) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+    if (createInfo == nullptr || createInfo->type != XR_TYPE_VULKAN_DEVICE_CREATE_INFO_KHR ||
+        createInfo->pfnGetInstanceProcAddr == nullptr || vulkanDevice == nullptr || vulkanResult == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    if (!IsValidSystem(createInfo->systemId)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    // The physical device comes from xrGetVulkanGraphicsDevice2KHR, which saw the instance.
+    if (object->vkInstance == VK_NULL_HANDLE) {
+        return XR_ERROR_CALL_ORDER_INVALID;
+    }
+    const auto createDevice =
+        reinterpret_cast<PFN_vkCreateDevice>(createInfo->pfnGetInstanceProcAddr(object->vkInstance, "vkCreateDevice"));
+    *vulkanResult = createDevice(createInfo->vulkanPhysicalDevice, createInfo->vulkanCreateInfo, createInfo->vulkanAllocator,
+                                 vulkanDevice);
+    return XR_SUCCESS;
+}
+#endif
+
+//
+// Dispatch.
+//
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+
+struct FunctionEntry {
+    const char* name;
+    PFN_xrVoidFunction function;
+    // Extension that must be enabled to get the function, or nullptr for core functions.
+    const char* extension;
+};
+
+#define MOCK_FUNCTION(name) \
+    { "xr" #name, reinterpret_cast<PFN_xrVoidFunction>(Mock##name), nullptr }
+#define MOCK_EXTENSION_FUNCTION(name, extension) \
+    { "xr" #name, reinterpret_cast<PFN_xrVoidFunction>(Mock##name), extension }
+
+const FunctionEntry Functions[] = {
+    MOCK_FUNCTION(GetInstanceProcAddr),
+    MOCK_FUNCTION(EnumerateApiLayerProperties),
+    MOCK_FUNCTION(EnumerateInstanceExtensionProperties),
+    MOCK_FUNCTION(CreateInstance),
+    MOCK_FUNCTION(DestroyInstance),
+    MOCK_FUNCTION(GetInstanceProperties),
+    MOCK_FUNCTION(PollEvent),
+    MOCK_FUNCTION(ResultToString),
+    MOCK_FUNCTION(StructureTypeToString),
+    MOCK_FUNCTION(GetSystem),
+    MOCK_FUNCTION(GetSystemProperties),
+    MOCK_FUNCTION(EnumerateEnvironmentBlendModes),
+    MOCK_FUNCTION(CreateSession),
+    MOCK_FUNCTION(DestroySession),
+    MOCK_FUNCTION(EnumerateReferenceSpaces),
+    MOCK_FUNCTION(CreateReferenceSpace),
+    MOCK_FUNCTION(GetReferenceSpaceBoundsRect),
+    MOCK_FUNCTION(CreateActionSpace),
+    MOCK_FUNCTION(LocateSpace),
+    MOCK_FUNCTION(DestroySpace),
+    MOCK_FUNCTION(EnumerateViewConfigurations),
+    MOCK_FUNCTION(GetViewConfigurationProperties),
+    MOCK_FUNCTION(EnumerateViewConfigurationViews),
+    MOCK_FUNCTION(EnumerateSwapchainFormats),
+    MOCK_FUNCTION(CreateSwapchain),
+    MOCK_FUNCTION(DestroySwapchain),
+    MOCK_FUNCTION(EnumerateSwapchainImages),
+    MOCK_FUNCTION(AcquireSwapchainImage),
+    MOCK_FUNCTION(WaitSwapchainImage),
+    MOCK_FUNCTION(ReleaseSwapchainImage),
+    MOCK_FUNCTION(BeginSession),
+    MOCK_FUNCTION(EndSession),
+    MOCK_FUNCTION(RequestExitSession),
+    MOCK_FUNCTION(WaitFrame),
+    MOCK_FUNCTION(BeginFrame),
+    MOCK_FUNCTION(EndFrame),
+    MOCK_FUNCTION(LocateViews),
+    MOCK_FUNCTION(StringToPath),
+    MOCK_FUNCTION(PathToString),
+    MOCK_FUNCTION(CreateActionSet),
+    MOCK_FUNCTION(DestroyActionSet),
+    MOCK_FUNCTION(CreateAction),
+    MOCK_FUNCTION(DestroyAction),
+    MOCK_FUNCTION(SuggestInteractionProfileBindings),
+    MOCK_FUNCTION(AttachSessionActionSets),
+    MOCK_FUNCTION(GetCurrentInteractionProfile),
+    MOCK_FUNCTION(GetActionStateBoolean),
+    MOCK_FUNCTION(GetActionStateFloat),
+    MOCK_FUNCTION(GetActionStateVector2f),
+    MOCK_FUNCTION(GetActionStatePose),
+    MOCK_FUNCTION(SyncActions),
+    MOCK_FUNCTION(EnumerateBoundSourcesForAction),
+    MOCK_FUNCTION(GetInputSourceLocalizedName),
+    MOCK_FUNCTION(ApplyHapticFeedback),
+    MOCK_FUNCTION(StopHapticFeedback),
+    MOCK_EXTENSION_FUNCTION(LocateSpacesKHR, XR_KHR_LOCATE_SPACES_EXTENSION_NAME),
+#if defined(XR_USE_PLATFORM_WIN32) && defined(XR_KHR_win32_convert_performance_counter_time)
+    MOCK_EXTENSION_FUNCTION(ConvertWin32PerformanceCounterToTimeKHR, XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME),
+    MOCK_EXTENSION_FUNCTION(ConvertTimeToWin32PerformanceCounterKHR, XR_KHR_WIN32_CONVERT_PERFORMANCE_COUNTER_TIME_EXTENSION_NAME),
+#elif defined(XR_USE_TIMESPEC) && defined(XR_KHR_convert_timespec_time)
+    MOCK_EXTENSION_FUNCTION(ConvertTimespecTimeToTimeKHR, XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME),
+    MOCK_EXTENSION_FUNCTION(ConvertTimeToTimespecTimeKHR, XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME),
+#endif
+#ifdef XR_USE_GRAPHICS_API_OPENGL
+    MOCK_EXTENSION_FUNCTION(GetOpenGLGraphicsRequirementsKHR, XR_KHR_OPENGL_ENABLE_EXTENSION_NAME),
+#endif
+#ifdef XR_USE_GRAPHICS_API_VULKAN
+    MOCK_EXTENSION_FUNCTION(GetVulkanGraphicsRequirementsKHR, XR_KHR_VULKAN_ENABLE_EXTENSION_NAME),
+    MOCK_EXTENSION_FUNCTION(GetVulkanInstanceExtensionsKHR, XR_KHR_VULKAN_ENABLE_EXTENSION_NAME),
+    MOCK_EXTENSION_FUNCTION(GetVulkanDeviceExtensionsKHR, XR_KHR_VULKAN_ENABLE_EXTENSION_NAME),
+    MOCK_EXTENSION_FUNCTION(GetVulkanGraphicsDeviceKHR, XR_KHR_VULKAN_ENABLE_EXTENSION_NAME),
+    // XR_KHR_vulkan_enable2 shares the requirements function, under another name.
+    {"xrGetVulkanGraphicsRequirements2KHR", reinterpret_cast<PFN_xrVoidFunction>(MockGetVulkanGraphicsRequirementsKHR),
+     XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME},
+    MOCK_EXTENSION_FUNCTION(CreateVulkanInstanceKHR, XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME),
+    MOCK_EXTENSION_FUNCTION(GetVulkanGraphicsDevice2KHR, XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME),
+    MOCK_EXTENSION_FUNCTION(CreateVulkanDeviceKHR, XR_KHR_VULKAN_ENABLE2_EXTENSION_NAME),
+#endif
+};
+
+#undef MOCK_FUNCTION
+#undef MOCK_EXTENSION_FUNCTION
+
+XRAPI_ATTR XrResult XRAPI_CALL MockGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+    if (name == nullptr || function == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *function = nullptr;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const Instance* object = nullptr;
+    if (instance != XR_NULL_HANDLE) {
+        object = Lookup<Instance>(instance);
+        if (object == nullptr) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+    } else if (strcmp(name, "xrEnumerateInstanceExtensionProperties") != 0 && strcmp(name, "xrEnumerateApiLayerProperties") != 0 &&
+               strcmp(name, "xrCreateInstance") != 0) {
+        return XR_ERROR_HANDLE_INVALID;
+    }
+
+    for (const FunctionEntry& entry : Functions) {
+        if (strcmp(entry.name, name) == 0) {
+            if (entry.extension != nullptr && (object == nullptr || object->extensions.count(entry.extension) == 0)) {
+                return XR_ERROR_FUNCTION_UNSUPPORTED;
+            }
+            *function = entry.function;
+            return XR_SUCCESS;
+        }
+    }
+    return XR_ERROR_FUNCTION_UNSUPPORTED;
+}
+}  // namespace
+
+// Entry point the OpenXR loader calls after loading the library named in the runtime manifest.
+MOCK_RUNTIME_EXPORT XRAPI_ATTR XrResult XRAPI_CALL xrNegotiateLoaderRuntimeInterface(const XrNegotiateLoaderInfo* loaderInfo,
+                                                                                     XrNegotiateRuntimeRequest* runtimeRequest) {
+    if (loaderInfo == nullptr || loaderInfo->structType != XR_LOADER_INTERFACE_STRUCT_LOADER_INFO ||
+        loaderInfo->structVersion != XR_LOADER_INFO_STRUCT_VERSION || loaderInfo->structSize != sizeof(XrNegotiateLoaderInfo)) {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+    if (runtimeRequest == nullptr || runtimeRequest->structType != XR_LOADER_INTERFACE_STRUCT_RUNTIME_REQUEST ||
+        runtimeRequest->structVersion != XR_RUNTIME_INFO_STRUCT_VERSION ||
+        runtimeRequest->structSize != sizeof(XrNegotiateRuntimeRequest)) {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+    if (loaderInfo->minInterfaceVersion > XR_CURRENT_LOADER_RUNTIME_VERSION ||
+        loaderInfo->maxInterfaceVersion < XR_CURRENT_LOADER_RUNTIME_VERSION ||
+        XR_VERSION_MAJOR(loaderInfo->minApiVersion) > 1 || XR_VERSION_MAJOR(loaderInfo->maxApiVersion) < 1) {
+        return XR_ERROR_INITIALIZATION_FAILED;
+    }
+
+    runtimeRequest->runtimeInterfaceVersion = XR_CURRENT_LOADER_RUNTIME_VERSION;
+    runtimeRequest->runtimeApiVersion = XR_CURRENT_API_VERSION;
+    runtimeRequest->getInstanceProcAddr = MockGetInstanceProcAddr;
+    return XR_SUCCESS;
+}
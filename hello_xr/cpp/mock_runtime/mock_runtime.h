@@ -0,0 +1,52 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+// Interface of the hello_xr mock runtime that applications may use beyond core OpenXR.
+//
+// The mock runtime stands in for a headset so the frame loop can run, and be benchmarked, on machines without one. Select
+// it by pointing the loader at its manifest, e.g. XR_RUNTIME_JSON=<build dir>/hello_xr_mock_runtime.json. It is
+// configured through environment variables read when the instance is created:
+//   HELLO_XR_MOCK_REFRESH_RATE        Display refresh rate in Hz that xrWaitFrame paces frames at (default 90). With 0
+//                                     xrWaitFrame never blocks and every frame is one nominal period later than the
+//                                     last, so runs are reproducible frame by frame.
+//   HELLO_XR_MOCK_VIEW_SIZE           Recommended size of each view, "<width>x<height>" (default 1440x1600).
+//   HELLO_XR_MOCK_POSE_SCRIPT         File of head and hand keyframes; see PoseScript. Default is a built-in motion.
+//   HELLO_XR_MOCK_EXIT_AFTER_FRAMES   Stop the session after this many frames, as if the user quit (default never).
+
+#include <openxr/openxr.h>
+
+// Sessions whose swapchain images are plain CPU memory, for graphics plugins that render without a GPU. Chain
+// XrGraphicsBindingMemoryMOCK to XrSessionCreateInfo::next in place of a graphics API binding; the swapchain images are
+// then enumerated as XrSwapchainImageMemoryMOCK.
+#define XR_MOCK_memory_swapchain 1
+#define XR_MOCK_memory_swapchain_SPEC_VERSION 1
+#define XR_MOCK_MEMORY_SWAPCHAIN_EXTENSION_NAME "XR_MOCK_memory_swapchain"
+
+// Not registered with Khronos, so picked far above the ranges of the registered extensions.
+#define XR_TYPE_GRAPHICS_BINDING_MEMORY_MOCK ((XrStructureType)1999000001)
+#define XR_TYPE_SWAPCHAIN_IMAGE_MEMORY_MOCK ((XrStructureType)1999000002)
+
+// Swapchain formats of memory sessions. All of them take four bytes per pixel.
+#define XR_MOCK_MEMORY_FORMAT_R8G8B8A8_UNORM 1
+#define XR_MOCK_MEMORY_FORMAT_R8G8B8A8_SRGB 2
+#define XR_MOCK_MEMORY_FORMAT_D32_SFLOAT 3
+
+// Rows start at multiples of this many bytes, so they may be loaded with aligned SIMD loads.
+#define XR_MOCK_MEMORY_ROW_ALIGNMENT 64
+
+typedef struct XrGraphicsBindingMemoryMOCK {
+    XrStructureType type;
+    const void* XR_MAY_ALIAS next;
+} XrGraphicsBindingMemoryMOCK;
+
+// Array layer i of an image starts at data + i * slicePitch; row y of a layer starts rowPitch * y bytes into it.
+typedef struct XrSwapchainImageMemoryMOCK {
+    XrStructureType type;
+    void* XR_MAY_ALIAS next;
+    void* data;
+    uint32_t rowPitch;
+    uint32_t slicePitch;
+} XrSwapchainImageMemoryMOCK;
@@ -0,0 +1,179 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "pose_script.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+constexpr double Pi = 3.14159265358979323846;
+
+XrQuaternionf QuaternionMultiply(const XrQuaternionf& a, const XrQuaternionf& b) {
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y, a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w, a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+XrVector3f Rotate(const XrQuaternionf& q, const XrVector3f& v) {
+    // v + 2w(q x v) + 2q x (q x v), with q the vector part of the quaternion.
+    const XrVector3f t{2.0f * (q.y * v.z - q.z * v.y), 2.0f * (q.z * v.x - q.x * v.z), 2.0f * (q.x * v.y - q.y * v.x)};
+    return {v.x + q.w * t.x + (q.y * t.z - q.z * t.y), v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+            v.z + q.w * t.z + (q.x * t.y - q.y * t.x)};
+}
+
+XrQuaternionf Normalize(const XrQuaternionf& q) {
+    const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    if (length == 0.0f) {
+        return {0.0f, 0.0f, 0.0f, 1.0f};
+    }
+    return {q.x / length, q.y / length, q.z / length, q.w / length};
+}
+
+// Yaw about +Y, then pitch about +X, in radians.
+XrQuaternionf YawPitch(double yaw, double pitch) {
+    const XrQuaternionf qYaw{0.0f, (float)std::sin(yaw * 0.5), 0.0f, (float)std::cos(yaw * 0.5)};
+    const XrQuaternionf qPitch{(float)std::sin(pitch * 0.5), 0.0f, 0.0f, (float)std::cos(pitch * 0.5)};
+    return QuaternionMultiply(qYaw, qPitch);
+}
+
+XrPosef Interpolate(const XrPosef& a, const XrPosef& b, float fraction) {
+    XrPosef pose;
+    pose.position = {a.position.x + (b.position.x - a.position.x) * fraction,
+                     a.position.y + (b.position.y - a.position.y) * fraction,
+                     a.position.z + (b.position.z - a.position.z) * fraction};
+    // Normalized lerp along the shorter arc.
+    const XrQuaternionf& qa = a.orientation;
+    const XrQuaternionf& qb = b.orientation;
+    const float sign = (qa.x * qb.x + qa.y * qb.y + qa.z * qb.z + qa.w * qb.w) < 0.0f ? -1.0f : 1.0f;
+    pose.orientation = Normalize({qa.x + (sign * qb.x - qa.x) * fraction, qa.y + (sign * qb.y - qa.y) * fraction,
+                                  qa.z + (sign * qb.z - qa.z) * fraction, qa.w + (sign * qb.w - qa.w) * fraction});
+    return pose;
+}
+}  // namespace
+
+namespace PoseMath {
+XrPosef Identity() {
+    XrPosef pose{};
+    pose.orientation.w = 1.0f;
+    return pose;
+}
+
+XrPosef Multiply(const XrPosef& a, const XrPosef& b) {
+    XrPosef pose;
+    pose.orientation = QuaternionMultiply(a.orientation, b.orientation);
+    const XrVector3f offset = Rotate(a.orientation, b.position);
+    pose.position = {a.position.x + offset.x, a.position.y + offset.y, a.position.z + offset.z};
+    return pose;
+}
+
+XrPosef Invert(const XrPosef& pose) {
+    XrPosef inverse;
+    inverse.orientation = {-pose.orientation.x, -pose.orientation.y, -pose.orientation.z, pose.orientation.w};
+    const XrVector3f position = Rotate(inverse.orientation, pose.position);
+    inverse.position = {-position.x, -position.y, -position.z};
+    return inverse;
+}
+}  // namespace PoseMath
+
+void PoseScript::Load(const std::string& path) {
+    for (std::vector<Keyframe>& track : m_tracks) {
+        track.clear();
+    }
+    m_duration = 0.0;
+    if (path.empty()) {
+        return;
+    }
+
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error(Fmt("Cannot open pose script %s", path.c_str()));
+    }
+
+    std::string line;
+    for (uint32_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        Keyframe keyframe;
+        std::string device;
+        if (!(fields >> keyframe.seconds)) {
+            continue;  // Blank or comment.
+        }
+        XrPosef& pose = keyframe.pose;
+        if (!(fields >> device >> pose.position.x >> pose.position.y >> pose.position.z >> pose.orientation.x >>
+              pose.orientation.y >> pose.orientation.z >> pose.orientation.w) ||
+            keyframe.seconds < 0.0) {
+            throw std::runtime_error(Fmt("Malformed keyframe in %s line %u", path.c_str(), lineNumber));
+        }
+        pose.orientation = Normalize(pose.orientation);
+
+        MockDevice trackDevice;
+        if (EqualsIgnoreCase(device, "head")) {
+            trackDevice = MockDevice::Head;
+        } else if (EqualsIgnoreCase(device, "left")) {
+            trackDevice = MockDevice::LeftHand;
+        } else if (EqualsIgnoreCase(device, "right")) {
+            trackDevice = MockDevice::RightHand;
+        } else {
+            throw std::runtime_error(Fmt("Unknown device '%s' in %s line %u", device.c_str(), path.c_str(), lineNumber));
+        }
+        m_tracks[(size_t)trackDevice].push_back(keyframe);
+        m_duration = std::max(m_duration, keyframe.seconds);
+    }
+
+    for (std::vector<Keyframe>& track : m_tracks) {
+        std::stable_sort(track.begin(), track.end(),
+                         [](const Keyframe& a, const Keyframe& b) { return a.seconds < b.seconds; });
+    }
+}
+
+XrPosef PoseScript::Locate(MockDevice device, double seconds) const {
+    const std::vector<Keyframe>& track = m_tracks[(size_t)device];
+    if (track.empty()) {
+        return BuiltInPose(device, seconds);
+    }
+
+    const double t = m_duration > 0.0 ? std::fmod(std::max(seconds, 0.0), m_duration) : 0.0;
+    const auto next = std::upper_bound(track.begin(), track.end(), t,
+                                       [](double time, const Keyframe& keyframe) { return time < keyframe.seconds; });
+    if (next == track.begin()) {
+        return track.front().pose;
+    }
+    if (next == track.end()) {
+        return track.back().pose;
+    }
+    const Keyframe& previous = *(next - 1);
+    const float fraction = (float)((t - previous.seconds) / (next->seconds - previous.seconds));
+    return Interpolate(previous.pose, next->pose, fraction);
+}
+
+float PoseScript::Squeeze(MockDevice hand, double seconds) const {
+    const double phase = hand == MockDevice::RightHand ? Pi : 0.0;
+    return (float)(0.5 - 0.5 * std::cos(2.0 * Pi * seconds / 3.0 + phase));
+}
+
+XrPosef PoseScript::BuiltInPose(MockDevice device, double seconds) {
+    const double t = std::max(seconds, 0.0);
+    XrPosef pose;
+    switch (device) {
+        case MockDevice::Head:
+            pose.position = {(float)(0.1 * std::sin(0.6 * t)), (float)(1.6 + 0.02 * std::sin(1.7 * t)),
+                             (float)(0.05 * std::sin(0.4 * t))};
+            pose.orientation = YawPitch(0.35 * std::sin(0.25 * t), 0.1 * std::sin(0.5 * t));
+            break;
+        case MockDevice::LeftHand:
+        case MockDevice::RightHand: {
+            const double side = device == MockDevice::LeftHand ? -1.0 : 1.0;
+            const double angle = 1.2 * t + (side > 0.0 ? Pi : 0.0);
+            pose.position = {(float)(0.2 * side + 0.08 * std::cos(angle)), (float)(1.35 + 0.08 * std::sin(angle)), -0.4f};
+            pose.orientation = YawPitch(0.2 * side * std::sin(0.8 * t), -0.5);
+            break;
+        }
+        default:
+            pose = PoseMath::Identity();
+            break;
+    }
+    return pose;
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+// Tracked devices of the mock runtime.
+enum class MockDevice : uint32_t { Head, LeftHand, RightHand, Count };
+
+namespace PoseMath {
+XrPosef Identity();
+
+// The pose b, given relative to a, relative to whatever a is relative to.
+XrPosef Multiply(const XrPosef& a, const XrPosef& b);
+
+XrPosef Invert(const XrPosef& pose);
+}  // namespace PoseMath
+
+// Where the tracked devices of the mock runtime are at any time, in stage space, and how far the hands squeeze.
+//
+// By default the devices follow a built-in motion: the head sways a little around standing height while the hands
+// circle in front of it. A script file replaces the motion of the devices it has keyframes for. It has one keyframe per
+// line, "<seconds> head|left|right <px> <py> <pz> <qx> <qy> <qz> <qw>", and '#' starts a comment. The keyframes of a
+// device are interpolated linearly and the script loops after its last keyframe.
+//
+// Either way a pose only depends on the time it is asked for, so two runs that see the same frame times see the same
+// poses.
+struct PoseScript {
+    // Throws if the file cannot be read or has a malformed line. An empty path keeps the built-in motion.
+    void Load(const std::string& path);
+
+    XrPosef Locate(MockDevice device, double seconds) const;
+
+    // How far the squeeze or trigger of a hand is pressed, from 0 to 1. Goes all the way every few seconds.
+    float Squeeze(MockDevice hand, double seconds) const;
+
+   private:
+    struct Keyframe {
+        double seconds;
+        XrPosef pose;
+    };
+
+    static XrPosef BuiltInPose(MockDevice device, double seconds);
+
+    std::array<std::vector<Keyframe>, (size_t)MockDevice::Count> m_tracks;
+    double m_duration{0.0};
+};
@@ -3,10 +3,12 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "openxr_program.h"
+#include "trace.h"
 #include <array>
 #include <cmath>
 #include <common/xr_linear.h>
 #include <set>
+#include <utils/nanoseconds.h>
 
 namespace {
 
@@ -83,6 +85,27 @@ GetXrReferenceSpaceCreateInfo(const std::string &referenceSpaceTypeStr) {
   }
   return referenceSpaceCreateInfo;
 }
+
+// 5cm cubes 10cm apart, filling a block as close to a cube as count allows
+// whose front face is centered 2m in front of the origin.
+std::vector<Cube> MakeCubeGrid(uint32_t count) {
+  std::vector<Cube> cubes;
+  cubes.reserve(count);
+  uint32_t side = 1;
+  while (side * side * side < count) {
+    side++;
+  }
+  const float spacing = 0.1f;
+  const float half = (side - 1) * spacing * 0.5f;
+  for (uint32_t i = 0; i < count; i++) {
+    const XrVector3f position{(i % side) * spacing - half,
+                              (i / side % side) * spacing - half,
+                              -2.f - (i / (side * side)) * spacing};
+    cubes.push_back(
+        Cube{Math::Pose::Translation(position), {0.05f, 0.05f, 0.05f}});
+  }
+  return cubes;
+}
 } // namespace
 
 OpenXrProgram::OpenXrProgram(
@@ -93,9 +116,12 @@ OpenXrProgram::OpenXrProgram(
       m_graphicsPlugin(graphicsPlugin),
       m_acceptableBlendModes{XR_ENVIRONMENT_BLEND_MODE_OPAQUE,
                              XR_ENVIRONMENT_BLEND_MODE_ADDITIVE,
-                             XR_ENVIRONMENT_BLEND_MODE_ALPHA_BLEND} {}
+                             XR_ENVIRONMENT_BLEND_MODE_ALPHA_BLEND},
+      m_gridCubes(MakeCubeGrid(options->GridCubes)) {}
 
 OpenXrProgram::~OpenXrProgram() {
+  StopFramePipeline();
+
   if (m_input.actionSet != XR_NULL_HANDLE) {
     for (auto hand : {Side::LEFT, Side::RIGHT}) {
       xrDestroySpace(m_input.handSpace[hand]);
@@ -210,6 +236,18 @@ void OpenXrProgram::CreateInstanceInternal() {
                  std::back_inserter(extensions),
                  [](const std::string &ext) { return ext.c_str(); });
 
+  // Optional: locate all visualized spaces with a single call per frame.
+  m_locateSpacesEnabled = SpaceLocator::IsExtensionAvailable();
+  if (m_locateSpacesEnabled) {
+    extensions.push_back(SpaceLocator::ExtensionName());
+  }
+
+  // Optional: compare predicted display times with the local clock.
+  m_timeConversionEnabled = FrameStats::IsExtensionAvailable();
+  if (m_timeConversionEnabled) {
+    extensions.push_back(FrameStats::ExtensionName());
+  }
+
   XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
   createInfo.next = m_platformPlugin->GetInstanceCreateExtension();
   createInfo.enabledExtensionCount = (uint32_t)extensions.size();
@@ -219,9 +257,13 @@ void OpenXrProgram::CreateInstanceInternal() {
   createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
 
   CHECK_XRCMD(xrCreateInstance(&createInfo, &m_instance));
+
+  m_frameStats.Initialize(m_instance, m_timeConversionEnabled,
+                          m_options->FrameStatsFile);
 }
 
 void OpenXrProgram::CreateInstance() {
+  TRACE_ZONE("CreateInstance");
   LogLayersAndExtensions();
 
   CreateInstanceInternal();
@@ -342,6 +384,7 @@ XrEnvironmentBlendMode OpenXrProgram::GetPreferredBlendMode() const {
 }
 
 void OpenXrProgram::InitializeSystem() {
+  TRACE_ZONE("InitializeSystem");
   CHECK(m_instance != XR_NULL_HANDLE);
   CHECK(m_systemId == XR_NULL_SYSTEM_ID);
 
@@ -357,11 +400,14 @@ void OpenXrProgram::InitializeSystem() {
 }
 
 void OpenXrProgram::InitializeDevice() {
+  TRACE_ZONE("InitializeDevice");
   LogViewConfigurations();
 
   // The graphics API can initialize the graphics device now that the systemId
   // and instance handle are available.
   m_graphicsPlugin->InitializeDevice(m_instance, m_systemId);
+  m_renderPackets =
+      m_graphicsPlugin->SupportsRenderPacket(&m_renderPacketProjection);
 }
 
 void OpenXrProgram::LogReferenceSpaces() {
@@ -648,6 +694,7 @@ void OpenXrProgram::CreateVisualizedSpaces() {
 }
 
 void OpenXrProgram::InitializeSession() {
+  TRACE_ZONE("InitializeSession");
   CHECK(m_instance != XR_NULL_HANDLE);
   CHECK(m_session == XR_NULL_HANDLE);
 
@@ -670,9 +717,19 @@ void OpenXrProgram::InitializeSession() {
     CHECK_XRCMD(xrCreateReferenceSpace(m_session, &referenceSpaceCreateInfo,
                                        &m_appSpace));
   }
+
+  m_spaceLocator.Initialize(m_instance, m_session, m_locateSpacesEnabled);
+  m_spaceLocator.Reserve((uint32_t)m_visualizedSpaces.size() + Side::COUNT);
+  for (XrSpace visualizedSpace : m_visualizedSpaces) {
+    m_spaceLocator.AddSpace(visualizedSpace);
+  }
+  for (auto hand : {Side::LEFT, Side::RIGHT}) {
+    m_handLocatorIndex[hand] = m_spaceLocator.AddSpace(m_input.handSpace[hand]);
+  }
 }
 
 void OpenXrProgram::CreateSwapchains() {
+  TRACE_ZONE("CreateSwapchains");
   CHECK(m_session != XR_NULL_HANDLE);
   CHECK(m_swapchains.empty());
   CHECK(m_configViews.empty());
@@ -754,19 +811,52 @@ void OpenXrProgram::CreateSwapchains() {
                  Fmt("Swapchain Formats: %s", swapchainFormatsString.c_str()));
     }
 
-    // Create a swapchain for each view.
-    for (uint32_t i = 0; i < viewCount; i++) {
+    // Multiview renders every view into its own layer of one array
+    // swapchain, which requires all views to share the same dimensions.
+    m_multiview = false;
+    if (m_options->Multiview) {
+      const bool sameSize = std::all_of(
+          m_configViews.begin(), m_configViews.end(),
+          [&](const XrViewConfigurationView &view) {
+            return view.recommendedImageRectWidth ==
+                       m_configViews[0].recommendedImageRectWidth &&
+                   view.recommendedImageRectHeight ==
+                       m_configViews[0].recommendedImageRectHeight;
+          });
+      if (!m_renderPackets) {
+        // Multiview frames are only rendered from render packets.
+        Log::Write(Log::Level::Warning,
+                   "Multiview requires render packets, which the graphics "
+                   "plugin does not support; rendering one view at a time");
+      } else if (!m_graphicsPlugin->SupportsMultiview()) {
+        Log::Write(Log::Level::Warning,
+                   "Multiview requested but not supported by the graphics "
+                   "plugin, rendering one view at a time");
+      } else if (!sameSize) {
+        Log::Write(Log::Level::Warning,
+                   "Multiview requested but views have different dimensions, "
+                   "rendering one view at a time");
+      } else {
+        m_multiview = true;
+      }
+    }
+
+    // Create a swapchain for each view, or a single array swapchain with a
+    // layer per view.
+    const uint32_t swapchainCount = m_multiview ? 1 : viewCount;
+    for (uint32_t i = 0; i < swapchainCount; i++) {
       const XrViewConfigurationView &vp = m_configViews[i];
+      const uint32_t arraySize = m_multiview ? viewCount : 1;
       Log::Write(Log::Level::Info,
                  Fmt("Creating swapchain for view %d with dimensions Width=%d "
-                     "Height=%d SampleCount=%d",
+                     "Height=%d SampleCount=%d ArraySize=%d",
                      i, vp.recommendedImageRectWidth,
                      vp.recommendedImageRectHeight,
-                     vp.recommendedSwapchainSampleCount));
+                     vp.recommendedSwapchainSampleCount, arraySize));
 
       // Create the swapchain.
       XrSwapchainCreateInfo swapchainCreateInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
-      swapchainCreateInfo.arraySize = 1;
+      swapchainCreateInfo.arraySize = arraySize;
       swapchainCreateInfo.format = m_colorSwapchainFormat;
       swapchainCreateInfo.width = vp.recommendedImageRectWidth;
       swapchainCreateInfo.height = vp.recommendedImageRectHeight;
@@ -824,6 +914,7 @@ const XrEventDataBaseHeader *OpenXrProgram::TryReadNextEvent() {
 }
 
 void OpenXrProgram::PollEvents(bool *exitRenderLoop, bool *requestRestart) {
+  TRACE_ZONE("PollEvents");
   *exitRenderLoop = *requestRestart = false;
 
   // Process all pending messages.
@@ -889,10 +980,14 @@ void OpenXrProgram::HandleSessionStateChangedEvent(
         m_options->Parsed.ViewConfigType;
     CHECK_XRCMD(xrBeginSession(m_session, &sessionBeginInfo));
     m_sessionRunning = true;
+    if (m_options->FramePipelining) {
+      StartFramePipeline();
+    }
     break;
   }
   case XR_SESSION_STATE_STOPPING: {
     CHECK(m_session != XR_NULL_HANDLE);
+    StopFramePipeline();
     m_sessionRunning = false;
     CHECK_XRCMD(xrEndSession(m_session))
     break;
@@ -956,12 +1051,20 @@ void OpenXrProgram::LogActionSourceName(XrAction action,
     sourceName += "'";
   }
 
-  Log::Write(Log::Level::Info,
-             Fmt("%s action is bound to %s", actionName.c_str(),
-                 ((!sourceName.empty()) ? sourceName.c_str() : "nothing")));
+  Log::Writef<Log::Level::Info>(
+      "%s action is bound to %s", actionName,
+      (!sourceName.empty()) ? sourceName.c_str() : "nothing");
 }
 
 void OpenXrProgram::PollActions() {
+  if (m_framePipeline && m_framePipeline->IsRunning()) {
+    return; // The simulation stage syncs actions for each frame it builds.
+  }
+  SyncActions();
+}
+
+void OpenXrProgram::SyncActions() {
+  TRACE_ZONE("PollActions");
   m_input.handActive = {XR_FALSE, XR_FALSE};
 
   // Sync actions
@@ -1012,26 +1115,61 @@ void OpenXrProgram::PollActions() {
   if ((quitValue.isActive == XR_TRUE) &&
       (quitValue.changedSinceLastSync == XR_TRUE) &&
       (quitValue.currentState == XR_TRUE)) {
-    CHECK_XRCMD(xrRequestExitSession(m_session));
+    RequestExitSession();
   }
 }
 
+void OpenXrProgram::RequestExitSession() {
+  CHECK(m_session != XR_NULL_HANDLE);
+  CHECK_XRCMD(xrRequestExitSession(m_session));
+}
+
 void OpenXrProgram::RenderFrame() {
+  TRACE_ZONE("RenderFrame");
   CHECK(m_session != XR_NULL_HANDLE);
 
+  if (m_framePipeline && m_framePipeline->IsRunning()) {
+    RenderPipelinedFrame();
+    return;
+  }
+
   XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
   XrFrameState frameState{XR_TYPE_FRAME_STATE};
+  const ksNanoseconds waitStart = GetTimeNanoseconds();
   CHECK_XRCMD(xrWaitFrame(m_session, &frameWaitInfo, &frameState));
+  m_frameStats.OnWaitFrame(waitStart);
+
+  // Reuse the cube list's storage from the previous frame.
+  m_cubes.clear();
+  if (frameState.shouldRender == XR_TRUE) {
+    LocateCubes(frameState.predictedDisplayTime, m_cubes);
+  }
+
+  SubmitFrame(frameState, m_cubes);
+}
+
+void OpenXrProgram::SubmitFrame(const XrFrameState &frameState,
+                                const std::vector<Cube> &cubes) {
+  TRACE_ZONE("SubmitFrame");
+  m_frameArena.BeginFrame();
+  LinearArena &arena = m_frameArena.Current();
 
   XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
-  CHECK_XRCMD(xrBeginFrame(m_session, &frameBeginInfo));
+  {
+    ScopedFramePhase phase(m_frameStats, FramePhase::BeginFrame);
+    CHECK_XRCMD(xrBeginFrame(m_session, &frameBeginInfo));
+  }
+  AllocationTracker::BeginScope();
 
-  std::vector<XrCompositionLayerBaseHeader *> layers;
+  ArenaVector<XrCompositionLayerBaseHeader *> layers{
+      ArenaAllocator<XrCompositionLayerBaseHeader *>(arena)};
   XrCompositionLayerProjection layer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
-  std::vector<XrCompositionLayerProjectionView> projectionLayerViews;
+  ArenaVector<XrCompositionLayerProjectionView> projectionLayerViews{
+      ArenaAllocator<XrCompositionLayerProjectionView>(arena)};
   if (frameState.shouldRender == XR_TRUE) {
-    if (RenderLayer(frameState.predictedDisplayTime, projectionLayerViews,
-                    layer)) {
+    m_graphicsPlugin->BeginGpuFrame(m_gpuFrameIndex++);
+    if (RenderLayer(frameState.predictedDisplayTime, cubes,
+                    projectionLayerViews, layer)) {
       layers.push_back(
           reinterpret_cast<XrCompositionLayerBaseHeader *>(&layer));
     }
@@ -1042,13 +1180,229 @@ void OpenXrProgram::RenderFrame() {
   frameEndInfo.environmentBlendMode = m_options->Parsed.EnvironmentBlendMode;
   frameEndInfo.layerCount = (uint32_t)layers.size();
   frameEndInfo.layers = layers.data();
-  CHECK_XRCMD(xrEndFrame(m_session, &frameEndInfo));
+  {
+    ScopedFramePhase phase(m_frameStats, FramePhase::EndFrame);
+    CHECK_XRCMD(xrEndFrame(m_session, &frameEndInfo));
+  }
+  if (frameState.shouldRender == XR_TRUE) {
+    m_frameStats.OnEndFrame(frameState);
+  }
+
+  // Only report when the count changes to avoid logging every frame.
+  const uint64_t frameAllocations = AllocationTracker::EndScope();
+  if (frameAllocations != m_lastFrameAllocations) {
+    Log::Write(frameAllocations != 0 ? Log::Level::Warning : Log::Level::Info,
+               Fmt("Heap allocations between xrBeginFrame and xrEndFrame: %llu",
+                   (unsigned long long)frameAllocations));
+    m_lastFrameAllocations = frameAllocations;
+  }
+
+  UpdateGpuTimings();
+  UpdateFrameCounters();
+  m_frameStats.Update();
+}
+
+void OpenXrProgram::UpdateGpuTimings() {
+  m_gpuTimings.clear();
+  m_graphicsPlugin->CollectGpuTimings(&m_gpuTimings);
+  for (const GpuFrameTiming &frame : m_gpuTimings) {
+    double frameMs = 0.0;
+    for (const GpuPassTiming &pass : frame.Passes) {
+      frameMs += pass.Milliseconds;
+      // A handful of passes, so a linear search beats hashing.
+      auto it = std::find_if(
+          m_gpuPassStats.begin(), m_gpuPassStats.end(),
+          [&](const GpuPassStats &entry) {
+            return entry.pass == pass.Pass &&
+                   entry.firstView == pass.FirstView &&
+                   entry.viewCount == pass.ViewCount;
+          });
+      if (it == m_gpuPassStats.end()) {
+        it = m_gpuPassStats.insert(
+            it, {pass.Pass, pass.FirstView, pass.ViewCount, {}});
+      }
+      it->stats.Add(pass.Milliseconds);
+    }
+    m_gpuFrameStats.Add(frameMs);
+  }
+
+  // Report every few seconds, like the frame pipeline timings.
+  constexpr ksNanoseconds logInterval = 5ULL * 1000 * 1000 * 1000;
+  const ksNanoseconds now = GetTimeNanoseconds();
+  if (m_lastGpuTimingLogTime == 0) {
+    m_lastGpuTimingLogTime = now;
+  }
+  if (now - m_lastGpuTimingLogTime < logInterval ||
+      m_gpuFrameStats.count == 0) {
+    return;
+  }
+
+  const auto format = [](const std::string &name,
+                          const GpuTimingStats &stats) {
+    return Fmt(" %s avg=%.2fms max=%.2fms", name.c_str(),
+               stats.totalMs / stats.count, stats.maxMs);
+  };
+  std::string line =
+      Fmt("GPU timings over %u frames:", m_gpuFrameStats.count) +
+      format("Total", m_gpuFrameStats);
+  for (GpuPassStats &pass : m_gpuPassStats) {
+    if (pass.stats.count == 0) {
+      continue;
+    }
+    // Named by the views the pass rendered, e.g. "Draw[1]" or "Draw[0-1]".
+    const std::string name =
+        pass.viewCount > 1
+            ? Fmt("%s[%u-%u]", pass.pass, pass.firstView,
+                  pass.firstView + pass.viewCount - 1)
+            : Fmt("%s[%u]", pass.pass, pass.firstView);
+    line += format(name, pass.stats);
+    pass.stats = {};
+  }
+  Log::Write(Log::Level::Info, line);
+
+  m_gpuFrameStats = {};
+  m_lastGpuTimingLogTime = now;
+}
+
+void OpenXrProgram::UpdateFrameCounters() {
+  m_frameCounters.clear();
+  m_graphicsPlugin->CollectFrameCounters(&m_frameCounters);
+  for (const GraphicsFrameCounters &counters : m_frameCounters) {
+    m_frameCounterStats.Add(counters);
+  }
+
+  // Report every few seconds, like the GPU timings.
+  constexpr ksNanoseconds logInterval = 5ULL * 1000 * 1000 * 1000;
+  const ksNanoseconds now = GetTimeNanoseconds();
+  if (m_lastFrameCounterLogTime == 0) {
+    m_lastFrameCounterLogTime = now;
+  }
+  if (now - m_lastFrameCounterLogTime < logInterval ||
+      m_frameCounterStats.frames == 0) {
+    return;
+  }
+
+  const FrameCounterStats &stats = m_frameCounterStats;
+  Log::Write(
+      Log::Level::Info,
+      Fmt("Graphics counters over %u frames: draws avg=%.1f max=%llu "
+          "state changes avg=%.1f max=%llu uploads avg=%.1fKB max=%.1fKB",
+          stats.frames, (double)stats.total.Draws / stats.frames,
+          (unsigned long long)stats.max.Draws,
+          (double)stats.total.StateChanges / stats.frames,
+          (unsigned long long)stats.max.StateChanges,
+          stats.total.UploadBytes / 1024.0 / stats.frames,
+          stats.max.UploadBytes / 1024.0));
+
+  m_frameCounterStats = {};
+  m_lastFrameCounterLogTime = now;
+}
+
+void OpenXrProgram::StartFramePipeline() {
+  if (!m_framePipeline) {
+    m_framePipeline.reset(new FramePipeline(
+        [this](XrFrameState &frameState) {
+          XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
+          const ksNanoseconds waitStart = GetTimeNanoseconds();
+          CHECK_XRCMD(xrWaitFrame(m_session, &frameWaitInfo, &frameState));
+          m_frameStats.OnWaitFrame(waitStart);
+        },
+        [this](FramePacket &packet) {
+          SyncActions();
+          if (packet.frameState.shouldRender == XR_TRUE) {
+            LocateCubes(packet.frameState.predictedDisplayTime, packet.cubes);
+          }
+        }));
+  }
+
+  Log::Write(Log::Level::Info, "Starting pipelined frame loop");
+  m_framePipeline->Start();
+  m_lastPipelineLogTime = GetTimeNanoseconds();
+}
+
+void OpenXrProgram::StopFramePipeline() {
+  if (!m_framePipeline || !m_framePipeline->IsRunning()) {
+    return;
+  }
+
+  // Frames which already returned from xrWaitFrame are ended without layers.
+  m_framePipeline->Stop([this](FramePacket &packet) {
+    packet.frameState.shouldRender = XR_FALSE;
+    SubmitFrame(packet.frameState, packet.cubes);
+  });
+  m_framePipeline->LogTimings();
+}
+
+void OpenXrProgram::RenderPipelinedFrame() {
+  FramePacket *packet = m_framePipeline->AcquireFrame();
+  if (packet == nullptr) {
+    return;
+  }
+
+  const ksNanoseconds renderStart = GetTimeNanoseconds();
+  try {
+    SubmitFrame(packet->frameState, packet->cubes);
+  } catch (...) {
+    m_framePipeline->ReleaseFrame(packet);
+    throw;
+  }
+  m_framePipeline->ReleaseFrame(packet);
+
+  const ksNanoseconds renderEnd = GetTimeNanoseconds();
+  m_framePipeline->AddRenderTiming(renderEnd - renderStart);
+
+  // Report stage timings every few seconds.
+  constexpr ksNanoseconds logInterval = 5ULL * 1000 * 1000 * 1000;
+  if (renderEnd - m_lastPipelineLogTime >= logInterval) {
+    m_framePipeline->LogTimings();
+    m_lastPipelineLogTime = renderEnd;
+  }
+}
+
+void OpenXrProgram::LocateCubes(XrTime predictedDisplayTime,
+                                std::vector<Cube> &cubes) {
+  TRACE_ZONE("LocateCubes");
+  ScopedFramePhase phase(m_frameStats, FramePhase::LocateSpaces);
+  m_spaceLocator.Locate(m_appSpace, predictedDisplayTime);
+
+  // For each locatable space that we want to visualize, render a 25cm cube.
+  for (uint32_t i = 0; i < (uint32_t)m_visualizedSpaces.size(); i++) {
+    if (m_spaceLocator.IsPoseValid(i)) {
+      cubes.push_back(Cube{m_spaceLocator.Pose(i), {0.25f, 0.25f, 0.25f}});
+    } else if (m_spaceLocator.Result(i) != XR_SUCCESS) {
+      Log::Writef<Log::Level::Verbose>(
+          "Unable to locate a visualized reference space in app space: %d",
+          m_spaceLocator.Result(i));
+    }
+  }
+
+  // Render a 10cm cube scaled by grabAction for each hand. Note renderHand will
+  // only be true when the application has focus.
+  for (auto hand : {Side::LEFT, Side::RIGHT}) {
+    const uint32_t i = m_handLocatorIndex[hand];
+    if (m_spaceLocator.IsPoseValid(i)) {
+      float scale = 0.1f * m_input.handScale[hand];
+      cubes.push_back(Cube{m_spaceLocator.Pose(i), {scale, scale, scale}});
+    } else if (m_spaceLocator.Result(i) != XR_SUCCESS) {
+      // Tracking loss is expected when the hand is not active so only log a
+      // message if the hand is active.
+      if (m_input.handActive[hand] == XR_TRUE) {
+        const char *handName[] = {"left", "right"};
+        Log::Writef<Log::Level::Verbose>(
+            "Unable to locate %s hand action space in app space: %d",
+            handName[hand], m_spaceLocator.Result(i));
+      }
+    }
+  }
+
+  cubes.insert(cubes.end(), m_gridCubes.begin(), m_gridCubes.end());
 }
 
 bool OpenXrProgram::RenderLayer(
-    XrTime predictedDisplayTime,
-    std::vector<XrCompositionLayerProjectionView> &projectionLayerViews,
+    XrTime predictedDisplayTime, const std::vector<Cube> &cubes,
+    ArenaVector<XrCompositionLayerProjectionView> &projectionLayerViews,
     XrCompositionLayerProjection &layer) {
+  TRACE_ZONE("RenderLayer");
   XrResult res;
 
   XrViewState viewState{XR_TYPE_VIEW_STATE};
@@ -1060,8 +1414,11 @@ bool OpenXrProgram::RenderLayer(
   viewLocateInfo.displayTime = predictedDisplayTime;
   viewLocateInfo.space = m_appSpace;
 
-  res = xrLocateViews(m_session, &viewLocateInfo, &viewState, viewCapacityInput,
-                      &viewCountOutput, m_views.data());
+  {
+    ScopedFramePhase phase(m_frameStats, FramePhase::LocateViews);
+    res = xrLocateViews(m_session, &viewLocateInfo, &viewState,
+                        viewCapacityInput, &viewCountOutput, m_views.data());
+  }
   CHECK_XRRESULT(res, "xrLocateViews");
   if ((viewState.viewStateFlags & XR_VIEW_STATE_POSITION_VALID_BIT) == 0 ||
       (viewState.viewStateFlags & XR_VIEW_STATE_ORIENTATION_VALID_BIT) == 0) {
@@ -1070,62 +1427,75 @@ bool OpenXrProgram::RenderLayer(
 
   CHECK(viewCountOutput == viewCapacityInput);
   CHECK(viewCountOutput == m_configViews.size());
-  CHECK(viewCountOutput == m_swapchains.size());
+  CHECK(m_multiview ? m_swapchains.size() == 1
+                    : viewCountOutput == m_swapchains.size());
 
   projectionLayerViews.resize(viewCountOutput);
+  for (uint32_t i = 0; i < viewCountOutput; i++) {
+    // With multiview all views share one array swapchain image, with view i
+    // rendered to layer i in a single pass.
+    const Swapchain &viewSwapchain = m_swapchains[m_multiview ? 0 : i];
+    projectionLayerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+    projectionLayerViews[i].pose = m_views[i].pose;
+    projectionLayerViews[i].fov = m_views[i].fov;
+    projectionLayerViews[i].subImage.swapchain = viewSwapchain.handle;
+    projectionLayerViews[i].subImage.imageRect.offset = {0, 0};
+    projectionLayerViews[i].subImage.imageRect.extent = {viewSwapchain.width,
+                                                         viewSwapchain.height};
+    projectionLayerViews[i].subImage.imageArrayIndex = m_multiview ? i : 0;
+  }
 
-  // For each locatable space that we want to visualize, render a 25cm cube.
-  std::vector<Cube> cubes;
+  // Transform the cubes once for all views rather than once per view.
+  RenderPacket packet{};
+  if (m_renderPackets) {
+    ScopedFramePhase phase(m_frameStats, FramePhase::BuildPacket);
+    // SubmitFrame started this frame with BeginGpuFrame(m_gpuFrameIndex++).
+    packet = m_packetBuilder.Build(
+        m_gpuFrameIndex - 1, projectionLayerViews.data(),
+        (uint32_t)projectionLayerViews.size(), m_renderPacketProjection, cubes,
+        m_jobSystem.get());
+  }
 
-  for (XrSpace visualizedSpace : m_visualizedSpaces) {
-    XrSpaceLocation spaceLocation{XR_TYPE_SPACE_LOCATION};
-    res = xrLocateSpace(visualizedSpace, m_appSpace, predictedDisplayTime,
-                        &spaceLocation);
-    CHECK_XRRESULT(res, "xrLocateSpace");
-    if (XR_UNQUALIFIED_SUCCESS(res)) {
-      if ((spaceLocation.locationFlags &
-           XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
-          (spaceLocation.locationFlags &
-           XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0) {
-        cubes.push_back(Cube{spaceLocation.pose, {0.25f, 0.25f, 0.25f}});
-      }
-    } else {
-      Log::Write(
-          Log::Level::Verbose,
-          Fmt("Unable to locate a visualized reference space in app space: %d",
-              res));
+  if (m_multiview) {
+    const Swapchain viewSwapchain = m_swapchains[0];
+
+    XrSwapchainImageAcquireInfo acquireInfo{
+        XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+
+    uint32_t swapchainImageIndex;
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::AcquireImage);
+      CHECK_XRCMD(xrAcquireSwapchainImage(viewSwapchain.handle, &acquireInfo,
+                                          &swapchainImageIndex));
     }
-  }
 
-  // Render a 10cm cube scaled by grabAction for each hand. Note renderHand will
-  // only be true when the application has focus.
-  for (auto hand : {Side::LEFT, Side::RIGHT}) {
-    XrSpaceLocation spaceLocation{XR_TYPE_SPACE_LOCATION};
-    res = xrLocateSpace(m_input.handSpace[hand], m_appSpace,
-                        predictedDisplayTime, &spaceLocation);
-    CHECK_XRRESULT(res, "xrLocateSpace");
-    if (XR_UNQUALIFIED_SUCCESS(res)) {
-      if ((spaceLocation.locationFlags &
-           XR_SPACE_LOCATION_POSITION_VALID_BIT) != 0 &&
-          (spaceLocation.locationFlags &
-           XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) != 0) {
-        float scale = 0.1f * m_input.handScale[hand];
-        cubes.push_back(Cube{spaceLocation.pose, {scale, scale, scale}});
-      }
-    } else {
-      // Tracking loss is expected when the hand is not active so only log a
-      // message if the hand is active.
-      if (m_input.handActive[hand] == XR_TRUE) {
-        const char *handName[] = {"left", "right"};
-        Log::Write(Log::Level::Verbose,
-                   Fmt("Unable to locate %s hand action space in app space: %d",
-                       handName[hand], res));
-      }
+    XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+    waitInfo.timeout = XR_INFINITE_DURATION;
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::WaitImage);
+      CHECK_XRCMD(xrWaitSwapchainImage(viewSwapchain.handle, &waitInfo));
+    }
+
+    const XrSwapchainImageBaseHeader *const swapchainImage =
+        m_swapchainImages[viewSwapchain.handle][swapchainImageIndex];
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::RenderView);
+      m_graphicsPlugin->RenderPacketViews(packet, 0, viewCountOutput,
+                                          swapchainImage,
+                                          m_colorSwapchainFormat);
+    }
+
+    XrSwapchainImageReleaseInfo releaseInfo{
+        XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::ReleaseImage);
+      CHECK_XRCMD(
+          xrReleaseSwapchainImage(viewSwapchain.handle, &releaseInfo));
     }
   }
 
   // Render view to the appropriate part of the swapchain image.
-  for (uint32_t i = 0; i < viewCountOutput; i++) {
+  for (uint32_t i = 0; i < viewCountOutput && !m_multiview; i++) {
     // Each view has a separate swapchain which is acquired, rendered to, and
     // released.
     const Swapchain viewSwapchain = m_swapchains[i];
@@ -1134,29 +1504,39 @@ bool OpenXrProgram::RenderLayer(
         XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
 
     uint32_t swapchainImageIndex;
-    CHECK_XRCMD(xrAcquireSwapchainImage(viewSwapchain.handle, &acquireInfo,
-                                        &swapchainImageIndex));
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::AcquireImage);
+      CHECK_XRCMD(xrAcquireSwapchainImage(viewSwapchain.handle, &acquireInfo,
+                                          &swapchainImageIndex));
+    }
 
     XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
     waitInfo.timeout = XR_INFINITE_DURATION;
-    CHECK_XRCMD(xrWaitSwapchainImage(viewSwapchain.handle, &waitInfo));
-
-    projectionLayerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
-    projectionLayerViews[i].pose = m_views[i].pose;
-    projectionLayerViews[i].fov = m_views[i].fov;
-    projectionLayerViews[i].subImage.swapchain = viewSwapchain.handle;
-    projectionLayerViews[i].subImage.imageRect.offset = {0, 0};
-    projectionLayerViews[i].subImage.imageRect.extent = {viewSwapchain.width,
-                                                         viewSwapchain.height};
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::WaitImage);
+      CHECK_XRCMD(xrWaitSwapchainImage(viewSwapchain.handle, &waitInfo));
+    }
 
     const XrSwapchainImageBaseHeader *const swapchainImage =
         m_swapchainImages[viewSwapchain.handle][swapchainImageIndex];
-    m_graphicsPlugin->RenderView(projectionLayerViews[i], swapchainImage,
-                                 m_colorSwapchainFormat, cubes);
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::RenderView);
+      if (m_renderPackets) {
+        m_graphicsPlugin->RenderPacketViews(packet, i, 1, swapchainImage,
+                                            m_colorSwapchainFormat);
+      } else {
+        m_graphicsPlugin->RenderView(projectionLayerViews[i], swapchainImage,
+                                     m_colorSwapchainFormat, cubes);
+      }
+    }
 
     XrSwapchainImageReleaseInfo releaseInfo{
         XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
-    CHECK_XRCMD(xrReleaseSwapchainImage(viewSwapchain.handle, &releaseInfo));
+    {
+      ScopedFramePhase phase(m_frameStats, FramePhase::ReleaseImage);
+      CHECK_XRCMD(
+          xrReleaseSwapchainImage(viewSwapchain.handle, &releaseInfo));
+    }
   }
 
   layer.space = m_appSpace;
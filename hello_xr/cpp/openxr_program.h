@@ -6,10 +6,16 @@
 #include "pch.h"
 #include "openxr_program.h"
 #include "common.h"
+#include "frame_arena.h"
+#include "frame_pipeline.h"
+#include "frame_stats.h"
 #include "graphicsplugin.h"
+#include "job_system.h"
 #include "options.h"
 #include "platformdata.h"
 #include "platformplugin.h"
+#include "render_packet.h"
+#include "space_locator.h"
 
 
 struct Swapchain {
@@ -40,6 +46,10 @@ struct OpenXrProgram {
   XrEnvironmentBlendMode GetPreferredBlendMode() const;
   void InitializeSystem();
   void InitializeDevice();
+  // Job system the transforms of a frame's render packet are spread over.
+  void SetJobSystem(const std::shared_ptr<JobSystem> &jobSystem) {
+    m_jobSystem = jobSystem;
+  }
   void LogReferenceSpaces();
   struct InputState {
     XrActionSet actionSet{XR_NULL_HANDLE};
@@ -70,12 +80,31 @@ struct OpenXrProgram {
   }
   void PollActions();
   void RenderFrame();
+  // Ask the runtime to end the session, as the quit action does.
+  void RequestExitSession();
+  // Locate every visualized space and hand at the predicted display time.
+  void LocateCubes(XrTime predictedDisplayTime, std::vector<Cube> &cubes);
+  // xrBeginFrame, render the cubes if the frame should be rendered, and
+  // xrEndFrame.
+  void SubmitFrame(const XrFrameState &frameState,
+                   const std::vector<Cube> &cubes);
   bool RenderLayer(
-      XrTime predictedDisplayTime,
-      std::vector<XrCompositionLayerProjectionView> &projectionLayerViews,
+      XrTime predictedDisplayTime, const std::vector<Cube> &cubes,
+      ArenaVector<XrCompositionLayerProjectionView> &projectionLayerViews,
       XrCompositionLayerProjection &layer);
 
 private:
+  void SyncActions();
+  void StartFramePipeline();
+  void StopFramePipeline();
+  void RenderPipelinedFrame();
+  // Gather the GPU timings the graphics plugin has finished measuring and log
+  // their averages every few seconds.
+  void UpdateGpuTimings();
+  // Gather the graphics plugin's counters of rendered frames and log their
+  // averages every few seconds.
+  void UpdateFrameCounters();
+
   const std::shared_ptr<const Options> m_options;
   std::shared_ptr<IPlatformPlugin> m_platformPlugin;
   std::shared_ptr<IGraphicsPlugin> m_graphicsPlugin;
@@ -86,13 +115,33 @@ private:
 
   std::vector<XrViewConfigurationView> m_configViews;
   std::vector<Swapchain> m_swapchains;
+  // True when all views render in one pass into layers of m_swapchains[0].
+  bool m_multiview{false};
   std::map<XrSwapchain, std::vector<XrSwapchainImageBaseHeader *>>
       m_swapchainImages;
   std::vector<XrView> m_views;
   int64_t m_colorSwapchainFormat{-1};
 
+  // True when the graphics plugin renders from a RenderPacket, whose
+  // view-projection transforms are built for m_renderPacketProjection.
+  bool m_renderPackets{false};
+  GraphicsAPI m_renderPacketProjection{GRAPHICS_VULKAN};
+  RenderPacketBuilder m_packetBuilder;
+  std::shared_ptr<JobSystem> m_jobSystem;
+
   std::vector<XrSpace> m_visualizedSpaces;
 
+  // Locates m_visualizedSpaces (indices [0, m_visualizedSpaces.size())) and
+  // the hand spaces in one batch per frame.
+  SpaceLocator m_spaceLocator;
+  std::array<uint32_t, Side::COUNT> m_handLocatorIndex;
+  bool m_locateSpacesEnabled{false};
+
+  // Latency of each phase of the frame loop, written to
+  // Options::FrameStatsFile.
+  FrameStats m_frameStats;
+  bool m_timeConversionEnabled{false};
+
   // Application's current lifecycle state according to the runtime
   XrSessionState m_sessionState{XR_SESSION_STATE_UNKNOWN};
   bool m_sessionRunning{false};
@@ -101,6 +150,66 @@ private:
   InputState m_input;
 
   const std::set<XrEnvironmentBlendMode> m_acceptableBlendModes;
+
+  // Only created when Options::FramePipelining is set.
+  std::unique_ptr<FramePipeline> m_framePipeline;
+  uint64_t m_lastPipelineLogTime{0};
+
+  // Per-frame scratch memory for the submit path, so steady-state frames do not
+  // touch the heap.
+  FrameArena m_frameArena{16 * 1024};
+  std::vector<Cube> m_cubes;
+  // Options::GridCubes cubes, added to every frame's cubes.
+  const std::vector<Cube> m_gridCubes;
+  uint64_t m_lastFrameAllocations{0};
+
+  // Average and maximum of a GPU duration since it was last logged.
+  struct GpuTimingStats {
+    uint32_t count{0};
+    double totalMs{0.0};
+    double maxMs{0.0};
+
+    void Add(double ms) {
+      count++;
+      totalMs += ms;
+      maxMs = std::max(maxMs, ms);
+    }
+  };
+  uint64_t m_gpuFrameIndex{0};
+  std::vector<GpuFrameTiming> m_gpuTimings;
+  GpuTimingStats m_gpuFrameStats;
+  // Timings of a pass, keyed by its static name and the views it rendered.
+  struct GpuPassStats {
+    const char *pass;
+    uint32_t firstView;
+    uint32_t viewCount;
+    GpuTimingStats stats;
+  };
+  // In the order first seen. Entries are kept when the stats are logged and
+  // reset, so the vector stops growing once every pass has been seen.
+  std::vector<GpuPassStats> m_gpuPassStats;
+  uint64_t m_lastGpuTimingLogTime{0};
+
+  // Sums and maxima of the graphics plugin's frame counters since they were
+  // last logged.
+  struct FrameCounterStats {
+    uint32_t frames{0};
+    GraphicsFrameCounters total{};
+    GraphicsFrameCounters max{};
+
+    void Add(const GraphicsFrameCounters &counters) {
+      frames++;
+      total.Draws += counters.Draws;
+      total.StateChanges += counters.StateChanges;
+      total.UploadBytes += counters.UploadBytes;
+      max.Draws = std::max(max.Draws, counters.Draws);
+      max.StateChanges = std::max(max.StateChanges, counters.StateChanges);
+      max.UploadBytes = std::max(max.UploadBytes, counters.UploadBytes);
+    }
+  };
+  std::vector<GraphicsFrameCounters> m_frameCounters;
+  FrameCounterStats m_frameCounterStats;
+  uint64_t m_lastFrameCounterLogTime{0};
 };
 
 std::shared_ptr<OpenXrProgram>
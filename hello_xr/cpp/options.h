@@ -63,6 +63,55 @@ struct Options {
 
     std::string AppSpace{"Local"};
 
+    // Overlap xrWaitFrame, simulation and render/submit of consecutive frames on separate threads.
+    bool FramePipelining{false};
+
+    // Render all views in one pass into a single texture-array swapchain, if the graphics plugin supports it.
+    bool Multiview{false};
+
+    // Number of frames the graphics plugin may record ahead of the GPU before it waits for the oldest one to finish.
+    uint32_t FramesInFlight{2};
+
+    // Frustum cull instances on the GPU and draw the visible ones indirectly, if the graphics plugin supports it. May be
+    // toggled while running.
+    bool GpuCulling{false};
+
+    // Directory where the graphics plugin keeps shader and pipeline caches between runs. Empty disables the caches.
+    std::string CacheDirectory;
+
+    // Samples per pixel, for graphics plugins that can multisample in tile memory and resolve without a separate pass.
+    uint32_t MsaaSamples{1};
+
+    // Do not clear color before rendering a view, if the graphics plugin supports it. Only correct when the scene covers
+    // every pixel of the view.
+    bool SkipClear{false};
+
+    // File that a summary of the frame phase latencies is appended to every few seconds: JSON lines if the name ends in
+    // ".json", CSV otherwise. Empty only logs the summary.
+    std::string FrameStatsFile;
+
+    // File that the trace zones recorded while running are written to on exit, in the Chrome trace event format. Empty
+    // records nothing. Needs a build with ENABLE_TRACE_ZONES.
+    std::string TraceFile;
+
+    // Write log messages below Error from a background thread, so logging never waits on output.
+    bool AsyncLog{false};
+
+    // Worker threads of the job system that spreads CPU work of a frame. With 0 the threads that wait for jobs run
+    // them. Defaults to one per hardware thread besides the main thread.
+    uint32_t JobWorkers{std::max(std::thread::hardware_concurrency(), 1u) - 1};
+
+    // Record the draws of a view on the job system's workers into secondary command buffers, if the graphics plugin
+    // supports it.
+    bool ParallelRecording{false};
+
+    // Measure the CPU cost of this many frames of the frame loop after a warm-up, log it and exit. 0 runs until quit.
+    uint32_t BenchmarkFrames{0};
+
+    // Draw this many more cubes, on a grid in front of the app space origin, to load the render path with e.g. the Null
+    // graphics plugin.
+    uint32_t GridCubes{0};
+
     struct {
         XrFormFactor FormFactor{XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY};
 
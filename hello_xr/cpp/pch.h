@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdarg>
 #include <cstdio>
@@ -107,6 +108,52 @@
 //
 // OpenXR Headers
 //
+// For XR_KHR_convert_timespec_time; Windows converts from QueryPerformanceCounter instead.
+#if !defined(XR_USE_PLATFORM_WIN32) && !defined(XR_USE_TIMESPEC)
+#define XR_USE_TIMESPEC
+#endif
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 #include <openxr/openxr_reflection.h>
+
+// XR_KHR_locate_spaces first shipped in the OpenXR 1.0.34 headers. Declare it when building against older ones so the
+// batched space location path, and the mock runtime's implementation of it, are always compiled.
+#ifndef XR_KHR_locate_spaces
+#define XR_KHR_locate_spaces 1
+#define XR_KHR_locate_spaces_SPEC_VERSION 1
+#define XR_KHR_LOCATE_SPACES_EXTENSION_NAME "XR_KHR_locate_spaces"
+constexpr XrStructureType XR_TYPE_SPACES_LOCATE_INFO_KHR = (XrStructureType)1000471000;
+constexpr XrStructureType XR_TYPE_SPACE_LOCATIONS_KHR = (XrStructureType)1000471001;
+constexpr XrStructureType XR_TYPE_SPACE_VELOCITIES_KHR = (XrStructureType)1000471002;
+typedef struct XrSpacesLocateInfoKHR {
+    XrStructureType type;
+    const void* XR_MAY_ALIAS next;
+    XrSpace baseSpace;
+    XrTime time;
+    uint32_t spaceCount;
+    const XrSpace* spaces;
+} XrSpacesLocateInfoKHR;
+typedef struct XrSpaceLocationDataKHR {
+    XrSpaceLocationFlags locationFlags;
+    XrPosef pose;
+} XrSpaceLocationDataKHR;
+typedef struct XrSpaceLocationsKHR {
+    XrStructureType type;
+    void* XR_MAY_ALIAS next;
+    uint32_t locationCount;
+    XrSpaceLocationDataKHR* locations;
+} XrSpaceLocationsKHR;
+typedef struct XrSpaceVelocityDataKHR {
+    XrSpaceVelocityFlags velocityFlags;
+    XrVector3f linearVelocity;
+    XrVector3f angularVelocity;
+} XrSpaceVelocityDataKHR;
+typedef struct XrSpaceVelocitiesKHR {
+    XrStructureType type;
+    void* XR_MAY_ALIAS next;
+    uint32_t velocityCount;
+    XrSpaceVelocityDataKHR* velocities;
+} XrSpaceVelocitiesKHR;
+typedef XrResult(XRAPI_PTR* PFN_xrLocateSpacesKHR)(XrSession session, const XrSpacesLocateInfoKHR* locateInfo,
+                                                   XrSpaceLocationsKHR* spaceLocations);
+#endif
@@ -0,0 +1,54 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "render_packet.h"
+#include "job_system.h"
+#include "trace.h"
+
+RenderPacket RenderPacketBuilder::Build(uint64_t frame, const XrCompositionLayerProjectionView* layerViews, uint32_t viewCount,
+                                        GraphicsAPI projectionApi, const std::vector<Cube>& cubes, JobSystem* jobSystem) {
+    TRACE_ZONE("BuildRenderPacket");
+    if (m_viewProjections.size() < viewCount) {
+        m_viewProjections.resize(viewCount);
+    }
+    for (uint32_t i = 0; i < viewCount; i++) {
+        const XrPosef& pose = layerViews[i].pose;
+        XrMatrix4x4f proj;
+        XrMatrix4x4f_CreateProjectionFov(&proj, projectionApi, layerViews[i].fov, 0.05f, 100.0f);
+        XrMatrix4x4f toView;
+        XrVector3f scale{1.f, 1.f, 1.f};
+        XrMatrix4x4f_CreateTranslationRotationScale(&toView, &pose.position, &pose.orientation, &scale);
+        XrMatrix4x4f view;
+        XrMatrix4x4f_InvertRigidBody(&view, &toView);
+        XrMatrix4x4f_Multiply(&m_viewProjections[i], &proj, &view);
+    }
+
+    const uint32_t cubeCount = (uint32_t)cubes.size();
+    if (m_models.size() < cubeCount) {
+        m_models.resize(cubeCount);
+    }
+    XrMatrix4x4f* models = m_models.data();
+    const auto writeModels = [&](uint32_t begin, uint32_t end) {
+        XrMatrix4x4f_CreateModelViewProjectionBatch(&models[begin], nullptr, &cubes[begin].Pose, sizeof(Cube),
+                                                    &cubes[begin].Scale, sizeof(Cube), end - begin);
+    };
+    // The batch transforms several cubes at a time with SIMD, so each job takes a few thousand.
+    constexpr uint32_t modelsPerJob = 2048;
+    if (jobSystem != nullptr) {
+        jobSystem->ParallelFor(cubeCount, modelsPerJob, writeModels);
+    } else if (cubeCount > 0) {
+        writeModels(0, cubeCount);
+    }
+
+    RenderPacket packet{};
+    packet.Frame = frame;
+    packet.LayerViews = layerViews;
+    packet.ViewProjections = m_viewProjections.data();
+    packet.ViewCount = viewCount;
+    packet.Models = models;
+    packet.ModelCount = cubeCount;
+    return packet;
+}
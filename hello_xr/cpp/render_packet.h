@@ -0,0 +1,32 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+#include "graphicsplugin.h"
+
+struct JobSystem;
+
+// Builds RenderPackets: the view-projection transform of every view and the model transform of every cube. Storage only
+// grows, so steady-state frames do not touch the heap. A packet points into the builder and is valid until the next
+// Build.
+struct RenderPacketBuilder {
+    // projectionApi selects the clip space of the view-projection transforms. With a job system the cubes are transformed
+    // in parallel.
+    RenderPacket Build(uint64_t frame, const XrCompositionLayerProjectionView* layerViews, uint32_t viewCount,
+                       GraphicsAPI projectionApi, const std::vector<Cube>& cubes, JobSystem* jobSystem = nullptr);
+
+    // Build a packet of a single view, for plugins to implement RenderView with RenderPacketViews. Its frames count down
+    // from the top of the range, so they never match a frame of BeginGpuFrame and the models are uploaded every time.
+    RenderPacket BuildView(const XrCompositionLayerProjectionView& layerView, GraphicsAPI projectionApi,
+                           const std::vector<Cube>& cubes) {
+        return Build(--m_viewFrame, &layerView, 1, projectionApi, cubes);
+    }
+
+   private:
+    uint64_t m_viewFrame{UINT64_MAX};
+    std::vector<XrMatrix4x4f> m_viewProjections;
+    std::vector<XrMatrix4x4f> m_models;
+};
@@ -0,0 +1,109 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "space_locator.h"
+
+bool SpaceLocator::IsExtensionAvailable() {
+    const char* extensionName = ExtensionName();
+    uint32_t extensionCount;
+    CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionCount, nullptr));
+    std::vector<XrExtensionProperties> extensions(extensionCount, {XR_TYPE_EXTENSION_PROPERTIES});
+    CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, (uint32_t)extensions.size(), &extensionCount, extensions.data()));
+    return std::any_of(extensions.begin(), extensions.end(),
+                       [&](const XrExtensionProperties& extension) { return strcmp(extension.extensionName, extensionName) == 0; });
+}
+
+const char* SpaceLocator::ExtensionName() { return XR_KHR_LOCATE_SPACES_EXTENSION_NAME; }
+
+void SpaceLocator::Initialize(XrInstance instance, XrSession session, bool extensionEnabled) {
+    CHECK(session != XR_NULL_HANDLE);
+    m_session = session;
+    m_xrLocateSpacesKHR = nullptr;
+
+    if (extensionEnabled) {
+        CHECK_XRCMD(xrGetInstanceProcAddr(instance, "xrLocateSpacesKHR", &m_xrLocateSpacesKHR));
+    }
+
+    Log::Write(Log::Level::Info,
+               Fmt("Space location: %s", IsBatched() ? "batched (XR_KHR_locate_spaces)" : "per-space xrLocateSpace"));
+}
+
+void SpaceLocator::Reserve(uint32_t capacity) {
+    m_spaces.reserve(capacity);
+    m_orientations.reserve(capacity);
+    m_positions.reserve(capacity);
+    m_locationFlags.reserve(capacity);
+    m_results.reserve(capacity);
+    m_batchLocations.reserve(capacity);
+}
+
+uint32_t SpaceLocator::AddSpace(XrSpace space) {
+    m_spaces.push_back(space);
+    m_orientations.push_back({0, 0, 0, 1});
+    m_positions.push_back({0, 0, 0});
+    m_locationFlags.push_back(0);
+    m_results.push_back(XR_ERROR_VALIDATION_FAILURE);
+    m_batchLocations.push_back({});
+    return (uint32_t)m_spaces.size() - 1;
+}
+
+void SpaceLocator::Clear() {
+    m_spaces.clear();
+    m_orientations.clear();
+    m_positions.clear();
+    m_locationFlags.clear();
+    m_results.clear();
+    m_batchLocations.clear();
+}
+
+void SpaceLocator::Locate(XrSpace baseSpace, XrTime time) {
+    if (m_spaces.empty()) {
+        return;
+    }
+
+    if (IsBatched()) {
+        LocateBatched(baseSpace, time);
+    } else {
+        LocateEach(baseSpace, time);
+    }
+}
+
+void SpaceLocator::LocateBatched(XrSpace baseSpace, XrTime time) {
+    XrSpacesLocateInfoKHR locateInfo{XR_TYPE_SPACES_LOCATE_INFO_KHR};
+    locateInfo.baseSpace = baseSpace;
+    locateInfo.time = time;
+    locateInfo.spaceCount = (uint32_t)m_spaces.size();
+    locateInfo.spaces = m_spaces.data();
+
+    XrSpaceLocationsKHR spaceLocations{XR_TYPE_SPACE_LOCATIONS_KHR};
+    spaceLocations.locationCount = (uint32_t)m_batchLocations.size();
+    spaceLocations.locations = m_batchLocations.data();
+
+    const auto xrLocateSpacesKHR = reinterpret_cast<PFN_xrLocateSpacesKHR>(m_xrLocateSpacesKHR);
+    XrResult res = xrLocateSpacesKHR(m_session, &locateInfo, &spaceLocations);
+    CHECK_XRRESULT(res, "xrLocateSpacesKHR");
+
+    for (size_t i = 0; i < m_spaces.size(); i++) {
+        // A qualified success (e.g. session loss pending) applies to the whole batch.
+        m_results[i] = res;
+        m_locationFlags[i] = XR_UNQUALIFIED_SUCCESS(res) ? m_batchLocations[i].locationFlags : 0;
+        m_orientations[i] = m_batchLocations[i].pose.orientation;
+        m_positions[i] = m_batchLocations[i].pose.position;
+    }
+}
+
+void SpaceLocator::LocateEach(XrSpace baseSpace, XrTime time) {
+    for (size_t i = 0; i < m_spaces.size(); i++) {
+        XrSpaceLocation spaceLocation{XR_TYPE_SPACE_LOCATION};
+        XrResult res = xrLocateSpace(m_spaces[i], baseSpace, time, &spaceLocation);
+        CHECK_XRRESULT(res, "xrLocateSpace");
+
+        m_results[i] = res;
+        m_locationFlags[i] = XR_UNQUALIFIED_SUCCESS(res) ? spaceLocation.locationFlags : 0;
+        m_orientations[i] = spaceLocation.pose.orientation;
+        m_positions[i] = spaceLocation.pose.position;
+    }
+}
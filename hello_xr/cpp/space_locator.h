@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+// Locates a fixed set of spaces against one base space in a single batch.
+// With XR_KHR_locate_spaces every space is located by one xrLocateSpacesKHR call; otherwise it falls back to one
+// xrLocateSpace call per space. Results land in a structure-of-arrays buffer that is sized once by Reserve/AddSpace and
+// reused every frame, so Locate() performs no allocation.
+struct SpaceLocator {
+    // True if the runtime exposes XR_KHR_locate_spaces, i.e. it is worth enabling at instance creation.
+    static bool IsExtensionAvailable();
+    // Name of the extension to enable.
+    static const char* ExtensionName();
+
+    // Bind to a session. extensionEnabled must only be true if ExtensionName() was enabled on the instance.
+    void Initialize(XrInstance instance, XrSession session, bool extensionEnabled);
+
+    void Reserve(uint32_t capacity);
+    // Register a space and return its index in the pose buffer.
+    uint32_t AddSpace(XrSpace space);
+    void Clear();
+
+    // Locate every registered space in baseSpace at time.
+    void Locate(XrSpace baseSpace, XrTime time);
+
+    bool IsBatched() const { return m_xrLocateSpacesKHR != nullptr; }
+    uint32_t Count() const { return (uint32_t)m_spaces.size(); }
+
+    // Result of locating space i. Anything but XR_SUCCESS means the pose is unusable.
+    XrResult Result(uint32_t i) const { return m_results[i]; }
+    // True if space i was located with both a valid position and orientation.
+    bool IsPoseValid(uint32_t i) const {
+        constexpr XrSpaceLocationFlags validFlags = XR_SPACE_LOCATION_POSITION_VALID_BIT | XR_SPACE_LOCATION_ORIENTATION_VALID_BIT;
+        return m_results[i] == XR_SUCCESS && (m_locationFlags[i] & validFlags) == validFlags;
+    }
+    XrPosef Pose(uint32_t i) const { return XrPosef{m_orientations[i], m_positions[i]}; }
+
+    const std::vector<XrQuaternionf>& Orientations() const { return m_orientations; }
+    const std::vector<XrVector3f>& Positions() const { return m_positions; }
+    const std::vector<XrSpaceLocationFlags>& LocationFlags() const { return m_locationFlags; }
+
+   private:
+    void LocateBatched(XrSpace baseSpace, XrTime time);
+    void LocateEach(XrSpace baseSpace, XrTime time);
+
+    XrSession m_session{XR_NULL_HANDLE};
+    PFN_xrVoidFunction m_xrLocateSpacesKHR{nullptr};
+
+    std::vector<XrSpace> m_spaces;
+
+    // Structure-of-arrays pose buffer, one entry per registered space.
+    std::vector<XrQuaternionf> m_orientations;
+    std::vector<XrVector3f> m_positions;
+    std::vector<XrSpaceLocationFlags> m_locationFlags;
+    std::vector<XrResult> m_results;
+
+    // Output array for xrLocateSpacesKHR, scattered into the buffers above.
+    std::vector<XrSpaceLocationDataKHR> m_batchLocations;
+};
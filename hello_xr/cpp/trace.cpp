@@ -0,0 +1,153 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include "pch.h"
+#include "common.h"
+#include "trace.h"
+
+#if defined(ENABLE_TRACE_ZONES)
+
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include <utils/threading.h>
+
+namespace Trace {
+std::atomic<bool> g_recording{false};
+
+namespace {
+struct Event {
+    const char* name;
+    ksNanoseconds start;
+    ksNanoseconds duration;
+};
+
+// The zones one thread recorded. Only the owning thread writes events, and only while writing is raised. Stop clears
+// g_recording and then waits for writing to drop on every buffer, so once it reads a buffer no zone is being written to
+// it and every later zone sees g_recording cleared.
+struct ThreadBuffer {
+    static constexpr uint64_t Capacity = 64 * 1024;
+
+    uint32_t id{0};
+    std::string name;
+    std::unique_ptr<Event[]> events{new Event[Capacity]};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint32_t> writing{0};
+};
+
+// Guards the list of buffers, their names and the output path. Buffers live until the process exits, since their
+// threads keep pointers to them.
+std::mutex g_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+std::string g_path;
+
+thread_local ThreadBuffer* t_buffer{nullptr};
+thread_local const char* t_threadName{nullptr};
+
+ThreadBuffer* GetThreadBuffer() {
+    if (t_buffer == nullptr) {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        std::lock_guard<std::mutex> lock(g_mutex);
+        buffer->id = (uint32_t)g_buffers.size() + 1;
+        buffer->name = t_threadName != nullptr ? t_threadName : Fmt("Thread %u", buffer->id);
+        t_buffer = buffer.get();
+        g_buffers.push_back(std::move(buffer));
+    }
+    return t_buffer;
+}
+}  // namespace
+
+void Start(const std::string& path) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_path = path;
+    g_recording = true;
+    Log::Write(Log::Level::Info, Fmt("Recording trace zones to %s", g_path.c_str()));
+}
+
+void Stop() {
+    if (!g_recording.exchange(false)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    // Zones ending right now may have seen g_recording before it was cleared; let them finish.
+    for (const std::unique_ptr<ThreadBuffer>& buffer : g_buffers) {
+        while (buffer->writing.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::ofstream file(g_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        Log::Write(Log::Level::Warning, Fmt("Failed to write trace to %s", g_path.c_str()));
+        return;
+    }
+
+    // Zones are complete ("X") events with microsecond timestamps; a metadata event names each thread's track.
+    uint64_t written = 0;
+    uint64_t overwritten = 0;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    for (const std::unique_ptr<ThreadBuffer>& buffer : g_buffers) {
+        file << separator
+             << Fmt("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", buffer->id,
+                    buffer->name.c_str());
+        separator = ",\n";
+
+        const uint64_t count = buffer->count.load(std::memory_order_relaxed);
+        const uint64_t first = count > ThreadBuffer::Capacity ? count - ThreadBuffer::Capacity : 0;
+        for (uint64_t i = first; i < count; i++) {
+            const Event& event = buffer->events[i % ThreadBuffer::Capacity];
+            file << separator
+                 << Fmt("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.name, buffer->id,
+                        event.start * 1e-3, event.duration * 1e-3);
+        }
+        written += count - first;
+        overwritten += first;
+    }
+    file << "\n]}\n";
+
+    Log::Write(Log::Level::Info, Fmt("Wrote %llu trace zones from %zu threads to %s (%llu older zones overwritten)",
+                                     (unsigned long long)written, g_buffers.size(), g_path.c_str(),
+                                     (unsigned long long)overwritten));
+}
+
+void SetThreadName(const char* name) {
+    t_threadName = name;
+    ksThread_SetName(name);
+    if (t_buffer != nullptr) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        t_buffer->name = name;
+    }
+}
+
+void Zone::End() {
+    const ksNanoseconds end = GetTimeNanoseconds();
+    ThreadBuffer* buffer = GetThreadBuffer();
+
+    // Raise writing before checking g_recording; Stop clears g_recording before checking writing. Both are sequentially
+    // consistent, so either Stop waits for this zone or this zone sees that recording stopped and is dropped.
+    buffer->writing.fetch_add(1);
+    if (g_recording.load()) {
+        const uint64_t index = buffer->count.load(std::memory_order_relaxed);
+        buffer->events[index % ThreadBuffer::Capacity] = {m_name, m_start, end - m_start};
+        buffer->count.store(index + 1, std::memory_order_relaxed);
+    }
+    buffer->writing.fetch_sub(1, std::memory_order_release);
+}
+}  // namespace Trace
+
+#else
+
+namespace Trace {
+void Start(const std::string& path) {
+    Log::Write(Log::Level::Warning,
+               Fmt("Not tracing to %s: this build was made without ENABLE_TRACE_ZONES", path.c_str()));
+}
+
+void Stop() {}
+}  // namespace Trace
+
+#endif
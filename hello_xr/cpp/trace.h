@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "pch.h"
+
+#include <utils/nanoseconds.h>
+
+// Scoped-zone profiler that writes the Chrome trace-event JSON format, for chrome://tracing or ui.perfetto.dev.
+//
+// TRACE_ZONE("Name") times the rest of the enclosing scope. Each thread records its zones into a ring buffer of its own,
+// without locks; only a thread's first zone after Trace::Start takes a lock, to register its buffer. When a ring is full
+// the oldest zones are overwritten. Trace::Stop writes the zones of every thread to the file given to Trace::Start, with
+// one track per thread labelled by TRACE_THREAD_NAME.
+//
+// Zones are only compiled in with ENABLE_TRACE_ZONES defined; otherwise both macros expand to nothing. Compiled in,
+// a zone costs one atomic load until recording is started (--trace <file>).
+#if defined(ENABLE_TRACE_ZONES)
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// name must be a string literal or otherwise outlive the trace.
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+// Label the calling thread's track, and name the thread for debuggers through ksThread_SetName.
+#define TRACE_THREAD_NAME(name) Trace::SetThreadName(name)
+#else
+#define TRACE_ZONE(name) (void)0
+#define TRACE_THREAD_NAME(name) (void)0
+#endif
+
+namespace Trace {
+// Start recording zones, to be written to path by Stop. Logs a warning if zones were not compiled in.
+void Start(const std::string& path);
+
+// Stop recording and write everything recorded to the file given to Start.
+void Stop();
+
+#if defined(ENABLE_TRACE_ZONES)
+extern std::atomic<bool> g_recording;
+
+void SetThreadName(const char* name);
+
+struct Zone {
+    explicit Zone(const char* name) : m_name(name), m_recording(g_recording.load(std::memory_order_relaxed)) {
+        if (m_recording) {
+            m_start = GetTimeNanoseconds();
+        }
+    }
+    ~Zone() {
+        if (m_recording) {
+            End();
+        }
+    }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+   private:
+    void End();
+
+    const char* const m_name;
+    const bool m_recording;
+    ksNanoseconds m_start{0};
+};
+#endif
+}  // namespace Trace
@@ -0,0 +1,71 @@
+// Copyright (c) 2017-2022, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+#version 450
+
+#pragma compute
+
+// Frustum culling of cube instances. Each invocation tests one instance's bounding sphere against the frusta of the
+// rendered views. Visible instances are appended to a compacted list and counted into an indirect draw command.
+
+layout (local_size_x = 64) in;
+
+layout (std140, binding = 0) uniform CullParams
+{
+    // Six inward facing, normalized planes per view. With a single view the second set repeats the first.
+    vec4 planes[12];
+    // Bounding sphere radius of an unscaled instance.
+    float radius;
+    uint instanceCount;
+} params;
+
+layout (std430, binding = 1) readonly buffer Instances
+{
+    mat4 models[];
+} instances;
+
+layout (std430, binding = 2) writeonly buffer VisibleInstances
+{
+    mat4 models[];
+} visible;
+
+layout (std430, binding = 3) buffer DrawCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+} draw;
+
+float PlaneDistance(int plane, vec3 point)
+{
+    return dot(params.planes[plane].xyz, point) + params.planes[plane].w;
+}
+
+// True if a sphere is at least partly inside the six planes starting at first.
+bool InsideFrustum(int first, vec3 center, float radius)
+{
+    float d = min(min(min(PlaneDistance(first, center), PlaneDistance(first + 1, center)),
+                      min(PlaneDistance(first + 2, center), PlaneDistance(first + 3, center))),
+                  min(PlaneDistance(first + 4, center), PlaneDistance(first + 5, center)));
+    return d >= -radius;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index < params.instanceCount)
+    {
+        mat4 model = instances.models[index];
+        vec3 center = model[3].xyz;
+        float radius = params.radius * max(max(length(model[0].xyz), length(model[1].xyz)), length(model[2].xyz));
+        bool inside0 = InsideFrustum(0, center, radius);
+        bool inside1 = InsideFrustum(6, center, radius);
+        if (inside0 || inside1)
+        {
+            uint slot = atomicAdd(draw.instanceCount, 1u);
+            visible.models[slot] = model;
+        }
+    }
+}